@@ -12,6 +12,9 @@ HEADERS += opmapcontrol.h \
            src/core/diagnostics.h \
            src/core/geodecoderstatus.h \
            src/core/kibertilecache.h \
+           src/core/decodedtilecache.h \
+           src/core/tilepack.h \
+           src/core/tiledownloader.h \
            src/core/languagetype.h \
            src/core/maptype.h \
            src/core/memorycache.h \
@@ -37,6 +40,7 @@ HEADERS += opmapcontrol.h \
            src/internals/sizelatlng.h \
            src/internals/tile.h \
            src/internals/tilematrix.h \
+           src/internals/tileprefetcher.h \
            src/mapwidget/configuration.h \
            src/mapwidget/gpsitem.h \
            src/mapwidget/homeitem.h \
@@ -44,6 +48,7 @@ HEADERS += opmapcontrol.h \
            src/mapwidget/mapripform.h \
            src/mapwidget/mapripper.h \
            src/mapwidget/opmapwidget.h \
+           src/mapwidget/tilepackexporter.h \
            src/mapwidget/trailitem.h \
            src/mapwidget/traillineitem.h \
            src/mapwidget/uavitem.h \
@@ -62,6 +67,9 @@ SOURCES += src/core/alllayersoftype.cpp \
            src/core/cacheitemqueue.cpp \
            src/core/diagnostics.cpp \
            src/core/kibertilecache.cpp \
+           src/core/decodedtilecache.cpp \
+           src/core/tilepack.cpp \
+           src/core/tiledownloader.cpp \
            src/core/languagetype.cpp \
            src/core/memorycache.cpp \
            src/core/opmaps.cpp \
@@ -84,6 +92,7 @@ SOURCES += src/core/alllayersoftype.cpp \
            src/internals/sizelatlng.cpp \
            src/internals/tile.cpp \
            src/internals/tilematrix.cpp \
+           src/internals/tileprefetcher.cpp \
            src/mapwidget/configuration.cpp \
            src/mapwidget/gpsitem.cpp \
            src/mapwidget/homeitem.cpp \
@@ -91,6 +100,7 @@ SOURCES += src/core/alllayersoftype.cpp \
            src/mapwidget/mapripform.cpp \
            src/mapwidget/mapripper.cpp \
            src/mapwidget/opmapwidget.cpp \
+           src/mapwidget/tilepackexporter.cpp \
            src/mapwidget/trailitem.cpp \
            src/mapwidget/traillineitem.cpp \
            src/mapwidget/uavitem.cpp \
@@ -18,6 +18,9 @@ HEADERS += libs/opmapcontrol/opmapcontrol.h \
            libs/opmapcontrol/src/core/diagnostics.h \
            libs/opmapcontrol/src/core/geodecoderstatus.h \
            libs/opmapcontrol/src/core/kibertilecache.h \
+           libs/opmapcontrol/src/core/decodedtilecache.h \
+           libs/opmapcontrol/src/core/tilepack.h \
+           libs/opmapcontrol/src/core/tiledownloader.h \
            libs/opmapcontrol/src/core/languagetype.h \
            libs/opmapcontrol/src/core/maptype.h \
            libs/opmapcontrol/src/core/memorycache.h \
@@ -43,12 +46,14 @@ HEADERS += libs/opmapcontrol/opmapcontrol.h \
            libs/opmapcontrol/src/internals/sizelatlng.h \
            libs/opmapcontrol/src/internals/tile.h \
            libs/opmapcontrol/src/internals/tilematrix.h \
+           libs/opmapcontrol/src/internals/tileprefetcher.h \
            libs/opmapcontrol/src/mapwidget/gpsitem.h \
            libs/opmapcontrol/src/mapwidget/homeitem.h \
            libs/opmapcontrol/src/mapwidget/mapgraphicitem.h \
            libs/opmapcontrol/src/mapwidget/mapripform.h \
            libs/opmapcontrol/src/mapwidget/mapripper.h \
            libs/opmapcontrol/src/mapwidget/opmapwidget.h \
+           libs/opmapcontrol/src/mapwidget/tilepackexporter.h \
            libs/opmapcontrol/src/mapwidget/trailitem.h \
            libs/opmapcontrol/src/mapwidget/traillineitem.h \
            libs/opmapcontrol/src/mapwidget/uavitem.h \
@@ -68,6 +73,9 @@ SOURCES += libs/opmapcontrol/src/core/alllayersoftype.cpp \
            libs/opmapcontrol/src/core/cacheitemqueue.cpp \
            libs/opmapcontrol/src/core/diagnostics.cpp \
            libs/opmapcontrol/src/core/kibertilecache.cpp \
+           libs/opmapcontrol/src/core/decodedtilecache.cpp \
+           libs/opmapcontrol/src/core/tilepack.cpp \
+           libs/opmapcontrol/src/core/tiledownloader.cpp \
            libs/opmapcontrol/src/core/languagetype.cpp \
            libs/opmapcontrol/src/core/memorycache.cpp \
            libs/opmapcontrol/src/core/opmaps.cpp \
@@ -90,6 +98,7 @@ SOURCES += libs/opmapcontrol/src/core/alllayersoftype.cpp \
            libs/opmapcontrol/src/internals/sizelatlng.cpp \
            libs/opmapcontrol/src/internals/tile.cpp \
            libs/opmapcontrol/src/internals/tilematrix.cpp \
+           libs/opmapcontrol/src/internals/tileprefetcher.cpp \
            libs/opmapcontrol/src/mapwidget/configuration.cpp \
            libs/opmapcontrol/src/mapwidget/gpsitem.cpp \
            libs/opmapcontrol/src/mapwidget/homeitem.cpp \
@@ -97,6 +106,7 @@ SOURCES += libs/opmapcontrol/src/core/alllayersoftype.cpp \
            libs/opmapcontrol/src/mapwidget/mapripform.cpp \
            libs/opmapcontrol/src/mapwidget/mapripper.cpp \
            libs/opmapcontrol/src/mapwidget/opmapwidget.cpp \
+           libs/opmapcontrol/src/mapwidget/tilepackexporter.cpp \
            libs/opmapcontrol/src/mapwidget/trailitem.cpp \
            libs/opmapcontrol/src/mapwidget/traillineitem.cpp \
            libs/opmapcontrol/src/mapwidget/uavitem.cpp \
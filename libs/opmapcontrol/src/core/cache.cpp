@@ -44,12 +44,98 @@ namespace core {
         routeCache = cache + "RouteCache/";
         geoCache = cache + "GeocoderCache/";
         placemarkCache = cache + "PlacemarkCache/";
+        tilePackCache = cache + "TilePacks/";
         ImageCache.setGtileCache(value);
+
+        packLock.lockForWrite();
+        qDeleteAll(packs);
+        packs.clear();
+        packLock.unlock();
+        QDir dir(tilePackCache);
+        foreach(const QString &file,dir.entryList(QStringList()<<"*.tilepack",QDir::Files,QDir::Name))
+        {
+            MountTilePack(dir.filePath(file));
+        }
     }
     QString Cache::CacheLocation()
     {
         return cache;
     }
+    bool Cache::MountTilePack(const QString &file)
+    {
+        TilePack *pack=new TilePack;
+        if(!pack->Open(file))
+        {
+#ifdef DEBUG_CACHE
+            qDebug()<<"MountTilePack: Unable to open"<<file;
+#endif //DEBUG_CACHE
+            delete pack;
+            return false;
+        }
+        packLock.lockForWrite();
+        packs.append(pack);
+        packLock.unlock();
+        return true;
+    }
+    bool Cache::ImportTilePack(const QString &file)
+    {
+        QString target=tilePackCache+QFileInfo(file).fileName();
+        if(!target.endsWith(".tilepack"))
+            target+=".tilepack";
+        // A pack of the same name is replaced
+        packLock.lockForWrite();
+        for(int i=packs.count()-1;i>=0;--i)
+        {
+            if(QFileInfo(packs.at(i)->FileName())==QFileInfo(target))
+                delete packs.takeAt(i);
+        }
+        packLock.unlock();
+        if(QFileInfo(file)==QFileInfo(target))
+            return MountTilePack(target);
+        QFile::remove(target);
+        if(!QDir().mkpath(tilePackCache) || !QFile::copy(file,target))
+            return false;
+        return MountTilePack(target);
+    }
+    QStringList Cache::TilePacks()
+    {
+        QStringList ret;
+        packLock.lockForRead();
+        foreach(TilePack *pack,packs)
+        {
+            ret.append(pack->FileName());
+        }
+        packLock.unlock();
+        return ret;
+    }
+    bool Cache::TilePacksContain(const MapType::Types &type,const Point &pos,const int &zoom)
+    {
+        bool ret=false;
+        packLock.lockForRead();
+        foreach(TilePack *pack,packs)
+        {
+            if(pack->Contains(type,pos,zoom))
+            {
+                ret=true;
+                break;
+            }
+        }
+        packLock.unlock();
+        return ret;
+    }
+    QByteArray Cache::GetImageFromTilePacks(const MapType::Types &type,const Point &pos,const int &zoom)
+    {
+        QByteArray ret;
+        packLock.lockForRead();
+        foreach(TilePack *pack,packs)
+        {
+            ret=pack->GetTile(type,pos,zoom);
+            if(!ret.isEmpty())
+                break;
+        }
+        packLock.unlock();
+        return ret;
+    }
     Cache::Cache()
     {
         if(cache.isNull()|cache.isEmpty())
@@ -28,7 +28,10 @@
 #define CACHE_H
 
 #include "pureimagecache.h"
+#include "tilepack.h"
 #include "debugheader.h"
+#include <QReadWriteLock>
+#include <QStringList>
 
 namespace core {
     class Cache
@@ -47,6 +50,20 @@ namespace core {
         void CacheRoute(const QString &urlEnd,const QString &content);
         QString GetRouteFromCache(const QString &urlEnd);
 
+        /**
+        * @brief Mounts a tile pack, its tiles are served before the ones of the database.
+        *        All packs in the TilePacks folder of the cache location are mounted
+        *        when the cache location is set.
+        */
+        bool MountTilePack(const QString &file);
+        /**
+        * @brief Copies a tile pack into the TilePacks folder of the cache location and mounts it
+        */
+        bool ImportTilePack(const QString &file);
+        QStringList TilePacks();
+        bool TilePacksContain(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        QByteArray GetImageFromTilePacks(const MapType::Types &type,const core::Point &pos,const int &zoom);
+
     private:
         Cache();
         Cache(Cache const&){}
@@ -56,6 +73,9 @@ namespace core {
         QString routeCache;
         QString geoCache;
         QString placemarkCache;
+        QString tilePackCache;
+        QReadWriteLock packLock;
+        QList<TilePack*> packs;
     };
 
 }
@@ -16,6 +16,9 @@ SOURCES += opmaps.cpp \
     point.cpp \
     size.cpp \
     kibertilecache.cpp \
+    decodedtilecache.cpp \
+    tilepack.cpp \
+    tiledownloader.cpp \
     diagnostics.cpp
 HEADERS += opmaps.h \
     size.h \
@@ -36,5 +39,8 @@ HEADERS += opmaps.h \
     placemark.h \
     point.h \
     kibertilecache.h \
+    decodedtilecache.h \
+    tilepack.h \
+    tiledownloader.h \
     debugheader.h \
     diagnostics.h
@@ -0,0 +1,68 @@
+/**
+******************************************************************************
+*
+* @file       decodedtilecache.cpp
+* @author     APM_PLANNER Project, http://www.diydrones.com Copyright (C) 2016.
+* @brief      Byte budgeted LRU cache of decoded tiles
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/* 
+* This program is free software; you can redistribute it and/or modify 
+* it under the terms of the GNU General Public License as published by 
+* the Free Software Foundation; either version 3 of the License, or 
+* (at your option) any later version.
+* 
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License 
+* for more details.
+* 
+* You should have received a copy of the GNU General Public License along 
+* with this program; if not, write to the Free Software Foundation, Inc., 
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include "decodedtilecache.h"
+
+namespace core {
+    DecodedTileCache::DecodedTileCache()
+    {
+        // Enough for the visible tiles of a full screen map and some around it
+        setCapacity(64);
+    }
+
+    void DecodedTileCache::setCapacity(const int &value)
+    {
+        QMutexLocker locker(&mutex);
+        cache.setMaxCost(value*1048576);
+    }
+    int DecodedTileCache::Capacity()
+    {
+        QMutexLocker locker(&mutex);
+        return cache.maxCost()/1048576;
+    }
+    double DecodedTileCache::Size()
+    {
+        QMutexLocker locker(&mutex);
+        return cache.totalCost()/1048576.0;
+    }
+
+    QImage DecodedTileCache::GetTile(const RawTile &tile)
+    {
+        QMutexLocker locker(&mutex);
+        QImage *image=cache.object(tile);
+        return image?*image:QImage();
+    }
+    void DecodedTileCache::AddTile(const RawTile &tile, const QImage &image)
+    {
+        QMutexLocker locker(&mutex);
+        cache.insert(tile,new QImage(image),image.byteCount());
+    }
+    void DecodedTileCache::Clear()
+    {
+        QMutexLocker locker(&mutex);
+        cache.clear();
+    }
+}
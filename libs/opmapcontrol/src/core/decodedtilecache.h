@@ -0,0 +1,61 @@
+/**
+******************************************************************************
+*
+* @file       decodedtilecache.h
+* @author     APM_PLANNER Project, http://www.diydrones.com Copyright (C) 2016.
+* @brief      Byte budgeted LRU cache of decoded tiles
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/* 
+* This program is free software; you can redistribute it and/or modify 
+* it under the terms of the GNU General Public License as published by 
+* the Free Software Foundation; either version 3 of the License, or 
+* (at your option) any later version.
+* 
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License 
+* for more details.
+* 
+* You should have received a copy of the GNU General Public License along 
+* with this program; if not, write to the Free Software Foundation, Inc., 
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef DECODEDTILECACHE_H
+#define DECODEDTILECACHE_H
+
+#include "rawtile.h"
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+namespace core {
+    /**
+    * @brief Holds decoded tiles ready to be painted. The least recently used
+    *        tiles are dropped when the decoded size exceeds the capacity.
+    *        Tiles are decoded by the loader threads so painting never decodes.
+    */
+    class DecodedTileCache
+    {
+    public:
+        DecodedTileCache();
+        /**
+        * @brief Sets the memory used for decoded tiles
+        *
+        * @param value size in Mb
+        */
+        void setCapacity(const int &value);
+        int Capacity();
+        double Size();
+        QImage GetTile(const RawTile &tile);
+        void AddTile(const RawTile &tile, const QImage &image);
+        void Clear();
+    private:
+        QMutex mutex;
+        QCache<RawTile,QImage> cache;   // Cost of each tile is its size in bytes
+    };
+
+}
+#endif // DECODEDTILECACHE_H
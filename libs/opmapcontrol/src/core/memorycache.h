@@ -32,6 +32,7 @@
 #include <QReadWriteLock>
 #include <QQueue>
 #include "kibertilecache.h"
+#include "decodedtilecache.h"
 #include <QDebug>
 #include "debugheader.h"
 namespace core {
@@ -41,6 +42,7 @@ namespace core {
         MemoryCache();
 
         KiberTileCache TilesInMemory;
+        DecodedTileCache DecodedTiles;      // Decoded tiles ready to be painted
         QByteArray GetTileFromMemoryCache(const RawTile &tile);
         void AddTileToMemoryCache(const RawTile &tile, const QByteArray &pic);
         QReadWriteLock kiberCacheLock;
@@ -42,7 +42,8 @@ namespace core {
         Language=LanguageType::English;
         LanguageStr=LanguageType().toShortString(Language);
         Cache::Instance();
-
+        connect(&Downloader,SIGNAL(TileDownloaded(core::RawTile,QByteArray,int)),
+                this,SLOT(TileDownloaded(core::RawTile,QByteArray,int)),Qt::DirectConnection);
     }
 
 
@@ -53,15 +54,8 @@ namespace core {
 
 
 
-    QByteArray OPMaps::GetImageFrom(const MapType::Types &type,const Point &pos,const int &zoom)
+    QByteArray OPMaps::GetImageFromCache(const MapType::Types &type,const Point &pos,const int &zoom)
     {
-#ifdef DEBUG_TIMINGS
-        QTime time;
-        time.restart();
-#endif
-#ifdef DEBUG_GMAPS
-        qDebug()<<"Entered GetImageFrom";
-#endif //DEBUG_GMAPS
         QByteArray ret;
 
         if(useMemoryCache)
@@ -75,201 +69,226 @@ namespace core {
                 errorvars.lock();
                 ++diag.tilesFromMem;
                 errorvars.unlock();
+                return ret;
             }
-
         }
-        if(ret.isEmpty())
-        {
 #ifdef DEBUG_GMAPS
-            qDebug()<<"Tile not in memory";
+        qDebug()<<"Tile not in memory";
 #endif //DEBUG_GMAPS
-            if(accessmode != (AccessMode::ServerOnly))
+        if(accessmode != (AccessMode::ServerOnly))
+        {
+            // Tile packs are memory mapped, their tiles are not copied to the memory cache
+            ret=Cache::Instance()->GetImageFromTilePacks(type,pos,zoom);
+            if(!ret.isEmpty())
             {
+                errorvars.lock();
+                ++diag.tilesFromDB;
+                errorvars.unlock();
+                return ret;
+            }
 #ifdef DEBUG_GMAPS
-                qDebug()<<"Try tile from DataBase";
+            qDebug()<<"Try tile from DataBase";
 #endif //DEBUG_GMAPS
-                ret=Cache::Instance()->ImageCache.GetImageFromCache(type,pos,zoom);
-                if(!ret.isEmpty())
-                {
-                    errorvars.lock();
-                    ++diag.tilesFromDB;
-                    errorvars.unlock();
+            ret=Cache::Instance()->ImageCache.GetImageFromCache(type,pos,zoom);
+            if(!ret.isEmpty())
+            {
+                errorvars.lock();
+                ++diag.tilesFromDB;
+                errorvars.unlock();
 #ifdef DEBUG_GMAPS
-                    qDebug()<<"Tile found in Database";
+                qDebug()<<"Tile found in Database";
 #endif //DEBUG_GMAPS
-                    if(useMemoryCache)
-                    {
+                if(useMemoryCache)
+                {
 #ifdef DEBUG_GMAPS
-                        qDebug()<<"Add Tile to memory";
+                    qDebug()<<"Add Tile to memory";
 #endif //DEBUG_GMAPS
-                        AddTileToMemoryCache(RawTile(type,pos,zoom),ret);
-                    }
-                    return ret;
+                    AddTileToMemoryCache(RawTile(type,pos,zoom),ret);
                 }
             }
-            if(accessmode!=AccessMode::CacheOnly)
-            {
-                QEventLoop q;
-                QNetworkReply *reply;
-                QNetworkRequest qheader;
-                QNetworkAccessManager network;
-                QTimer tT;
-                tT.setSingleShot(true);
-                connect(&network, SIGNAL(finished(QNetworkReply*)),
-                        &q, SLOT(quit()));
-                connect(&tT, SIGNAL(timeout()), &q, SLOT(quit()));
+        }
+        return ret;
+    }
+
+    bool OPMaps::IsTileCached(const MapType::Types &type,const Point &pos,const int &zoom)
+    {
+        if(!GetTileFromMemoryCache(RawTile(type,pos,zoom)).isEmpty())
+            return true;
+        if(accessmode==AccessMode::ServerOnly)
+            return false;
+        return Cache::Instance()->TilePacksContain(type,pos,zoom) ||
+               Cache::Instance()->ImageCache.ContainsTile(type,pos,zoom);
+    }
+
+    QByteArray OPMaps::GetImageFrom(const MapType::Types &type,const Point &pos,const int &zoom)
+    {
 #ifdef DEBUG_GMAPS
-                qDebug()<<"Try Tile from the Internet";
+        qDebug()<<"Entered GetImageFrom";
 #endif //DEBUG_GMAPS
-#ifdef DEBUG_TIMINGS
-                qDebug()<<"opmaps before make image url"<<time.elapsed();
-#endif
-                QString url=MakeImageUrl(type,pos,zoom,LanguageStr);
-#ifdef DEBUG_TIMINGS
-                qDebug()<<"opmaps after make image url"<<time.elapsed();
-#endif		//url	"http://vec02.maps.yandex.ru/tiles?l=map&v=2.10.2&x=7&y=5&z=3"	string
-                //"http://map3.pergo.com.tr/tile/02/000/000/007/000/000/002.png"
-                qheader.setUrl(QUrl(url));
-                qheader.setRawHeader("User-Agent",UserAgent);
-                qheader.setRawHeader("Accept","*/*");
-                switch(type)
-                {
-                case MapType::GoogleMap:
-                case MapType::GoogleSatellite:
-                case MapType::GoogleLabels:
-                case MapType::GoogleTerrain:
-                case MapType::GoogleHybrid:
-                    {
-                        qheader.setRawHeader("Referrer", "https://maps.google.com/");
-                    }
-                    break;
+        QByteArray ret=GetImageFromCache(type,pos,zoom);
+        if(ret.isEmpty() && accessmode!=AccessMode::CacheOnly)
+        {
+#ifdef DEBUG_GMAPS
+            qDebug()<<"Try Tile from the Internet";
+#endif //DEBUG_GMAPS
+            // The tile is cached by TileDownloaded()
+            ret=Downloader.Download(RawTile(type,pos,zoom),MakeImageRequest(type,pos,zoom),Timeout);
+        }
+        return ret;
+    }
 
-                case MapType::GoogleMapChina:
-                case MapType::GoogleSatelliteChina:
-                case MapType::GoogleLabelsChina:
-                case MapType::GoogleTerrainChina:
-                case MapType::GoogleHybridChina:
-                    {
-                        qheader.setRawHeader("Referrer", "http://ditu.google.cn/");
-                    }
-                    break;
+    void OPMaps::RequestImageFrom(const MapType::Types &type,const Point &pos,const int &zoom,const void *owner)
+    {
+        Downloader.Request(RawTile(type,pos,zoom),MakeImageRequest(type,pos,zoom),Timeout,owner);
+    }
 
-                case MapType::BingHybrid:
-                case MapType::BingMap:
-                case MapType::BingSatellite:
-                    {
-                        qheader.setRawHeader("Referrer", "http://www.bing.com/maps/");
-                    }
-                    break;
+    void OPMaps::PrefetchImages(const QList<RawTile> &tiles)
+    {
+        TileDownloader::PrefetchList list;
+        if(accessmode!=AccessMode::CacheOnly)
+        {
+            foreach(RawTile tile,tiles)
+            {
+                list.append(qMakePair(tile,MakeImageRequest(tile.Type(),tile.Pos(),tile.Zoom())));
+            }
+        }
+        Downloader.SetPrefetch(list,Timeout);
+    }
 
-                case MapType::YahooHybrid:
-                case MapType::YahooLabels:
-                case MapType::YahooMap:
-                case MapType::YahooSatellite:
-                    {
-                        qheader.setRawHeader("Referrer", "http://maps.yahoo.com/");
-                    }
-                    break;
+    QNetworkRequest OPMaps::MakeImageRequest(const MapType::Types &type,const Point &pos,const int &zoom)
+    {
+        QNetworkRequest qheader;
+        QString url=MakeImageUrl(type,pos,zoom,LanguageStr);
+        //url	"http://vec02.maps.yandex.ru/tiles?l=map&v=2.10.2&x=7&y=5&z=3"	string
+        //"http://map3.pergo.com.tr/tile/02/000/000/007/000/000/002.png"
+        qheader.setUrl(QUrl(url));
+        qheader.setRawHeader("User-Agent",UserAgent);
+        qheader.setRawHeader("Accept","*/*");
+        switch(type)
+        {
+        case MapType::GoogleMap:
+        case MapType::GoogleSatellite:
+        case MapType::GoogleLabels:
+        case MapType::GoogleTerrain:
+        case MapType::GoogleHybrid:
+            {
+                qheader.setRawHeader("Referrer", "https://maps.google.com/");
+            }
+            break;
 
-                case MapType::ArcGIS_MapsLT_Map_Labels:
-                case MapType::ArcGIS_MapsLT_Map:
-                case MapType::ArcGIS_MapsLT_OrtoFoto:
-                case MapType::ArcGIS_MapsLT_Map_Hybrid:
-                    {
-                        qheader.setRawHeader("Referrer", "http://www.maps.lt/map_beta/");
-                    }
-                    break;
+        case MapType::GoogleMapChina:
+        case MapType::GoogleSatelliteChina:
+        case MapType::GoogleLabelsChina:
+        case MapType::GoogleTerrainChina:
+        case MapType::GoogleHybridChina:
+            {
+                qheader.setRawHeader("Referrer", "http://ditu.google.cn/");
+            }
+            break;
 
-                case MapType::OpenStreetMapSurfer:
-                case MapType::OpenStreetMapSurferTerrain:
-                    {
-                        qheader.setRawHeader("Referrer", "http://www.mapsurfer.net/");
-                    }
-                    break;
+        case MapType::BingHybrid:
+        case MapType::BingMap:
+        case MapType::BingSatellite:
+            {
+                qheader.setRawHeader("Referrer", "http://www.bing.com/maps/");
+            }
+            break;
 
-                case MapType::OpenStreetMap:
-                case MapType::OpenStreetOsm:
-                    {
-                        qheader.setRawHeader("Referrer", "http://www.openstreetmap.org/");
-                    }
-                    break;
+        case MapType::YahooHybrid:
+        case MapType::YahooLabels:
+        case MapType::YahooMap:
+        case MapType::YahooSatellite:
+            {
+                qheader.setRawHeader("Referrer", "http://maps.yahoo.com/");
+            }
+            break;
 
-                case MapType::YandexMapRu:
-                    {
-                        qheader.setRawHeader("Referrer", "http://maps.yandex.ru/");
-                    }
-                    break;
-                case MapType::Statkart_Topo2:
-                                    {
-                                        qheader.setRawHeader("Referrer", "http://www.norgeskart.no/");
-                                    }
-                                    break;
-                default:
-                    break;
-                }
-                reply=network.get(qheader);
-                tT.start(Timeout);
-                q.exec();
+        case MapType::ArcGIS_MapsLT_Map_Labels:
+        case MapType::ArcGIS_MapsLT_Map:
+        case MapType::ArcGIS_MapsLT_OrtoFoto:
+        case MapType::ArcGIS_MapsLT_Map_Hybrid:
+            {
+                qheader.setRawHeader("Referrer", "http://www.maps.lt/map_beta/");
+            }
+            break;
 
-                if(!tT.isActive()){
-                    errorvars.lock();
-                    ++diag.timeouts;
-                    errorvars.unlock();
-                    return ret;
-                }
-                tT.stop();
-                if( (reply->error()!=QNetworkReply::NoError))
-                {
-#ifdef DEBUG_GMAPS
-                    qDebug() << " Download Tile Network error: " << reply->errorString();
-#endif
-                    errorvars.lock();
-                    ++diag.networkerrors;
-                    errorvars.unlock();
-                    reply->deleteLater();
-                    return ret;
-                }
-                ret=reply->readAll();
-                reply->deleteLater();//TODO can't this be global??
-                if(ret.isEmpty())
-                {
-#ifdef DEBUG_GMAPS
-                    qDebug()<<"Invalid Tile";
-#endif //DEBUG_GMAPS
-                    errorvars.lock();
-                    ++diag.emptytiles;
-                    errorvars.unlock();
-                    return ret;
-                }
+        case MapType::OpenStreetMapSurfer:
+        case MapType::OpenStreetMapSurferTerrain:
+            {
+                qheader.setRawHeader("Referrer", "http://www.mapsurfer.net/");
+            }
+            break;
+
+        case MapType::OpenStreetMap:
+        case MapType::OpenStreetOsm:
+            {
+                qheader.setRawHeader("Referrer", "http://www.openstreetmap.org/");
+            }
+            break;
+
+        case MapType::YandexMapRu:
+            {
+                qheader.setRawHeader("Referrer", "http://maps.yandex.ru/");
+            }
+            break;
+        case MapType::Statkart_Topo2:
+                            {
+                                qheader.setRawHeader("Referrer", "http://www.norgeskart.no/");
+                            }
+                            break;
+        default:
+            break;
+        }
+        return qheader;
+    }
+
+    void OPMaps::TileDownloaded(RawTile tile,QByteArray data,int result)
+    {
+        // Called from the thread of the downloader for every downloaded tile
+        errorvars.lock();
+        switch(result)
+        {
+        case TileDownloader::Success:
+            ++diag.tilesFromNet;
+            break;
+        case TileDownloader::Timeout:
+            ++diag.timeouts;
+            break;
+        case TileDownloader::NetworkError:
+            ++diag.networkerrors;
+            break;
+        case TileDownloader::EmptyTile:
+            ++diag.emptytiles;
+            break;
+        default:
+            break;
+        }
+        errorvars.unlock();
+        if(data.isEmpty())
+        {
 #ifdef DEBUG_GMAPS
-                qDebug()<<"Received Tile from the Internet";
+            qDebug()<<"Invalid Tile";
 #endif //DEBUG_GMAPS
-                errorvars.lock();
-                ++diag.tilesFromNet;
-                errorvars.unlock();
-                if (useMemoryCache)
-                {
+            return;
+        }
 #ifdef DEBUG_GMAPS
-                    qDebug()<<"Add Tile to memory cache";
+        qDebug()<<"Received Tile from the Internet";
 #endif //DEBUG_GMAPS
-                    AddTileToMemoryCache(RawTile(type,pos,zoom),ret);
-                }
-                if(accessmode!=AccessMode::ServerOnly)
-                {
+        if (useMemoryCache)
+        {
 #ifdef DEBUG_GMAPS
-                    qDebug()<<"Add tile to DataBase";
+            qDebug()<<"Add Tile to memory cache";
 #endif //DEBUG_GMAPS
-                    CacheItemQueue * item=new CacheItemQueue(type,pos,ret,zoom);
-                    TileDBcacheQueue.EnqueueCacheTask(item);
-                }
-
-
-            }
+            AddTileToMemoryCache(tile,data);
         }
+        if(accessmode!=AccessMode::ServerOnly)
+        {
 #ifdef DEBUG_GMAPS
-        qDebug()<<"Entered GetImageFrom";
+            qDebug()<<"Add tile to DataBase";
 #endif //DEBUG_GMAPS
-        return ret;
+            CacheItemQueue * item=new CacheItemQueue(tile.Type(),tile.Pos(),data,tile.Zoom());
+            TileDBcacheQueue.EnqueueCacheTask(item);
+        }
     }
 
     bool OPMaps::ExportToGMDB(const QString &file)
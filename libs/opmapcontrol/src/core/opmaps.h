@@ -40,14 +40,15 @@
 #include "alllayersoftype.h"
 #include "urlfactory.h"
 #include "diagnostics.h"
+#include "tiledownloader.h"
 
 //#include "point.h"
 
 
 namespace core {
-    class OPMaps: public MemoryCache,public AllLayersOfType,public UrlFactory
+    class OPMaps: public UrlFactory,public MemoryCache,public AllLayersOfType
     {
-
+        Q_OBJECT
 
     public:
 
@@ -61,7 +62,35 @@ namespace core {
         /// </summary>
 
 
+        /**
+        * @brief Delivers a tile from the memory or database cache, or downloads it
+        *        and waits for it. Blocks, use RequestImageFrom() instead in the gui.
+        */
         QByteArray GetImageFrom(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        /**
+        * @brief Delivers a tile from the memory or database cache without downloading it
+        */
+        QByteArray GetImageFromCache(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        /**
+        * @brief Checks if a tile is in the memory cache, a tile pack or the database
+        *        without reading it
+        */
+        bool IsTileCached(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        /**
+        * @brief Queues the download of a tile. Downloader emits TileDownloaded when
+        *        it is done, the tile is cached before.
+        *
+        * @param owner view requesting the tile, see TileDownloader::SetViewCenter()
+        */
+        void RequestImageFrom(const MapType::Types &type,const core::Point &pos,const int &zoom,const void *owner);
+        /**
+        * @brief Replaces the tiles prefetched at low priority, see TileDownloader::SetPrefetch().
+        *        The tiles should not be cached already.
+        *
+        * @param tiles tiles to prefetch, most important first
+        */
+        void PrefetchImages(const QList<RawTile> &tiles);
+        TileDownloader Downloader;
         bool UseMemoryCache(){return useMemoryCache;}//TODO
         void setUseMemoryCache(const bool& value){useMemoryCache=value;}
         void setLanguage(const LanguageType::Types& language){Language=language;}//TODO
@@ -71,7 +100,11 @@ namespace core {
         int RetryLoadTile;
         diagnostics GetDiagnostics();
 
+    private slots:
+        void TileDownloaded(core::RawTile tile,QByteArray data,int result);
+
     private:
+        QNetworkRequest MakeImageRequest(const MapType::Types &type,const core::Point &pos,const int &zoom);
         bool useMemoryCache;
         LanguageType::Types Language;
         AccessMode::Types accessmode;
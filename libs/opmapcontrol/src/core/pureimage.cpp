@@ -38,6 +38,13 @@ QPixmap PureImageProxy::FromStream(const QByteArray &array)
 {
     return QPixmap::fromImage(QImage::fromData(array));
 }
+QImage PureImageProxy::Decode(const QByteArray &array)
+{
+    QImage image=QImage::fromData(array);
+    if(image.isNull())
+        return image;
+    return image.convertToFormat(image.hasAlphaChannel()?QImage::Format_ARGB32_Premultiplied:QImage::Format_RGB32);
+}
 bool PureImageProxy::Save(const QByteArray &array, QPixmap &pic)
 {
     pic=QPixmap::fromImage(QImage::fromData(array));
@@ -28,6 +28,7 @@
 #define PUREIMAGE_H
 
 #include <QPixmap>
+#include <QImage>
 #include <QByteArray>
 
 
@@ -38,6 +39,11 @@ namespace core {
         PureImageProxy();
         static QPixmap FromStream(const QByteArray &array);
         static bool Save(const QByteArray &array,QPixmap &pic);
+        /**
+        * @brief Decodes a tile into an image in a format which is painted without
+        *        conversion. Unlike QPixmap this may be done outside the gui thread.
+        */
+        static QImage Decode(const QByteArray &array);
     };
 
 }
@@ -27,19 +27,87 @@
 #include "pureimagecache.h"
 #include <QDateTime>
 #include <QSettings>
+#include <QThread>
 //#define DEBUG_PUREIMAGECACHE
 namespace core {
-    qlonglong PureImageCache::ConnCounter=0;
+    PureImageCache::ThreadConnection::ThreadConnection(const QString &name, const QString &file, const int generation):
+        name(name),generation(generation),open(false),inTransaction(false)
+    {
+        db = QSqlDatabase::addDatabase("QSQLITE",name);
+        db.setDatabaseName(file);
+        // The connection is kept open so readers and the writer wait for each other
+        // instead of failing while a batch of tiles is committed
+        db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+        if(db.open())
+        {
+            selectTile=QSqlQuery(db);
+            selectTileId=QSqlQuery(db);
+            insertTile=QSqlQuery(db);
+            insertTileData=QSqlQuery(db);
+            open=selectTile.prepare("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE Type=? AND Zoom=? AND X=? AND Y=?)") &&
+                 selectTileId.prepare("SELECT id FROM Tiles WHERE Type=? AND Zoom=? AND X=? AND Y=?") &&
+                 insertTile.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)") &&
+                 insertTileData.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
+#ifdef DEBUG_PUREIMAGECACHE
+            if(!open)
+                qDebug()<<"ThreadConnection: Unable to prepare statements"<<selectTile.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+        }
+#ifdef DEBUG_PUREIMAGECACHE
+        else
+            qDebug()<<"ThreadConnection: Unable to open database"<<file;
+#endif //DEBUG_PUREIMAGECACHE
+    }
+
+    PureImageCache::ThreadConnection::~ThreadConnection()
+    {
+        if(inTransaction)
+            db.commit();
+        selectTile=QSqlQuery();
+        selectTileId=QSqlQuery();
+        insertTile=QSqlQuery();
+        insertTileData=QSqlQuery();
+        db.close();
+        db=QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+    }
 
-    PureImageCache::PureImageCache()
+    PureImageCache::PureImageCache():generation(0)
     {
 
     }
 
+    PureImageCache::~PureImageCache()
+    {
+        // Connections of other threads are closed when their thread finishes
+        connections.setLocalData(0);
+    }
+
+    PureImageCache::ThreadConnection *PureImageCache::Connection()
+    {
+        // Must be called holding the lock
+        int current=generation.load();
+        ThreadConnection *cn=connections.localData();
+        if(cn && cn->generation!=current)
+        {
+            // The cache location changed, the old connection is closed
+            connections.setLocalData(0);
+            cn=0;
+        }
+        if(!cn)
+        {
+            QString name=QString("PureImageCache_%1_%2").arg((quintptr)this,0,16).arg((quintptr)QThread::currentThreadId(),0,16);
+            cn=new ThreadConnection(name,gtilecache+"Data.qmdb",current);
+            connections.setLocalData(cn);
+        }
+        return cn->isOpen()?cn:0;
+    }
+
     void PureImageCache::setGtileCache(const QString &value)
     {
         lock.lockForWrite();
         gtilecache=value;
+        generation.ref();
         QDir d;
         if(!d.exists(gtilecache))
         {
@@ -57,6 +125,10 @@ namespace core {
 #endif //DEBUG_PUREIMAGECACHE
                 CreateEmptyDB(db);
             }
+            else
+            {
+                UpdateDB(db);
+            }
         }
         lock.unlock();
     }
@@ -161,6 +233,15 @@ namespace core {
         {
 #ifdef DEBUG_PUREIMAGECACHE
             qDebug()<<"CreateEmptyDB: "<<query.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+            db.close();
+            return false;
+        }
+        query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (Type, Zoom, X, Y)");
+        if(query.numRowsAffected()==-1)
+        {
+#ifdef DEBUG_PUREIMAGECACHE
+            qDebug()<<"CreateEmptyDB: "<<query.lastError().driverText();
 #endif //DEBUG_PUREIMAGECACHE
             db.close();
             return false;
@@ -169,6 +250,32 @@ namespace core {
         QSqlDatabase::removeDatabase(QLatin1String("CreateConn"));
         return true;
     }
+    bool PureImageCache::UpdateDB(const QString &file)
+    {
+        bool ret=false;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE",QLatin1String("UpdateConn"));
+            db.setDatabaseName(file);
+            if(db.open())
+            {
+                // Databases of older versions lack the index used to look up tiles
+                QSqlQuery query(db);
+                ret=query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (Type, Zoom, X, Y)");
+#ifdef DEBUG_PUREIMAGECACHE
+                if(!ret)
+                    qDebug()<<"UpdateDB: "<<query.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+                query.clear();
+                db.close();
+            }
+#ifdef DEBUG_PUREIMAGECACHE
+            else
+                qDebug()<<"UpdateDB: Unable to open database";
+#endif //DEBUG_PUREIMAGECACHE
+        }
+        QSqlDatabase::removeDatabase(QLatin1String("UpdateConn"));
+        return ret;
+    }
     bool PureImageCache::PutImageToCache(const QByteArray &tile, const MapType::Types &type,const Point &pos,const int &zoom)
     {
         if(gtilecache.isEmpty()|gtilecache.isNull())
@@ -177,119 +284,140 @@ namespace core {
 #ifdef DEBUG_PUREIMAGECACHE
         qDebug()<<"PutImageToCache Start:";//<<pos;
 #endif //DEBUG_PUREIMAGECACHE
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
+        bool ret=false;
+        ThreadConnection *cn=Connection();
+        if(cn)
         {
-            QSqlDatabase cn;
-            cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-            QString db=gtilecache+"Data.qmdb";
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if(cn.open())
+            cn->insertTile.bindValue(0,pos.X());
+            cn->insertTile.bindValue(1,pos.Y());
+            cn->insertTile.bindValue(2,zoom);
+            cn->insertTile.bindValue(3,(int)type);
+            cn->insertTile.bindValue(4,QDateTime::currentDateTime().toString());
+            if(cn->insertTile.exec())
             {
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
-                    query.addBindValue(pos.X());
-                    query.addBindValue(pos.Y());
-                    query.addBindValue(zoom);
-
-                    query.addBindValue((int)type);
-                    query.addBindValue(QDateTime::currentDateTime().toString());
-                    query.exec();
-                }
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
-                    query.addBindValue(tile);
-                    query.exec();
-                }
-                cn.close();
+                cn->insertTileData.bindValue(0,tile);
+                ret=cn->insertTileData.exec();
             }
+#ifdef DEBUG_PUREIMAGECACHE
+            if(!ret)
+                qDebug()<<"PutImageToCache: "<<cn->insertTile.lastError().driverText()<<cn->insertTileData.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
         }
-        QSqlDatabase::removeDatabase(QString::number(id));
         lock.unlock();
-        return true;
+        return ret;
     }
     QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
     {
-        lock.lockForRead();
         QByteArray ar;
         if(gtilecache.isEmpty()|gtilecache.isNull())
             return ar;
-        QString dir=gtilecache;
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
+        lock.lockForRead();
 #ifdef DEBUG_PUREIMAGECACHE
-        qDebug()<<"Cache dir="<<dir<<" Try to GET:"<<pos.X()+","+pos.Y();
+        qDebug()<<"Cache dir="<<gtilecache<<" Try to GET:"<<pos.X()+","+pos.Y();
 #endif //DEBUG_PUREIMAGECACHE
-
-            QString db=dir+"Data.qmdb";
-			{
-				QSqlDatabase cn;
-			
-				cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-
-	            cn.setDatabaseName(db);
-		        cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-			    if(cn.open())
-				{
-					QSqlQuery query(cn);
-					query.exec(QString("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=%1 AND Y=%2 AND Zoom=%3 AND Type=%4)").arg(pos.X()).arg(pos.Y()).arg(zoom).arg((int) type));
-					query.next();
-					if(query.isValid())
-					{
-						ar=query.value(0).toByteArray();
-					}
-					cn.close();
-				}
-			}
-			QSqlDatabase::removeDatabase(QString::number(id));
+        ThreadConnection *cn=Connection();
+        if(cn)
+        {
+            cn->selectTile.bindValue(0,(int)type);
+            cn->selectTile.bindValue(1,zoom);
+            cn->selectTile.bindValue(2,pos.X());
+            cn->selectTile.bindValue(3,pos.Y());
+            if(cn->selectTile.exec() && cn->selectTile.next())
+            {
+                ar=cn->selectTile.value(0).toByteArray();
+            }
+            // Release the statement so it does not block writers
+            cn->selectTile.finish();
+        }
         lock.unlock();
         return ar;
     }
+    bool PureImageCache::ContainsTile(MapType::Types type, Point pos, int zoom)
+    {
+        if(gtilecache.isEmpty()|gtilecache.isNull())
+            return false;
+        bool ret=false;
+        lock.lockForRead();
+        ThreadConnection *cn=Connection();
+        if(cn)
+        {
+            // Only the index is read, the tile data is not touched
+            cn->selectTileId.bindValue(0,(int)type);
+            cn->selectTileId.bindValue(1,zoom);
+            cn->selectTileId.bindValue(2,pos.X());
+            cn->selectTileId.bindValue(3,pos.Y());
+            ret=cn->selectTileId.exec() && cn->selectTileId.next();
+            cn->selectTileId.finish();
+        }
+        lock.unlock();
+        return ret;
+    }
+    bool PureImageCache::BeginTransaction()
+    {
+        if(gtilecache.isEmpty()|gtilecache.isNull())
+            return false;
+        bool ret=false;
+        lock.lockForRead();
+        ThreadConnection *cn=Connection();
+        if(cn && !cn->inTransaction)
+        {
+            ret=cn->db.transaction();
+            cn->inTransaction=ret;
+        }
+        lock.unlock();
+        return ret;
+    }
+    bool PureImageCache::CommitTransaction()
+    {
+        if(gtilecache.isEmpty()|gtilecache.isNull())
+            return false;
+        bool ret=false;
+        lock.lockForRead();
+        ThreadConnection *cn=Connection();
+        if(cn && cn->inTransaction)
+        {
+            ret=cn->db.commit();
+            if(!ret)
+            {
+#ifdef DEBUG_PUREIMAGECACHE
+                qDebug()<<"CommitTransaction: "<<cn->db.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+                cn->db.rollback();
+            }
+            cn->inTransaction=false;
+        }
+        lock.unlock();
+        return ret;
+    }
     void PureImageCache::deleteOlderTiles(int const& days)
     {
         if(gtilecache.isEmpty()|gtilecache.isNull())
             return;
-        QList<long> add;
-        bool ret=true;
-        QString dir=gtilecache;
+        QList<qlonglong> add;
+        lock.lockForRead();
+        ThreadConnection *cn=Connection();
+        if(cn && !cn->inTransaction)
         {
-            QString db=dir+"Data.qmdb";
-            ret=QFileInfo(db).exists();
-            if(ret)
+            QSqlQuery query(cn->db);
+            query.exec(QString("SELECT id, Date FROM Tiles"));
+            while(query.next())
+            {
+                if(QDateTime::fromString(query.value(1).toString()).daysTo(QDateTime::currentDateTime())>days)
+                    add.append(query.value(0).toLongLong());
+            }
+            query.finish();
+            if(!add.isEmpty() && cn->db.transaction())
             {
-                QSqlDatabase cn;
-                Mcounter.lock();
-                qlonglong id=++ConnCounter;
-                Mcounter.unlock();
-                cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-                cn.setDatabaseName(db);
-                cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-                if(cn.open())
+                query.prepare("DELETE FROM Tiles WHERE id = ?");
+                foreach(qlonglong i,add)
                 {
-                    {
-                        QSqlQuery query(cn);
-                        query.exec(QString("SELECT id, X, Y, Zoom, Type, Date FROM Tiles"));
-                        while(query.next())
-                        {
-                            if(QDateTime::fromString(query.value(5).toString()).daysTo(QDateTime::currentDateTime())>days)
-                                add.append(query.value(0).toLongLong());
-                        }
-                        foreach(long i,add)
-                        {
-                            query.exec(QString("DELETE FROM Tiles WHERE id = %1;").arg(i));
-                        }
-                    }
-
-                    cn.close();
+                    query.bindValue(0,i);
+                    query.exec();
                 }
-                QSqlDatabase::removeDatabase(QString::number(id));
+                cn->db.commit();
             }
         }
+        lock.unlock();
     }
     // PureImageCache::ExportMapDataToDB("C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data.qmdb","C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data2.qmdb");
     bool PureImageCache::ExportMapDataToDB(QString sourceFile, QString destFile)
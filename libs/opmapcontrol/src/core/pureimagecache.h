@@ -42,24 +42,68 @@
 #include <QList>
 #include <QMutex>
 #include <QReadWriteLock>
+#include <QThreadStorage>
+#include <QAtomicInt>
 namespace core {
     class PureImageCache
     {
 
     public:
         PureImageCache();
+        ~PureImageCache();
         static bool CreateEmptyDB(const QString &file);
+        /**
+         * @brief UpdateDB brings an existing database to the current layout,
+         *        it adds the tile lookup index to databases created without it.
+         */
+        static bool UpdateDB(const QString &file);
         bool PutImageToCache(const QByteArray &tile,const MapType::Types &type,const core::Point &pos, const int &zoom);
         QByteArray GetImageFromCache(MapType::Types type, core::Point pos, int zoom);
+        /**
+         * @brief ContainsTile checks if a tile is cached without reading it
+         */
+        bool ContainsTile(MapType::Types type, core::Point pos, int zoom);
+        /**
+         * @brief BeginTransaction starts a transaction on the connection of the
+         *        calling thread. All tiles put to the cache until CommitTransaction()
+         *        is called are written at once.
+         */
+        bool BeginTransaction();
+        bool CommitTransaction();
         QString GtileCache();
         void setGtileCache(const QString &value);
         static bool ExportMapDataToDB(QString sourceFile, QString destFile);
         void deleteOlderTiles(int const& days);
     private:
+        /**
+         * @brief The ThreadConnection class holds the database connection of one
+         *        thread and its prepared statements. It lives as long as its thread
+         *        or until the cache location changes.
+         */
+        class ThreadConnection
+        {
+        public:
+            ThreadConnection(const QString &name, const QString &file, const int generation);
+            ~ThreadConnection();
+            bool isOpen() const { return open; }
+
+            QString name;
+            int generation;         ///< Cache location generation the connection was opened for
+            bool open;
+            bool inTransaction;
+            QSqlDatabase db;
+            QSqlQuery selectTile;
+            QSqlQuery selectTileId;
+            QSqlQuery insertTile;
+            QSqlQuery insertTileData;
+        };
+
+        ThreadConnection *Connection();
+
         QString gtilecache;
-        QMutex Mcounter;
         QReadWriteLock lock;
-        static qlonglong ConnCounter;
+        QAtomicInt generation;      ///< Incremented on every change of the cache location
+        QThreadStorage<ThreadConnection*> connections;
 
     };
 
@@ -85,15 +85,24 @@ void TileCacheQueue::run()
 #endif //DEBUG_TILECACHEQUEUE
         if(tileCacheQueue.count()>0)
         {
+            // Tiles queued meanwhile are written in one transaction
+            QList<CacheItemQueue*> tasks;
             mutex.lock();
-            task=tileCacheQueue.dequeue();
+            while(!tileCacheQueue.isEmpty() && tasks.count()<MaxBatchSize)
+                tasks.append(tileCacheQueue.dequeue());
             mutex.unlock();
+            PureImageCache &cache=Cache::Instance()->ImageCache;
+            cache.BeginTransaction();
+            foreach(task,tasks)
+            {
 #ifdef DEBUG_TILECACHEQUEUE
-            qDebug()<<"Cache engine Put:"<<task->GetPosition().X()<<","<<task->GetPosition().Y();
+                qDebug()<<"Cache engine Put:"<<task->GetPosition().X()<<","<<task->GetPosition().Y();
 #endif //DEBUG_TILECACHEQUEUE
-            Cache::Instance()->ImageCache.PutImageToCache(task->GetImg(),task->GetMapType(),task->GetPosition(),task->GetZoom());
+                cache.PutImageToCache(task->GetImg(),task->GetMapType(),task->GetPosition(),task->GetZoom());
+                delete task;
+            }
+            cache.CommitTransaction();
             usleep(44);
-            delete task;
         }
 
         else
@@ -50,6 +50,7 @@ namespace core {
     protected:
         QQueue<CacheItemQueue*> tileCacheQueue;
     private:
+        static const int MaxBatchSize=64;   // Maximum number of tiles written in one transaction
         void run();
         QMutex mutex;
         QMutex waitmutex;
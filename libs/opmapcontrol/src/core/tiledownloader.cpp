@@ -0,0 +1,365 @@
+/**
+******************************************************************************
+*
+* @file       tiledownloader.cpp
+* @author     APM_PLANNER Project, http://www.diydrones.com Copyright (C) 2016.
+* @brief      Asynchronous download of map tiles
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/* 
+* This program is free software; you can redistribute it and/or modify 
+* it under the terms of the GNU General Public License as published by 
+* the Free Software Foundation; either version 3 of the License, or 
+* (at your option) any later version.
+* 
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License 
+* for more details.
+* 
+* You should have received a copy of the GNU General Public License along 
+* with this program; if not, write to the Free Software Foundation, Inc., 
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include "tiledownloader.h"
+#include <QTimer>
+//#define DEBUG_TILEDOWNLOADER
+namespace core {
+    TileDownloader::TileDownloader():network(0),timeoutTimer(0),maxRequestsPerHost(12),prefetchBudget(256*1024),
+        prefetchTokens(256*1024),runningPrefetch(0),stopped(false)
+    {
+        prefetchRefill.start();
+        moveToThread(&thread);
+        thread.start();
+        QMetaObject::invokeMethod(this,"Startup",Qt::QueuedConnection);
+    }
+    TileDownloader::~TileDownloader()
+    {
+        QMetaObject::invokeMethod(this,"Shutdown",Qt::BlockingQueuedConnection);
+        thread.quit();
+        thread.wait();
+    }
+
+    void TileDownloader::Startup()
+    {
+        network=new QNetworkAccessManager(this);
+        timeoutTimer=new QTimer(this);
+        connect(timeoutTimer,SIGNAL(timeout()),this,SLOT(CheckTimeouts()));
+        timeoutTimer->start(250);
+        StartRequests();
+    }
+    void TileDownloader::Shutdown()
+    {
+        // Runs in the thread of the downloader, all waiting threads are released
+        timeoutTimer->stop();
+        mutex.lock();
+        stopped=true;
+        foreach(EntryPtr entry,entries)
+        {
+            entry->done=true;
+        }
+        entries.clear();
+        mutex.unlock();
+        finished.wakeAll();
+        QList<QNetworkReply*> running=replies.keys();
+        foreach(QNetworkReply *reply,running)
+        {
+            reply->abort();
+        }
+        delete network;
+        network=0;
+    }
+
+    TileDownloader::EntryPtr TileDownloader::Enqueue(const RawTile &tile, const QNetworkRequest &request, const int &timeout)
+    {
+        // Must be called holding the mutex
+        EntryPtr entry=entries.value(tile);
+        if(entry.isNull())
+        {
+            entry=EntryPtr(new Entry(tile));
+            entry->request=request;
+            entry->request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute,true);
+            entry->host=request.url().host();
+            entry->timeout=timeout;
+            entries.insert(tile,entry);
+        }
+        // A prefetched tile is now needed by a view
+        entry->prefetch=false;
+        return entry;
+    }
+    void TileDownloader::Request(const RawTile &tile, const QNetworkRequest &request, const int &timeout, const void *owner)
+    {
+        mutex.lock();
+        if(stopped)
+        {
+            mutex.unlock();
+            return;
+        }
+        EntryPtr entry=Enqueue(tile,request,timeout);
+        if(!entry->owners.contains(owner))
+            entry->owners.append(owner);
+        mutex.unlock();
+        QMetaObject::invokeMethod(this,"StartRequests",Qt::QueuedConnection);
+    }
+    QByteArray TileDownloader::Download(const RawTile &tile, const QNetworkRequest &request, const int &timeout)
+    {
+        QMutexLocker locker(&mutex);
+        if(stopped)
+            return QByteArray();
+        EntryPtr entry=Enqueue(tile,request,timeout);
+        ++entry->waiters;
+        QMetaObject::invokeMethod(this,"StartRequests",Qt::QueuedConnection);
+        // The downloader completes every started tile, at the latest when it times out
+        while(!entry->done)
+            finished.wait(&mutex);
+        --entry->waiters;
+        return entry->data;
+    }
+
+    void TileDownloader::SetViewCenter(const void *owner, const int &zoom, const Point &center)
+    {
+        mutex.lock();
+        View view;
+        view.zoom=zoom;
+        view.center=center;
+        views.insert(owner,view);
+        mutex.unlock();
+    }
+    void TileDownloader::Cancel(const void *owner)
+    {
+        mutex.lock();
+        views.remove(owner);
+        QHash<RawTile,EntryPtr>::iterator i=entries.begin();
+        while(i!=entries.end())
+        {
+            EntryPtr entry=i.value();
+            entry->owners.removeAll(owner);
+            if(!entry->reply && !entry->prefetch && entry->owners.isEmpty() && entry->waiters==0)
+                i=entries.erase(i);
+            else
+                ++i;
+        }
+        mutex.unlock();
+    }
+
+    void TileDownloader::SetPrefetch(const PrefetchList &tiles, const int &timeout)
+    {
+        mutex.lock();
+        // Drop the queued tiles of the last list, running ones are completed
+        QHash<RawTile,EntryPtr>::iterator i=entries.begin();
+        while(i!=entries.end())
+        {
+            if(i.value()->prefetch && !i.value()->reply)
+                i=entries.erase(i);
+            else
+                ++i;
+        }
+        if(stopped || prefetchBudget==0)
+        {
+            mutex.unlock();
+            return;
+        }
+        for(int order=0;order<tiles.count();++order)
+        {
+            const RawTile &tile=tiles.at(order).first;
+            if(entries.contains(tile))
+                continue;
+            EntryPtr entry(new Entry(tile));
+            entry->request=tiles.at(order).second;
+            entry->request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute,true);
+            entry->host=entry->request.url().host();
+            entry->timeout=timeout;
+            entry->prefetch=true;
+            entry->prefetchOrder=order;
+            entries.insert(tile,entry);
+        }
+        mutex.unlock();
+        QMetaObject::invokeMethod(this,"StartRequests",Qt::QueuedConnection);
+    }
+    void TileDownloader::SetPrefetchBudget(const int &value)
+    {
+        mutex.lock();
+        prefetchBudget=qMax(0,value);
+        prefetchTokens=qMin(prefetchTokens,(qint64)prefetchBudget);
+        mutex.unlock();
+    }
+    int TileDownloader::PrefetchBudget()
+    {
+        QMutexLocker locker(&mutex);
+        return prefetchBudget;
+    }
+    void TileDownloader::RefillPrefetchBudget()
+    {
+        // Must be called holding the mutex, allows bursts of up to one second of budget
+        qint64 elapsed=prefetchRefill.restart();
+        prefetchTokens=qMin(prefetchTokens+elapsed*prefetchBudget/1000,(qint64)prefetchBudget);
+    }
+
+    void TileDownloader::SetMaxRequestsPerHost(const int &value)
+    {
+        mutex.lock();
+        maxRequestsPerHost=qMax(1,value);
+        mutex.unlock();
+        QMetaObject::invokeMethod(this,"StartRequests",Qt::QueuedConnection);
+    }
+    int TileDownloader::MaxRequestsPerHost()
+    {
+        QMutexLocker locker(&mutex);
+        return maxRequestsPerHost;
+    }
+    int TileDownloader::PendingCount()
+    {
+        QMutexLocker locker(&mutex);
+        return entries.count();
+    }
+
+    qint64 TileDownloader::Priority(const EntryPtr &entry) const
+    {
+        // Must be called holding the mutex, smaller values are started first
+        if(entry->waiters>0)
+            return -1;
+        if(entry->prefetch)
+            return (Q_INT64_C(1)<<41)+entry->prefetchOrder;
+        qint64 priority=Q_INT64_C(1)<<40;
+        RawTile tile=entry->tile;
+        foreach(const void *owner,entry->owners)
+        {
+            QHash<const void*,View>::const_iterator view=views.constFind(owner);
+            if(view!=views.constEnd() && view->zoom==tile.Zoom())
+            {
+                qint64 dx=tile.Pos().X()-view->center.X();
+                qint64 dy=tile.Pos().Y()-view->center.Y();
+                priority=qMin(priority,dx*dx+dy*dy);
+            }
+        }
+        return priority;
+    }
+
+    void TileDownloader::StartRequests()
+    {
+        if(!network)
+            return;
+        QList<EntryPtr> start;
+        mutex.lock();
+        RefillPrefetchBudget();
+        // Prefetched tiles must leave most connections to the tiles of the views
+        const int maxPrefetch=qMax(1,maxRequestsPerHost/4);
+        while(true)
+        {
+            // The queue is small, so the best tile is searched instead of keeping it sorted
+            EntryPtr best;
+            qint64 bestPriority=0;
+            foreach(const EntryPtr &entry,entries)
+            {
+                if(entry->reply || start.contains(entry) || runningPerHost.value(entry->host)>=maxRequestsPerHost)
+                    continue;
+                if(entry->prefetch && (runningPrefetch>=maxPrefetch || prefetchTokens<=0))
+                    continue;
+                qint64 priority=Priority(entry);
+                if(best.isNull() || priority<bestPriority)
+                {
+                    best=entry;
+                    bestPriority=priority;
+                }
+            }
+            if(best.isNull())
+                break;
+            ++runningPerHost[best->host];
+            if(best->prefetch)
+            {
+                best->prefetchStarted=true;
+                ++runningPrefetch;
+            }
+            start.append(best);
+        }
+        mutex.unlock();
+
+        foreach(const EntryPtr &entry,start)
+        {
+#ifdef DEBUG_TILEDOWNLOADER
+            qDebug()<<"TileDownloader: start"<<entry->request.url().toString();
+#endif //DEBUG_TILEDOWNLOADER
+            QNetworkReply *reply=network->get(entry->request);
+            connect(reply,SIGNAL(finished()),this,SLOT(RequestFinished()));
+            mutex.lock();
+            entry->reply=reply;
+            entry->started.start();
+            mutex.unlock();
+            replies.insert(reply,entry);
+        }
+    }
+
+    void TileDownloader::RequestFinished()
+    {
+        QNetworkReply *reply=qobject_cast<QNetworkReply*>(sender());
+        EntryPtr entry=replies.take(reply);
+        if(entry.isNull())
+            return;
+
+        QByteArray data;
+        Result result=Success;
+        if(entry->timedOut)
+        {
+            result=Timeout;
+        }
+        else if(reply->error()!=QNetworkReply::NoError)
+        {
+#ifdef DEBUG_TILEDOWNLOADER
+            qDebug()<<"TileDownloader: network error"<<reply->errorString();
+#endif //DEBUG_TILEDOWNLOADER
+            result=NetworkError;
+        }
+        else
+        {
+            data=reply->readAll();
+            if(data.isEmpty())
+                result=EmptyTile;
+        }
+        reply->deleteLater();
+
+        mutex.lock();
+        if(--runningPerHost[entry->host]<=0)
+            runningPerHost.remove(entry->host);
+        if(entry->prefetchStarted)
+        {
+            // Failed tiles are charged too, so an unreachable server is not polled at full rate
+            --runningPrefetch;
+            prefetchTokens-=qMax(data.size(),1024);
+        }
+        entries.remove(entry->tile);
+        entry->reply=0;
+        entry->data=data;
+        entry->result=result;
+        entry->done=true;
+        mutex.unlock();
+        finished.wakeAll();
+
+        emit TileDownloaded(entry->tile,data,result);
+        StartRequests();
+    }
+
+    void TileDownloader::CheckTimeouts()
+    {
+        QList<QNetworkReply*> expired;
+        mutex.lock();
+        for(QHash<QNetworkReply*,EntryPtr>::const_iterator i=replies.constBegin();i!=replies.constEnd();++i)
+        {
+            if(i.value()->started.elapsed()>i.value()->timeout)
+            {
+                i.value()->timedOut=true;
+                expired.append(i.key());
+            }
+        }
+        mutex.unlock();
+        // abort() emits finished, which completes the tile
+        foreach(QNetworkReply *reply,expired)
+        {
+            reply->abort();
+        }
+        // Prefetched tiles wait here for the budget to refill
+        StartRequests();
+    }
+}
@@ -0,0 +1,189 @@
+/**
+******************************************************************************
+*
+* @file       tiledownloader.h
+* @author     APM_PLANNER Project, http://www.diydrones.com Copyright (C) 2016.
+* @brief      Asynchronous download of map tiles
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/* 
+* This program is free software; you can redistribute it and/or modify 
+* it under the terms of the GNU General Public License as published by 
+* the Free Software Foundation; either version 3 of the License, or 
+* (at your option) any later version.
+* 
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License 
+* for more details.
+* 
+* You should have received a copy of the GNU General Public License along 
+* with this program; if not, write to the Free Software Foundation, Inc., 
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef TILEDOWNLOADER_H
+#define TILEDOWNLOADER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkRequest>
+#include <QtNetwork/QNetworkReply>
+#include "rawtile.h"
+
+class QTimer;
+
+namespace core {
+    /**
+    * @brief Downloads tiles using a single network access manager running in its
+    *        own thread. Connections are kept alive and requests are pipelined.
+    *        The number of requests in flight is limited per host, a tile requested
+    *        more than once is only downloaded once and queued tiles are started
+    *        in order of their distance to the center of the view which requested them.
+    *        Prefetched tiles are started after all requested tiles and only while the
+    *        prefetch bandwidth budget allows it.
+    *        All public methods are thread safe.
+    */
+    class TileDownloader:public QObject
+    {
+        Q_OBJECT
+    public:
+        typedef QList<QPair<RawTile,QNetworkRequest> > PrefetchList;
+
+        enum Result
+        {
+            Success,
+            Timeout,
+            NetworkError,
+            EmptyTile,
+            Canceled
+        };
+
+        TileDownloader();
+        ~TileDownloader();
+
+        /**
+        * @brief Queues the download of a tile, TileDownloaded is emitted when it is done
+        *
+        * @param tile tile to download, used to find duplicate requests
+        * @param request request of the tile
+        * @param timeout time in ms the download may take once started
+        * @param owner view requesting the tile, its center orders the queue
+        */
+        void Request(const RawTile &tile, const QNetworkRequest &request, const int &timeout, const void *owner);
+
+        /**
+        * @brief Downloads a tile ahead of all queued tiles and waits for it.
+        *        Must not be called from a slot connected to TileDownloaded.
+        *
+        * @return the tile or an empty array if the download failed
+        */
+        QByteArray Download(const RawTile &tile, const QNetworkRequest &request, const int &timeout);
+
+        /**
+        * @brief Sets the view center used to order the tiles requested by owner.
+        *        Tiles of other zoom levels are started after all others.
+        */
+        void SetViewCenter(const void *owner, const int &zoom, const core::Point &center);
+
+        /**
+        * @brief Drops all queued tiles requested by owner. Tiles already in flight
+        *        are completed.
+        */
+        void Cancel(const void *owner);
+
+        /**
+        * @brief Replaces the queued prefetch tiles. The tiles are started in the
+        *        order of the list once no requested tile is waiting. Tiles of the
+        *        last list which were already started are completed.
+        *
+        * @param tiles tiles and their requests, most important first
+        * @param timeout time in ms the download of a tile may take once started
+        */
+        void SetPrefetch(const PrefetchList &tiles, const int &timeout);
+
+        /**
+        * @brief Sets the bandwidth prefetched tiles may use in bytes per second,
+        *        0 disables prefetching.
+        */
+        void SetPrefetchBudget(const int &value);
+        int PrefetchBudget();
+
+        void SetMaxRequestsPerHost(const int &value);
+        int MaxRequestsPerHost();
+        int PendingCount();
+
+    signals:
+        /**
+        * @brief Emitted from the thread of the downloader for every finished tile.
+        *        Connect using Qt::DirectConnection.
+        */
+        void TileDownloaded(core::RawTile tile, QByteArray data, int result);
+
+    private slots:
+        void Startup();
+        void Shutdown();
+        void StartRequests();
+        void RequestFinished();
+        void CheckTimeouts();
+
+    private:
+        struct View
+        {
+            int zoom;
+            core::Point center;
+        };
+        struct Entry
+        {
+            Entry(const RawTile &tile):tile(tile),timeout(0),waiters(0),prefetch(false),prefetchOrder(0),prefetchStarted(false),reply(0),timedOut(false),done(false),result(Canceled){}
+            RawTile tile;
+            QNetworkRequest request;
+            QString host;
+            int timeout;
+            QList<const void*> owners;  // Views which requested the tile
+            int waiters;                // Threads waiting in Download()
+            bool prefetch;              // Only queued by SetPrefetch()
+            int prefetchOrder;          // Position in the prefetch list
+            bool prefetchStarted;       // Started as prefetched tile, charged to the budget
+            QNetworkReply *reply;       // Reply while in flight, 0 while queued
+            QElapsedTimer started;
+            bool timedOut;
+            bool done;
+            QByteArray data;
+            Result result;
+        };
+        typedef QSharedPointer<Entry> EntryPtr;
+
+        EntryPtr Enqueue(const RawTile &tile, const QNetworkRequest &request, const int &timeout);
+        qint64 Priority(const EntryPtr &entry) const;
+        void RefillPrefetchBudget();
+
+        QThread thread;
+        QNetworkAccessManager *network;
+        QTimer *timeoutTimer;
+        QMutex mutex;
+        QWaitCondition finished;
+        QHash<RawTile,EntryPtr> entries;            // All queued and running tiles
+        QHash<QNetworkReply*,EntryPtr> replies;     // Running tiles
+        QHash<QString,int> runningPerHost;
+        QHash<const void*,View> views;
+        int maxRequestsPerHost;
+        int prefetchBudget;         // Bytes per second
+        qint64 prefetchTokens;      // Bytes prefetched tiles may still use, negative if overdrawn
+        QElapsedTimer prefetchRefill;
+        int runningPrefetch;
+        bool stopped;               // Set on shutdown, no more tiles are accepted
+    };
+
+}
+#endif // TILEDOWNLOADER_H
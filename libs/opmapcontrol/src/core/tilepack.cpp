@@ -0,0 +1,186 @@
+/**
+******************************************************************************
+*
+* @file       tilepack.cpp
+* @author     APM_PLANNER Project, http://www.diydrones.com Copyright (C) 2016.
+* @brief      Read only tile pack files holding the tiles of an area
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/* 
+* This program is free software; you can redistribute it and/or modify 
+* it under the terms of the GNU General Public License as published by 
+* the Free Software Foundation; either version 3 of the License, or 
+* (at your option) any later version.
+* 
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License 
+* for more details.
+* 
+* You should have received a copy of the GNU General Public License along 
+* with this program; if not, write to the Free Software Foundation, Inc., 
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include "tilepack.h"
+#include <QtEndian>
+#include <string.h>
+#include <algorithm>
+//#define DEBUG_TILEPACK
+namespace core {
+    const char TilePack::Magic[8]={'O','P','M','T','P','A','C','K'};
+
+    TilePack::TilePack():data(0),size(0),index(0),count(0)
+    {
+    }
+    TilePack::~TilePack()
+    {
+        Close();
+    }
+    bool TilePack::Open(const QString &fileName)
+    {
+        Close();
+        file.setFileName(fileName);
+        if(!file.open(QIODevice::ReadOnly))
+            return false;
+        size=file.size();
+        data=size>=HeaderSize?file.map(0,size):0;
+        if(data && memcmp(data,Magic,sizeof(Magic))==0 && qFromLittleEndian<quint32>(data+8)==Version)
+        {
+            count=qFromLittleEndian<quint32>(data+12);
+            quint64 indexOffset=qFromLittleEndian<quint64>(data+16);
+            if(indexOffset>=(quint64)HeaderSize && indexOffset+(quint64)count*IndexEntrySize==(quint64)size)
+            {
+                index=data+indexOffset;
+                return true;
+            }
+        }
+#ifdef DEBUG_TILEPACK
+        qDebug()<<"TilePack: invalid tile pack"<<fileName;
+#endif //DEBUG_TILEPACK
+        Close();
+        return false;
+    }
+    void TilePack::Close()
+    {
+        if(data)
+            file.unmap(const_cast<uchar*>(data));
+        file.close();
+        data=0;
+        size=0;
+        index=0;
+        count=0;
+    }
+
+    quint64 TilePack::Key(const MapType::Types &type,const Point &pos,const int &zoom)
+    {
+        // 12 bits type, 6 bits zoom, 23 bits each for x and y
+        return ((quint64)(type&0xfff)<<52)|((quint64)(zoom&0x3f)<<46)|((quint64)(pos.X()&0x7fffff)<<23)|(quint64)(pos.Y()&0x7fffff);
+    }
+
+    const uchar *TilePack::Find(const quint64 &key)const
+    {
+        int first=0;
+        int last=count;
+        while(first<last)
+        {
+            int middle=first+(last-first)/2;
+            if(qFromLittleEndian<quint64>(index+middle*IndexEntrySize)<key)
+                first=middle+1;
+            else
+                last=middle;
+        }
+        if(first<count && qFromLittleEndian<quint64>(index+first*IndexEntrySize)==key)
+            return index+first*IndexEntrySize;
+        return 0;
+    }
+    bool TilePack::Contains(const MapType::Types &type,const Point &pos,const int &zoom)const
+    {
+        return IsOpen() && Find(Key(type,pos,zoom))!=0;
+    }
+    QByteArray TilePack::GetTile(const MapType::Types &type,const Point &pos,const int &zoom)const
+    {
+        if(!IsOpen())
+            return QByteArray();
+        const uchar *entry=Find(Key(type,pos,zoom));
+        if(!entry)
+            return QByteArray();
+        quint64 offset=qFromLittleEndian<quint64>(entry+8);
+        quint32 length=qFromLittleEndian<quint32>(entry+16);
+        if(offset+length>(quint64)size)
+            return QByteArray();
+        // Copied, so the tile stays valid when the pack is closed
+        return QByteArray((const char*)data+offset,length);
+    }
+
+    TilePackWriter::TilePackWriter():finished(false)
+    {
+    }
+    TilePackWriter::~TilePackWriter()
+    {
+        if(file.isOpen() && !finished)
+        {
+            file.close();
+            file.remove();
+        }
+    }
+    bool TilePackWriter::Open(const QString &fileName)
+    {
+        file.setFileName(fileName);
+        entries.clear();
+        finished=false;
+        if(!file.open(QIODevice::WriteOnly|QIODevice::Truncate))
+            return false;
+        // The header is written again with the final values by Finish()
+        QByteArray header(TilePack::HeaderSize,0);
+        return file.write(header)==header.size();
+    }
+    bool TilePackWriter::AddTile(const MapType::Types &type,const Point &pos,const int &zoom,const QByteArray &tile)
+    {
+        if(!file.isOpen() || tile.isEmpty())
+            return false;
+        Entry entry;
+        entry.key=TilePack::Key(type,pos,zoom);
+        entry.offset=file.pos();
+        entry.size=tile.size();
+        if(file.write(tile)!=tile.size())
+            return false;
+        entries.append(entry);
+        return true;
+    }
+    bool TilePackWriter::Finish()
+    {
+        if(!file.isOpen())
+            return false;
+        std::stable_sort(entries.begin(),entries.end());
+        QByteArray index;
+        index.reserve(entries.count()*TilePack::IndexEntrySize);
+        uchar buffer[TilePack::IndexEntrySize];
+        quint32 count=0;
+        for(int i=0;i<entries.count();++i)
+        {
+            if(i>0 && entries.at(i).key==entries.at(i-1).key)
+                continue;
+            qToLittleEndian<quint64>(entries.at(i).key,buffer);
+            qToLittleEndian<quint64>(entries.at(i).offset,buffer+8);
+            qToLittleEndian<quint32>(entries.at(i).size,buffer+16);
+            qToLittleEndian<quint32>(0,buffer+20);
+            index.append((const char*)buffer,sizeof(buffer));
+            ++count;
+        }
+        uchar header[TilePack::HeaderSize];
+        memcpy(header,TilePack::Magic,sizeof(TilePack::Magic));
+        qToLittleEndian<quint32>(TilePack::Version,header+8);
+        qToLittleEndian<quint32>(count,header+12);
+        qToLittleEndian<quint64>(file.pos(),header+16);
+        bool ok=file.write(index)==index.size() && file.seek(0) && file.write((const char*)header,sizeof(header))==(qint64)sizeof(header);
+        file.close();
+        finished=ok;
+        if(!ok)
+            file.remove();
+        return ok;
+    }
+
+}
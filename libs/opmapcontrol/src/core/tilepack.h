@@ -0,0 +1,110 @@
+/**
+******************************************************************************
+*
+* @file       tilepack.h
+* @author     APM_PLANNER Project, http://www.diydrones.com Copyright (C) 2016.
+* @brief      Read only tile pack files holding the tiles of an area
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/* 
+* This program is free software; you can redistribute it and/or modify 
+* it under the terms of the GNU General Public License as published by 
+* the Free Software Foundation; either version 3 of the License, or 
+* (at your option) any later version.
+* 
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License 
+* for more details.
+* 
+* You should have received a copy of the GNU General Public License along 
+* with this program; if not, write to the Free Software Foundation, Inc., 
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef TILEPACK_H
+#define TILEPACK_H
+
+#include "maptype.h"
+#include "point.h"
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+namespace core {
+    /**
+    * @brief A tile pack is a single file holding the tiles of an area, it is
+    *        memory mapped and tiles are served without a database. All numbers
+    *        are little endian.
+    *
+    *        Header (24 bytes): "OPMTPACK", version, tile count, offset of the index
+    *        Tile data, one tile after the other
+    *        Index: one entry (key, offset, size) of 24 bytes per tile, sorted by key
+    *
+    *        Once opened a pack is read only and may be used from all threads.
+    */
+    class TilePack
+    {
+    public:
+        TilePack();
+        ~TilePack();
+        bool Open(const QString &file);
+        void Close();
+        bool IsOpen()const{return data!=0;}
+        QString FileName()const{return file.fileName();}
+        int Count()const{return count;}
+        bool Contains(const MapType::Types &type,const core::Point &pos,const int &zoom)const;
+        QByteArray GetTile(const MapType::Types &type,const core::Point &pos,const int &zoom)const;
+
+        static quint64 Key(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        static const char Magic[8];
+        static const quint32 Version=1;
+        static const int HeaderSize=24;
+        static const int IndexEntrySize=24;
+    private:
+        /**
+        * @brief Delivers the index entry of a tile or 0 if the pack does not hold it
+        */
+        const uchar *Find(const quint64 &key)const;
+
+        QFile file;
+        const uchar *data;
+        qint64 size;
+        const uchar *index;
+        int count;
+    };
+
+    /**
+    * @brief Writes a tile pack. Tiles may be added in any order, the index is
+    *        sorted when the pack is finished. Adding a tile twice keeps the first.
+    */
+    class TilePackWriter
+    {
+    public:
+        TilePackWriter();
+        ~TilePackWriter();
+        bool Open(const QString &file);
+        bool AddTile(const MapType::Types &type,const core::Point &pos,const int &zoom,const QByteArray &tile);
+        /**
+        * @brief Writes the index and closes the pack. A pack not finished is removed.
+        */
+        bool Finish();
+        int Count()const{return entries.count();}   // Tiles added so far
+    private:
+        struct Entry
+        {
+            quint64 key;
+            quint64 offset;
+            quint32 size;
+            bool operator<(const Entry &other)const{return key<other.key;}
+        };
+        QFile file;
+        QVector<Entry> entries;
+        bool finished;
+    };
+
+}
+#endif // TILEPACK_H
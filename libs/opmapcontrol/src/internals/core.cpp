@@ -25,6 +25,7 @@
 * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 */
 #include "core.h"
+#include <qmath.h>
 
 #ifdef DEBUG_CORE
 qlonglong internals::Core::debugcounter=0;
@@ -57,10 +58,19 @@ namespace internals {
         dragPoint=Point(0,0);
         CanDragMap=true;
         tilesToload=0;
-        OPMaps::Instance();
+        destroying=false;
+        connect(&OPMaps::Instance()->Downloader,SIGNAL(TileDownloaded(core::RawTile,QByteArray,int)),
+                this,SLOT(OnTileDownloaded(core::RawTile,QByteArray,int)),Qt::DirectConnection);
     }
     Core::~Core()
     {
+        // OnTileDownloaded runs on the thread of the downloader, wait until a
+        // running call is done and keep later ones from using this view
+        MtileDownloaded.lock();
+        destroying=true;
+        disconnect(&OPMaps::Instance()->Downloader,0,this,0);
+        OPMaps::Instance()->Downloader.Cancel(this);
+        MtileDownloaded.unlock();
         ProcessLoadTaskCallback.waitForDone();
     }
 
@@ -123,60 +133,94 @@ namespace internals {
                         Tile* t = new Tile(task.Zoom, task.Pos);
                         QVector<MapType::Types> layers= OPMaps::Instance()->GetAllLayersOfType(GetMapType());
 
+                        bool downloading=false;
                         foreach(MapType::Types tl,layers)
                         {
-                            int retry = 0;
-                            do
+                            // tile number inversion(BottomLeft -> TopLeft) for pergo maps
+                            Point pos=task.Pos;
+                            if(tl == MapType::PergoTurkeyMap)
                             {
-                                QByteArray img;
+                                pos=Point(task.Pos.X(), maxOfTiles.Height() - task.Pos.Y());
+                            }
 
-                                // tile number inversion(BottomLeft -> TopLeft) for pergo maps
-                                if(tl == MapType::PergoTurkeyMap)
+                            // Tiles are decoded here so painting does not need to
+                            RawTile key(tl, pos, task.Zoom);
+                            bool useMemoryCache=OPMaps::Instance()->UseMemoryCache();
+                            QImage img;
+                            if(useMemoryCache)
+                            {
+                                img = OPMaps::Instance()->DecodedTiles.GetTile(key);
+                            }
+                            if(img.isNull())
+                            {
+                                QByteArray data;
+                                bool failed=false;
+                                bool layerDownloading=false;
+                                Mdownloads.lock();
+                                if(downloadingTiles.contains(key))
                                 {
-                                    img = OPMaps::Instance()->GetImageFrom(tl, Point(task.Pos.X(), maxOfTiles.Height() - task.Pos.Y()), task.Zoom);
+                                    layerDownloading=true;
                                 }
-                                else // ok
+                                else if(downloadedTiles.contains(key))
+                                {
+                                    data=downloadedTiles.take(key);
+                                    failed=data.isEmpty();
+                                }
+                                Mdownloads.unlock();
+                                if(layerDownloading)
+                                {
+                                    downloading=true;
+                                    continue;
+                                }
+
+                                if(data.isEmpty() && !failed)
                                 {
 #ifdef DEBUG_CORE
                                     qDebug()<<"start getting image"<<" ID="<<debug;
 #endif //DEBUG_CORE
-                                    img = OPMaps::Instance()->GetImageFrom(tl, task.Pos, task.Zoom);
+                                    data = OPMaps::Instance()->GetImageFromCache(tl, pos, task.Zoom);
+                                    if(data.isEmpty() && OPMaps::Instance()->GetAccessMode()!=AccessMode::CacheOnly)
+                                    {
+                                        // The task is queued again when the download is done
+                                        Mdownloads.lock();
+                                        downloadingTiles.insert(key, task);
+                                        Mdownloads.unlock();
+                                        OPMaps::Instance()->RequestImageFrom(tl, pos, task.Zoom, this);
+                                        downloading=true;
+                                        continue;
+                                    }
+                                }
+                                img = PureImageProxy::Decode(data);
 #ifdef DEBUG_CORE
-                                    qDebug()<<"Core::run:gotimage size:"<<img.count()<<" ID="<<debug<<" time="<<t.elapsed();
+                                qDebug()<<"Core::run:gotimage null:"<<img.isNull()<<" ID="<<debug;
 #endif //DEBUG_CORE
+                                if(useMemoryCache && !img.isNull())
+                                {
+                                    OPMaps::Instance()->DecodedTiles.AddTile(key, img);
                                 }
+                            }
 
-                                if(img.length()!=0)
+                            if(!img.isNull())
+                            {
+                                Moverlays.lock();
                                 {
-                                    Moverlays.lock();
-                                    {
-                                        t->Overlays.append(img);
+                                    t->Overlays.append(img);
 #ifdef DEBUG_CORE
-                                        qDebug()<<"Core::run append img:"<<img.length()<<" to tile:"<<t->GetPos().ToString()<<" now has "<<t->Overlays.count()<<" overlays"<<" ID="<<debug;
+                                    qDebug()<<"Core::run append img:"<<img.byteCount()<<" to tile:"<<t->GetPos().ToString()<<" now has "<<t->Overlays.count()<<" overlays"<<" ID="<<debug;
 #endif //DEBUG_CORE
 
-                                    }
-                                    Moverlays.unlock();
-
-                                    break;
-                                }
-                                else if(OPMaps::Instance()->RetryLoadTile > 0)
-                                {
-#ifdef DEBUG_CORE
-                                    qDebug()<<"ProcessLoadTask: " << task.ToString()<< " -> empty tile, retry " << retry<<" ID="<<debug;;
-#endif //DEBUG_CORE
-                                    {
-                                        QWaitCondition wait;
-                                        QMutex m;
-                                        m.lock();
-                                        wait.wait(&m,500);
-                                    }
                                 }
+                                Moverlays.unlock();
                             }
-                            while(++retry < OPMaps::Instance()->RetryLoadTile);
                         }
 
-                        if(t->Overlays.count() > 0)
+                        if(downloading)
+                        {
+                            // Completed once all layers are downloaded
+                            delete t;
+                            t = 0;
+                        }
+                        else if(t->Overlays.count() > 0)
                         {
                             Matrix.SetTileAt(task.Pos,t);
                             emit OnNeedInvalidation();
@@ -202,6 +246,9 @@ namespace internals {
 
                 {
                     // last buddy cleans stuff ;}
+                    Mdownloads.lock();
+                    last = last && downloadingTiles.isEmpty();
+                    Mdownloads.unlock();
                     if(last)
                     {
                         OPMaps::Instance()->kiberCacheLock.lockForWrite();
@@ -261,6 +308,7 @@ namespace internals {
                 MtileToload.lock();
                 tilesToload=0;
                 MtileToload.unlock();
+                CancelDownloads();
                 Matrix.Clear();
                 GoToCurrentPositionOnZoom();
                 UpdateBounds();
@@ -511,6 +559,7 @@ namespace internals {
             MtileToload.lock();
             tilesToload=0;
             MtileToload.unlock();
+            CancelDownloads();
             Matrix.Clear();
 
             emit OnNeedInvalidation();
@@ -620,14 +669,67 @@ namespace internals {
             MtileToload.lock();
             tilesToload=0;
             MtileToload.unlock();
+            CancelDownloads();
             //  ProcessLoadTaskCallback.waitForDone();
         }
     }
+    void Core::CancelDownloads()
+    {
+        OPMaps::Instance()->Downloader.Cancel(this);
+        Mdownloads.lock();
+        downloadingTiles.clear();
+        downloadRetries.clear();
+        downloadedTiles.clear();
+        Mdownloads.unlock();
+    }
+    void Core::OnTileDownloaded(RawTile tile,QByteArray data,int result)
+    {
+        Q_UNUSED(result);
+        // Called from the thread of the downloader for the tiles of all views
+        QMutexLocker locker(&MtileDownloaded);
+        if(destroying)
+            return;
+        Mdownloads.lock();
+        if(!downloadingTiles.contains(tile))
+        {
+            Mdownloads.unlock();
+            return;
+        }
+        if(data.isEmpty() && ++downloadRetries[tile] < OPMaps::Instance()->RetryLoadTile)
+        {
+#ifdef DEBUG_CORE
+            qDebug()<<"OnTileDownloaded: " << tile.ToString()<< " -> empty tile, retry " << downloadRetries.value(tile);
+#endif //DEBUG_CORE
+            Mdownloads.unlock();
+            OPMaps::Instance()->RequestImageFrom(tile.Type(), tile.Pos(), tile.Zoom(), this);
+            return;
+        }
+        LoadTask task=downloadingTiles.take(tile);
+        downloadRetries.remove(tile);
+        downloadedTiles.insert(tile,data);
+        Mdownloads.unlock();
+
+        // A loader thread decodes the tile and adds it to the matrix
+        MtileLoadQueue.lock();
+        {
+            if(!tileLoadQueue.contains(task))
+            {
+                MtileToload.lock();
+                ++tilesToload;
+                MtileToload.unlock();
+                tileLoadQueue.enqueue(task);
+                ProcessLoadTaskCallback.start(this);
+            }
+        }
+        MtileLoadQueue.unlock();
+    }
     void Core::UpdateBounds()
     {
         MtileDrawingList.lock();
         {
             FindTilesAround(tileDrawingList);
+            // Tiles nearest to the center are downloaded first
+            OPMaps::Instance()->Downloader.SetViewCenter(this, Zoom(), centerTileXYLocation);
 
 #ifdef DEBUG_CORE
             qDebug()<<"OnTileLoadStart: " << tileDrawingList.count() << " tiles to load at zoom " << Zoom() << ", time: " << QDateTime::currentDateTime().date();
@@ -662,6 +764,69 @@ namespace internals {
         MtileDrawingList.unlock();
         UpdateGroundResolution();
     }
+    void Core::SetPrefetchPath(const QList<PointLatLng> &ahead, const QList<PointLatLng> &route)
+    {
+        QList<RawTile> tiles;
+        QSet<RawTile> known;
+        if(started)
+        {
+            // Most important first, the downloader starts the tiles in this order
+            AddPrefetchTiles(tiles, known, ahead, Zoom(), sizeOfMapArea.Width(), sizeOfMapArea.Height());
+            AddPrefetchTiles(tiles, known, route, Zoom(), 1, 1);
+            for(int z=Zoom()-1; z<=Zoom()+1; z+=2)
+            {
+                if(z>=0 && z<=MaxZoom())
+                {
+                    AddPrefetchTiles(tiles, known, ahead, z, 1, 1);
+                    AddPrefetchTiles(tiles, known, route, z, 1, 1);
+                }
+            }
+        }
+        prefetcher.SetTiles(tiles);
+    }
+    void Core::AddPrefetchTiles(QList<RawTile> &tiles, QSet<RawTile> &known, const QList<PointLatLng> &path, const int &zoom, const int &width, const int &height)
+    {
+        // Limits the tiles planned per update, the rest is planned when the vehicle got closer
+        const int maxTiles=512;
+        if(path.isEmpty())
+            return;
+        QVector<MapType::Types> layers=OPMaps::Instance()->GetAllLayersOfType(GetMapType());
+        Size minXY=Projection()->GetTileMatrixMinXY(zoom);
+        Size maxXY=Projection()->GetTileMatrixMaxXY(zoom);
+        int step=Projection()->TileSize().Width()/2;
+        Point last=Projection()->FromLatLngToPixel(path.first(),zoom);
+        for(int i=0;i<path.count();++i)
+        {
+            // The segment is walked in half tile steps so no tile along it is missed
+            Point next=Projection()->FromLatLngToPixel(path.at(i),zoom);
+            qint64 dx=next.X()-last.X();
+            qint64 dy=next.Y()-last.Y();
+            int steps=qMax(1,(int)(qSqrt(dx*dx+dy*dy)/step));
+            for(int s=(i==0)?steps:1;s<=steps;++s)
+            {
+                Point center=Projection()->FromPixelToTileXY(Point(last.X()+dx*s/steps,last.Y()+dy*s/steps));
+                for(int x=center.X()-width;x<=center.X()+width;++x)
+                {
+                    for(int y=center.Y()-height;y<=center.Y()+height;++y)
+                    {
+                        if(x<minXY.Width() || y<minXY.Height() || x>maxXY.Width() || y>maxXY.Height())
+                            continue;
+                        foreach(MapType::Types type,layers)
+                        {
+                            RawTile tile(type,Point(x,y),zoom);
+                            if(known.contains(tile))
+                                continue;
+                            if(tiles.count()>=maxTiles)
+                                return;
+                            known.insert(tile);
+                            tiles.append(tile);
+                        }
+                    }
+                }
+            }
+            last=next;
+        }
+    }
     void Core::FindTilesAround(QList<Point> &list)
     {
         list.clear();;
@@ -39,7 +39,9 @@
 #include "QThreadPool"
 #include "tilematrix.h"
 #include <QQueue>
+#include <QSet>
 #include "loadtask.h"
+#include "tileprefetcher.h"
 #include "copyrightstrings.h"
 #include "rectlatlng.h"
 #include "../internals/projections/lks94projection.h"
@@ -186,6 +188,16 @@ namespace internals {
 
         void FindTilesAround(QList<core::Point> &list);
 
+        /**
+        * @brief Prefetches tiles at low priority. At the current zoom level the
+        *        view is prefetched along ahead and a small band along route, at the
+        *        neighbouring zoom levels a small band along both.
+        *
+        * @param ahead track the view is expected to follow, starting at the vehicle
+        * @param route planned route of the vehicle
+        */
+        void SetPrefetchPath(const QList<PointLatLng> &ahead, const QList<PointLatLng> &route);
+
         void UpdateGroundResolution();
 
         TileMatrix Matrix;
@@ -204,7 +216,13 @@ namespace internals {
         void OnEmptyTileError(int zoom, core::Point pos);
         void OnNeedInvalidation();
 
+    private slots:
+        void OnTileDownloaded(core::RawTile tile,QByteArray data,int result);
+
     private:
+        void CancelDownloads();
+        void AddPrefetchTiles(QList<RawTile> &tiles, QSet<RawTile> &known, const QList<PointLatLng> &path, const int &zoom, const int &width, const int &height);
+
 
 
         PointLatLng currentPosition;
@@ -241,6 +259,16 @@ namespace internals {
 
         QMutex MtileLoadQueue;
 
+        QMutex Mdownloads;
+        QHash<RawTile,LoadTask> downloadingTiles;   // Tiles being downloaded and the task to complete with them
+        QHash<RawTile,int> downloadRetries;
+        QHash<RawTile,QByteArray> downloadedTiles;  // Downloaded tiles not yet decoded, empty if the download failed
+
+        QMutex MtileDownloaded;     // Held by OnTileDownloaded, the destructor waits for it
+        bool destroying;
+
+        TilePrefetcher prefetcher;
+
         QMutex Moverlays;
 
         QMutex MtileDrawingList;
@@ -4,6 +4,7 @@ HEADERS += core.h \
     rectangle.h \
     tile.h \
     tilematrix.h \
+    tileprefetcher.h \
     loadtask.h \
     copyrightstrings.h \
     pureprojection.h \
@@ -15,6 +16,7 @@ SOURCES += core.cpp \
     rectangle.cpp \
     tile.cpp \
     tilematrix.cpp \
+    tileprefetcher.cpp \
     pureprojection.cpp \
     rectlatlng.cpp \
     sizelatlng.cpp \
@@ -53,7 +53,7 @@ public:
         this->pos=cSource.pos;
     }
     bool HasValue(){return !(zoom==0);}
-    QList<QByteArray> Overlays;
+    QList<QImage> Overlays;     // Decoded image of each layer
 protected:
 
     QMutex mutex;
@@ -0,0 +1,104 @@
+/**
+******************************************************************************
+*
+* @file       tileprefetcher.cpp
+* @author     APM_PLANNER Project, http://www.diydrones.com Copyright (C) 2016.
+* @brief      Prefetches map tiles ahead of the vehicle and along the route
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/* 
+* This program is free software; you can redistribute it and/or modify 
+* it under the terms of the GNU General Public License as published by 
+* the Free Software Foundation; either version 3 of the License, or 
+* (at your option) any later version.
+* 
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License 
+* for more details.
+* 
+* You should have received a copy of the GNU General Public License along 
+* with this program; if not, write to the Free Software Foundation, Inc., 
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include "tileprefetcher.h"
+#include "../core/opmaps.h"
+#include <QThreadPool>
+//#define DEBUG_TILEPREFETCHER
+namespace internals {
+    TilePrefetcher::TilePrefetcher():hasPending(false),running(false)
+    {
+        setAutoDelete(false);
+    }
+    TilePrefetcher::~TilePrefetcher()
+    {
+        mutex.lock();
+        hasPending=false;
+        pending.clear();
+        while(running)
+            idle.wait(&mutex);
+        mutex.unlock();
+    }
+
+    void TilePrefetcher::SetTiles(const QList<core::RawTile> &tiles)
+    {
+        QMutexLocker locker(&mutex);
+        pending=tiles;
+        hasPending=true;
+        if(!running)
+        {
+            running=true;
+            QThreadPool::globalInstance()->start(this);
+        }
+    }
+
+    bool TilePrefetcher::IsCached(const core::RawTile &tile)
+    {
+        if(cached.contains(tile))
+            return true;
+        core::RawTile t=tile;
+        bool found=core::OPMaps::Instance()->IsTileCached(t.Type(),t.Pos(),t.Zoom());
+        if(found)
+        {
+            // Keep the set small, it is refilled by the next lookups
+            if(cached.count()>=16384)
+                cached.clear();
+            cached.insert(tile);
+        }
+        return found;
+    }
+
+    void TilePrefetcher::run()
+    {
+        while(true)
+        {
+            mutex.lock();
+            if(!hasPending)
+            {
+                running=false;
+                idle.wakeAll();
+                mutex.unlock();
+                return;
+            }
+            QList<core::RawTile> tiles=pending;
+            pending.clear();
+            hasPending=false;
+            mutex.unlock();
+
+            QList<core::RawTile> missing;
+            foreach(const core::RawTile &tile,tiles)
+            {
+                if(!IsCached(tile))
+                    missing.append(tile);
+            }
+#ifdef DEBUG_TILEPREFETCHER
+            qDebug()<<"TilePrefetcher: "<<missing.count()<<" of "<<tiles.count()<<" tiles not cached";
+#endif //DEBUG_TILEPREFETCHER
+            core::OPMaps::Instance()->PrefetchImages(missing);
+        }
+    }
+
+}
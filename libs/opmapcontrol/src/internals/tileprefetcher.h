@@ -0,0 +1,69 @@
+/**
+******************************************************************************
+*
+* @file       tileprefetcher.h
+* @author     APM_PLANNER Project, http://www.diydrones.com Copyright (C) 2016.
+* @brief      Prefetches map tiles ahead of the vehicle and along the route
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/* 
+* This program is free software; you can redistribute it and/or modify 
+* it under the terms of the GNU General Public License as published by 
+* the Free Software Foundation; either version 3 of the License, or 
+* (at your option) any later version.
+* 
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License 
+* for more details.
+* 
+* You should have received a copy of the GNU General Public License along 
+* with this program; if not, write to the Free Software Foundation, Inc., 
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef TILEPREFETCHER_H
+#define TILEPREFETCHER_H
+
+#include <QRunnable>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QSet>
+#include "../core/rawtile.h"
+
+namespace internals {
+    /**
+    * @brief Hands the tiles planned for prefetching to the downloader. The
+    *        cache lookups are done in a thread of the global thread pool, so the
+    *        gui thread only plans the tiles. Tiles found in a cache are remembered
+    *        and not looked up again.
+    */
+    class TilePrefetcher:public QRunnable
+    {
+    public:
+        TilePrefetcher();
+        ~TilePrefetcher();
+
+        /**
+        * @brief Replaces the tiles to prefetch, an empty list stops prefetching
+        *
+        * @param tiles tiles to prefetch, most important first
+        */
+        void SetTiles(const QList<core::RawTile> &tiles);
+        void run();
+    private:
+        bool IsCached(const core::RawTile &tile);
+
+        QMutex mutex;
+        QWaitCondition idle;
+        QList<core::RawTile> pending;
+        bool hasPending;
+        bool running;
+        QSet<core::RawTile> cached;     // Only used by run()
+    };
+
+}
+#endif // TILEPREFETCHER_H
@@ -387,14 +387,15 @@ namespace mapcontrol
                             //lock(t.Overlays)
                             if(t!=0)
                             {
-                                foreach(QByteArray img,t->Overlays)
+                                foreach(const QImage &img,t->Overlays)
                                 {
-                                    if(img.count()!=0)
+                                    if(!img.isNull())
                                     {
                                         if(!found)
                                             found = true;
                                         {
-                                            painter->drawPixmap(core->tileRect.X(),core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height(),PureImageProxy::FromStream(img));
+                                            // Tiles are decoded by the loader threads, painting only blits them
+                                            painter->drawImage(QRect(core->tileRect.X(),core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height()),img);
                                            // qDebug()<<"tile:"<<core->tileRect.X()<<core->tileRect.Y();
                                         }
                                     }
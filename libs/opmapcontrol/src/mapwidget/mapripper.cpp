@@ -31,11 +31,13 @@
 #include <QScreen>
 #include <QCursor>
 #include <QDebug>
+#include <QTime>
+//#define DEBUG_MAPRIPPER
 
 namespace mapcontrol
 {
 
-MapRipper::MapRipper(internals::Core * core, const internals::RectLatLng & rect):sleep(100),cancel(false),progressForm(0),core(core)
+MapRipper::MapRipper(internals::Core * core, const internals::RectLatLng & rect):startIndex(0),cancel(false),progressForm(0),core(core)
 {
     if(!rect.IsEmpty())
     {
@@ -44,6 +46,12 @@ MapRipper::MapRipper(internals::Core * core, const internals::RectLatLng & rect)
         area=rect;
         zoom=core->Zoom();
         maxzoom=core->MaxZoom();
+        if(LoadCheckpoint())
+        {
+#ifdef DEBUG_MAPRIPPER
+            qDebug() << "MapRipper: resuming at zoom" << zoom << "point" << startIndex;
+#endif //DEBUG_MAPRIPPER
+        }
         points=core->Projection()->GetAreaTileList(area,zoom,0);
         progressForm->show();
 
@@ -103,60 +111,211 @@ void MapRipper::finish()
             {
                 this->doRip();
             }else{
+                ClearCheckpoint();
                 this->stopRipping();
             }
         }
     }
     else
     {
+        // A canceled ripping keeps its checkpoint to be resumed later
+        if(cancel==false)
+            ClearCheckpoint();
         this->stopRipping();
     }
 }
 
 void MapRipper::run()
 {
-    int countOk = 0;
-    bool goodtile=false;
-    //  Stuff.Shuffle<Point>(ref list);
     QVector<core::MapType::Types> types = OPMaps::Instance()->GetAllLayersOfType(type);
     int all=points.count();
-    for(int i = 0; i < all; i++)
+    QVector<int> remaining(all,types.count());  // Layers of each point not yet processed
+    QVector<bool> complete(all,true);           // False if a layer of the point failed
+    QHash<core::RawTile,int> retries;
+    int next=qMin(startIndex,all);              // Next point to request
+    int checkpoint=next;                        // All points before are cached
+    int processed=next;
+#ifdef DEBUG_MAPRIPPER
+    int failed=0;
+#endif //DEBUG_MAPRIPPER
+    QTime lastSave;
+    lastSave.start();
+
+    connect(&OPMaps::Instance()->Downloader,SIGNAL(TileDownloaded(core::RawTile,QByteArray,int)),
+            this,SLOT(TileDownloaded(core::RawTile,QByteArray,int)),Qt::DirectConnection);
+    emit providerChanged(core::MapType::StrByType(type),zoom);
+    emit numberOfTilesChanged(all,processed);
+
+    while(!cancel)
     {
-        emit numberOfTilesChanged(all,i+1);
-        if(cancel)
-            break;
+        mutex.lock();
+        QList<RipTile> done=doneTiles;
+        QList<RipTile> retry=failedTiles;
+        doneTiles.clear();
+        failedTiles.clear();
+        int flying=inFlight.count();
+        mutex.unlock();
 
-        core::Point p = points[i];
+        foreach(const RipTile &tile,done)
         {
-            //qDebug()<<"offline fetching:"<<p.ToString();
-            foreach(core::MapType::Types type,types)
-            {
-                emit providerChanged(core::MapType::StrByType(type),zoom);
-                QByteArray img = OPMaps::Instance()->GetImageFrom(type, p, zoom);
-                if(img.length()!=0)
-                {
-                    goodtile=true;
-                    img=NULL;
-                }
-                else
-                    goodtile=false;
-            }
-            if(goodtile)
+            if(--remaining[tile.index]==0)
+                ++processed;
+        }
+        foreach(RipTile tile,retry)
+        {
+            if(++retries[tile.tile]<OPMaps::Instance()->RetryLoadTile)
             {
-                countOk++;
+                mutex.lock();
+                inFlight.insert(tile.tile,tile.index);
+                mutex.unlock();
+                OPMaps::Instance()->RequestImageFrom(tile.tile.Type(),tile.tile.Pos(),zoom,this);
+                ++flying;
+                continue;
             }
-            else
+#ifdef DEBUG_MAPRIPPER
+            qDebug() << "MapRipper: unable to download" << tile.tile.ToString();
+            ++failed;
+#endif //DEBUG_MAPRIPPER
+            complete[tile.index]=false;
+            if(--remaining[tile.index]==0)
+                ++processed;
+        }
+
+        // Keep the downloader busy, cached tiles are skipped
+        while(flying<MaxInFlight && next<all && !cancel)
+        {
+            core::Point p=points.at(next);
+            foreach(core::MapType::Types layer,types)
             {
-                i--;
-                QThread::msleep(1000);
-                continue;
+                if(OPMaps::Instance()->IsTileCached(layer,p,zoom))
+                {
+                    --remaining[next];
+                    continue;
+                }
+                mutex.lock();
+                inFlight.insert(core::RawTile(layer,p,zoom),next);
+                mutex.unlock();
+                OPMaps::Instance()->RequestImageFrom(layer,p,zoom,this);
+                ++flying;
             }
+            if(remaining[next]==0)
+                ++processed;
+            ++next;
+        }
+
+        while(checkpoint<all && remaining[checkpoint]==0 && complete[checkpoint])
+            ++checkpoint;
+        if(lastSave.elapsed()>2000)
+        {
+            SaveCheckpoint(zoom,checkpoint);
+            lastSave.restart();
         }
-        emit percentageChanged((int) ((i+1)*100/all));//, i+1);
-        // worker.ReportProgress((int) ((i+1)*100/all), i+1);
+        emit numberOfTilesChanged(all,processed);
+        emit percentageChanged(all>0?(int)((qint64)processed*100/all):100);
+
+        if(processed>=all)
+            break;
+        mutex.lock();
+        if(doneTiles.isEmpty() && failedTiles.isEmpty())
+            tileDone.wait(&mutex,500);
+        mutex.unlock();
+    }
+
+    disconnect(&OPMaps::Instance()->Downloader,0,this,0);
+    OPMaps::Instance()->Downloader.Cancel(this);
+    mutex.lock();
+    inFlight.clear();
+    doneTiles.clear();
+    failedTiles.clear();
+    mutex.unlock();
 
-        QThread::msleep(sleep);
+    if(cancel)
+    {
+        SaveCheckpoint(zoom,checkpoint);
+    }
+    else
+    {
+#ifdef DEBUG_MAPRIPPER
+        if(failed>0)
+            qDebug() << "MapRipper:" << failed << "tiles of zoom" << zoom << "could not be downloaded";
+#endif //DEBUG_MAPRIPPER
+        SaveCheckpoint(zoom+1,0);
     }
+    startIndex=0;
+}
+
+void MapRipper::TileDownloaded(core::RawTile tile,QByteArray data,int result)
+{
+    Q_UNUSED(result);
+    // Called from the thread of the downloader, the tile is already cached
+    QMutexLocker locker(&mutex);
+    QHash<core::RawTile,int>::iterator i=inFlight.find(tile);
+    if(i==inFlight.end())
+        return;
+    RipTile ripTile(tile,i.value());
+    inFlight.erase(i);
+    if(data.isEmpty())
+        failedTiles.append(ripTile);
+    else
+        doneTiles.append(ripTile);
+    tileDone.wakeAll();
+}
+
+bool MapRipper::HasCheckpoint()
+{
+    QSettings settings;
+    settings.beginGroup("MAP_RIPPER");
+    return settings.contains("ZOOM");
+}
+
+internals::RectLatLng MapRipper::CheckpointArea()
+{
+    QSettings settings;
+    settings.beginGroup("MAP_RIPPER");
+    return internals::RectLatLng(settings.value("LAT").toDouble(),settings.value("LNG").toDouble(),
+                                 settings.value("WIDTH_LNG").toDouble(),settings.value("HEIGHT_LAT").toDouble());
+}
+
+bool MapRipper::LoadCheckpoint()
+{
+    if(!HasCheckpoint())
+        return false;
+    internals::RectLatLng saved=CheckpointArea();
+    QSettings settings;
+    settings.beginGroup("MAP_RIPPER");
+    const double epsilon=1e-9;
+    if(settings.value("TYPE").toInt()!=(int)type ||
+       qAbs(saved.Lat()-area.Lat())>epsilon || qAbs(saved.Lng()-area.Lng())>epsilon ||
+       qAbs(saved.WidthLng()-area.WidthLng())>epsilon || qAbs(saved.HeightLat()-area.HeightLat())>epsilon)
+    {
+        return false;
+    }
+    int savedZoom=settings.value("ZOOM").toInt();
+    if(savedZoom<zoom || savedZoom>maxzoom)
+        return false;
+    zoom=savedZoom;
+    startIndex=settings.value("INDEX").toInt();
+    return true;
+}
+
+void MapRipper::SaveCheckpoint(const int &zoom,const int &index)
+{
+    QSettings settings;
+    settings.beginGroup("MAP_RIPPER");
+    settings.setValue("TYPE",(int)type);
+    settings.setValue("LAT",area.Lat());
+    settings.setValue("LNG",area.Lng());
+    settings.setValue("WIDTH_LNG",area.WidthLng());
+    settings.setValue("HEIGHT_LAT",area.HeightLat());
+    settings.setValue("ZOOM",zoom);
+    settings.setValue("INDEX",index);
+    settings.endGroup();
+}
+
+void MapRipper::ClearCheckpoint()
+{
+    QSettings settings;
+    settings.remove("MAP_RIPPER");
 }
 
 void MapRipper::doRip()
@@ -32,8 +32,19 @@
 #include "mapripform.h"
 #include <QObject>
 #include <QMessageBox>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
 namespace mapcontrol
 {
+    /**
+    * @brief Caches the tiles of an area for offline use, one zoom level after the
+    *        other. Tiles are requested from the downloader of OPMaps, up to MaxInFlight
+    *        at once, after the tiles of the map views. Tiles which are already cached
+    *        are skipped. The progress is stored as checkpoint in the settings, so
+    *        an interrupted ripping continues where it stopped when the same area is
+    *        ripped again.
+    */
     class MapRipper:public QThread
     {
         Q_OBJECT
@@ -43,11 +54,39 @@ namespace mapcontrol
         void moveFormToCenter();
         void doRip();
 
+        /**
+        * @brief Returns true if an interrupted ripping can be resumed
+        */
+        static bool HasCheckpoint();
+        /**
+        * @brief Returns the area of the interrupted ripping
+        */
+        static internals::RectLatLng CheckpointArea();
+
+    private slots:
+        void TileDownloaded(core::RawTile tile,QByteArray data,int result);
+
     private:
+        struct RipTile
+        {
+            RipTile(const core::RawTile &tile,const int &index):tile(tile),index(index){}
+            core::RawTile tile;
+            int index;          // Index of the point of the tile
+        };
+        static const int MaxInFlight=64;
+        bool LoadCheckpoint();
+        void SaveCheckpoint(const int &zoom,const int &index);
+        static void ClearCheckpoint();
+
         QList<core::Point> points;
         int zoom;
         core::MapType::Types type;
-        int sleep;
+        int startIndex;         // First point to rip, all before are cached
+        QMutex mutex;
+        QWaitCondition tileDone;
+        QHash<core::RawTile,int> inFlight;      // Requested tiles and the index of their point
+        QList<RipTile> doneTiles;               // Downloaded tiles not yet counted by run()
+        QList<RipTile> failedTiles;
         internals::RectLatLng area;
         bool cancel;
         MapRipForm * progressForm;
@@ -14,6 +14,7 @@ SOURCES += mapgraphicitem.cpp \
     homeitem.cpp \
     mapripform.cpp \
     mapripper.cpp \
+    tilepackexporter.cpp \
     traillineitem.cpp
 
 LIBS += -L../build \
@@ -39,6 +40,7 @@ HEADERS += mapgraphicitem.h \
     homeitem.h \
     mapripform.h \
     mapripper.h \
+    tilepackexporter.h \
     traillineitem.h
 QT += opengl
 QT += network
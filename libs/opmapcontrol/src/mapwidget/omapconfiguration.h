@@ -146,6 +146,28 @@ public:
     */
     void SetTileMemorySize(int const& value){core::OPMaps::Instance()->TilesInMemory.setMemoryCacheCapacity(value);}
 
+    /**
+    * @brief  Sets the size of the memory for decoded tiles ready to be painted
+    *
+    * @param  value size in Mb to use for decoded tiles
+    * @return
+    */
+    void SetDecodedTileMemorySize(int const& value){core::OPMaps::Instance()->DecodedTiles.setCapacity(value);}
+
+    /**
+    * @brief  Sets the bandwidth used to prefetch tiles ahead of the vehicle
+    *
+    * @param  value bandwidth in kB/s, 0 disables prefetching
+    * @return
+    */
+    void SetPrefetchBudget(int const& value){core::OPMaps::Instance()->Downloader.SetPrefetchBudget(value*1024);}
+    /**
+    * @brief  Returns the bandwidth used to prefetch tiles in kB/s
+    *
+    * @return
+    */
+    int PrefetchBudget(){return core::OPMaps::Instance()->Downloader.PrefetchBudget()/1024;}
+
     /**
     * @brief Sets the location for the SQLite Database used for caching and the geocoding cache files
     *
@@ -174,6 +196,14 @@ public:
     */
     void ExportMapDataToDB(QString const& sourceDB, QString const& destDB)const{core::PureImageCache::ExportMapDataToDB(sourceDB,destDB);}
     /**
+    * @brief  Copies a tile pack to the cache location and serves its tiles ahead of the DB.
+    *         A pack of the same name is replaced.
+    *
+    * @param file the tile pack
+    * @return true on success
+    */
+    bool ImportTilePack(QString const& file){return core::Cache::Instance()->ImportTilePack(file);}
+    /**
     * @brief Returns the location for the SQLite Database used for caching and the geocoding cache files
     *
     * @return
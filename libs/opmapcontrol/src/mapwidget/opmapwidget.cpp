@@ -464,6 +464,14 @@ namespace mapcontrol
     {
         new MapRipper(core,map->SelectedArea());
     }
+    void OPMapWidget::ResumeRipMap()
+    {
+        new MapRipper(core,MapRipper::CheckpointArea());
+    }
+    TilePackExporter* OPMapWidget::ExportTilePack(QString const& file, internals::RectLatLng const& area, int const& minZoom, int const& maxZoom)
+    {
+        return new TilePackExporter(core,file,area,minZoom,maxZoom);
+    }
 
 
 #define deg_to_rad          ((double)M_PI / 180.0)
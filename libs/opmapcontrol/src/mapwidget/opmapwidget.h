@@ -43,6 +43,7 @@
 #include "homeitem.h"
 #include "waypointlineitem.h"
 #include "mapripper.h"
+#include "tilepackexporter.h"
 #include "uavtrailtype.h"
 namespace mapcontrol
 {
@@ -232,6 +233,30 @@ namespace mapcontrol
 
         void ReloadMap(){map->ReloadMap(); map->resize();}
 
+        /**
+        * @brief Prefetches tiles at low priority, see Configuration::SetPrefetchBudget()
+        *
+        * @param ahead track the map is expected to follow, starting at the vehicle
+        * @param route planned route of the vehicle
+        */
+        void SetPrefetchPath(QList<internals::PointLatLng> const& ahead, QList<internals::PointLatLng> const& route){map->core->SetPrefetchPath(ahead,route);}
+
+        /**
+        * @brief Returns true if an interrupted ripping can be resumed, see ResumeRipMap()
+        */
+        bool HasRipCheckpoint(){return MapRipper::HasCheckpoint();}
+
+        /**
+        * @brief Creates an exporter writing the cached tiles of an area to a tile pack.
+        *        Connect to its signals, then start() it. It deletes itself when done.
+        *
+        * @param file the tile pack to create
+        * @param area area to export
+        * @param minZoom first zoom level to export
+        * @param maxZoom last zoom level to export
+        */
+        TilePackExporter* ExportTilePack(QString const& file, internals::RectLatLng const& area, int const& minZoom, int const& maxZoom);
+
         GeoCoderStatusCode::Types SetCurrentPositionByKeywords(QString const& keys){return map->SetCurrentPositionByKeywords(keys);}
 
         bool UseOpenGL(){return useOpenGL;}
@@ -510,6 +535,10 @@ namespace mapcontrol
         * @brief Ripps the current selection to the DB
         */
         void RipMap();
+        /**
+        * @brief Continues the interrupted ripping of an area
+        */
+        void ResumeRipMap();
 
         /**
         * @brief Sets the map zoom level
@@ -0,0 +1,95 @@
+/**
+******************************************************************************
+*
+* @file       tilepackexporter.cpp
+* @author     APM_PLANNER Project, http://www.diydrones.com Copyright (C) 2016.
+* @brief      A class that writes the cached tiles of an area to a tile pack
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include "tilepackexporter.h"
+#include "../core/cache.h"
+#include "../core/tilepack.h"
+#include <QTime>
+
+namespace mapcontrol
+{
+
+TilePackExporter::TilePackExporter(internals::Core * core, const QString &file, const internals::RectLatLng &area, const int &minZoom, const int &maxZoom):file(file),minZoom(minZoom),cancel(false)
+{
+    // The projection belongs to the map, so the tile lists are made here and not in run()
+    type=core->GetMapType();
+    for(int zoom=minZoom;zoom<=maxZoom;++zoom)
+    {
+        points.append(core->Projection()->GetAreaTileList(area,zoom,0));
+    }
+    connect(this,SIGNAL(finished()),this,SLOT(deleteLater()));
+}
+
+void TilePackExporter::run()
+{
+    QVector<core::MapType::Types> types=core::OPMaps::Instance()->GetAllLayersOfType(type);
+    int all=0;
+    foreach(const QList<core::Point> &zoomPoints,points)
+        all+=zoomPoints.count()*types.count();
+    int processed=0;
+    int count=-1;
+    QTime lastReport;
+    lastReport.start();
+    emit numberOfTilesChanged(all,processed);
+    {
+        // A pack which is not finished is removed by the writer
+        core::TilePackWriter writer;
+        bool ok=writer.Open(file);
+        for(int i=0;i<points.count() && ok && !cancel;++i)
+        {
+            int zoom=minZoom+i;
+            foreach(core::Point p,points.at(i))
+            {
+                foreach(core::MapType::Types layer,types)
+                {
+                    QByteArray data=core::Cache::Instance()->GetImageFromTilePacks(layer,p,zoom);
+                    if(data.isEmpty())
+                        data=core::Cache::Instance()->ImageCache.GetImageFromCache(layer,p,zoom);
+                    if(!data.isEmpty() && !writer.AddTile(layer,p,zoom,data))
+                        ok=false;
+                    ++processed;
+                }
+                if(!ok || cancel)
+                    break;
+                if(lastReport.elapsed()>200)
+                {
+                    emit numberOfTilesChanged(all,processed);
+                    lastReport.restart();
+                }
+            }
+        }
+        if(ok && !cancel)
+        {
+            int written=writer.Count();
+            if(writer.Finish())
+                count=written;
+        }
+    }
+    emit numberOfTilesChanged(all,processed);
+    emit exportFinished(file,count);
+}
+
+}
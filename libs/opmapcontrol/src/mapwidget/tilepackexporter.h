@@ -0,0 +1,74 @@
+/**
+******************************************************************************
+*
+* @file       tilepackexporter.h
+* @author     APM_PLANNER Project, http://www.diydrones.com Copyright (C) 2016.
+* @brief      A class that writes the cached tiles of an area to a tile pack
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef TILEPACKEXPORTER_H
+#define TILEPACKEXPORTER_H
+
+#include <QThread>
+#include "../internals/core.h"
+
+namespace mapcontrol
+{
+    /**
+    * @brief Writes the cached tiles of an area to a tile pack in its own thread,
+    *        so large areas do not block the user interface. Tiles which are not
+    *        cached are skipped. A canceled or failed export removes the pack.
+    *        The exporter deletes itself when it is done.
+    */
+    class TilePackExporter:public QThread
+    {
+        Q_OBJECT
+    public:
+        /**
+        * @brief Collects the tiles of the area, the export begins with start()
+        */
+        TilePackExporter(internals::Core *,QString const& file,internals::RectLatLng const& area,int const& minZoom,int const& maxZoom);
+        void run();
+
+    signals:
+        void numberOfTilesChanged(int const& total,int const& actual);
+        /**
+        * @brief Emitted when the export is done
+        *
+        * @param file the tile pack
+        * @param count number of exported tiles, -1 on error or if canceled
+        */
+        void exportFinished(QString const& file,int const& count);
+
+    public slots:
+        void cancelExport(){
+            this->cancel=true;
+        }
+
+    private:
+        QString file;
+        QList<QList<core::Point> > points;      // Tiles of each zoom level
+        int minZoom;
+        core::MapType::Types type;
+        bool cancel;
+    };
+}
+#endif // TILEPACKEXPORTER_H
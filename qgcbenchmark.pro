@@ -0,0 +1,124 @@
+# -------------------------------------------------
+# APM Planner - headless benchmarks
+#
+# Builds a console application running performance benchmarks of the
+# log loading and data handling code without the user interface.
+#
+# Usage: qgcbenchmark [BenchmarkName ...] [--option value ...]
+# -------------------------------------------------
+
+CONFIG += qt \
+    thread \
+    console
+CONFIG -= app_bundle
+QT += core \
+    gui \
+    network \
+    sql
+
+TEMPLATE = app
+TARGET = qgcbenchmark
+BASEDIR = $${IN_PWD}
+BENCHMARKDIR = $$BASEDIR/src/qgcbenchmark
+LANGUAGE = C++
+
+linux-g++|linux-g++-64{
+    debug {
+        TARGETDIR = $${OUT_PWD}/debug
+        BUILDDIR = $${OUT_PWD}/build-debug
+    }
+    release {
+        TARGETDIR = $${OUT_PWD}/release
+        BUILDDIR = $${OUT_PWD}/build-release
+    }
+} else {
+    TARGETDIR = $${OUT_PWD}
+    BUILDDIR = $${OUT_PWD}/build
+}
+OBJECTS_DIR = $${BUILDDIR}/obj
+MOC_DIR = $${BUILDDIR}/moc
+
+#
+# Logging Library
+#
+include (QsLog/QsLog.pri)
+
+INCLUDEPATH += $$BASEDIR \
+    $$BASEDIR/src \
+    $$BASEDIR/src/ui \
+    $$BASEDIR/src/ui/linechart \
+    $$BASEDIR/src/uas \
+    $$BASEDIR/src/comm \
+    $$BASEDIR/libs/mavlink/include/mavlink/v1.0 \
+    $$BASEDIR/libs/mavlink/include/mavlink/v1.0/ardupilotmega \
+    $$BASEDIR/libs/opmapcontrol/src/core \
+    $$BASEDIR/libs/qwt \
+    $$BENCHMARKDIR
+
+DEFINES += MAVLINK_NO_DATA \
+    QGC_USE_ARDUPILOTMEGA_MESSAGES
+
+HEADERS += \
+    src/configuration.h \
+    src/globalobject.h \
+    src/QGC.h \
+    src/uas/ApmLogMessages.h \
+    src/ui/AP2DataPlot2DModel.h \
+    src/ui/AP2DataPlotColumnStore.h \
+    src/ui/AP2DataPlotRecordBatch.h \
+    src/ui/AP2DataPlotTimeIndex.h \
+    src/ui/AP2DataPlotLogCache.h \
+    src/ui/AP2DataPlotStatus.h \
+    src/ui/AP2DataPlotBinaryParser.h \
+    src/ui/AP2DataPlotParallelParser.h \
+    src/ui/AP2DataPlotTLogParser.h \
+    src/ui/AP2DataPlotThread.h \
+    src/ui/linechart/RollingStatistics.h \
+    src/ui/linechart/TimeSeriesBuffer.h \
+    src/ui/linechart/TimeSeriesCurveData.h \
+    libs/qwt/qwt_data.h \
+    libs/opmapcontrol/src/core/maptype.h \
+    libs/opmapcontrol/src/core/point.h \
+    libs/opmapcontrol/src/core/size.h \
+    libs/opmapcontrol/src/core/pureimagecache.h \
+    libs/opmapcontrol/src/core/rawtile.h \
+    libs/opmapcontrol/src/core/tiledownloader.h \
+    $$BENCHMARKDIR/AutoBenchmark.h \
+    $$BENCHMARKDIR/DataflashLogGenerator.h \
+    $$BENCHMARKDIR/LocalTileServer.h \
+    $$BENCHMARKDIR/TileDownloadBenchmark.h
+
+SOURCES += \
+    src/globalobject.cc \
+    src/QGC.cc \
+    src/uas/ApmLogMessages.cc \
+    src/ui/AP2DataPlot2DModel.cc \
+    src/ui/AP2DataPlotColumnStore.cc \
+    src/ui/AP2DataPlotRecordBatch.cc \
+    src/ui/AP2DataPlotTimeIndex.cc \
+    src/ui/AP2DataPlotLogCache.cc \
+    src/ui/AP2DataPlotStatus.cc \
+    src/ui/AP2DataPlotBinaryParser.cc \
+    src/ui/AP2DataPlotParallelParser.cc \
+    src/ui/AP2DataPlotTLogParser.cc \
+    src/ui/AP2DataPlotThread.cc \
+    src/ui/linechart/RollingStatistics.cc \
+    src/ui/linechart/TimeSeriesBuffer.cc \
+    src/ui/linechart/TimeSeriesCurveData.cc \
+    libs/qwt/qwt_data.cpp \
+    libs/opmapcontrol/src/core/point.cpp \
+    libs/opmapcontrol/src/core/size.cpp \
+    libs/opmapcontrol/src/core/pureimagecache.cpp \
+    libs/opmapcontrol/src/core/rawtile.cpp \
+    libs/opmapcontrol/src/core/tiledownloader.cpp \
+    $$BENCHMARKDIR/benchmarkSuite.cc \
+    $$BENCHMARKDIR/DataflashLogGenerator.cc \
+    $$BENCHMARKDIR/DataflashParserBenchmark.cc \
+    $$BENCHMARKDIR/DataflashParallelParserBenchmark.cc \
+    $$BENCHMARKDIR/DataflashAsciiParserBenchmark.cc \
+    $$BENCHMARKDIR/TLogParserBenchmark.cc \
+    $$BENCHMARKDIR/RollingStatisticsBenchmark.cc \
+    $$BENCHMARKDIR/TimeSeriesBufferBenchmark.cc \
+    $$BENCHMARKDIR/TileCacheBenchmark.cc \
+    $$BENCHMARKDIR/LocalTileServer.cc \
+    $$BENCHMARKDIR/TileDownloadBenchmark.cc
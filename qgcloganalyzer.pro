@@ -0,0 +1,90 @@
+# -------------------------------------------------
+# APM Planner - headless log analyzer
+#
+# Builds a console application which loads dataflash and telemetry logs
+# using the log parsers of the graph view, without the user interface,
+# and exports series and summary statistics of them.
+#
+# Usage: qgcloganalyzer [--option value ...] <log or directory> ...
+# -------------------------------------------------
+
+CONFIG += qt \
+    thread \
+    console
+CONFIG -= app_bundle
+QT += core \
+    gui \
+    sql
+
+TEMPLATE = app
+TARGET = qgcloganalyzer
+BASEDIR = $${IN_PWD}
+ANALYZERDIR = $$BASEDIR/src/qgcloganalyzer
+LANGUAGE = C++
+
+linux-g++|linux-g++-64{
+    debug {
+        TARGETDIR = $${OUT_PWD}/debug
+        BUILDDIR = $${OUT_PWD}/build-debug
+    }
+    release {
+        TARGETDIR = $${OUT_PWD}/release
+        BUILDDIR = $${OUT_PWD}/build-release
+    }
+} else {
+    TARGETDIR = $${OUT_PWD}
+    BUILDDIR = $${OUT_PWD}/build
+}
+OBJECTS_DIR = $${BUILDDIR}/obj
+MOC_DIR = $${BUILDDIR}/moc
+
+#
+# Logging Library
+#
+include (QsLog/QsLog.pri)
+
+INCLUDEPATH += $$BASEDIR \
+    $$BASEDIR/src \
+    $$BASEDIR/src/ui \
+    $$BASEDIR/src/uas \
+    $$BASEDIR/src/comm \
+    $$BASEDIR/libs/mavlink/include/mavlink/v1.0 \
+    $$BASEDIR/libs/mavlink/include/mavlink/v1.0/ardupilotmega \
+    $$ANALYZERDIR
+
+DEFINES += MAVLINK_NO_DATA \
+    QGC_USE_ARDUPILOTMEGA_MESSAGES
+
+HEADERS += \
+    src/configuration.h \
+    src/globalobject.h \
+    src/QGC.h \
+    src/uas/ApmLogMessages.h \
+    src/ui/AP2DataPlot2DModel.h \
+    src/ui/AP2DataPlotColumnStore.h \
+    src/ui/AP2DataPlotRecordBatch.h \
+    src/ui/AP2DataPlotTimeIndex.h \
+    src/ui/AP2DataPlotLogCache.h \
+    src/ui/AP2DataPlotStatus.h \
+    src/ui/AP2DataPlotBinaryParser.h \
+    src/ui/AP2DataPlotParallelParser.h \
+    src/ui/AP2DataPlotTLogParser.h \
+    src/ui/AP2DataPlotThread.h \
+    $$ANALYZERDIR/LogAnalyzer.h
+
+SOURCES += \
+    src/globalobject.cc \
+    src/QGC.cc \
+    src/uas/ApmLogMessages.cc \
+    src/ui/AP2DataPlot2DModel.cc \
+    src/ui/AP2DataPlotColumnStore.cc \
+    src/ui/AP2DataPlotRecordBatch.cc \
+    src/ui/AP2DataPlotTimeIndex.cc \
+    src/ui/AP2DataPlotLogCache.cc \
+    src/ui/AP2DataPlotStatus.cc \
+    src/ui/AP2DataPlotBinaryParser.cc \
+    src/ui/AP2DataPlotParallelParser.cc \
+    src/ui/AP2DataPlotTLogParser.cc \
+    src/ui/AP2DataPlotThread.cc \
+    $$ANALYZERDIR/LogAnalyzer.cc \
+    $$ANALYZERDIR/main.cc
@@ -0,0 +1,32 @@
+# -------------------------------------------------
+# APM Planner - headless MAVLink receive benchmark
+#
+# Builds the application sources with a console entry point which replays a
+# tlog or simulated telemetry through MAVLinkProtocol, MAVLinkDecoder and
+# UAS::receiveMessage. It uses the offscreen platform and needs no window
+# system.
+#
+# Usage: qgcreceivebenchmark [MAVLinkReceiveBenchmark] [--option value ...]
+# -------------------------------------------------
+
+include(qgroundcontrol.pro)
+
+TARGET = qgcreceivebenchmark
+CONFIG += console
+CONFIG -= app_bundle
+# Reset QMAKE_POST_LINK to prevent file copy operations
+QMAKE_POST_LINK = ""
+
+BENCHMARKDIR = $$BASEDIR/src/qgcbenchmark
+INCLUDEPATH += $$BENCHMARKDIR
+
+SOURCES -= src/main.cc
+
+HEADERS += \
+    $$BENCHMARKDIR/AutoBenchmark.h \
+    $$BENCHMARKDIR/AllocationCounter.h \
+    $$BENCHMARKDIR/MAVLinkReceiveBenchmark.h
+
+SOURCES += \
+    $$BENCHMARKDIR/AllocationCounter.cc \
+    $$BENCHMARKDIR/MAVLinkReceiveBenchmark.cc
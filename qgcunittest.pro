@@ -239,7 +239,8 @@ INCLUDEPATH += src \
     src/ui/watchdog \
     src/ui/map3D \
     src/ui/mission \
-    src/ui/designer
+    src/ui/designer \
+    src/qgcbenchmark
 HEADERS += src/MG.h \
     src/QGCCore.h \
     src/uas/UASInterface.h \
@@ -250,7 +251,9 @@ HEADERS += src/MG.h \
     src/comm/SerialLinkInterface.h \
     src/comm/SerialLink.h \
     src/comm/ProtocolInterface.h \
+    src/comm/MAVLinkMessageBatch.h \
     src/comm/MAVLinkProtocol.h \
+    src/comm/TelemetryStore.h \
     src/comm/QGCFlightGearLink.h \
     src/ui/CommConfigurationWindow.h \
     src/ui/SerialConfigurationWindow.h \
@@ -263,6 +266,9 @@ HEADERS += src/MG.h \
     src/ui/linechart/LinechartPlot.h \
     src/ui/linechart/Scrollbar.h \
     src/ui/linechart/ScrollZoomer.h \
+    src/ui/linechart/RollingStatistics.h \
+    src/ui/linechart/TimeSeriesBuffer.h \
+    src/ui/linechart/TimeSeriesCurveData.h \
     src/configuration.h \
     src/ui/uas/UASView.h \
     src/ui/CameraView.h \
@@ -369,6 +375,8 @@ HEADERS += src/MG.h \
     src/ui/mission/QGCMissionNavTakeoff.h \
     $$TESTDIR/AutoTest.h \
     $$TESTDIR/UASUnitTest.h \
+    $$TESTDIR/TileDownloaderTest.h \
+    src/qgcbenchmark/LocalTileServer.h \
 
 # Google Earth is only supported on Mac OS and Windows with Visual Studio Compiler
 macx|macx-g++|macx-g++42|win32-msvc2008|win32-msvc2010::HEADERS += src/ui/map3D/QGCGoogleEarthView.h
@@ -421,7 +429,9 @@ SOURCES += src/QGCCore.cc \
     src/comm/LinkManager.cc \
     src/comm/LinkInterface.cpp \
     src/comm/SerialLink.cc \
+    src/comm/MAVLinkMessageBatch.cc \
     src/comm/MAVLinkProtocol.cc \
+    src/comm/TelemetryStore.cc \
     src/comm/QGCFlightGearLink.cc \
     src/ui/CommConfigurationWindow.cc \
     src/ui/SerialConfigurationWindow.cc \
@@ -434,6 +444,9 @@ SOURCES += src/QGCCore.cc \
     src/ui/linechart/LinechartPlot.cc \
     src/ui/linechart/Scrollbar.cc \
     src/ui/linechart/ScrollZoomer.cc \
+    src/ui/linechart/RollingStatistics.cc \
+    src/ui/linechart/TimeSeriesBuffer.cc \
+    src/ui/linechart/TimeSeriesCurveData.cc \
     src/ui/uas/UASView.cc \
     src/ui/CameraView.cc \
     src/comm/MAVLinkSimulationLink.cc \
@@ -523,7 +536,9 @@ SOURCES += src/QGCCore.cc \
     src/ui/QGCPluginHost.cc \
     src/ui/firmwareupdate/QGCPX4FirmwareUpdate.cc \
     $$TESTDIR/testSuite.cc \
-    $$TESTDIR/UASUnitTest.cc
+    $$TESTDIR/UASUnitTest.cc \
+    $$TESTDIR/TileDownloaderTest.cc \
+    src/qgcbenchmark/LocalTileServer.cc
 
 # Enable Google Earth only on Mac OS and Windows with Visual Studio compiler
 macx|macx-g++|macx-g++42|win32-msvc2008|win32-msvc2010::SOURCES += src/ui/map3D/QGCGoogleEarthView.cc
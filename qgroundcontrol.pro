@@ -496,6 +496,7 @@ HEADERS += \
     src/uas/SlugsMAV.h \
     src/uas/PxQuadMAV.h \
     src/uas/ArduPilotMegaMAV.h \
+    src/uas/ApmLogMessages.h \
     src/uas/senseSoarMAV.h \
     src/ui/watchdog/WatchdogControl.h \
     src/ui/watchdog/WatchdogProcessView.h \
@@ -659,7 +660,9 @@ HEADERS += \
     src/ui/PrimaryFlightDisplayQML.h \
     src/ui/configuration/CompassMotorCalibrationDialog.h \
     src/comm/MAVLinkDecoder.h \
+    src/comm/MAVLinkMessageBatch.h \
     src/comm/MAVLinkProtocol.h \
+    src/comm/TelemetryStore.h \
     src/ui/MissionElevationDisplay.h \
     src/ui/GoogleElevationData.h \
     src/comm/UASObject.h \
@@ -668,6 +671,17 @@ HEADERS += \
     src/comm/AbsPositionOverview.h \
     src/comm/MissionOverview.h \
     src/ui/AP2DataPlot2DModel.h \
+    src/ui/AP2DataPlotColumnStore.h \
+    src/ui/AP2DataPlotRecordBatch.h \
+    src/ui/AP2DataPlotLogCache.h \
+    src/ui/AP2DataPlotStatus.h \
+    src/ui/AP2DataPlotBinaryParser.h \
+    src/ui/AP2DataPlotParallelParser.h \
+    src/ui/AP2DataPlotTLogParser.h \
+    src/ui/AP2DataPlotSeriesPyramid.h \
+    src/ui/AP2DataPlotOnlineHistory.h \
+    src/ui/AP2DataPlotTimeIndex.h \
+    src/ui/AP2DataPlotExportThread.h \
     src/ui/uas/PreFlightCalibrationDialog.h \
     src/ui/configuration/RadioFlashWizard.h \
     src/ui/GraphTreeWidgetItem.h \
@@ -715,6 +729,7 @@ SOURCES += src/main.cc \
     src/uas/SlugsMAV.cc \
     src/uas/PxQuadMAV.cc \
     src/uas/ArduPilotMegaMAV.cc \
+    src/uas/ApmLogMessages.cc \
     src/uas/senseSoarMAV.cpp \
     src/ui/watchdog/WatchdogControl.cc \
     src/ui/watchdog/WatchdogProcessView.cc \
@@ -876,7 +891,9 @@ SOURCES += src/main.cc \
     src/ui/PrimaryFlightDisplayQML.cpp \
     src/ui/configuration/CompassMotorCalibrationDialog.cpp \
     src/comm/MAVLinkDecoder.cc \
+    src/comm/MAVLinkMessageBatch.cc \
     src/comm/MAVLinkProtocol.cc \
+    src/comm/TelemetryStore.cc \
     src/ui/MissionElevationDisplay.cpp \
     src/ui/GoogleElevationData.cpp \
     src/comm/UASObject.cc \
@@ -885,6 +902,17 @@ SOURCES += src/main.cc \
     src/comm/AbsPositionOverview.cc \
     src/comm/MissionOverview.cc \
     src/ui/AP2DataPlot2DModel.cc \
+    src/ui/AP2DataPlotColumnStore.cc \
+    src/ui/AP2DataPlotRecordBatch.cc \
+    src/ui/AP2DataPlotLogCache.cc \
+    src/ui/AP2DataPlotStatus.cc \
+    src/ui/AP2DataPlotBinaryParser.cc \
+    src/ui/AP2DataPlotParallelParser.cc \
+    src/ui/AP2DataPlotTLogParser.cc \
+    src/ui/AP2DataPlotSeriesPyramid.cc \
+    src/ui/AP2DataPlotOnlineHistory.cc \
+    src/ui/AP2DataPlotTimeIndex.cc \
+    src/ui/AP2DataPlotExportThread.cc \
     src/ui/uas/PreFlightCalibrationDialog.cpp \
     src/ui/configuration/RadioFlashWizard.cpp \
     src/ui/GraphTreeWidgetItem.cc \
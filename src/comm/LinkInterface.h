@@ -90,7 +90,11 @@ public:
      */
     virtual QString getDetail() const = 0;
 
-    virtual void requestReset() = 0;
+    /**
+     * @brief Reset the connected device. Invokable so the protocol thread can
+     *        request it through a queued call.
+     */
+    Q_INVOKABLE virtual void requestReset() = 0;
 
     /**
      * @brief Determine the connection status
@@ -62,10 +62,15 @@ LinkManager::LinkManager(QObject *parent) :
     m_mavlinkLoggingEnabled = true;
     m_mavlinkDecoder = new MAVLinkDecoder(this);
     m_mavlinkProtocol = new MAVLinkProtocol();
-    m_mavlinkProtocol->setConnectionManager(this);
+    m_mavlinkProtocol->moveToThread(&m_protocolThread);
+    connect(m_mavlinkProtocol,SIGNAL(systemDetected(LinkInterface*,int,mavlink_heartbeat_t)),this,SLOT(systemDetected(LinkInterface*,int,mavlink_heartbeat_t)));
     connect(m_mavlinkProtocol,SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)),m_mavlinkDecoder,SLOT(receiveMessage(LinkInterface*,mavlink_message_t)));
     connect(m_mavlinkProtocol,SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)),this,SLOT(receiveMessage(LinkInterface*,mavlink_message_t)));
+    connect(m_mavlinkProtocol,SIGNAL(messagesReceived(LinkInterface*,MAVLinkMessageBatch)),m_mavlinkDecoder,SLOT(receiveMessages(LinkInterface*,MAVLinkMessageBatch)));
+    connect(m_mavlinkProtocol,SIGNAL(messagesReceived(LinkInterface*,MAVLinkMessageBatch)),this,SLOT(receiveMessages(LinkInterface*,MAVLinkMessageBatch)));
     connect(m_mavlinkProtocol,SIGNAL(protocolStatusMessage(QString,QString)),this,SLOT(protocolStatusMessageRec(QString,QString)));
+    m_protocolThread.setObjectName("MAVLinkProtocol");
+    m_protocolThread.start();
 
     QTimer::singleShot(500, this, SLOT(reloadSettings()));
 }
@@ -109,7 +114,8 @@ void LinkManager::stopLogging()
 
 LinkManager::~LinkManager()
 {
-    m_mavlinkProtocol->setConnectionManager(NULL);
+    m_protocolThread.quit();
+    m_protocolThread.wait();
     delete m_mavlinkProtocol;
     m_mavlinkProtocol = NULL;
     saveSettings();
@@ -337,6 +343,10 @@ void LinkManager::removeLink(int linkId)
         {
             m_connectionMap.value(linkId)->disconnect();
         }
+        // Make sure the protocol thread is done with all data of the link
+        QObject::disconnect(m_connectionMap.value(linkId), 0, m_mavlinkProtocol, 0);
+        QMetaObject::invokeMethod(m_mavlinkProtocol, "removeLink", Qt::BlockingQueuedConnection,
+                                  Q_ARG(LinkInterface*, m_connectionMap.value(linkId)));
         delete m_connectionMap.value(linkId);
         m_connectionMap.remove(linkId);
         saveSettings();
@@ -453,9 +463,57 @@ QList<QString> LinkManager::getCurrentPorts()
 
 void LinkManager::receiveMessage(LinkInterface* link,mavlink_message_t message)
 {
+    // The message was queued by the protocol thread, drop it if the link is gone
+    if (m_connectionMap.key(link, -1) == -1)
+    {
+        return;
+    }
+    routeMessage(link, message);
     emit messageReceived(link,message);
 }
 
+void LinkManager::receiveMessages(LinkInterface* link, const MAVLinkMessageBatch &messages)
+{
+    // The batch was queued by the protocol thread, drop it if the link is gone
+    if (m_connectionMap.key(link, -1) == -1)
+    {
+        return;
+    }
+    for (MAVLinkMessageBatch::const_iterator iter = messages.begin(); iter != messages.end(); ++iter)
+    {
+        routeMessage(link, *iter);
+    }
+    emit messagesReceived(link,messages);
+}
+
+void LinkManager::routeMessage(LinkInterface* link, const mavlink_message_t &message)
+{
+    // Each message goes to the vehicle of its system only. Messages are routed
+    // here instead of connecting every vehicle to the protocol, because a
+    // vehicle created from systemDetected would miss the messages queued
+    // before its connection was made, including its first heartbeat.
+    // receiveMessage is virtual, derived autopilots get their messages
+    UASInterface *uas = m_uasMap.value(message.sysid, 0);
+    if (uas)
+    {
+        uas->receiveMessage(link, message);
+    }
+    UASObject *obj = m_uasObjectMap.value(message.sysid, 0);
+    if (obj)
+    {
+        obj->messageReceived(link, message);
+    }
+}
+
+void LinkManager::systemDetected(LinkInterface* link, int sysid, mavlink_heartbeat_t heartbeat)
+{
+    if ((m_connectionMap.key(link, -1) == -1) || m_uasMap.contains(sysid))
+    {
+        return;
+    }
+    createUAS(m_mavlinkProtocol, link, sysid, &heartbeat);
+}
+
 UASInterface* LinkManager::getUas(int id)
 {
     if (m_uasMap.contains(id))
@@ -505,8 +563,6 @@ UASInterface* LinkManager::createUAS(MAVLinkProtocol* mavlink, LinkInterface* li
         UAS* mav = new UAS(0, sysid);
         // Set the system type
         mav->setSystemType((int)heartbeat->type);
-        // Connect this robot to the UAS object
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
 #ifdef QGC_PROTOBUF_ENABLED
         connect(mavlink, SIGNAL(extendedMessageReceived(LinkInterface*, std::tr1::shared_ptr<google::protobuf::Message>)), mav, SLOT(receiveExtendedMessage(LinkInterface*, std::tr1::shared_ptr<google::protobuf::Message>)));
 #endif
@@ -518,11 +574,6 @@ UASInterface* LinkManager::createUAS(MAVLinkProtocol* mavlink, LinkInterface* li
         PxQuadMAV* mav = new PxQuadMAV(0, sysid);
         // Set the system type
         mav->setSystemType((int)heartbeat->type);
-        // Connect this robot to the UAS object
-        // it is IMPORTANT here to use the right object type,
-        // else the slot of the parent object is called (and thus the special
-        // packets never reach their goal)
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
 #ifdef QGC_PROTOBUF_ENABLED
         connect(mavlink, SIGNAL(extendedMessageReceived(LinkInterface*, std::tr1::shared_ptr<google::protobuf::Message>)), mav, SLOT(receiveExtendedMessage(LinkInterface*, std::tr1::shared_ptr<google::protobuf::Message>)));
 #endif
@@ -534,11 +585,6 @@ UASInterface* LinkManager::createUAS(MAVLinkProtocol* mavlink, LinkInterface* li
         SlugsMAV* mav = new SlugsMAV(0, sysid);
         // Set the system type
         mav->setSystemType((int)heartbeat->type);
-        // Connect this robot to the UAS object
-        // it is IMPORTANT here to use the right object type,
-        // else the slot of the parent object is called (and thus the special
-        // packets never reach their goal)
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
         uas = mav;
     }
     break;
@@ -548,11 +594,6 @@ UASInterface* LinkManager::createUAS(MAVLinkProtocol* mavlink, LinkInterface* li
 
         // Set the system type
         mav->setSystemType((int)heartbeat->type);
-        // Connect this robot to the UAS object
-        // it is IMPORTANT here to use the right object type,
-        // else the slot of the parent object is called (and thus the special
-        // packets never reach their goal)
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
         uas = mav;
     }
     break;
@@ -561,7 +602,6 @@ UASInterface* LinkManager::createUAS(MAVLinkProtocol* mavlink, LinkInterface* li
         {
             senseSoarMAV* mav = new senseSoarMAV(0,sysid);
             mav->setSystemType((int)heartbeat->type);
-            connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
             uas = mav;
             break;
         }
@@ -570,18 +610,12 @@ UASInterface* LinkManager::createUAS(MAVLinkProtocol* mavlink, LinkInterface* li
     {
         UAS* mav = new UAS(0, sysid);
         mav->setSystemType((int)heartbeat->type);
-        // Connect this robot to the UAS object
-        // it is IMPORTANT here to use the right object type,
-        // else the slot of the parent object is called (and thus the special
-        // packets never reach their goal)
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
         uas = mav;
     }
     break;
     }
 
     UASObject *obj = new UASObject();
-    connect(mavlink,SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)),obj,SLOT(messageReceived(LinkInterface*,mavlink_message_t)));
     m_uasObjectMap[sysid] = obj;
 
     m_uasMap.insert(sysid,uas);
@@ -33,6 +33,7 @@ This file is part of the APM_PLANNER project
 #define LINKMANAGER_H
 
 #include <QObject>
+#include <QThread>
 /**
  * @brief The ConnectionManager class
  * This class handles all connections between the GCS and the actual hardware.
@@ -40,8 +41,11 @@ This file is part of the APM_PLANNER project
  * and emit signals upwards when mavlink messages come in.
  * This class lives in the UI thread
  * The Serial Link lives in the UI Thread
- * The mavlink decoder lives in its own thread
+ * The mavlink protocol (parsing, tlog and loss accounting) lives in its own thread
+ * The mavlink decoder lives in the UI thread
  * the UAS Class lives in the UI thread
+ * Link reads and the message handling of the UAS therefore still wait for a busy
+ * UI thread, only the parsing and logging of the received bytes does not.
  */
 #include "MAVLinkDecoder.h"
 #include "MAVLinkProtocol.h"
@@ -110,9 +114,12 @@ signals:
 
     void linkError(int linkid, QString message);
     void messageReceived(LinkInterface* link,mavlink_message_t message);
+    /** @brief All messages decoded from one read of a link, see MAVLinkProtocol::setBatchedDispatch */
+    void messagesReceived(LinkInterface* link, const MAVLinkMessageBatch &messages);
 
 public slots:
     void receiveMessage(LinkInterface* link,mavlink_message_t message);
+    void receiveMessages(LinkInterface* link, const MAVLinkMessageBatch &messages);
     void protocolStatusMessageRec(QString title,QString text);
     void enableLogging(bool enabled);
     void reloadSettings();
@@ -123,10 +130,13 @@ private slots:
     void linkDisonnected(LinkInterface* link);
     void linkErrorRec(LinkInterface* link,QString error);
     void linkTimeoutTriggered(LinkInterface*);
+    void systemDetected(LinkInterface* link, int sysid, mavlink_heartbeat_t heartbeat);
 
 private:
     void loadSettings();
     void saveSettings();
+    /** @brief Delivers a message to the vehicle of its system */
+    void routeMessage(LinkInterface* link, const mavlink_message_t &message);
 
 private:
     QMap<int,LinkInterface*> m_connectionMap;
@@ -134,6 +144,7 @@ private:
     QMap<QString,int> m_portToBaudMap;
     MAVLinkDecoder *m_mavlinkDecoder;
     MAVLinkProtocol *m_mavlinkProtocol;
+    QThread m_protocolThread;           /// Thread the protocol lives in
     QString m_logSubDir;
     bool m_mavlinkLoggingEnabled;
 };
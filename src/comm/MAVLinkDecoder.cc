@@ -45,6 +45,14 @@ MAVLinkDecoder::MAVLinkDecoder(QObject *parent) : QObject(parent)
     static mavlink_message_info_t msg[256] = MAVLINK_MESSAGE_INFO;
     memcpy(messageInfo, msg, sizeof(mavlink_message_info_t)*256);
     memset(receivedMessages, 0, sizeof(mavlink_message_t)*256);
+    for (int i = 0; i < 256; ++i)
+    {
+        hasTextField[i] = false;
+        for (unsigned int j = 0; j < messageInfo[i].num_fields; ++j)
+        {
+            hasTextField[i] |= (messageInfo[i].fields[j].type == MAVLINK_TYPE_CHAR);
+        }
+    }
 
     // Allow system status
 //    messageFilter.insert(MAVLINK_MSG_ID_HEARTBEAT, false);
@@ -127,6 +135,14 @@ void MAVLinkDecoder::sendMessage(mavlink_message_t msg)
 }
 
 
+void MAVLinkDecoder::receiveMessages(LinkInterface* link, const MAVLinkMessageBatch &messages)
+{
+    for (MAVLinkMessageBatch::const_iterator iter = messages.begin(); iter != messages.end(); ++iter)
+    {
+        receiveMessage(link, *iter);
+    }
+}
+
 QList<QPair<QString,QVariant> > MAVLinkDecoder::receiveMessage(LinkInterface* link, mavlink_message_t message)
 {
     Q_UNUSED(link);
@@ -148,6 +164,12 @@ QList<QPair<QString,QVariant> > MAVLinkDecoder::receiveMessage(LinkInterface* li
         onboardTimeOffset[message.sysid] = (timebase.time_unix_usec+500)/1000 - timebase.time_boot_ms;
         onboardToGCSUnixTimeOffsetAndDelay[message.sysid] = static_cast<qint64>(QGC::groundTimeMilliseconds() - (timebase.time_unix_usec+500)/1000);
     }
+    else if (!hasTextField[msgid])
+    {
+        // Plain numeric messages are polled from the TelemetryStore of the
+        // MAVLinkProtocol, only messages carrying text are emitted field by field
+        return QList<QPair<QString,QVariant> >();
+    }
     else
     {
 
@@ -215,6 +237,10 @@ QList<QPair<QString,QVariant> > MAVLinkDecoder::receiveMessage(LinkInterface* li
 
 QPair<QString,QVariant> MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64 time)
 {
+    if (!hasTextField[msg->msgid])
+    {
+        return QPair<QString,QVariant>();
+    }
     UASInterface *uas = UASManager::instance()->getUASForId(msg->sysid);
     bool localemit = false;
     if (!uas)
@@ -38,6 +38,7 @@ This file is part of the APM_PLANNER project
 #include "QsLog.h"
 #include "libs/mavlink/include/mavlink/v1.0/ardupilotmega/mavlink.h"
 #include "LinkInterface.h"
+#include "MAVLinkMessageBatch.h"
 
 #include <QObject>
 #include <QThread>
@@ -68,6 +69,7 @@ signals:
 
 public slots:
     QList<QPair<QString,QVariant> > receiveMessage(LinkInterface* link, mavlink_message_t message);
+    void receiveMessages(LinkInterface* link, const MAVLinkMessageBatch &messages);
     void sendMessage(mavlink_message_t msg);
     QPair<QString,QVariant> emitFieldValue(mavlink_message_t* msg, int fieldid, quint64 time);
 
@@ -95,6 +97,7 @@ private:
     QMap<uint16_t, bool> textMessageFilter;           ///< Message/field names not to emit in text mode
     mavlink_message_t receivedMessages[256];    ///< Available / known messages
     mavlink_message_info_t messageInfo[256];    ///< Message information
+    bool hasTextField[256];                     ///< Message has a char field, its values are named by text
     QMap<int,quint64> onboardTimeOffset;
     QMap<int,quint64> firstOnboardTime;
     QMap<int,quint64> onboardToGCSUnixTimeOffsetAndDelay;
@@ -0,0 +1,131 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief MAVLinkMessageBatch
+ *          Spans of decoded mavlink_message_t packets delivered in one signal and
+ *          the pool recycling their storage.
+ *
+ */
+
+#include "MAVLinkMessageBatch.h"
+#include <QMutexLocker>
+#include "QsLog.h"
+
+bool MAVLinkMessageBatch::isFull() const
+{
+    return !m_block || (m_count >= m_block->m_messages.size());
+}
+
+bool MAVLinkMessageBatch::append(const mavlink_message_t &message, const quint64 receiveTime)
+{
+    if (isFull())
+    {
+        return false;
+    }
+    if (m_count == 0)
+    {
+        m_receiveTime = receiveTime;
+    }
+    // The vector of a block is never copied, so data() does not detach
+    m_block->m_messages.data()[m_count++] = message;
+    return true;
+}
+
+MAVLinkMessagePoolData::~MAVLinkMessagePoolData()
+{
+    qDeleteAll(m_freeBlocks);
+}
+
+MAVLinkMessagePool::MAVLinkMessagePool(const int blockSize, const int blockCount) :
+    m_blockSize(qMax(1, blockSize)),
+    m_data(new MAVLinkMessagePoolData)
+{
+    for (int i = 0; i < blockCount; ++i)
+    {
+        Block *block = new Block(m_blockSize);
+        block->m_pool = m_data;
+        m_data->m_freeBlocks.enqueue(block);
+        m_data->m_blockCount++;
+    }
+}
+
+MAVLinkMessagePool::~MAVLinkMessagePool()
+{
+    QMutexLocker locker(&m_data->m_mutex);
+    m_data->m_closed = true;
+}
+
+MAVLinkMessageBatch MAVLinkMessagePool::acquire()
+{
+    Block *block = 0;
+    {
+        QMutexLocker locker(&m_data->m_mutex);
+        if (!m_data->m_freeBlocks.isEmpty())
+        {
+            block = m_data->m_freeBlocks.dequeue();
+        }
+        else
+        {
+            m_data->m_blockCount++;
+            QLOG_DEBUG() << "MAVLinkMessagePool::acquire(): all blocks in use, allocating block" << m_data->m_blockCount;
+        }
+    }
+    if (!block)
+    {
+        block = new Block(m_blockSize);
+        block->m_pool = m_data;
+    }
+
+    MAVLinkMessageBatch batch;
+    batch.m_block = QSharedPointer<Block>(block, &MAVLinkMessagePool::recycle);
+    return batch;
+}
+
+int MAVLinkMessagePool::blockCount() const
+{
+    QMutexLocker locker(&m_data->m_mutex);
+    return m_data->m_blockCount;
+}
+
+int MAVLinkMessagePool::freeBlockCount() const
+{
+    QMutexLocker locker(&m_data->m_mutex);
+    return m_data->m_freeBlocks.size();
+}
+
+void MAVLinkMessagePool::recycle(Block *block)
+{
+    QSharedPointer<MAVLinkMessagePoolData> data = block->m_pool.toStrongRef();
+    if (data)
+    {
+        QMutexLocker locker(&data->m_mutex);
+        if (!data->m_closed)
+        {
+            data->m_freeBlocks.enqueue(block);
+            return;
+        }
+        data->m_blockCount--;
+    }
+    delete block;
+}
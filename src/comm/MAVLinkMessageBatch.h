@@ -0,0 +1,162 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief MAVLinkMessageBatch
+ *          Spans of decoded mavlink_message_t packets delivered in one signal and
+ *          the pool recycling their storage.
+ *
+ */
+
+#ifndef MAVLINKMESSAGEBATCH_H
+#define MAVLINKMESSAGEBATCH_H
+
+#include <QMetaType>
+#include <QMutex>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QVector>
+#include <QWeakPointer>
+#include "libs/mavlink/include/mavlink/v1.0/ardupilotmega/mavlink.h"
+
+class MAVLinkMessagePool;
+struct MAVLinkMessagePoolData;
+
+/**
+ * @brief The MAVLinkMessageBatch class is a read only span of decoded messages.
+ *        It is cheap to copy, all copies share the same storage block. The block
+ *        is handed back to its MAVLinkMessagePool as soon as the last copy is
+ *        destroyed, so a batch can be passed through queued connections without
+ *        copying the messages.
+ */
+class MAVLinkMessageBatch
+{
+public:
+    typedef const mavlink_message_t *const_iterator;
+
+    MAVLinkMessageBatch() : m_count(0), m_receiveTime(0) {}
+
+    int size() const { return m_count; }
+    bool isEmpty() const { return m_count == 0; }
+    bool isFull() const;
+
+    const mavlink_message_t &at(const int index) const { return m_block->m_messages.at(index); }
+    const_iterator begin() const { return m_block ? m_block->m_messages.constData() : 0; }
+    const_iterator end() const { return m_block ? m_block->m_messages.constData() + m_count : 0; }
+
+    /**
+     * @brief receiveTime delivers the time the first message of the batch was
+     *        decoded in [us] since epoch, 0 if the batch is empty.
+     */
+    quint64 receiveTime() const { return m_receiveTime; }
+
+    /**
+     * @brief append copies a message into the batch. Only allowed for the writer
+     *        of the batch as long as no copy of the batch was handed out.
+     *
+     * @return false if the batch is full or has no storage
+     */
+    bool append(const mavlink_message_t &message, const quint64 receiveTime);
+
+private:
+    friend class MAVLinkMessagePool;
+    friend struct MAVLinkMessagePoolData;
+
+    /**
+     * @brief The Block struct is the storage of a batch. Its size is fixed when
+     *        it is created so appending never allocates.
+     */
+    struct Block
+    {
+        QVector<mavlink_message_t> m_messages;          /// Message storage of fixed size
+        QWeakPointer<MAVLinkMessagePoolData> m_pool;    /// Pool to return the block to
+
+        explicit Block(const int capacity) : m_messages(capacity) {}
+    };
+
+    QSharedPointer<Block> m_block;  /// Storage shared by all copies
+    int m_count;                    /// Number of valid messages in the block
+    quint64 m_receiveTime;          /// Decode time of the first message
+};
+
+Q_DECLARE_METATYPE(MAVLinkMessageBatch)
+
+/**
+ * @brief The MAVLinkMessagePool class hands out MAVLinkMessageBatch storage
+ *        blocks and takes them back once all batches using them are destroyed.
+ *        Free blocks are reused in the order they were returned, forming a ring
+ *        of preallocated blocks. New blocks are only allocated if all blocks are
+ *        in use, e.g. while the receivers of queued batches lag behind.
+ *
+ *        Blocks may be returned from any thread.
+ */
+class MAVLinkMessagePool
+{
+public:
+    static const int DefaultBlockSize = 128;    /// Messages per block
+    static const int DefaultBlockCount = 16;    /// Blocks allocated up front
+
+    explicit MAVLinkMessagePool(const int blockSize = DefaultBlockSize, const int blockCount = DefaultBlockCount);
+    ~MAVLinkMessagePool();
+
+    /**
+     * @brief acquire delivers an empty batch with a free storage block
+     */
+    MAVLinkMessageBatch acquire();
+
+    /**
+     * @brief blockCount delivers the number of blocks allocated by the pool
+     */
+    int blockCount() const;
+
+    /**
+     * @brief freeBlockCount delivers the number of blocks ready for reuse
+     */
+    int freeBlockCount() const;
+
+private:
+    typedef MAVLinkMessageBatch::Block Block;
+
+    static void recycle(Block *block);
+
+    int m_blockSize;                            /// Messages per block
+    QSharedPointer<MAVLinkMessagePoolData> m_data;  /// Free list, outlives the pool while blocks are in use
+};
+
+/**
+ * @brief The MAVLinkMessagePoolData struct holds the free list of a pool. Blocks
+ *        only keep a weak reference so they are deleted instead of recycled once
+ *        their pool is gone.
+ */
+struct MAVLinkMessagePoolData
+{
+    QMutex m_mutex;                                 /// Guards all members, blocks return from any thread
+    QQueue<MAVLinkMessageBatch::Block *> m_freeBlocks;  /// Blocks ready for reuse, oldest first
+    int m_blockCount;                               /// Number of allocated blocks
+    bool m_closed;                                  /// True once the pool is destroyed
+
+    MAVLinkMessagePoolData() : m_blockCount(0), m_closed(false) {}
+    ~MAVLinkMessagePoolData();
+};
+
+#endif // MAVLINKMESSAGEBATCH_H
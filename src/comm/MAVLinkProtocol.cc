@@ -34,20 +34,34 @@ This file is part of the APM_PLANNER project
 
 
 #include "MAVLinkProtocol.h"
-#include "LinkManager.h"
+#include "QsLog.h"
+
+namespace
+{
+    // Interval of the statistics log output in [ms]
+    const qint64 STATISTICS_LOG_INTERVAL = 10000;
+}
 
 MAVLinkProtocol::MAVLinkProtocol():
     m_isOnline(true),
-    m_loggingEnabled(false),
-    m_logfile(NULL),
-    m_connectionManager(NULL)
+    m_batchedDispatch(true),
+    m_batchDecodeNsecs(0),
+    m_batchFirstDecodeNsecs(0),
+    m_lastStatisticsLog(0),
+    m_loggingEnabled(0),
+    m_logfile(NULL)
 {
+    // All signals of the protocol are delivered through queued connections
+    qRegisterMetaType<LinkInterface*>("LinkInterface*");
+    qRegisterMetaType<mavlink_message_t>("mavlink_message_t");
+    qRegisterMetaType<mavlink_heartbeat_t>("mavlink_heartbeat_t");
+    qRegisterMetaType<MAVLinkMessageBatch>("MAVLinkMessageBatch");
+    m_clock.start();
 }
 
 MAVLinkProtocol::~MAVLinkProtocol()
 {
     stopLogging();
-    m_connectionManager = NULL;
 }
 
 void MAVLinkProtocol::sendMessage(mavlink_message_t msg)
@@ -55,11 +69,15 @@ void MAVLinkProtocol::sendMessage(mavlink_message_t msg)
     Q_UNUSED(msg);
 }
 
-void MAVLinkProtocol::receiveBytes(LinkInterface* link, QByteArray b)
+void MAVLinkProtocol::receiveBytes(LinkInterface* link, const QByteArray &b)
 {
     mavlink_message_t message;
     mavlink_status_t status;
 
+    const qint64 startNsecs = m_clock.nsecsElapsed();
+    const quint64 dispatchNsecs = m_statistics.m_dispatchNsecs;
+    m_statistics.m_bytesReceived += b.size();
+
     // Cache the link ID for common use.
     int linkId = link->getId();
 
@@ -91,7 +109,8 @@ void MAVLinkProtocol::receiveBytes(LinkInterface* link, QByteArray b)
                 //500 bytes with no mavlink message. Are we connected to a mavlink capable device?
                 if (!checkedUserNonMavlink)
                 {
-                    link->requestReset();
+                    // The link lives in the GUI thread
+                    QMetaObject::invokeMethod(link, "requestReset", Qt::QueuedConnection);
                     nonmavlinkCount=0;
                     checkedUserNonMavlink = true;
                 }
@@ -201,38 +220,136 @@ void MAVLinkProtocol::receiveBytes(LinkInterface* link, QByteArray b)
 #endif
 
             // Log data
-            if (m_loggingEnabled && m_logfile)
-            {
-                quint64 time = QGC::groundTimeUsecs();
-
-                QDataStream outStream(m_logfile);
-                outStream.setByteOrder(QDataStream::BigEndian);
-                outStream << time; // write time stamp
-                // write headers, payload (incs CRC)
-                int bytesWritten = outStream.writeRawData((const char*)&message.magic,
-                                     static_cast<uint>(MAVLINK_NUM_NON_PAYLOAD_BYTES + message.len));
-
-                if(bytesWritten != (MAVLINK_NUM_NON_PAYLOAD_BYTES + message.len))
-                {
-                    emit protocolStatusMessage(tr("MAVLink Logging failed"),
-                                               tr("Could not write to file %1, disabling logging.")
-                                               .arg(m_logfile->fileName()));
-                    // Stop logging
-                    stopLogging();
-                }
-            }
-            quint64 time = QGC::groundTimeUsecs();
-            m_mavlinkMsgBuffer[time] = message;
-            if (m_isOnline)
+            writeLog(message);
+            if (m_isOnline.load() && handleMessage(message, link))
             {
-                handleMessage(time,link);
+                const quint64 time = QGC::groundTimeUsecs();
+                m_telemetryStore.update(message, time / 1000);
+                dispatchMessage(message, link, time, m_clock.nsecsElapsed());
             }
         }
     }
+
+    // Everything decoded from this read is delivered at once
+    dispatchBatch(link);
+
+    const qint64 endNsecs = m_clock.nsecsElapsed();
+    m_statistics.m_parseNsecs += (endNsecs - startNsecs) - (m_statistics.m_dispatchNsecs - dispatchNsecs);
+    {
+        QMutexLocker locker(&m_statisticsMutex);
+        m_publishedStatistics = m_statistics;
+    }
+    if (endNsecs / 1000000 - m_lastStatisticsLog > STATISTICS_LOG_INTERVAL)
+    {
+        m_lastStatisticsLog = endNsecs / 1000000;
+        logStatistics();
+    }
+}
+
+void MAVLinkProtocol::dispatchMessage(const mavlink_message_t &message, LinkInterface *link,
+                                      const quint64 receiveTime, const qint64 decodeNsecs)
+{
+    if (!m_batchedDispatch.load())
+    {
+        const qint64 startNsecs = m_clock.nsecsElapsed();
+        const quint64 latency = static_cast<quint64>(startNsecs - decodeNsecs);
+        // The packet is emitted as a whole, as it is only 255 - 261 bytes short
+        // kind of inefficient, but no issue for a groundstation pc.
+        // It buys as reentrancy for the whole code over all threads
+        emit messageReceived(link, message);
+
+        m_statistics.m_messagesDispatched++;
+        m_statistics.m_dispatchCount++;
+        m_statistics.m_latencyNsecs += latency;
+        m_statistics.m_maxLatencyNsecs = qMax(m_statistics.m_maxLatencyNsecs, latency);
+        m_statistics.m_dispatchNsecs += m_clock.nsecsElapsed() - startNsecs;
+        return;
+    }
+
+    if (m_batch.isFull())
+    {
+        dispatchBatch(link);
+    }
+    if (m_batch.isEmpty())
+    {
+        m_batch = m_messagePool.acquire();
+        m_batchDecodeNsecs = 0;
+        m_batchFirstDecodeNsecs = decodeNsecs;
+    }
+    m_batch.append(message, receiveTime);
+    m_batchDecodeNsecs += decodeNsecs;
+}
+
+void MAVLinkProtocol::dispatchBatch(LinkInterface *link)
+{
+    if (m_batch.isEmpty())
+    {
+        return;
+    }
+
+    // Release our reference before emitting so the block returns to the pool
+    // as soon as the last receiver is done with it.
+    MAVLinkMessageBatch batch = m_batch;
+    m_batch = MAVLinkMessageBatch();
+
+    const qint64 startNsecs = m_clock.nsecsElapsed();
+    const quint64 count = static_cast<quint64>(batch.size());
+    emit messagesReceived(link, batch);
+
+    // The first message of the batch waited longest
+    const quint64 maxLatency = static_cast<quint64>(startNsecs - m_batchFirstDecodeNsecs);
+    m_statistics.m_messagesDispatched += count;
+    m_statistics.m_dispatchCount++;
+    m_statistics.m_latencyNsecs += static_cast<quint64>(startNsecs) * count - static_cast<quint64>(m_batchDecodeNsecs);
+    m_statistics.m_maxLatencyNsecs = qMax(m_statistics.m_maxLatencyNsecs, maxLatency);
+    m_statistics.m_dispatchNsecs += m_clock.nsecsElapsed() - startNsecs;
+}
+
+void MAVLinkProtocol::removeLink(LinkInterface *link)
+{
+    // Called in the protocol thread, all data queued before is already processed
+    const int linkId = link->getId();
+    totalReceiveCounter.remove(linkId);
+    currReceiveCounter.remove(linkId);
+    totalLossCounter.remove(linkId);
+    currLossCounter.remove(linkId);
+}
+
+void MAVLinkProtocol::updateTelemetry(mavlink_message_t message, quint64 time)
+{
+    m_telemetryStore.update(message, time);
+}
+
+MAVLinkProtocol::Statistics MAVLinkProtocol::statistics() const
+{
+    QMutexLocker locker(&m_statisticsMutex);
+    return m_publishedStatistics;
+}
+
+void MAVLinkProtocol::resetStatistics()
+{
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "resetStatistics", Qt::QueuedConnection);
+        return;
+    }
+    m_statistics = Statistics();
+    QMutexLocker locker(&m_statisticsMutex);
+    m_publishedStatistics = m_statistics;
 }
-void MAVLinkProtocol::handleMessage(quint64 timeid,LinkInterface *link)
+
+void MAVLinkProtocol::logStatistics()
+{
+    QLOG_DEBUG() << "MAVLinkProtocol statistics: bytes" << m_statistics.m_bytesReceived
+                 << "messages" << m_statistics.m_messagesDispatched
+                 << "msg/s" << m_statistics.messagesPerSecond()
+                 << "msg/dispatch" << m_statistics.messagesPerDispatch()
+                 << "avg latency [us]" << m_statistics.averageLatencyUsecs()
+                 << "max latency [us]" << m_statistics.m_maxLatencyNsecs / 1000;
+}
+
+bool MAVLinkProtocol::handleMessage(mavlink_message_t &message, LinkInterface *link)
 {
-    mavlink_message_t message = m_mavlinkMsgBuffer.value(timeid);
     unsigned int linkId = link->getId();
     // ORDER MATTERS HERE!
     // If the matching UAS object does not yet exist, it has to be created
@@ -246,19 +363,17 @@ void MAVLinkProtocol::handleMessage(quint64 timeid,LinkInterface *link)
 
     }
 
-    //UASInterface* uas = UASManager::instance()->getUASForId(message.sysid);
-    Q_ASSERT_X(m_connectionManager != NULL, "MAVLinkProtocol::receiveBytes", " error:m_connectionManager == NULL");
-    UASInterface* uas = m_connectionManager->getUas(message.sysid);
-    //qDebug() << "MAVLinkProtocol::receiveBytes" << uas;
+    // The vehicles live in the GUI thread, so the protocol tracks the known
+    // systems itself instead of asking the LinkManager.
+    bool known = m_systems.contains(message.sysid);
 
     // Check and (if necessary) create UAS object
-    if (uas == NULL && message.msgid == MAVLINK_MSG_ID_HEARTBEAT)
+    if (!known && message.msgid == MAVLINK_MSG_ID_HEARTBEAT)
     {
         // ORDER MATTERS HERE!
-        // The UAS object has first to be created and connected,
-        // only then the rest of the application can be made aware
-        // of its existence, as it only then can send and receive
-        // it's first messages.
+        // systemDetected is queued before the batch holding this heartbeat,
+        // so the UAS object is created and connected before the rest of the
+        // application gets its first messages.
 
         // Check if the UAS has the same id like this system
         if (message.sysid == getSystemId())
@@ -266,7 +381,7 @@ void MAVLinkProtocol::handleMessage(quint64 timeid,LinkInterface *link)
             if (m_throwAwayGCSPackets)
             {
                 //If replaying, we have to assume that it's just hearing ground control traffic
-                return;
+                return false;
             }
             emit protocolStatusMessage(tr("SYSTEM ID CONFLICT!"), tr("Warning: A second system is using the same system id (%1)").arg(getSystemId()));
         }
@@ -294,15 +409,17 @@ void MAVLinkProtocol::handleMessage(quint64 timeid,LinkInterface *link)
             }
 
             // Ignore this message and continue gracefully
-            return;
+            return false;
         }
 
-        // Create a new UAS object
-        uas = m_connectionManager->createUAS(this,link,message.sysid,&heartbeat); //QGCMAVLinkUASFactory::createUAS(this, link, message.sysid, &heartbeat);
+        // Let the LinkManager create a new UAS object
+        m_systems.insert(message.sysid);
+        known = true;
+        emit systemDetected(link, message.sysid, heartbeat);
     }
 
     // Only count message if UAS exists for this message
-    if (uas != NULL)
+    if (known)
     {
 
         // Increase receive counter
@@ -373,11 +490,6 @@ void MAVLinkProtocol::handleMessage(quint64 timeid,LinkInterface *link)
             emit receiveLossChanged(message.sysid, receiveLoss);
         }
 
-        // The packet is emitted as a whole, as it is only 255 - 261 bytes short
-        // kind of inefficient, but no issue for a groundstation pc.
-        // It buys as reentrancy for the whole code over all threads
-        emit messageReceived(link, message);
-
         // Multiplex message if enabled
         //if (m_multiplexingEnabled)
         //{
@@ -392,10 +504,38 @@ void MAVLinkProtocol::handleMessage(quint64 timeid,LinkInterface *link)
              //   if (currLink != link) sendMessage(currLink, message, message.sysid, message.compid);
             //}
         //}
+        return true;
     }
+    return false;
 }
 
-void MAVLinkProtocol::stopLogging()
+void MAVLinkProtocol::writeLog(const mavlink_message_t &message)
+{
+    QMutexLocker locker(&m_logMutex);
+    if (!m_logfile)
+    {
+        return;
+    }
+    quint64 time = QGC::groundTimeUsecs();
+
+    QDataStream outStream(m_logfile);
+    outStream.setByteOrder(QDataStream::BigEndian);
+    outStream << time; // write time stamp
+    // write headers, payload (incs CRC)
+    int bytesWritten = outStream.writeRawData((const char*)&message.magic,
+                         static_cast<uint>(MAVLINK_NUM_NON_PAYLOAD_BYTES + message.len));
+
+    if(bytesWritten != (MAVLINK_NUM_NON_PAYLOAD_BYTES + message.len))
+    {
+        emit protocolStatusMessage(tr("MAVLink Logging failed"),
+                                   tr("Could not write to file %1, disabling logging.")
+                                   .arg(m_logfile->fileName()));
+        // Stop logging
+        closeLog();
+    }
+}
+
+void MAVLinkProtocol::closeLog()
 {
     if (m_logfile && m_logfile->isOpen()){
         QLOG_DEBUG() << "Stop MAVLink logging" << m_logfile->fileName();
@@ -404,31 +544,38 @@ void MAVLinkProtocol::stopLogging()
         delete m_logfile;
         m_logfile = NULL;
     }
-    m_loggingEnabled = false;
+    m_loggingEnabled.store(0);
+}
+
+void MAVLinkProtocol::stopLogging()
+{
+    QMutexLocker locker(&m_logMutex);
+    closeLog();
 }
 
 bool MAVLinkProtocol::startLogging(const QString& filename)
 {
+    QMutexLocker locker(&m_logMutex);
     if (m_logfile && m_logfile->isOpen())
     {
         return true;
     }
-    stopLogging();
+    closeLog();
     QLOG_DEBUG() << "Start MAVLink logging" << filename;
 
     Q_ASSERT_X(m_logfile == NULL, "startLogging", "m_logFile == NULL");
 
     m_logfile = new QFile(filename);
     if (m_logfile->open(QIODevice::WriteOnly | QIODevice::Append)){
-         m_loggingEnabled = true;
+         m_loggingEnabled.store(1);
 
     } else {
         emit protocolStatusMessage(tr("Started MAVLink logging"),
                                    tr("FAILED: MAVLink cannot start logging to.").arg(m_logfile->fileName()));
-        m_loggingEnabled = false;
+        m_loggingEnabled.store(0);
         delete m_logfile;
         m_logfile = NULL;
     }
     //emit loggingChanged(m_loggingEnabled);
-    return m_loggingEnabled; // reflects if logging started or not.
+    return m_loggingEnabled.load() != 0; // reflects if logging started or not.
 }
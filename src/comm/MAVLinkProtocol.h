@@ -43,9 +43,21 @@ This file is part of the APM_PLANNER project
 #include <QFile>
 #include "QGC.h"
 #include <QDataStream>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSet>
 #include "UASInterface.h"
+#include "MAVLinkMessageBatch.h"
+#include "TelemetryStore.h"
 //#include "MAVLinkDecoder.h"
-class LinkManager;
+
+/**
+ * @brief The MAVLinkProtocol class parses the bytes received by the links,
+ *        writes the tlog and does the loss accounting. It runs in its own
+ *        thread owned by the LinkManager so GUI load cannot delay parsing.
+ *        Its results are published through queued signals only. All public
+ *        methods may be called from any thread.
+ */
 class MAVLinkProtocol : public QObject
 {
     Q_OBJECT
@@ -53,23 +65,111 @@ public:
     explicit MAVLinkProtocol();
     ~MAVLinkProtocol();
 
-    void setConnectionManager(LinkManager *manager) { m_connectionManager = manager; }
     void sendMessage(mavlink_message_t msg);
     void stopLogging();
     bool startLogging(const QString& filename);
-    bool loggingEnabled() { return m_loggingEnabled; }
-    void setOnline(bool isonline) { m_isOnline = isonline; }
+    bool loggingEnabled() { return m_loggingEnabled.load() != 0; }
+    void setOnline(bool isonline) { m_isOnline.store(isonline ? 1 : 0); }
+
+    /**
+     * @brief setBatchedDispatch selects how decoded messages are delivered. In
+     *        batched mode all messages decoded from one read of a link are
+     *        delivered with a single messagesReceived signal, otherwise every
+     *        message is delivered with its own messageReceived signal.
+     *        Batched mode is the default.
+     */
+    void setBatchedDispatch(bool batched) { m_batchedDispatch.store(batched ? 1 : 0); }
+    bool batchedDispatch() const { return m_batchedDispatch.load() != 0; }
+
+    /**
+     * @brief The Statistics struct holds the receive counters of the protocol
+     */
+    struct Statistics
+    {
+        quint64 m_bytesReceived;        /// Bytes passed to receiveBytes
+        quint64 m_messagesDispatched;   /// Messages delivered to the receivers
+        quint64 m_dispatchCount;        /// Number of messageReceived/messagesReceived signals
+        quint64 m_parseNsecs;           /// Time spent decoding and accounting
+        quint64 m_dispatchNsecs;        /// Time spent emitting, includes directly connected receivers
+        quint64 m_latencyNsecs;         /// Sum of the time from decoding to delivery of every message
+        quint64 m_maxLatencyNsecs;      /// Longest time from decoding to delivery of a message
+
+        Statistics() : m_bytesReceived(0), m_messagesDispatched(0), m_dispatchCount(0), m_parseNsecs(0),
+                       m_dispatchNsecs(0), m_latencyNsecs(0), m_maxLatencyNsecs(0) {}
+
+        /** @brief Messages handled per second of receive thread time */
+        double messagesPerSecond() const
+        {
+            const quint64 nsecs = m_parseNsecs + m_dispatchNsecs;
+            return nsecs ? m_messagesDispatched * 1000000000.0 / nsecs : 0.0;
+        }
+        /** @brief Average number of messages delivered per signal */
+        double messagesPerDispatch() const
+        {
+            return m_dispatchCount ? static_cast<double>(m_messagesDispatched) / m_dispatchCount : 0.0;
+        }
+        /** @brief Average time from decoding to delivery of a message in [us] */
+        double averageLatencyUsecs() const
+        {
+            return m_messagesDispatched ? m_latencyNsecs / (1000.0 * m_messagesDispatched) : 0.0;
+        }
+    };
+
+    /**
+     * @brief statistics delivers a snapshot of the receive counters. The
+     *        snapshot is updated after every read of a link.
+     */
+    Statistics statistics() const;
+
+    /**
+     * @brief telemetryStore delivers the latest values of all received fields.
+     *        It is updated before a message is delivered and may be read
+     *        from any thread.
+     */
+    const TelemetryStore &telemetryStore() const { return m_telemetryStore; }
+
 private:
-    QMap<quint64,mavlink_message_t> m_mavlinkMsgBuffer;
-    void handleMessage(quint64 timeid,LinkInterface *link);
-    bool m_isOnline;
+    /**
+     * @brief handleMessage does the UAS creation and the loss accounting of a
+     *        decoded message.
+     * @return true if the message has to be delivered to the receivers
+     */
+    bool handleMessage(mavlink_message_t &message, LinkInterface *link);
+
+    /**
+     * @brief dispatchMessage delivers a message directly or adds it to the batch
+     */
+    void dispatchMessage(const mavlink_message_t &message, LinkInterface *link, const quint64 receiveTime, const qint64 decodeNsecs);
+
+    /**
+     * @brief dispatchBatch delivers all batched messages
+     */
+    void dispatchBatch(LinkInterface *link);
+
+    void logStatistics();
+    void writeLog(const mavlink_message_t &message);
+    void closeLog();
+
+    QAtomicInt m_isOnline;
+    QAtomicInt m_batchedDispatch;
+    MAVLinkMessagePool m_messagePool;   /// Storage of the message batches
+    MAVLinkMessageBatch m_batch;        /// Messages not yet delivered
+    qint64 m_batchDecodeNsecs;          /// Sum of the decode times of the batched messages
+    qint64 m_batchFirstDecodeNsecs;     /// Decode time of the first batched message
+    QElapsedTimer m_clock;              /// Time base of the statistics
+    qint64 m_lastStatisticsLog;         /// Time the statistics were logged the last time
+    Statistics m_statistics;            /// Counters updated by the protocol thread
+    Statistics m_publishedStatistics;   /// Snapshot of the counters for other threads
+    mutable QMutex m_statisticsMutex;   /// Guards m_publishedStatistics
+    QSet<int> m_systems;                /// Systems systemDetected was emitted for
+    TelemetryStore m_telemetryStore;    /// Latest value of every field, written by the protocol thread
     int getSystemId() { return 252; }
     int getComponentId() { return 1; }
-    bool m_loggingEnabled;
+    QAtomicInt m_loggingEnabled;        /// Read by the GUI thread, set under m_logMutex
     QFile *m_logfile;
+    QMutex m_logMutex;                  /// Guards m_logfile
 
     bool m_throwAwayGCSPackets;
-    LinkManager *m_connectionManager;
     bool versionMismatchIgnore;
     QMap<int,qint64> totalReceiveCounter;
     QMap<int,qint64> currReceiveCounter;
@@ -84,9 +184,40 @@ signals:
     void textMessageReceived(int uasid, int componentid, int severity, const QString& text);
     void receiveLossChanged(int id,float value);
     void messageReceived(LinkInterface *link,mavlink_message_t message);
+    /** @brief Delivers all messages decoded from one read of a link in batched mode */
+    void messagesReceived(LinkInterface *link, const MAVLinkMessageBatch &messages);
+    /**
+     * @brief systemDetected is emitted for the first valid heartbeat of a system.
+     *        Its messages are delivered from now on, the receiver has to create
+     *        the vehicle.
+     */
+    void systemDetected(LinkInterface *link, int sysid, mavlink_heartbeat_t heartbeat);
 
 public slots:
-    void receiveBytes(LinkInterface* link, QByteArray b);
+    void receiveBytes(LinkInterface* link, const QByteArray &b);
+
+    /**
+     * @brief removeLink drops all state of a link. Once this returns no queued
+     *        data of the link is left in the protocol thread, so it has to be
+     *        invoked with a blocking queued connection before the link is deleted.
+     */
+    void removeLink(LinkInterface *link);
+
+    /**
+     * @brief updateTelemetry stores a message which did not arrive through
+     *        receiveBytes, like a replayed tlog message, in the telemetry store.
+     *        The store has a single writer, so this has to be queued to the
+     *        protocol thread.
+     *
+     * @param message - decoded message
+     * @param time - ground time of reception in [ms] since epoch
+     */
+    void updateTelemetry(mavlink_message_t message, quint64 time);
+
+    void resetStatistics();
 };
 
+Q_DECLARE_METATYPE(mavlink_message_t)
+Q_DECLARE_METATYPE(mavlink_heartbeat_t)
+
 #endif // NEW_MAVLINKPARSER_H
@@ -6,6 +6,7 @@
 #include "UAS.h"
 #include "MainWindow.h"
 #include "QGCMAVLinkUASFactory.h"
+#include "QGC.h"
 TLogReplayLink::TLogReplayLink(QObject *parent) :
     LinkInterface(),
     m_toBeDeleted(false),
@@ -274,6 +275,10 @@ void TLogReplayLink::run()
                         {
                             msleep(1);
                         }
+                        // Replayed messages bypass the MAVLinkProtocol, feed the
+                        // telemetry store the widgets poll the message fields from
+                        QMetaObject::invokeMethod(LinkManager::instance()->getProtocol(), "updateTelemetry", Qt::QueuedConnection,
+                                                  Q_ARG(mavlink_message_t, message), Q_ARG(quint64, QGC::groundTimeMilliseconds()));
                         uas->receiveMessage(this,message);
                         LinkManager::instance()->getUasObject(message.sysid)->messageReceived(this,message);
                         m_mavlinkDecoder->receiveMessage(this,message);
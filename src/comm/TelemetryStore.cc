@@ -0,0 +1,450 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief TelemetryStore
+ *          Latest value of every numeric field of every received message,
+ *          readable from any thread without locking.
+ *
+ */
+
+#include "TelemetryStore.h"
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+    const char *typeName(const mavlink_message_type_t type)
+    {
+        switch (type)
+        {
+        case MAVLINK_TYPE_UINT8_T:  return "uint8_t";
+        case MAVLINK_TYPE_INT8_T:   return "int8_t";
+        case MAVLINK_TYPE_UINT16_T: return "uint16_t";
+        case MAVLINK_TYPE_INT16_T:  return "int16_t";
+        case MAVLINK_TYPE_UINT32_T: return "uint32_t";
+        case MAVLINK_TYPE_INT32_T:  return "int32_t";
+        case MAVLINK_TYPE_UINT64_T: return "uint64_t";
+        case MAVLINK_TYPE_INT64_T:  return "int64_t";
+        case MAVLINK_TYPE_FLOAT:    return "float";
+        case MAVLINK_TYPE_DOUBLE:   return "double";
+        default:                    return "char";
+        }
+    }
+
+    int typeSize(const mavlink_message_type_t type)
+    {
+        switch (type)
+        {
+        case MAVLINK_TYPE_UINT16_T:
+        case MAVLINK_TYPE_INT16_T:  return 2;
+        case MAVLINK_TYPE_UINT32_T:
+        case MAVLINK_TYPE_INT32_T:
+        case MAVLINK_TYPE_FLOAT:    return 4;
+        case MAVLINK_TYPE_UINT64_T:
+        case MAVLINK_TYPE_INT64_T:
+        case MAVLINK_TYPE_DOUBLE:   return 8;
+        default:                    return 1;
+        }
+    }
+
+    template <typename T> inline T readRaw(const char *data)
+    {
+        T value;
+        memcpy(&value, data, sizeof(T));    // payload fields are not aligned
+        return value;
+    }
+
+    // Onboard times below 40 years are times since boot, not Unix time
+    const quint64 MAX_BOOT_TIME = Q_UINT64_C(1261440000000);
+}
+
+TelemetryStore::System::System() :
+    m_hasOnboardOffset(false),
+    m_onboardOffset(0),
+    m_lastOnboardTime(0),
+    m_unixOffsetAndDelay(0)
+{
+    for (int msgid = 0; msgid < 256; ++msgid)
+    {
+        m_firstCompid[msgid] = -1;
+    }
+}
+
+TelemetryStore::System::~System()
+{
+    for (int compid = 0; compid < 256; ++compid)
+    {
+        delete[] m_components[compid].load();
+    }
+}
+
+TelemetryStore::TelemetryStore()
+{
+    static const mavlink_message_info_t messageInfo[256] = MAVLINK_MESSAGE_INFO;
+
+    for (int msgid = 0; msgid < 256; ++msgid)
+    {
+        m_firstSlot[msgid] = m_slots.size();
+        const mavlink_message_info_t &info = messageInfo[msgid];
+
+        // A leading time field is used as the time of all values
+        m_timeOffset[msgid] = -1;
+        m_timeIsUsec[msgid] = false;
+        if (info.num_fields > 0)
+        {
+            const mavlink_field_info_t &first = info.fields[0];
+            if ((QString(first.name) == "time_boot_ms") && (first.type == MAVLINK_TYPE_UINT32_T))
+            {
+                m_timeOffset[msgid] = static_cast<int>(first.wire_offset);
+            }
+            else if (QString(first.name).contains("usec") && (first.type == MAVLINK_TYPE_UINT64_T))
+            {
+                m_timeOffset[msgid] = static_cast<int>(first.wire_offset);
+                m_timeIsUsec[msgid] = true;
+            }
+        }
+
+        if (msgid == MAVLINK_MSG_ID_DEBUG)
+        {
+            // The value of each index is an own value
+            SlotInfo slot;
+            slot.m_msgid = static_cast<quint8>(msgid);
+            slot.m_fieldType = MAVLINK_TYPE_FLOAT;
+            slot.m_type = typeName(MAVLINK_TYPE_FLOAT);
+            slot.m_offset = offsetof(mavlink_debug_t, value);
+            for (int index = 0; index < 256; ++index)
+            {
+                slot.m_name = QString("debug.%1").arg(index);
+                m_nameToSlot.insert(slot.m_name, m_slots.size());
+                m_slots.append(slot);
+            }
+            m_slotCountOf[msgid] = m_slots.size() - m_firstSlot[msgid];
+            continue;
+        }
+
+        for (unsigned int field = 0; field < info.num_fields; ++field)
+        {
+            const mavlink_field_info_t &fieldInfo = info.fields[field];
+            if (fieldInfo.type == MAVLINK_TYPE_CHAR)
+            {
+                continue;   // Text is delivered by the MAVLinkDecoder
+            }
+
+            SlotInfo slot;
+            slot.m_msgid = static_cast<quint8>(msgid);
+            slot.m_fieldType = static_cast<quint8>(fieldInfo.type);
+            const QString name = QString("%1.%2").arg(info.name).arg(fieldInfo.name);
+            if (fieldInfo.array_length == 0)
+            {
+                slot.m_name = name;
+                slot.m_type = typeName(fieldInfo.type);
+                slot.m_offset = static_cast<quint16>(fieldInfo.wire_offset);
+                m_nameToSlot.insert(slot.m_name, m_slots.size());
+                m_slots.append(slot);
+                continue;
+            }
+            slot.m_type = QString("%1[%2]").arg(typeName(fieldInfo.type)).arg(fieldInfo.array_length);
+            for (unsigned int element = 0; element < fieldInfo.array_length; ++element)
+            {
+                slot.m_name = QString("%1.%2").arg(name).arg(element);
+                slot.m_offset = static_cast<quint16>(fieldInfo.wire_offset + element * typeSize(fieldInfo.type));
+                m_nameToSlot.insert(slot.m_name, m_slots.size());
+                m_slots.append(slot);
+            }
+        }
+        m_slotCountOf[msgid] = m_slots.size() - m_firstSlot[msgid];
+    }
+    m_slots.squeeze();
+}
+
+TelemetryStore::~TelemetryStore()
+{
+    for (int sysid = 0; sysid < 256; ++sysid)
+    {
+        delete m_systems[sysid].load();
+    }
+}
+
+const TelemetryStore::Slot *TelemetryStore::component(const int sysid, const int compid) const
+{
+    if ((sysid < 0) || (sysid > 255) || (compid < 0) || (compid > 255))
+    {
+        return 0;
+    }
+    const System *system = m_systems[sysid].loadAcquire();
+    return system ? system->m_components[compid].loadAcquire() : 0;
+}
+
+bool TelemetryStore::isMultiComponent(const int sysid, const quint8 msgid) const
+{
+    if ((sysid < 0) || (sysid > 255))
+    {
+        return false;
+    }
+    const System *system = m_systems[sysid].loadAcquire();
+    return system && (system->m_multiComponent[msgid].load() != 0);
+}
+
+QString TelemetryStore::slotName(const int slot, const int component) const
+{
+    if (component < 0)
+    {
+        return m_slots.at(slot).m_name;
+    }
+    return QString("C%1:%2").arg(component).arg(m_slots.at(slot).m_name);
+}
+
+int TelemetryStore::slotIndex(const quint8 msgid, const int field) const
+{
+    if ((field < 0) || (field >= m_slotCountOf[msgid]))
+    {
+        return -1;
+    }
+    return m_firstSlot[msgid] + field;
+}
+
+double TelemetryStore::readField(const char *payload, const SlotInfo &info)
+{
+    const char *data = payload + info.m_offset;
+    switch (info.m_fieldType)
+    {
+    case MAVLINK_TYPE_UINT8_T:  return readRaw<quint8>(data);
+    case MAVLINK_TYPE_INT8_T:   return readRaw<qint8>(data);
+    case MAVLINK_TYPE_UINT16_T: return readRaw<quint16>(data);
+    case MAVLINK_TYPE_INT16_T:  return readRaw<qint16>(data);
+    case MAVLINK_TYPE_UINT32_T: return readRaw<quint32>(data);
+    case MAVLINK_TYPE_INT32_T:  return readRaw<qint32>(data);
+    case MAVLINK_TYPE_UINT64_T: return static_cast<double>(readRaw<quint64>(data));
+    case MAVLINK_TYPE_INT64_T:  return static_cast<double>(readRaw<qint64>(data));
+    case MAVLINK_TYPE_FLOAT:    return readRaw<float>(data);
+    case MAVLINK_TYPE_DOUBLE:   return readRaw<double>(data);
+    default:                    return 0.0;
+    }
+}
+
+quint64 TelemetryStore::onboardTime(System &system, const mavlink_message_t &message, const quint64 time) const
+{
+    const char *payload = _MAV_PAYLOAD(&message);
+    if (message.msgid == MAVLINK_MSG_ID_SYSTEM_TIME)
+    {
+        const quint64 unixTime = (readRaw<quint64>(payload + offsetof(mavlink_system_time_t, time_unix_usec)) + 500) / 1000;
+        const quint32 bootTime = readRaw<quint32>(payload + offsetof(mavlink_system_time_t, time_boot_ms));
+        system.m_hasOnboardOffset = true;
+        system.m_onboardOffset = static_cast<qint64>(unixTime) - bootTime;
+        system.m_lastOnboardTime = bootTime;
+        system.m_unixOffsetAndDelay = static_cast<qint64>(time - unixTime);
+    }
+
+    quint64 onboard = 0;
+    const int offset = m_timeOffset[message.msgid];
+    if (offset >= 0)
+    {
+        onboard = m_timeIsUsec[message.msgid] ? (readRaw<quint64>(payload + offset) + 500) / 1000 // round to [ms]
+                                              : readRaw<quint32>(payload + offset);
+    }
+
+    if (onboard == 0)
+    {
+        // No onboard time, use the ground time corrected by the known delay
+        return time - system.m_unixOffsetAndDelay;
+    }
+    if (onboard >= MAX_BOOT_TIME)
+    {
+        return onboard;     // Already a Unix timestamp
+    }
+    // Time since boot. The offset is taken from the first message and renewed
+    // if the system rebooted.
+    if (!system.m_hasOnboardOffset || (onboard + 100 < system.m_lastOnboardTime))
+    {
+        system.m_hasOnboardOffset = true;
+        system.m_onboardOffset = static_cast<qint64>(time - onboard);
+    }
+    system.m_lastOnboardTime = qMax(system.m_lastOnboardTime, onboard);
+    return onboard + system.m_onboardOffset;
+}
+
+void TelemetryStore::update(const mavlink_message_t &message, const quint64 time)
+{
+    const int count = m_slotCountOf[message.msgid];
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Only the writer allocates, readers see the zeroed slots after the release
+    System *system = m_systems[message.sysid].load();
+    if (!system)
+    {
+        system = new System();
+        m_systems[message.sysid].storeRelease(system);
+    }
+    Slot *componentSlots = system->m_components[message.compid].load();
+    if (!componentSlots)
+    {
+        componentSlots = new Slot[m_slots.size()];
+        system->m_components[message.compid].storeRelease(componentSlots);
+    }
+    qint16 &firstCompid = system->m_firstCompid[message.msgid];
+    if (firstCompid < 0)
+    {
+        firstCompid = message.compid;
+    }
+    else if (firstCompid != message.compid)
+    {
+        system->m_multiComponent[message.msgid].store(1);
+    }
+
+    const quint64 valueTime = onboardTime(*system, message, time);
+    const char *payload = _MAV_PAYLOAD(&message);
+    int first = m_firstSlot[message.msgid];
+    int end = first + count;
+    if (message.msgid == MAVLINK_MSG_ID_DEBUG)
+    {
+        first += readRaw<quint8>(payload + offsetof(mavlink_debug_t, ind));
+        end = first + 1;
+    }
+    for (int i = first; i < end; ++i)
+    {
+        const double value = readField(payload, m_slots.at(i));
+        quint64 bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        Slot &slot = componentSlots[i];
+        const int sequence = slot.m_sequence.load();
+        slot.m_sequence.store(sequence + 1);
+        // The release stores keep the odd sequence ahead of the data and the
+        // data ahead of the final even sequence.
+        slot.m_bits.storeRelease(bits);
+        slot.m_time.storeRelease(valueTime);
+        slot.m_sequence.storeRelease(sequence + 2);
+    }
+}
+
+bool TelemetryStore::value(const int sysid, const int compid, const int slot, Value &value) const
+{
+    const Slot *componentSlots = component(sysid, compid);
+    if (!componentSlots || (slot < 0) || (slot >= m_slots.size()))
+    {
+        return false;
+    }
+
+    const Slot &source = componentSlots[slot];
+    forever
+    {
+        const int before = source.m_sequence.loadAcquire();
+        if (before & 1)
+        {
+            continue;   // The writer is updating the slot
+        }
+        const quint64 bits = source.m_bits.loadAcquire();
+        const quint64 time = source.m_time.loadAcquire();
+        if (source.m_sequence.load() != before)
+        {
+            continue;
+        }
+        memcpy(&value.m_value, &bits, sizeof(bits));
+        value.m_time = time;
+        value.m_sequence = static_cast<quint32>(before) / 2;
+        return before != 0;
+    }
+}
+
+quint32 TelemetryStore::sequence(const int sysid, const int compid, const int slot) const
+{
+    const Slot *componentSlots = component(sysid, compid);
+    if (!componentSlots || (slot < 0) || (slot >= m_slots.size()))
+    {
+        return 0;
+    }
+    return static_cast<quint32>(componentSlots[slot].m_sequence.loadAcquire()) / 2;
+}
+
+QList<int> TelemetryStore::writtenSlots(const int sysid, const int compid) const
+{
+    QList<int> result;
+    const Slot *componentSlots = component(sysid, compid);
+    if (!componentSlots)
+    {
+        return result;
+    }
+    for (int i = 0; i < m_slots.size(); ++i)
+    {
+        if (componentSlots[i].m_sequence.load() != 0)
+        {
+            result.append(i);
+        }
+    }
+    return result;
+}
+
+TelemetryStoreReader::TelemetryStoreReader(const TelemetryStore &store) :
+    m_store(store),
+    m_sysid(-1),
+    m_lastSequence(256)
+{
+}
+
+void TelemetryStoreReader::setSystem(const int sysid)
+{
+    m_sysid = sysid;
+    for (int compid = 0; compid < m_lastSequence.size(); ++compid)
+    {
+        m_lastSequence[compid].clear();
+    }
+}
+
+void TelemetryStoreReader::poll(QVector<Change> &changes)
+{
+    if (m_sysid < 0)
+    {
+        return;
+    }
+    for (int compid = 0; compid < m_lastSequence.size(); ++compid)
+    {
+        if (!m_store.hasComponent(m_sysid, compid))
+        {
+            continue;
+        }
+        QVector<quint32> &lastSequence = m_lastSequence[compid];
+        if (lastSequence.isEmpty())
+        {
+            lastSequence.fill(0, m_store.slotCount());
+        }
+        for (int slot = 0; slot < lastSequence.size(); ++slot)
+        {
+            if (m_store.sequence(m_sysid, compid, slot) == lastSequence.at(slot))
+            {
+                continue;
+            }
+            Change change;
+            change.m_slot = slot;
+            change.m_component = m_store.isMultiComponent(m_sysid, m_store.slotMessage(slot)) ? compid : -1;
+            if (m_store.value(m_sysid, compid, slot, change.m_value))
+            {
+                lastSequence[slot] = change.m_value.m_sequence;
+                changes.append(change);
+            }
+        }
+    }
+}
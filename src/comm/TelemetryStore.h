@@ -0,0 +1,253 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief TelemetryStore
+ *          Latest value of every numeric field of every received message,
+ *          readable from any thread without locking.
+ *
+ */
+
+#ifndef TELEMETRYSTORE_H
+#define TELEMETRYSTORE_H
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include "libs/mavlink/include/mavlink/v1.0/ardupilotmega/mavlink.h"
+
+/**
+ * @brief The TelemetryStore class holds the latest value of every numeric field
+ *        of every message per system and component. It is written by the
+ *        protocol thread and polled by the widgets at their frame rate instead
+ *        of receiving a valueChanged signal per field.
+ *
+ *        The slot layout is derived once from MAVLINK_MESSAGE_INFO. Each field
+ *        gets one slot, array fields get one slot per element and text fields
+ *        get none. DEBUG messages get one slot "debug.N" per index like the
+ *        MAVLinkDecoder names them. A slot is addressed by (sysid, compid, slot)
+ *        where the global slot index can be resolved from a name like
+ *        "VFR_HUD.airspeed". The slots of a component are allocated when its
+ *        first message arrives.
+ *
+ *        Each slot is a seqlock: the single writer makes the sequence odd while
+ *        it updates the slot, readers retry until they see the same even
+ *        sequence before and after reading. The sequence counts the updates of
+ *        a slot, so readers detect changes by comparing it to the last one seen.
+ */
+class TelemetryStore
+{
+public:
+    /**
+     * @brief The Value struct is a consistent copy of a slot
+     */
+    struct Value
+    {
+        double m_value;         /// Field value converted to double
+        quint64 m_time;         /// Onboard time of the message aligned to ground time in [ms] since epoch
+        quint32 m_sequence;     /// Number of updates of the slot, 0 if never written
+
+        Value() : m_value(0.0), m_time(0), m_sequence(0) {}
+        bool isValid() const { return m_sequence != 0; }
+    };
+
+    TelemetryStore();
+    ~TelemetryStore();
+
+    /**
+     * @brief update stores all numeric fields of a message. Must only be called
+     *        from one thread. The timestamp of the message (time_boot_ms or
+     *        time_usec) is aligned to ground time like the MAVLinkDecoder does.
+     *
+     * @param message - decoded message
+     * @param time - ground time of reception in [ms] since epoch
+     */
+    void update(const mavlink_message_t &message, const quint64 time);
+
+    /**
+     * @brief slotIndex delivers the global slot index of a field
+     *
+     * @param name - "MESSAGE.field", "MESSAGE.field.n" for array elements or
+     *               "debug.n" for DEBUG values
+     * @return slot index or -1 if there is no such numeric field
+     */
+    int slotIndex(const QString &name) const { return m_nameToSlot.value(name, -1); }
+
+    /**
+     * @brief slotIndex delivers the global slot index of a field
+     *
+     * @param msgid - message id
+     * @param field - slot within the message (array elements count separately)
+     * @return slot index or -1 if the message has no such slot
+     */
+    int slotIndex(const quint8 msgid, const int field) const;
+
+    int slotCount() const { return m_slots.size(); }
+    QString slotName(const int slot) const { return m_slots.at(slot).m_name; }
+    quint8 slotMessage(const int slot) const { return m_slots.at(slot).m_msgid; }
+
+    /**
+     * @brief slotName delivers the value name of a slot. Like the MAVLinkDecoder
+     *        the component is prepended as "C<compid>:" if it is not -1.
+     */
+    QString slotName(const int slot, const int component) const;
+
+    /**
+     * @brief nameKey delivers a unique key for each slot and component, so
+     *        widgets can cache the value names.
+     */
+    int nameKey(const int slot, const int component) const { return (component + 1) * m_slots.size() + slot; }
+
+    /**
+     * @brief slotType delivers the type of a slot as used by the MAVLinkDecoder
+     *        as unit, like "float" or "uint16_t[8]".
+     */
+    QString slotType(const int slot) const { return m_slots.at(slot).m_type; }
+
+    /**
+     * @brief hasComponent checks if a component of a system sent any message
+     */
+    bool hasComponent(const int sysid, const int compid) const { return component(sysid, compid) != 0; }
+
+    /**
+     * @brief isMultiComponent checks if a message was received from more than
+     *        one component of a system. Its values are then named by component.
+     */
+    bool isMultiComponent(const int sysid, const quint8 msgid) const;
+
+    /**
+     * @brief value reads a slot. May be called from any thread.
+     *
+     * @param sysid - system id
+     * @param compid - component id
+     * @param slot - global slot index
+     * @param value - receives the value
+     * @return true if the slot was written at least once
+     */
+    bool value(const int sysid, const int compid, const int slot, Value &value) const;
+
+    /**
+     * @brief sequence delivers the update count of a slot without reading its
+     *        value. Cheap check whether a slot changed since the last read.
+     */
+    quint32 sequence(const int sysid, const int compid, const int slot) const;
+
+    /**
+     * @brief writtenSlots delivers all slots of a component written at least once
+     */
+    QList<int> writtenSlots(const int sysid, const int compid) const;
+
+private:
+    struct SlotInfo
+    {
+        QString m_name;         /// "MESSAGE.field[.n]"
+        QString m_type;         /// Type name like "float"
+        quint8 m_msgid;         /// Message the slot belongs to
+        quint8 m_fieldType;     /// MAVLINK_TYPE_*
+        quint16 m_offset;       /// Byte offset within the payload
+    };
+
+    struct Slot
+    {
+        QAtomicInt m_sequence;          /// Odd while the writer updates the slot
+        QAtomicInteger<quint64> m_bits; /// Bits of the double value
+        QAtomicInteger<quint64> m_time; /// Update time
+    };
+
+    /**
+     * @brief The System struct holds the slots of all components of a system
+     *        and the state used by the writer to align the onboard time.
+     */
+    struct System
+    {
+        QAtomicPointer<Slot> m_components[256]; /// Slots of each component, allocated on first use
+        QAtomicInt m_multiComponent[256];       /// Messages received from several components
+        qint16 m_firstCompid[256];              /// First component of each message, -1 if none
+        bool m_hasOnboardOffset;                /// True if m_onboardOffset is known
+        qint64 m_onboardOffset;                 /// Ground time minus onboard time in [ms]
+        quint64 m_lastOnboardTime;              /// Latest onboard time in [ms]
+        qint64 m_unixOffsetAndDelay;            /// Ground time minus onboard unix time in [ms]
+
+        System();
+        ~System();
+    };
+
+    const Slot *component(const int sysid, const int compid) const;
+    quint64 onboardTime(System &system, const mavlink_message_t &message, const quint64 time) const;
+    static double readField(const char *payload, const SlotInfo &info);
+
+    QVector<SlotInfo> m_slots;          /// Layout of all slots, constant after construction
+    QHash<QString, int> m_nameToSlot;   /// Slot name to slot index
+    int m_firstSlot[256];               /// First slot of each message
+    int m_slotCountOf[256];             /// Number of slots of each message
+    int m_timeOffset[256];              /// Payload offset of the leading timestamp, -1 if none
+    bool m_timeIsUsec[256];             /// True if the timestamp is time_usec instead of time_boot_ms
+    QAtomicPointer<System> m_systems[256];/// Each system, allocated on first use
+};
+
+/**
+ * @brief The TelemetryStoreReader class finds the slots of one system which were
+ *        updated since the last poll by comparing their sequences. Every widget
+ *        polling the store uses its own reader.
+ */
+class TelemetryStoreReader
+{
+public:
+    /**
+     * @brief The Change struct holds an updated slot and its value
+     */
+    struct Change
+    {
+        int m_slot;
+        int m_component;        /// Component id for the value name, -1 if the message has one component
+        TelemetryStore::Value m_value;
+    };
+
+    explicit TelemetryStoreReader(const TelemetryStore &store);
+
+    const TelemetryStore &store() const { return m_store; }
+
+    /**
+     * @brief setSystem selects the system to poll, -1 for none. The next poll
+     *        delivers all slots written so far.
+     */
+    void setSystem(const int sysid);
+    int system() const { return m_sysid; }
+
+    /**
+     * @brief poll appends all slots of all components updated since the last
+     *        poll to changes
+     */
+    void poll(QVector<Change> &changes);
+
+private:
+    const TelemetryStore &m_store;
+    int m_sysid;                        /// Polled system
+    QVector<QVector<quint32> > m_lastSequence; /// Sequence of each slot of each component at the last poll
+};
+
+#endif // TELEMETRYSTORE_H
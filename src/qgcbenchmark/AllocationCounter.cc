@@ -0,0 +1,109 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Process wide heap allocation counter for benchmarks
+ */
+
+#include "AllocationCounter.h"
+#include <QAtomicInteger>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    // Statically initialized as allocations happen before any constructor runs
+    QBasicAtomicInteger<quint64> s_allocations = Q_BASIC_ATOMIC_INITIALIZER(0);
+}
+
+#if defined(__GLIBC__)
+
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+
+    void *malloc(size_t size)
+    {
+        s_allocations.fetchAndAddRelaxed(1);
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        s_allocations.fetchAndAddRelaxed(1);
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *ptr, size_t size)
+    {
+        // Growing a block usually means a new allocation
+        s_allocations.fetchAndAddRelaxed(1);
+        return __libc_realloc(ptr, size);
+    }
+}
+
+bool AllocationCounter::countsAllAllocations()
+{
+    return true;
+}
+
+#else
+
+void *operator new(std::size_t size)
+{
+    s_allocations.fetchAndAddRelaxed(1);
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) Q_DECL_NOTHROW
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) Q_DECL_NOTHROW
+{
+    std::free(ptr);
+}
+
+bool AllocationCounter::countsAllAllocations()
+{
+    return false;
+}
+
+#endif
+
+quint64 AllocationCounter::count()
+{
+    return s_allocations.load();
+}
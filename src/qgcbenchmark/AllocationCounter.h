@@ -0,0 +1,51 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Process wide heap allocation counter for benchmarks
+ *
+ *   With glibc malloc, calloc and realloc are interposed so allocations of Qt
+ *   containers are counted too. On other platforms only the C++ operator new
+ *   is replaced.
+ */
+
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+namespace AllocationCounter
+{
+    /**
+     * @brief count delivers the number of heap allocations done by all threads
+     *        since the start of the process.
+     */
+    quint64 count();
+
+    /**
+     * @brief countsAllAllocations delivers true if malloc is counted and false
+     *        if only operator new is counted.
+     */
+    bool countsAllAllocations();
+}
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,162 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Minimal framework for headless benchmarks
+ *
+ *   Works like AutoTest.h of the qgcunittest. Each benchmark registers itself
+ *   using DECLARE_BENCHMARK and BENCHMARK_MAIN runs all of them or only those
+ *   named on the command line. Benchmarks which need a QApplication create it
+ *   themselves and call AutoBenchmark::run(app).
+ *
+ *   Usage: qgcbenchmark [BenchmarkName ...] [--option value ...]
+ */
+
+#ifndef AUTOBENCHMARK_H
+#define AUTOBENCHMARK_H
+
+#include <QCoreApplication>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QSharedPointer>
+#include <QTextStream>
+
+/**
+ * @brief The Benchmark class is the base of all benchmarks
+ */
+class Benchmark
+{
+public:
+    virtual ~Benchmark() {}
+
+    /**
+     * @brief run executes the benchmark and prints its results to out
+     *
+     * @param args - all command line arguments
+     * @param out - stream to report the results to
+     * @return true on success, false otherwise
+     */
+    virtual bool run(const QStringList &args, QTextStream &out) = 0;
+
+    QString name() const { return m_name; }
+    void setName(const QString &name) { m_name = name; }
+
+    /**
+     * @brief option delivers the value of a "--name value" command line option
+     * @return value of the option or defaultValue if the option is not set
+     */
+    static QString option(const QStringList &args, const QString &name, const QString &defaultValue)
+    {
+        int index = args.indexOf(name);
+        if ((index >= 0) && (index + 1 < args.size()))
+        {
+            return args.at(index + 1);
+        }
+        return defaultValue;
+    }
+
+private:
+    QString m_name;
+};
+
+namespace AutoBenchmark
+{
+    typedef QList<Benchmark*> BenchmarkList;
+
+    inline BenchmarkList& benchmarkList()
+    {
+        static BenchmarkList list;
+        return list;
+    }
+
+    inline void addBenchmark(Benchmark* benchmark)
+    {
+        benchmarkList().append(benchmark);
+    }
+
+    inline int run(QCoreApplication &app)
+    {
+        QStringList args = app.arguments();
+        QTextStream out(stdout);
+
+        // Plain arguments select benchmarks, "--name value" pairs are options
+        QStringList selected;
+        for (int i = 1; i < args.size(); ++i)
+        {
+            if (args.at(i).startsWith("--"))
+            {
+                ++i;
+            }
+            else
+            {
+                selected.append(args.at(i));
+            }
+        }
+
+        int failures = 0;
+        foreach (Benchmark* benchmark, benchmarkList())
+        {
+            if (!selected.isEmpty() && !selected.contains(benchmark->name()))
+            {
+                continue;
+            }
+            out << "********* Start benchmark " << benchmark->name() << " *********" << endl;
+            if (!benchmark->run(args, out))
+            {
+                out << "FAIL: " << benchmark->name() << endl;
+                ++failures;
+            }
+            out << "********* Finished benchmark " << benchmark->name() << " *********" << endl;
+        }
+        return failures;
+    }
+
+    inline int run(int argc, char *argv[])
+    {
+        QCoreApplication app(argc, argv);
+        return run(app);
+    }
+}
+
+template <class T>
+class BenchmarkRegistration
+{
+public:
+    QSharedPointer<T> child;
+
+    BenchmarkRegistration(const QString& name) : child(new T)
+    {
+        child->setName(name);
+        AutoBenchmark::addBenchmark(child.data());
+    }
+};
+
+#define DECLARE_BENCHMARK(className) static BenchmarkRegistration<className> b(#className);
+
+#define BENCHMARK_MAIN \
+    int main(int argc, char *argv[]) \
+    { \
+        return AutoBenchmark::run(argc, argv); \
+    }
+
+#endif // AUTOBENCHMARK_H
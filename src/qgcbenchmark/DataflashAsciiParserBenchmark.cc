@@ -0,0 +1,205 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Throughput benchmark of the ASCII dataflash log loader
+ *
+ *   Loads a synthetic ASCII log through AP2DataPlotThread and checks that the
+ *   flight mode names of the MODE rows are kept.
+ *
+ *   Options:
+ *      --size-mb <size>    Size of the synthetic log in MB (default 64)
+ *      --keep              Do not delete the synthetic log after the run
+ */
+
+#include "AutoBenchmark.h"
+#include "AP2DataPlot2DModel.h"
+#include "AP2DataPlotLogCache.h"
+#include "AP2DataPlotThread.h"
+#include "QGC.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <cmath>
+
+namespace
+{
+    const char *const MODE_NAMES[] = { "STABILIZE", "ALT_HOLD", "LOITER", "AUTO", "RTL" };
+    const int MODE_COUNT = sizeof(MODE_NAMES) / sizeof(MODE_NAMES[0]);
+    const int ATT_ROWS_PER_MODE = 500;
+
+    // Write to disk in blocks of this size
+    const int WRITE_BLOCK_SIZE = 1024 * 1024;
+}
+
+/**
+ * @brief The AsciiLogGenerator class writes a synthetic ASCII log like it is
+ *        downloaded from an APM with attitude rows and some mode changes.
+ */
+class AsciiLogGenerator
+{
+public:
+    AsciiLogGenerator() : m_modeCount(0) {}
+
+    bool generate(const QString &fileName, const qint64 size)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            m_error = "Unable to create " + fileName;
+            return false;
+        }
+
+        QByteArray buffer;
+        buffer.append("FMT, 128, 89, FMT, BBnNZ, Type,Length,Name,Format,Columns\n");
+        buffer.append("FMT, 129, 31, PARM, QNf, TimeUS,Name,Value\n");
+        buffer.append("FMT, 130, 11, MODE, QMB, TimeUS,Mode,ModeNum\n");
+        buffer.append("FMT, 131, 27, ATT, QccccCC, TimeUS,DesRoll,Roll,DesPitch,Pitch,DesYaw,Yaw\n");
+        buffer.append("PARM, 1000, RATE_RLL_P, 0.15\n");
+
+        quint64 timeUS = 2000;
+        qint64 written = 0;
+        int row = 0;
+        while (written + buffer.size() < size)
+        {
+            if (row % ATT_ROWS_PER_MODE == 0)
+            {
+                buffer.append("MODE, " + QByteArray::number(timeUS) + ", " + MODE_NAMES[m_modeCount % MODE_COUNT] +
+                              ", " + QByteArray::number(m_modeCount % MODE_COUNT) + "\n");
+                ++m_modeCount;
+            }
+            const double roll = std::sin(row * 0.001) * 30.0;
+            const double pitch = std::cos(row * 0.001) * 10.0;
+            buffer.append("ATT, " + QByteArray::number(timeUS) + ", " + QByteArray::number(roll, 'f', 2) + ", " +
+                          QByteArray::number(roll + 0.1, 'f', 2) + ", " + QByteArray::number(pitch, 'f', 2) + ", " +
+                          QByteArray::number(pitch - 0.1, 'f', 2) + ", 90.00, 90.50\n");
+            timeUS += 10000;
+            ++row;
+
+            if (buffer.size() >= WRITE_BLOCK_SIZE)
+            {
+                if (file.write(buffer) != buffer.size())
+                {
+                    m_error = "Unable to write " + fileName;
+                    return false;
+                }
+                written += buffer.size();
+                buffer.clear();
+            }
+        }
+        if (file.write(buffer) != buffer.size())
+        {
+            m_error = "Unable to write " + fileName;
+            return false;
+        }
+        return true;
+    }
+
+    int modeCount() const { return m_modeCount; }
+    QString getError() const { return m_error; }
+
+private:
+    int m_modeCount;
+    QString m_error;
+};
+
+class DataflashAsciiParserBenchmark : public Benchmark
+{
+public:
+    bool run(const QStringList &args, QTextStream &out)
+    {
+        const qint64 sizeMB = option(args, "--size-mb", "64").toLongLong();
+        const QString fileName = QDir::temp().filePath("qgcbenchmark_dataflash.log");
+        out << "Generating synthetic ASCII log of " << sizeMB << " MB: " << fileName << endl;
+        AsciiLogGenerator generator;
+        if (!generator.generate(fileName, sizeMB * 1024 * 1024))
+        {
+            out << generator.getError() << endl;
+            return false;
+        }
+
+        // A cached log would be restored instead of parsed
+        removeCachedLog(fileName);
+
+        AP2DataPlot2DModel model;
+        AP2DataPlotThread thread(&model);
+        QElapsedTimer timer;
+        timer.start();
+        thread.loadFile(fileName);
+        thread.wait();
+        const double seconds = timer.nsecsElapsed() / 1000000000.0;
+        const qint64 size = QFileInfo(fileName).size();
+
+        removeCachedLog(fileName);
+        if (!args.contains("--keep"))
+        {
+            QFile::remove(fileName);
+        }
+
+        if (!verify(model, generator.modeCount(), out))
+        {
+            return false;
+        }
+
+        const double megaBytes = size / (1024.0 * 1024.0);
+        const int rows = model.rowCount();
+        out << "Parsed " << megaBytes << " MB (" << rows << " rows) in " << seconds << " s" << endl;
+        out << "RESULT DataflashAsciiParser: " << megaBytes / seconds << " MB/s, "
+            << rows / seconds << " rows/s" << endl;
+        return true;
+    }
+
+private:
+    void removeCachedLog(const QString &fileName)
+    {
+        QFile file(fileName);
+        AP2DataPlotLogCache cache(QGC::appDataDirectory() + "/logcache/");
+        if (file.open(QIODevice::ReadOnly) && cache.open(file))
+        {
+            QFile::remove(cache.fileName());
+        }
+    }
+
+    bool verify(AP2DataPlot2DModel &model, const int modeCount, QTextStream &out)
+    {
+        const QMap<double, QVariant> modes = model.getValues("MODE", "Mode", false);
+        if (modes.size() != modeCount)
+        {
+            out << "Loaded " << modes.size() << " MODE rows, expected " << modeCount << endl;
+            return false;
+        }
+        int i = 0;
+        for (QMap<double, QVariant>::const_iterator iter = modes.constBegin(); iter != modes.constEnd(); ++iter, ++i)
+        {
+            if (iter.value().toString() != MODE_NAMES[i % MODE_COUNT])
+            {
+                out << "MODE row " << i << " holds '" << iter.value().toString() << "', expected '"
+                    << MODE_NAMES[i % MODE_COUNT] << "'" << endl;
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+DECLARE_BENCHMARK(DataflashAsciiParserBenchmark)
@@ -0,0 +1,284 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Writer for synthetic binary dataflash logs
+ */
+
+#include "DataflashLogGenerator.h"
+#include "AutoBenchmark.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QtEndian>
+#include <cmath>
+
+namespace
+{
+    // Message types used in the synthetic log
+    const quint8 FMT_TYPE  = 0x80;
+    const quint8 PARM_TYPE = 0x81;
+    const quint8 MODE_TYPE = 0x82;
+    const quint8 ATT_TYPE  = 0x83;
+    const quint8 IMU_TYPE  = 0x84;
+    const quint8 GPS_TYPE  = 0x85;
+    const quint8 MSG_TYPE  = 0x86;
+
+    // Write to disk in blocks of this size
+    const int WRITE_BLOCK_SIZE = 1024 * 1024;
+}
+
+DataflashLogGenerator::DataflashLogGenerator() :
+    m_messageCount(0)
+{
+}
+
+template <typename T> void DataflashLogGenerator::write(const T value)
+{
+    uchar data[sizeof(T)];
+    qToLittleEndian<T>(value, data);
+    m_buffer.append(reinterpret_cast<const char*>(data), sizeof(T));
+}
+
+template <> void DataflashLogGenerator::write<float>(const float value)
+{
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    write<quint32>(bits);
+}
+
+void DataflashLogGenerator::writeHeader(const quint8 type)
+{
+    m_buffer.append(static_cast<char>(0xA3));
+    m_buffer.append(static_cast<char>(0x95));
+    m_buffer.append(static_cast<char>(type));
+}
+
+void DataflashLogGenerator::writeText(const char *text, const int length)
+{
+    QByteArray data(text);
+    data = data.left(length);
+    m_buffer.append(data);
+    m_buffer.append(QByteArray(length - data.size(), '\0'));
+}
+
+void DataflashLogGenerator::writeFMT(const quint8 type, const quint8 length, const char *name, const char *format, const char *labels)
+{
+    writeHeader(FMT_TYPE);
+    write<quint8>(type);
+    write<quint8>(length);
+    writeText(name, 4);
+    writeText(format, 16);
+    writeText(labels, 64);
+}
+
+void DataflashLogGenerator::writeFormats()
+{
+    writeFMT(FMT_TYPE, 89, "FMT", "BBnNZ", "Type,Length,Name,Format,Columns");
+    writeFMT(PARM_TYPE, 31, "PARM", "QNf", "TimeUS,Name,Value");
+    writeFMT(MODE_TYPE, 13, "MODE", "QMB", "TimeUS,Mode,ModeNum");
+    writeFMT(ATT_TYPE, 23, "ATT", "QccccCC", "TimeUS,DesRoll,Roll,DesPitch,Pitch,DesYaw,Yaw");
+    writeFMT(IMU_TYPE, 49, "IMU", "QffffffIIfBB", "TimeUS,GyrX,GyrY,GyrZ,AccX,AccY,AccZ,EG,EA,T,GH,AH");
+    writeFMT(GPS_TYPE, 50, "GPS", "QBIHBcLLeeEefB", "TimeUS,Status,GMS,GWk,NSats,HDop,Lat,Lng,RAlt,Alt,Spd,GCrs,VZ,U");
+    writeFMT(MSG_TYPE, 75, "MSG", "QZ", "TimeUS,Message");
+}
+
+bool DataflashLogGenerator::generate(const QString &fileName, const qint64 size)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        m_error = "Unable to open " + fileName + " for writing: " + file.errorString();
+        return false;
+    }
+
+    m_buffer.clear();
+    m_buffer.reserve(WRITE_BLOCK_SIZE + 1024);
+    m_messageCount = 0;
+
+    writeFormats();
+
+    // Parameters identifying the log as copter log
+    quint64 timeUS = 1000000;
+    const char *params[] = { "RATE_RLL_P", "RATE_PIT_P", "RATE_YAW_P", "WPNAV_SPEED" };
+    for (unsigned int i = 0; i < sizeof(params) / sizeof(params[0]); ++i)
+    {
+        writeHeader(PARM_TYPE);
+        write<quint64>(timeUS);
+        writeText(params[i], 16);
+        write<float>(0.15f * (i + 1));
+        ++m_messageCount;
+    }
+    writeHeader(MODE_TYPE);
+    write<quint64>(timeUS);
+    write<quint8>(5);
+    write<quint8>(5);
+    ++m_messageCount;
+
+    qint64 written = 0;
+    for (quint32 cycle = 0; written + m_buffer.size() < size; ++cycle)
+    {
+        timeUS += 10000;
+        const double phase = cycle * 0.01;
+
+        writeHeader(ATT_TYPE);
+        write<quint64>(timeUS);
+        write<qint16>(static_cast<qint16>(1000 * sin(phase)));
+        write<qint16>(static_cast<qint16>(1010 * sin(phase)));
+        write<qint16>(static_cast<qint16>(500 * cos(phase)));
+        write<qint16>(static_cast<qint16>(510 * cos(phase)));
+        write<quint16>(static_cast<quint16>(cycle % 36000));
+        write<quint16>(static_cast<quint16>((cycle + 5) % 36000));
+
+        writeHeader(IMU_TYPE);
+        write<quint64>(timeUS);
+        write<float>(static_cast<float>(0.01 * sin(phase)));
+        write<float>(static_cast<float>(0.01 * cos(phase)));
+        write<float>(0.001f);
+        write<float>(static_cast<float>(0.2 * sin(phase * 3.0)));
+        write<float>(static_cast<float>(0.2 * cos(phase * 3.0)));
+        write<float>(-9.81f);
+        write<quint32>(0);
+        write<quint32>(0);
+        write<float>(42.5f);
+        write<quint8>(1);
+        write<quint8>(1);
+        m_messageCount += 2;
+
+        if (cycle % 20 == 0)
+        {
+            writeHeader(GPS_TYPE);
+            write<quint64>(timeUS);
+            write<quint8>(3);
+            write<quint32>(static_cast<quint32>(timeUS / 1000));
+            write<quint16>(1890);
+            write<quint8>(12);
+            write<qint16>(90);
+            write<qint32>(static_cast<qint32>(-353632620 + 100 * sin(phase)));
+            write<qint32>(static_cast<qint32>(1491652300 + 100 * cos(phase)));
+            write<qint32>(2500);
+            write<qint32>(58400);
+            write<quint32>(512);
+            write<qint32>(static_cast<qint32>(cycle % 36000));
+            write<float>(0.1f);
+            write<quint8>(1);
+            ++m_messageCount;
+        }
+
+        if (cycle % 1000 == 0)
+        {
+            writeHeader(MSG_TYPE);
+            write<quint64>(timeUS);
+            writeText("Synthetic benchmark message", 64);
+            ++m_messageCount;
+        }
+
+        if (m_buffer.size() >= WRITE_BLOCK_SIZE)
+        {
+            if (file.write(m_buffer) != m_buffer.size())
+            {
+                m_error = "Unable to write " + fileName + ": " + file.errorString();
+                return false;
+            }
+            written += m_buffer.size();
+            m_buffer.clear();
+        }
+    }
+
+    if (file.write(m_buffer) != m_buffer.size())
+    {
+        m_error = "Unable to write " + fileName + ": " + file.errorString();
+        return false;
+    }
+    m_buffer.clear();
+    m_buffer.squeeze();
+    return true;
+}
+
+BenchmarkLog::BenchmarkLog(const QStringList &args, QTextStream &out) :
+    m_data(0),
+    m_valid(true),
+    m_remove(false)
+{
+    m_fileName = Benchmark::option(args, "--file", QString());
+    if (!m_fileName.isEmpty())
+    {
+        return;
+    }
+
+    const qint64 sizeMB = Benchmark::option(args, "--size-mb", "1024").toLongLong();
+    m_fileName = QDir::temp().filePath("qgcbenchmark_dataflash.bin");
+    m_remove = !args.contains("--keep");
+    out << "Generating synthetic log of " << sizeMB << " MB: " << m_fileName << endl;
+
+    QElapsedTimer timer;
+    timer.start();
+    DataflashLogGenerator generator;
+    m_valid = generator.generate(m_fileName, sizeMB * 1024 * 1024);
+    if (!m_valid)
+    {
+        out << generator.getError() << endl;
+        return;
+    }
+    out << "Generated " << generator.messageCount() << " messages in "
+        << timer.elapsed() / 1000.0 << " s" << endl;
+}
+
+BenchmarkLog::~BenchmarkLog()
+{
+    if (m_data)
+    {
+        m_file.unmap(const_cast<uchar*>(m_data));
+    }
+    m_file.close();
+    if (m_remove)
+    {
+        QFile::remove(m_fileName);
+    }
+}
+
+const uchar *BenchmarkLog::map()
+{
+    if (m_data)
+    {
+        return m_data;
+    }
+
+    m_file.setFileName(m_fileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        return 0;
+    }
+    m_data = m_file.map(0, m_file.size());
+    if (!m_data)
+    {
+        return 0;
+    }
+
+    quint64 checksum = 0;
+    for (qint64 i = 0; i < m_file.size(); i += 4096)
+    {
+        checksum += m_data[i];
+    }
+    Q_UNUSED(checksum);
+    return m_data;
+}
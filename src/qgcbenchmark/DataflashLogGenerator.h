@@ -0,0 +1,108 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Writer for synthetic binary dataflash logs
+ */
+
+#ifndef DATAFLASHLOGGENERATOR_H
+#define DATAFLASHLOGGENERATOR_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+/**
+ * @brief The DataflashLogGenerator class writes a synthetic binary dataflash log
+ *        of a given size. The log contains FMT, PARM, MODE, ATT, IMU, GPS and MSG
+ *        messages with plausible values and a time stamp increasing by 10ms per
+ *        ATT/IMU pair, like a copter logging at 100Hz.
+ */
+class DataflashLogGenerator
+{
+public:
+    DataflashLogGenerator();
+
+    /**
+     * @brief generate writes the log file
+     *
+     * @param fileName - name of the file to create
+     * @param size - minimal size of the log in bytes
+     * @return true on success, false otherwise. Use getError() for details.
+     */
+    bool generate(const QString &fileName, const qint64 size);
+
+    /**
+     * @brief messageCount delivers the number of data messages (without FMT)
+     *        written by the last call of generate()
+     */
+    qint64 messageCount() const { return m_messageCount; }
+
+    QString getError() const { return m_error; }
+
+private:
+    void writeFormats();
+    void writeFMT(const quint8 type, const quint8 length, const char *name, const char *format, const char *labels);
+    void writeHeader(const quint8 type);
+    void writeText(const char *text, const int length);
+    template <typename T> void write(const T value);
+
+    QByteArray m_buffer;        /// Buffer holding not yet written data
+    qint64 m_messageCount;      /// Number of data messages written
+    QString m_error;            /// Last error
+};
+
+/**
+ * @brief The BenchmarkLog class delivers the log a benchmark works on. This is
+ *        either the log given with "--file <log.bin>" or a synthetic log with the
+ *        size given by "--size-mb <size>" (default 1024). The synthetic log is
+ *        removed on destruction unless "--keep" is given.
+ */
+class BenchmarkLog
+{
+public:
+    BenchmarkLog(const QStringList &args, QTextStream &out);
+    ~BenchmarkLog();
+
+    bool isValid() const { return m_valid; }
+    QString fileName() const { return m_fileName; }
+
+    /**
+     * @brief map maps the log into memory and touches every page once, so
+     *        measurements show the parser and not the disk.
+     *
+     * @return pointer to the log data or 0 on error
+     */
+    const uchar *map();
+    qint64 size() const { return m_file.size(); }
+
+private:
+    QFile m_file;
+    const uchar *m_data;
+    QString m_fileName;
+    bool m_valid;
+    bool m_remove;
+};
+
+#endif // DATAFLASHLOGGENERATOR_H
@@ -0,0 +1,144 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Speedup benchmark of the multi threaded dataflash parser
+ *
+ *   Parses the log with the sequential and the parallel parser, checks that
+ *   both models are identical and reports the throughput of both.
+ *
+ *   Options:
+ *      --threads <count>   Number of threads (default QThread::idealThreadCount())
+ *      --file <log.bin>    Parse an existing log instead of a synthetic one
+ *      --size-mb <size>    Size of the synthetic log in MB (default 1024)
+ *      --keep              Do not delete the synthetic log after the run
+ */
+
+#include "AutoBenchmark.h"
+#include "DataflashLogGenerator.h"
+#include "AP2DataPlot2DModel.h"
+#include "AP2DataPlotBinaryParser.h"
+#include "AP2DataPlotParallelParser.h"
+#include "AP2DataPlotStatus.h"
+#include <QElapsedTimer>
+#include <QThread>
+
+class DataflashParallelParserBenchmark : public Benchmark
+{
+public:
+    bool run(const QStringList &args, QTextStream &out)
+    {
+        BenchmarkLog log(args, out);
+        const uchar *data = log.isValid() ? log.map() : 0;
+        if (!data)
+        {
+            out << "Unable to map log file " << log.fileName() << endl;
+            return false;
+        }
+        const qint64 size = log.size();
+        const double megaBytes = size / (1024.0 * 1024.0);
+        const int threads = option(args, "--threads", QString::number(QThread::idealThreadCount())).toInt();
+
+        QElapsedTimer timer;
+
+        // Sequential reference
+        AP2DataPlot2DModel sequentialModel;
+        AP2DataPlotStatus sequentialStatus;
+        AP2DataPlotBinaryParser sequentialParser(&sequentialModel, &sequentialStatus);
+        timer.start();
+        if (sequentialParser.parse(data, size, 0, size) < 0)
+        {
+            out << "Sequential parsing failed: " << sequentialModel.getError() << endl;
+            return false;
+        }
+        sequentialModel.endTransaction();
+        const double sequentialSeconds = timer.nsecsElapsed() / 1000000000.0;
+
+        // Parallel
+        AP2DataPlot2DModel parallelModel;
+        AP2DataPlotStatus parallelStatus;
+        AP2DataPlotParallelParser parallelParser(&parallelModel, &parallelStatus);
+        parallelParser.setThreadCount(threads);
+        bool stop = false;
+        timer.restart();
+        if (parallelParser.parse(data, size, stop) < 0)
+        {
+            out << "Parallel parsing failed: " << parallelParser.getError() << endl;
+            return false;
+        }
+        parallelModel.endTransaction();
+        const double parallelSeconds = timer.nsecsElapsed() / 1000000000.0;
+
+        if (!isIdentical(sequentialModel, parallelModel, out))
+        {
+            return false;
+        }
+
+        out << "Parsed " << megaBytes << " MB (" << parallelModel.rowCount() << " rows)" << endl;
+        out << "RESULT DataflashParser sequential: " << megaBytes / sequentialSeconds << " MB/s" << endl;
+        out << "RESULT DataflashParser " << threads << " threads: " << megaBytes / parallelSeconds << " MB/s" << endl;
+        out << "RESULT DataflashParser speedup: " << sequentialSeconds / parallelSeconds << endl;
+        return true;
+    }
+
+private:
+    bool isIdentical(AP2DataPlot2DModel &expected, AP2DataPlot2DModel &actual, QTextStream &out)
+    {
+        if ((expected.rowCount() != actual.rowCount()) || (expected.columnCount() != actual.columnCount()) ||
+            (expected.getFirstIndex() != actual.getFirstIndex()) || (expected.getLastIndex() != actual.getLastIndex()))
+        {
+            out << "Models differ in size or index range" << endl;
+            return false;
+        }
+
+        const AP2DataPlotColumnStore &expectedStore = expected.columnStore();
+        const AP2DataPlotColumnStore &actualStore = actual.columnStore();
+        if (expectedStore.tableCount() != actualStore.tableCount())
+        {
+            out << "Models differ in number of message types" << endl;
+            return false;
+        }
+        for (int i = 0; i < expectedStore.tableCount(); ++i)
+        {
+            const AP2DataPlotTable &expectedTable = expectedStore.table(i);
+            const AP2DataPlotTable &actualTable = actualStore.table(i);
+            if ((expectedTable.m_name != actualTable.m_name) || (expectedTable.m_index != actualTable.m_index) ||
+                (expectedTable.m_columns != actualTable.m_columns))
+            {
+                out << "Models differ in data of message type " << expectedTable.m_name << endl;
+                return false;
+            }
+        }
+        for (int row = 0; row < expectedStore.rowCount(); ++row)
+        {
+            if ((expectedStore.rowAt(row).m_tableID != actualStore.rowAt(row).m_tableID) ||
+                (expectedStore.rowAt(row).m_row != actualStore.rowAt(row).m_row))
+            {
+                out << "Models differ in row order at row " << row << endl;
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+DECLARE_BENCHMARK(DataflashParallelParserBenchmark)
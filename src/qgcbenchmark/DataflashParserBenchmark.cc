@@ -0,0 +1,78 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Throughput benchmark of the memory mapped dataflash parser
+ *
+ *   Options:
+ *      --file <log.bin>    Parse an existing log instead of a synthetic one
+ *      --size-mb <size>    Size of the synthetic log in MB (default 1024)
+ *      --keep              Do not delete the synthetic log after the run
+ */
+
+#include "AutoBenchmark.h"
+#include "DataflashLogGenerator.h"
+#include "AP2DataPlot2DModel.h"
+#include "AP2DataPlotBinaryParser.h"
+#include "AP2DataPlotStatus.h"
+#include <QElapsedTimer>
+
+class DataflashParserBenchmark : public Benchmark
+{
+public:
+    bool run(const QStringList &args, QTextStream &out)
+    {
+        BenchmarkLog log(args, out);
+        const uchar *data = log.isValid() ? log.map() : 0;
+        if (!data)
+        {
+            out << "Unable to map log file " << log.fileName() << endl;
+            return false;
+        }
+
+        AP2DataPlot2DModel model;
+        AP2DataPlotStatus status;
+        AP2DataPlotBinaryParser parser(&model, &status);
+
+        QElapsedTimer timer;
+        timer.start();
+        model.startTransaction();
+        qint64 pos = parser.parse(data, log.size(), 0, log.size());
+        model.endTransaction();
+        const double seconds = timer.nsecsElapsed() / 1000000000.0;
+
+        if (pos < 0)
+        {
+            out << "Parsing failed: " << model.getError() << endl;
+            return false;
+        }
+
+        const double megaBytes = log.size() / (1024.0 * 1024.0);
+        const int rows = model.rowCount();
+        out << "Parsed " << megaBytes << " MB (" << rows << " rows) in " << seconds << " s" << endl;
+        out << "RESULT DataflashParser: " << megaBytes / seconds << " MB/s, "
+            << rows / seconds << " rows/s" << endl;
+        return true;
+    }
+};
+
+DECLARE_BENCHMARK(DataflashParserBenchmark)
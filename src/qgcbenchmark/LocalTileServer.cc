@@ -0,0 +1,173 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Minimal HTTP server delivering map tiles from disk
+ */
+
+#include "LocalTileServer.h"
+#include <QFile>
+#include <QHostAddress>
+#include <QList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+namespace
+{
+    // Interval in ms the server checks for answers whose latency expired
+    const int POLL_INTERVAL = 2;
+}
+
+LocalTileServer::LocalTileServer(const QString &directory, const int latency) :
+    m_directory(directory),
+    m_latency(qMax(0, latency)),
+    m_server(0),
+    m_timer(0),
+    m_port(0),
+    m_requestCount(0)
+{
+    moveToThread(&m_thread);
+    m_thread.start();
+}
+
+LocalTileServer::~LocalTileServer()
+{
+    QMetaObject::invokeMethod(this, "shutdown", Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+bool LocalTileServer::start()
+{
+    QMetaObject::invokeMethod(this, "startup", Qt::BlockingQueuedConnection);
+    return m_port != 0;
+}
+
+void LocalTileServer::startup()
+{
+    m_clock.start();
+    m_server = new QTcpServer(this);
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    if (m_server->listen(QHostAddress::LocalHost))
+    {
+        m_port = m_server->serverPort();
+    }
+    m_timer = new QTimer(this);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(sendAnswers()));
+    m_timer->start(POLL_INTERVAL);
+}
+
+void LocalTileServer::shutdown()
+{
+    // Runs in the thread of the server
+    delete m_timer;
+    m_timer = 0;
+    QList<QTcpSocket*> sockets = m_buffers.keys();
+    m_buffers.clear();
+    m_answers.clear();
+    foreach (QTcpSocket *socket, sockets)
+    {
+        socket->disconnect(this);
+        socket->abort();
+        delete socket;
+    }
+    delete m_server;
+    m_server = 0;
+}
+
+void LocalTileServer::newConnection()
+{
+    while (m_server->hasPendingConnections())
+    {
+        QTcpSocket *socket = m_server->nextPendingConnection();
+        m_buffers.insert(socket, QByteArray());
+        m_answers.insert(socket, QQueue<Answer>());
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequests()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(disconnected()));
+    }
+}
+
+void LocalTileServer::readRequests()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if (!m_buffers.contains(socket))
+    {
+        return;
+    }
+    QByteArray &buffer = m_buffers[socket];
+    buffer.append(socket->readAll());
+
+    // The requests have no body, so every header block is a complete request
+    int end = buffer.indexOf("\r\n\r\n");
+    while (end >= 0)
+    {
+        QByteArray requestLine = buffer.left(buffer.indexOf("\r\n"));
+        buffer.remove(0, end + 4);
+
+        QList<QByteArray> parts = requestLine.split(' ');
+        Answer pending;
+        pending.m_due = m_clock.elapsed() + m_latency;
+        pending.m_data = answer(parts.size() >= 2 ? parts.at(1) : QByteArray());
+        m_answers[socket].enqueue(pending);
+        m_requestCount.ref();
+
+        end = buffer.indexOf("\r\n\r\n");
+    }
+}
+
+void LocalTileServer::disconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    m_buffers.remove(socket);
+    m_answers.remove(socket);
+    socket->deleteLater();
+}
+
+void LocalTileServer::sendAnswers()
+{
+    const qint64 now = m_clock.elapsed();
+    for (QHash<QTcpSocket*, QQueue<Answer> >::iterator i = m_answers.begin(); i != m_answers.end(); ++i)
+    {
+        // Answers are queued in request order, so they are also due in that order
+        QQueue<Answer> &queue = i.value();
+        while (!queue.isEmpty() && (queue.head().m_due <= now))
+        {
+            i.key()->write(queue.dequeue().m_data);
+        }
+    }
+}
+
+QByteArray LocalTileServer::answer(const QByteArray &path) const
+{
+    QFile file(m_directory + QString::fromLatin1(path));
+    if (path.contains("..") || !file.open(QIODevice::ReadOnly))
+    {
+        return QByteArray("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n");
+    }
+    QByteArray body = file.readAll();
+    QByteArray data("HTTP/1.1 200 OK\r\nContent-Type: image/png\r\nConnection: keep-alive\r\nContent-Length: ");
+    data.append(QByteArray::number(body.size()));
+    data.append("\r\n\r\n");
+    data.append(body);
+    return data;
+}
@@ -0,0 +1,105 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Minimal HTTP server delivering map tiles from disk
+ */
+
+#ifndef LOCALTILESERVER_H
+#define LOCALTILESERVER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QQueue>
+#include <QString>
+#include <QThread>
+
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+
+/**
+ * @brief The LocalTileServer class is a stand in for a tile server used by the
+ *        tile download benchmark. It runs in its own thread and answers
+ *        "GET /<zoom>/<x>/<y>.png" with the file of the same name below its
+ *        directory. Connections are kept alive and pipelined requests are
+ *        answered in order. Every answer is delayed by a fixed latency to
+ *        simulate the round trip to a remote server.
+ */
+class LocalTileServer : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief LocalTileServer CTOR
+     * @param directory - directory holding the tiles
+     * @param latency - delay of every answer in ms
+     */
+    LocalTileServer(const QString &directory, const int latency);
+    ~LocalTileServer();
+
+    /**
+     * @brief start starts listening on a free port of the loopback interface
+     * @return true on success, false otherwise
+     */
+    bool start();
+
+    quint16 port() const { return m_port; }
+
+    /**
+     * @brief requestCount delivers the number of requests received so far
+     */
+    int requestCount() const { return m_requestCount.load(); }
+
+private slots:
+    void startup();
+    void shutdown();
+    void newConnection();
+    void readRequests();
+    void disconnected();
+    void sendAnswers();
+
+private:
+    struct Answer
+    {
+        qint64 m_due;           /// Time the answer is sent at in ms
+        QByteArray m_data;      /// Complete HTTP response
+    };
+
+    QByteArray answer(const QByteArray &path) const;
+
+    QString m_directory;
+    int m_latency;
+    QThread m_thread;
+    QTcpServer *m_server;
+    QTimer *m_timer;            /// Polls for due answers
+    QElapsedTimer m_clock;
+    QHash<QTcpSocket*, QByteArray> m_buffers;       /// Received but not yet parsed data
+    QHash<QTcpSocket*, QQueue<Answer> > m_answers;  /// Answers waiting for their latency
+    quint16 m_port;
+    QAtomicInt m_requestCount;
+};
+
+#endif // LOCALTILESERVER_H
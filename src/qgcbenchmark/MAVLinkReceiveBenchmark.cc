@@ -0,0 +1,372 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Throughput and latency benchmark of the MAVLink receive path
+ *
+ *   Replays a tlog or the telemetry of a MAVLinkSimulationMAV through a null
+ *   link into MAVLinkProtocol, MAVLinkDecoder and UAS::receiveMessage. All
+ *   stages run in the benchmark thread, so the time of a stage is its CPU time.
+ *
+ *   Options:
+ *      --file <log.tlog>       Replay an existing tlog instead of simulated telemetry
+ *      --seconds <seconds>     Simulated flight time (default 600)
+ *      --per-read <count>      Packets handed to the protocol per read (default 1)
+ *      --warmup <count>        Packets replayed before measuring (default 1000)
+ *      --unbatched             Deliver every message with its own signal
+ */
+
+#include "MAVLinkReceiveBenchmark.h"
+#include "AllocationCounter.h"
+#include "AutoBenchmark.h"
+#include "ArduPilotMegaMAV.h"
+#include "LinkManager.h"
+#include "MAVLinkSimulationMAV.h"
+#include "UAS.h"
+#include <QApplication>
+#include <QFile>
+#include <QVector>
+#include <algorithm>
+#include <cstring>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    // Every packet of a tlog is preceded by its 8 byte receive time
+    const int TLOG_TIMESTAMP_SIZE = 8;
+
+    /**
+     * @brief The ReplayData struct holds raw MAVLink packets back to back
+     */
+    struct ReplayData
+    {
+        QByteArray m_bytes;             /// All packets without tlog timestamps
+        QVector<int> m_packetEnds;      /// Offset behind each packet
+    };
+
+    /**
+     * @brief packetLength delivers the length of the packet at data or 0 if
+     *        there is no complete packet
+     */
+    int packetLength(const char *data, const int size)
+    {
+        if ((size < 2) || (static_cast<uchar>(data[0]) != MAVLINK_STX))
+        {
+            return 0;
+        }
+        const int length = static_cast<uchar>(data[1]) + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+        return (length <= size) ? length : 0;
+    }
+
+    bool loadTLog(const QString &fileName, ReplayData &replay, QString &error)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            error = "Unable to open " + fileName;
+            return false;
+        }
+        const QByteArray log = file.readAll();
+        replay.m_bytes.reserve(log.size());
+
+        int pos = 0;
+        while (pos + TLOG_TIMESTAMP_SIZE < log.size())
+        {
+            const int length = packetLength(log.constData() + pos + TLOG_TIMESTAMP_SIZE,
+                                            log.size() - pos - TLOG_TIMESTAMP_SIZE);
+            if (length == 0)
+            {
+                ++pos;  // resync on the next byte
+                continue;
+            }
+            replay.m_bytes.append(log.constData() + pos + TLOG_TIMESTAMP_SIZE, length);
+            replay.m_packetEnds.append(replay.m_bytes.size());
+            pos += TLOG_TIMESTAMP_SIZE + length;
+        }
+        if (replay.m_packetEnds.isEmpty())
+        {
+            error = "No MAVLink packets found in " + fileName;
+            return false;
+        }
+        return true;
+    }
+
+    void simulate(const int seconds, ReplayData &replay)
+    {
+        // The simulation link registers itself at the LinkManager
+        SimulationCaptureLink *link = new SimulationCaptureLink();
+        {
+            MAVLinkSimulationMAV mav(link, 1);
+            link->takeBytes();  // the constructor already ran one step
+            // Each step of the simulated MAV covers 20ms
+            for (int step = 0; step < seconds * 50; ++step)
+            {
+                mav.mainloop();
+                const QByteArray bytes = link->takeBytes();
+                int pos = 0;
+                int length;
+                while ((length = packetLength(bytes.constData() + pos, bytes.size() - pos)) > 0)
+                {
+                    replay.m_bytes.append(bytes.constData() + pos, length);
+                    replay.m_packetEnds.append(replay.m_bytes.size());
+                    pos += length;
+                }
+            }
+        }
+        LinkManager::instance()->removeLink(link->getId());
+    }
+
+    qint64 processCpuNsecs()
+    {
+#if defined(Q_OS_UNIX)
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+        {
+            return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * Q_INT64_C(1000000000) +
+                   (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * Q_INT64_C(1000);
+        }
+#endif
+        return -1;
+    }
+}
+
+ReceiveStageProbe::ReceiveStageProbe(MAVLinkProtocol *protocol, QObject *parent) :
+    QObject(parent),
+    m_protocol(protocol),
+    m_messageCount(0),
+    m_decoderNsecs(0),
+    m_vehicleNsecs(0)
+{
+    // Direct connections, every stage runs in the thread calling receiveBytes
+    connect(protocol, SIGNAL(systemDetected(LinkInterface*,int,mavlink_heartbeat_t)),
+            this, SLOT(systemDetected(LinkInterface*,int,mavlink_heartbeat_t)), Qt::DirectConnection);
+    connect(protocol, SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)),
+            this, SLOT(messageReceived(LinkInterface*,mavlink_message_t)), Qt::DirectConnection);
+    connect(protocol, SIGNAL(messagesReceived(LinkInterface*,MAVLinkMessageBatch)),
+            this, SLOT(messagesReceived(LinkInterface*,MAVLinkMessageBatch)), Qt::DirectConnection);
+    m_clock.start();
+}
+
+ReceiveStageProbe::~ReceiveStageProbe()
+{
+    qDeleteAll(m_vehicles);
+}
+
+void ReceiveStageProbe::resetCounters()
+{
+    m_messageCount = 0;
+    m_decoderNsecs = 0;
+    m_vehicleNsecs = 0;
+}
+
+void ReceiveStageProbe::systemDetected(LinkInterface *link, int sysid, mavlink_heartbeat_t heartbeat)
+{
+    Q_UNUSED(link);
+    if (m_vehicles.contains(sysid))
+    {
+        return;
+    }
+    UAS *uas;
+    if (heartbeat.autopilot == MAV_AUTOPILOT_ARDUPILOTMEGA)
+    {
+        uas = new ArduPilotMegaMAV(0, sysid);
+    }
+    else
+    {
+        uas = new UAS(0, sysid);
+    }
+    uas->setSystemType(static_cast<int>(heartbeat.type));
+    m_vehicles.insert(sysid, uas);
+}
+
+void ReceiveStageProbe::messageReceived(LinkInterface *link, mavlink_message_t message)
+{
+    const qint64 start = m_clock.nsecsElapsed();
+    m_decoder.receiveMessage(link, message);
+    const qint64 decoded = m_clock.nsecsElapsed();
+    foreach (UASInterface *uas, m_vehicles)
+    {
+        uas->receiveMessage(link, message);
+    }
+    m_decoderNsecs += decoded - start;
+    m_vehicleNsecs += m_clock.nsecsElapsed() - decoded;
+    ++m_messageCount;
+}
+
+void ReceiveStageProbe::messagesReceived(LinkInterface *link, const MAVLinkMessageBatch &messages)
+{
+    // Same order as the LinkManager: vehicles first, then the decoder
+    const qint64 start = m_clock.nsecsElapsed();
+    foreach (UASInterface *uas, m_vehicles)
+    {
+        for (MAVLinkMessageBatch::const_iterator iter = messages.begin(); iter != messages.end(); ++iter)
+        {
+            uas->receiveMessage(link, *iter);
+        }
+    }
+    const qint64 delivered = m_clock.nsecsElapsed();
+    m_decoder.receiveMessages(link, messages);
+    m_vehicleNsecs += delivered - start;
+    m_decoderNsecs += m_clock.nsecsElapsed() - delivered;
+    m_messageCount += messages.size();
+}
+
+class MAVLinkReceiveBenchmark : public Benchmark
+{
+public:
+    bool run(const QStringList &args, QTextStream &out)
+    {
+        ReplayData replay;
+        const QString fileName = option(args, "--file", QString());
+        if (fileName.isEmpty())
+        {
+            const int seconds = option(args, "--seconds", "600").toInt();
+            out << "Simulating " << seconds << " s of MAVLinkSimulationMAV telemetry" << endl;
+            simulate(seconds, replay);
+        }
+        else
+        {
+            QString error;
+            if (!loadTLog(fileName, replay, error))
+            {
+                out << error << endl;
+                return false;
+            }
+        }
+        const int packetCount = replay.m_packetEnds.size();
+        if (packetCount == 0)
+        {
+            out << "Nothing to replay" << endl;
+            return false;
+        }
+        const int perRead = qMax(1, option(args, "--per-read", "1").toInt());
+        const int warmup = qBound(0, option(args, "--warmup", "1000").toInt(), packetCount - 1);
+        out << "Replaying " << packetCount << " packets (" << replay.m_bytes.size() << " bytes), "
+            << perRead << " per read" << endl;
+
+        NullLink link;
+        MAVLinkProtocol protocol;
+        protocol.setBatchedDispatch(!args.contains("--unbatched"));
+        ReceiveStageProbe probe(&protocol);
+
+        // Everything allocated during the measurement is done by the stages
+        QVector<qint64> latencies;
+        latencies.reserve(packetCount);
+        QByteArray readBuffer;
+        readBuffer.reserve(MAVLINK_MAX_PACKET_LEN * perRead);
+
+        int packet = 0;
+        quint64 allocations = 0;
+        qint64 cpuStart = 0;
+        QElapsedTimer clock;
+        clock.start();
+        qint64 measureStart = 0;
+        while (packet < packetCount)
+        {
+            if (packet == warmup)
+            {
+                // The vehicle exists now and the caches are warm
+                protocol.resetStatistics();
+                probe.resetCounters();
+                cpuStart = processCpuNsecs();
+                measureStart = clock.nsecsElapsed();
+            }
+            const int first = packet ? replay.m_packetEnds.at(packet - 1) : 0;
+            const int lastPacket = qMin(packet + perRead, (packet < warmup) ? warmup : packetCount);
+            const int length = replay.m_packetEnds.at(lastPacket - 1) - first;
+            readBuffer.resize(length);
+            memcpy(readBuffer.data(), replay.m_bytes.constData() + first, length);
+
+            const quint64 messagesBefore = probe.messageCount();
+            const quint64 allocationsBefore = AllocationCounter::count();
+            const qint64 start = clock.nsecsElapsed();
+            protocol.receiveBytes(&link, readBuffer);
+            const qint64 latency = clock.nsecsElapsed() - start;
+
+            if (packet >= warmup)
+            {
+                allocations += AllocationCounter::count() - allocationsBefore;
+                // A message is done once the read holding it is done
+                for (quint64 i = messagesBefore; i < probe.messageCount(); ++i)
+                {
+                    latencies.append(latency);
+                }
+            }
+            packet = lastPacket;
+        }
+        const qint64 wallNsecs = clock.nsecsElapsed() - measureStart;
+        const qint64 cpuNsecs = (cpuStart >= 0) ? processCpuNsecs() - cpuStart : -1;
+
+        const quint64 messages = probe.messageCount();
+        if ((messages == 0) || (probe.vehicleCount() == 0))
+        {
+            out << "No messages were delivered to a vehicle, the replay needs heartbeats" << endl;
+            return false;
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        const double p50 = latencies.at(latencies.size() / 2) / 1000.0;
+        const double p99 = latencies.at(qMin(latencies.size() - 1, latencies.size() * 99 / 100)) / 1000.0;
+        const double seconds = wallNsecs / 1000000000.0;
+        const MAVLinkProtocol::Statistics statistics = protocol.statistics();
+
+        // The protocol stage is everything not spent in the receivers
+        const qint64 protocolNsecs = wallNsecs - probe.decoderNsecs() - probe.vehicleNsecs();
+        out << "Stage times per message (single thread, wall time equals CPU time):" << endl;
+        out << "  MAVLinkProtocol     " << protocolNsecs / double(messages) << " ns ("
+            << 100.0 * protocolNsecs / wallNsecs << " %), parsing "
+            << statistics.m_parseNsecs / double(messages) << " ns" << endl;
+        out << "  MAVLinkDecoder      " << probe.decoderNsecs() / double(messages) << " ns ("
+            << 100.0 * probe.decoderNsecs() / wallNsecs << " %)" << endl;
+        out << "  UAS::receiveMessage " << probe.vehicleNsecs() / double(messages) << " ns ("
+            << 100.0 * probe.vehicleNsecs() / wallNsecs << " %)" << endl;
+        if (cpuNsecs >= 0)
+        {
+            out << "Process CPU time " << cpuNsecs / 1000000000.0 << " s of " << seconds << " s wall time" << endl;
+        }
+        out << "Delivered " << messages << " messages in " << statistics.m_dispatchCount << " signals, "
+            << probe.vehicleCount() << " vehicle(s)" << endl;
+        out << "RESULT MAVLinkReceive: " << messages / seconds << " msgs/s, p50 " << p50 << " us, p99 "
+            << p99 << " us, " << allocations / double(messages) << " allocs/msg"
+            << (AllocationCounter::countsAllAllocations() ? "" : " (operator new only)") << endl;
+        return true;
+    }
+};
+
+DECLARE_BENCHMARK(MAVLinkReceiveBenchmark)
+
+/**
+ * @brief main runs the receive benchmarks. The vehicles need a QApplication,
+ *        the offscreen platform keeps it from opening a display.
+ */
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    return AutoBenchmark::run(app);
+}
@@ -0,0 +1,130 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Helpers of the MAVLink receive benchmark
+ */
+
+#ifndef MAVLINKRECEIVEBENCHMARK_H
+#define MAVLINKRECEIVEBENCHMARK_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include "LinkInterface.h"
+#include "MAVLinkDecoder.h"
+#include "MAVLinkMessageBatch.h"
+#include "MAVLinkProtocol.h"
+#include "MAVLinkSimulationLink.h"
+
+class UASInterface;
+
+/**
+ * @brief The NullLink class is a link without a device. The benchmark hands
+ *        the replayed bytes directly to the protocol, everything written to
+ *        the link is dropped.
+ */
+class NullLink : public LinkInterface
+{
+public:
+    NullLink() : m_id(getNextLinkId()) {}
+
+    void disableTimeouts() {}
+    void enableTimeouts() {}
+    int getId() const { return m_id; }
+    QString getName() const { return "Null link"; }
+    QString getShortName() const { return "Null"; }
+    QString getDetail() const { return QString(); }
+    void requestReset() {}
+    bool isConnected() const { return true; }
+    qint64 getConnectionSpeed() const { return 0; }
+    qint64 bytesAvailable() { return 0; }
+    bool connect() { return true; }
+    bool disconnect() { return true; }
+    void writeBytes(const char *bytes, qint64 length) { Q_UNUSED(bytes); Q_UNUSED(length); }
+
+protected:
+    void readBytes() {}
+
+private:
+    const int m_id;
+};
+
+/**
+ * @brief The SimulationCaptureLink class collects the packets sent by a
+ *        MAVLinkSimulationMAV instead of streaming them.
+ */
+class SimulationCaptureLink : public MAVLinkSimulationLink
+{
+public:
+    /**
+     * @brief takeBytes delivers all bytes sent since the last call
+     */
+    QByteArray takeBytes()
+    {
+        QMutexLocker locker(&readyBufferMutex);
+        QByteArray bytes;
+        bytes.reserve(readyBuffer.size());
+        while (!readyBuffer.isEmpty())
+        {
+            bytes.append(static_cast<char>(readyBuffer.dequeue()));
+        }
+        return bytes;
+    }
+};
+
+/**
+ * @brief The ReceiveStageProbe class takes the place of the LinkManager. It
+ *        creates the vehicles, delivers the messages of the protocol to the
+ *        decoder and the vehicles and measures the time spent in each of them.
+ *        It has to live in the thread of the protocol.
+ */
+class ReceiveStageProbe : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ReceiveStageProbe(MAVLinkProtocol *protocol, QObject *parent = 0);
+    ~ReceiveStageProbe();
+
+    void resetCounters();
+
+    quint64 messageCount() const { return m_messageCount; }
+    qint64 decoderNsecs() const { return m_decoderNsecs; }
+    qint64 vehicleNsecs() const { return m_vehicleNsecs; }
+    int vehicleCount() const { return m_vehicles.size(); }
+
+private slots:
+    void systemDetected(LinkInterface *link, int sysid, mavlink_heartbeat_t heartbeat);
+    void messageReceived(LinkInterface *link, mavlink_message_t message);
+    void messagesReceived(LinkInterface *link, const MAVLinkMessageBatch &messages);
+
+private:
+    MAVLinkProtocol *m_protocol;
+    MAVLinkDecoder m_decoder;
+    QHash<int, UASInterface*> m_vehicles;   /// Vehicle of each system id
+    QElapsedTimer m_clock;
+    quint64 m_messageCount;                 /// Messages delivered since resetCounters()
+    qint64 m_decoderNsecs;                  /// Time spent in MAVLinkDecoder
+    qint64 m_vehicleNsecs;                  /// Time spent in UAS::receiveMessage
+};
+
+#endif // MAVLINKRECEIVEBENCHMARK_H
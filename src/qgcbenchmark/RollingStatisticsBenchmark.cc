@@ -0,0 +1,168 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Micro benchmark of the live linechart statistics
+ *
+ *   Compares the incremental RollingStatistics against recalculating mean,
+ *   variance and median over the whole window on every sample, and the
+ *   vectorised min/max against a scalar loop over a plot buffer.
+ *
+ *   Options:
+ *      --curves <count>    Number of simulated curves (default 100)
+ *      --samples <count>   Samples appended to each curve (default 20000)
+ *      --window <size>     Averaging window size (default 200)
+ *      --points <count>    Size of the plot buffer for min/max (default 1000000)
+ */
+
+#include "AutoBenchmark.h"
+#include "RollingStatistics.h"
+#include <QElapsedTimer>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Deterministic noisy signal so both implementations see the same data
+    double sample(const int curve, const int index)
+    {
+        return std::sin(index * 0.01 + curve) * 100.0 + ((index * 7919 + curve * 104729) % 1000) * 0.01;
+    }
+}
+
+class RollingStatisticsBenchmark : public Benchmark
+{
+public:
+    bool run(const QStringList &args, QTextStream &out)
+    {
+        const int curves = qMax(1, option(args, "--curves", "100").toInt());
+        const int samples = qMax(1, option(args, "--samples", "20000").toInt());
+        const int window = qMax(1, option(args, "--window", "200").toInt());
+        const int points = qMax(1, option(args, "--points", "1000000").toInt());
+        const double totalSamples = static_cast<double>(curves) * samples;
+
+        // Reference: statistics recalculated over the window for every sample
+        QElapsedTimer timer;
+        timer.start();
+        double referenceSum = 0.0;
+        QVector<double> history(samples);
+        QVector<double> sorted;
+        for (int curve = 0; curve < curves; ++curve)
+        {
+            for (int i = 0; i < samples; ++i)
+            {
+                history[i] = sample(curve, i);
+                const int count = qMin(window, i + 1);
+                const double *first = history.constData() + i + 1 - count;
+                double mean = 0.0;
+                for (int j = 0; j < count; ++j)
+                {
+                    mean += first[j];
+                }
+                mean /= count;
+                double variance = 0.0;
+                for (int j = 0; j < count; ++j)
+                {
+                    variance += (first[j] - mean) * (first[j] - mean);
+                }
+                variance /= count;
+                sorted.resize(count);
+                std::copy(first, first + count, sorted.begin());
+                std::sort(sorted.begin(), sorted.end());
+                referenceSum += mean + variance + sorted.at(count / 2);
+            }
+        }
+        const double referenceSeconds = timer.nsecsElapsed() / 1000000000.0;
+
+        // Incremental statistics
+        timer.restart();
+        double incrementalSum = 0.0;
+        for (int curve = 0; curve < curves; ++curve)
+        {
+            RollingStatistics statistics(window);
+            for (int i = 0; i < samples; ++i)
+            {
+                statistics.append(sample(curve, i));
+                incrementalSum += statistics.mean() + statistics.variance() + statistics.median();
+            }
+        }
+        const double incrementalSeconds = timer.nsecsElapsed() / 1000000000.0;
+
+        out << "Window " << window << ", " << curves << " curves with " << samples << " samples each" << endl;
+        out << "Checksums: reference " << referenceSum << ", incremental " << incrementalSum << endl;
+        out << "RESULT RollingStatisticsReference: " << totalSamples / referenceSeconds << " samples/s" << endl;
+        out << "RESULT RollingStatistics: " << totalSamples / incrementalSeconds << " samples/s" << endl;
+
+        // Min/max over a plot buffer as done for every replot
+        QVector<double> buffer(points);
+        for (int i = 0; i < points; ++i)
+        {
+            buffer[i] = sample(0, i);
+        }
+        const int passes = qMax(1, 100000000 / points);
+
+        timer.restart();
+        double scalarMin = 0.0;
+        double scalarMax = 0.0;
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            const double *data = buffer.constData();
+            scalarMin = scalarMax = data[0];
+            for (int i = 1; i < points; ++i)
+            {
+                if (data[i] < scalarMin)
+                {
+                    scalarMin = data[i];
+                }
+                if (data[i] > scalarMax)
+                {
+                    scalarMax = data[i];
+                }
+            }
+        }
+        const double scalarSeconds = timer.nsecsElapsed() / 1000000000.0;
+
+        timer.restart();
+        double min = 0.0;
+        double max = 0.0;
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            RollingStatistics::minMax(buffer.constData(), points, min, max);
+        }
+        const double vectorSeconds = timer.nsecsElapsed() / 1000000000.0;
+
+        if ((min != scalarMin) || (max != scalarMax))
+        {
+            out << "Min/max mismatch: " << min << "/" << max << " expected "
+                << scalarMin << "/" << scalarMax << endl;
+            return false;
+        }
+
+        const double totalPoints = static_cast<double>(points) * passes;
+        out << "RESULT MinMaxScalar: " << totalPoints / scalarSeconds / 1000000.0 << " Mpoints/s" << endl;
+        out << "RESULT MinMax: " << totalPoints / vectorSeconds / 1000000.0 << " Mpoints/s" << endl;
+        return true;
+    }
+};
+
+DECLARE_BENCHMARK(RollingStatisticsBenchmark)
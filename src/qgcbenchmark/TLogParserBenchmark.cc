@@ -0,0 +1,203 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+/**
+ * @file
+ *   @brief Throughput benchmark of the tlog decoder
+ *
+ *   Options:
+ *      --file <log.tlog>   Parse an existing tlog instead of a synthetic one
+ *      --size-mb <size>    Size of the synthetic tlog in MB (default 256)
+ *      --keep              Do not delete the synthetic tlog after the run
+ */
+
+#include "AutoBenchmark.h"
+#include "AP2DataPlot2DModel.h"
+#include "AP2DataPlotStatus.h"
+#include "AP2DataPlotTLogParser.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QtEndian>
+
+/**
+ * @brief The TLogGenerator class writes a synthetic tlog like a copter streaming
+ *        telemetry at 50Hz. Every packet is preceded by its 8 byte big endian
+ *        receive time in microseconds as written by the MAVLink logger.
+ */
+class TLogGenerator
+{
+public:
+    TLogGenerator() : m_messageCount(0) {}
+
+    bool generate(const QString &fileName, const qint64 size)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            m_error = "Unable to create " + fileName;
+            return false;
+        }
+
+        mavlink_message_t msg;
+        quint32 timeMS = 0;
+        while (file.size() + m_buffer.size() < size)
+        {
+            const float t = timeMS / 1000.0f;
+            mavlink_msg_attitude_pack(1, 1, &msg, timeMS, 0.1f * t, -0.05f * t, 1.5f, 0.01f, 0.02f, 0.03f);
+            write(msg, timeMS);
+            mavlink_msg_global_position_int_pack(1, 1, &msg, timeMS, 473977420 + timeMS, 85455940 - timeMS,
+                                                 584000, 10000 + timeMS % 1000, 100, -50, 2, 9000);
+            write(msg, timeMS);
+            mavlink_msg_raw_imu_pack(1, 1, &msg, timeMS * 1000ULL, 10, -20, -980, 1, 2, 3, 200, -100, 400);
+            write(msg, timeMS);
+            if (timeMS % 100 == 0)
+            {
+                mavlink_msg_vfr_hud_pack(1, 1, &msg, 12.5f, 11.8f, 90, 55, 100.0f + t, 0.5f);
+                write(msg, timeMS);
+            }
+            if (timeMS % 1000 == 0)
+            {
+                // mode changes every minute
+                mavlink_msg_heartbeat_pack(1, 1, &msg, MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_ARDUPILOTMEGA,
+                                           MAV_MODE_FLAG_CUSTOM_MODE_ENABLED, (timeMS / 60000) % 6, MAV_STATE_ACTIVE);
+                write(msg, timeMS);
+                // GCS heartbeats are skipped by the decoder
+                mavlink_msg_heartbeat_pack(255, 190, &msg, MAV_TYPE_GCS, MAV_AUTOPILOT_INVALID, 0, 0, MAV_STATE_ACTIVE);
+                write(msg, timeMS);
+            }
+            if (timeMS % 30000 == 0)
+            {
+                mavlink_msg_statustext_pack(1, 1, &msg, MAV_SEVERITY_INFO, "Benchmark status text");
+                write(msg, timeMS);
+            }
+            timeMS += 20;
+
+            if (m_buffer.size() >= 1024 * 1024)
+            {
+                if (file.write(m_buffer) != m_buffer.size())
+                {
+                    m_error = "Unable to write " + fileName;
+                    return false;
+                }
+                m_buffer.clear();
+            }
+        }
+        if (file.write(m_buffer) != m_buffer.size())
+        {
+            m_error = "Unable to write " + fileName;
+            return false;
+        }
+        m_buffer.clear();
+        return true;
+    }
+
+    qint64 messageCount() const { return m_messageCount; }
+    QString getError() const { return m_error; }
+
+private:
+    void write(const mavlink_message_t &msg, const quint32 timeMS)
+    {
+        uchar timeStamp[sizeof(quint64)];
+        qToBigEndian<quint64>(1450000000000000ULL + timeMS * 1000ULL, timeStamp);
+        m_buffer.append(reinterpret_cast<const char*>(timeStamp), sizeof(timeStamp));
+
+        uint8_t packet[MAVLINK_MAX_PACKET_LEN];
+        const uint16_t length = mavlink_msg_to_send_buffer(packet, &msg);
+        m_buffer.append(reinterpret_cast<const char*>(packet), length);
+        ++m_messageCount;
+    }
+
+    QByteArray m_buffer;        /// Buffer holding not yet written data
+    qint64 m_messageCount;      /// Number of packets written
+    QString m_error;            /// Last error
+};
+
+class TLogParserBenchmark : public Benchmark
+{
+public:
+    bool run(const QStringList &args, QTextStream &out)
+    {
+        QString fileName = option(args, "--file", QString());
+        const bool remove = fileName.isEmpty() && !args.contains("--keep");
+        if (fileName.isEmpty())
+        {
+            const qint64 sizeMB = option(args, "--size-mb", "256").toLongLong();
+            fileName = QDir::temp().filePath("qgcbenchmark_telemetry.tlog");
+            out << "Generating synthetic tlog of " << sizeMB << " MB: " << fileName << endl;
+            TLogGenerator generator;
+            if (!generator.generate(fileName, sizeMB * 1024 * 1024))
+            {
+                out << generator.getError() << endl;
+                return false;
+            }
+            out << "Generated " << generator.messageCount() << " packets" << endl;
+        }
+
+        QFile file(fileName);
+        const uchar *data = file.open(QIODevice::ReadOnly) ? file.map(0, file.size()) : 0;
+        if (!data)
+        {
+            out << "Unable to map log file " << fileName << endl;
+            return false;
+        }
+        const qint64 size = file.size();
+        // touch every page once so the measurement shows the decoder and not the disk
+        quint64 checksum = 0;
+        for (qint64 i = 0; i < size; i += 4096)
+        {
+            checksum += data[i];
+        }
+        Q_UNUSED(checksum);
+
+        AP2DataPlot2DModel model;
+        AP2DataPlotStatus status;
+        AP2DataPlotTLogParser parser(&model, &status);
+
+        QElapsedTimer timer;
+        timer.start();
+        model.startTransaction();
+        const bool success = parser.start() && parser.parse(data, size) && parser.finish();
+        model.endTransaction();
+        const double seconds = timer.nsecsElapsed() / 1000000000.0;
+
+        file.unmap(const_cast<uchar*>(data));
+        file.close();
+        if (remove)
+        {
+            QFile::remove(fileName);
+        }
+
+        if (!success)
+        {
+            out << "Parsing failed: " << model.getError() << endl;
+            return false;
+        }
+
+        const double megaBytes = size / (1024.0 * 1024.0);
+        const int rows = model.rowCount();
+        out << "Parsed " << megaBytes << " MB (" << rows << " rows) in " << seconds << " s" << endl;
+        out << "RESULT TLogParser: " << megaBytes / seconds << " MB/s, "
+            << rows / seconds << " rows/s" << endl;
+        return true;
+    }
+};
+
+DECLARE_BENCHMARK(TLogParserBenchmark)
@@ -0,0 +1,199 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Micro benchmark of the map tile database cache
+ *
+ *   Writes tiles to an empty PureImageCache database in batched transactions,
+ *   then reads them back in random order, first from one thread and then from
+ *   several threads each using its own pooled connection.
+ *
+ *   Options:
+ *      --tiles <count>     Number of tiles written and read (default 5000)
+ *      --size <bytes>      Size of each tile (default 16384)
+ *      --batch <count>     Tiles written per transaction, 1 disables batching (default 64)
+ *      --threads <count>   Number of reading threads (default QThread::idealThreadCount())
+ */
+
+#include "AutoBenchmark.h"
+#include "pureimagecache.h"
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+
+namespace
+{
+    const int TILE_ZOOM = 17;
+    const int TILES_PER_ROW = 100;
+
+    core::Point tilePosition(const int tile)
+    {
+        return core::Point(tile % TILES_PER_ROW, tile / TILES_PER_ROW);
+    }
+
+    // Deterministic random order so every run reads the same sequence
+    QVector<int> shuffledTiles(const int count)
+    {
+        QVector<int> tiles(count);
+        for (int i = 0; i < count; ++i)
+        {
+            tiles[i] = i;
+        }
+        quint32 state = 12345;
+        for (int i = count - 1; i > 0; --i)
+        {
+            state = state * 1103515245 + 12345;
+            qSwap(tiles[i], tiles[(state >> 8) % (i + 1)]);
+        }
+        return tiles;
+    }
+
+    /**
+     * @brief The ReadTask class reads every n-th tile of the shuffled list
+     */
+    class ReadTask : public QRunnable
+    {
+    public:
+        ReadTask(core::PureImageCache &cache, const QVector<int> &tiles, const int first,
+                 const int step, const int size, QAtomicInt &failures) :
+            m_cache(cache),
+            m_tiles(tiles),
+            m_first(first),
+            m_step(step),
+            m_size(size),
+            m_failures(failures)
+        {
+        }
+
+        void run()
+        {
+            for (int i = m_first; i < m_tiles.size(); i += m_step)
+            {
+                if (m_cache.GetImageFromCache(core::MapType::GoogleSatellite, tilePosition(m_tiles.at(i)), TILE_ZOOM).size() != m_size)
+                {
+                    m_failures.ref();
+                }
+            }
+        }
+
+    private:
+        core::PureImageCache &m_cache;
+        const QVector<int> &m_tiles;
+        const int m_first;
+        const int m_step;
+        const int m_size;
+        QAtomicInt &m_failures;
+    };
+}
+
+class TileCacheBenchmark : public Benchmark
+{
+public:
+    bool run(const QStringList &args, QTextStream &out)
+    {
+        const int tiles = qMax(1, option(args, "--tiles", "5000").toInt());
+        const int size = qMax(1, option(args, "--size", "16384").toInt());
+        const int batch = qMax(1, option(args, "--batch", "64").toInt());
+        const int threads = qMax(1, option(args, "--threads", QString::number(QThread::idealThreadCount())).toInt());
+
+        QTemporaryDir dir;
+        if (!dir.isValid())
+        {
+            out << "Unable to create temporary directory" << endl;
+            return false;
+        }
+
+        core::PureImageCache cache;
+        cache.setGtileCache(dir.path() + "/");
+
+        QByteArray tile(size, 0);
+        for (int i = 0; i < size; ++i)
+        {
+            tile[i] = static_cast<char>((i * 7919) & 0xff);
+        }
+
+        // Writes as done by the TileCacheQueue
+        QElapsedTimer timer;
+        timer.start();
+        for (int first = 0; first < tiles; first += batch)
+        {
+            if (batch > 1)
+            {
+                cache.BeginTransaction();
+            }
+            for (int i = first; i < qMin(first + batch, tiles); ++i)
+            {
+                if (!cache.PutImageToCache(tile, core::MapType::GoogleSatellite, tilePosition(i), TILE_ZOOM))
+                {
+                    out << "Unable to write tile " << i << endl;
+                    return false;
+                }
+            }
+            if ((batch > 1) && !cache.CommitTransaction())
+            {
+                out << "Unable to commit tiles " << first << " to " << first + batch - 1 << endl;
+                return false;
+            }
+        }
+        const double writeSeconds = timer.nsecsElapsed() / 1000000000.0;
+
+        const QVector<int> order = shuffledTiles(tiles);
+        QAtomicInt failures(0);
+
+        // Reads from one thread as done when panning over a cached area
+        timer.restart();
+        ReadTask(cache, order, 0, 1, size, failures).run();
+        const double readSeconds = timer.nsecsElapsed() / 1000000000.0;
+
+        // Reads from several threads each using its own connection
+        timer.restart();
+        {
+            QThreadPool pool;
+            pool.setMaxThreadCount(threads);
+            for (int i = 0; i < threads; ++i)
+            {
+                pool.start(new ReadTask(cache, order, i, threads, size, failures));
+            }
+            pool.waitForDone();
+        }
+        const double parallelSeconds = timer.nsecsElapsed() / 1000000000.0;
+
+        if (failures.load() != 0)
+        {
+            out << failures.load() << " tiles could not be read back" << endl;
+            return false;
+        }
+
+        out << tiles << " tiles of " << size << " bytes, " << batch << " tiles per transaction, "
+            << threads << " reading threads" << endl;
+        out << "RESULT TileCacheWrite: " << tiles / writeSeconds << " tiles/s" << endl;
+        out << "RESULT TileCacheRead: " << tiles / readSeconds << " tiles/s" << endl;
+        out << "RESULT TileCacheReadParallel: " << tiles / parallelSeconds << " tiles/s" << endl;
+        return true;
+    }
+};
+
+DECLARE_BENCHMARK(TileCacheBenchmark)
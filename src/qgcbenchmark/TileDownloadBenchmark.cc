@@ -0,0 +1,193 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Benchmark of the map tile downloader
+ *
+ *   Serves tiles from a LocalTileServer with a fixed latency and downloads
+ *   them once one by one, like OPMaps did before it used the TileDownloader,
+ *   and once using the TileDownloader. Every tile is requested twice from the
+ *   TileDownloader to check that duplicate requests are only downloaded once.
+ *
+ *   Options:
+ *      --tiles <count>     Number of tiles downloaded (default 256)
+ *      --latency <ms>      Delay of every answer of the server (default 30)
+ *      --perhost <count>   Requests in flight per host of the TileDownloader (default 12)
+ *      --dir <path>        Directory holding the tiles as <zoom>/<x>/<y>.png,
+ *                          synthetic tiles are created if not given
+ */
+
+#include "TileDownloadBenchmark.h"
+#include "AutoBenchmark.h"
+#include "LocalTileServer.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QTemporaryDir>
+
+namespace
+{
+    const int TILE_ZOOM = 17;
+    const int TILES_PER_ROW = 16;
+    const int TILE_SIZE = 12 * 1024;
+    // Time in ms all tiles must be downloaded in
+    const int DOWNLOAD_TIMEOUT = 120000;
+
+    core::Point tilePosition(const int tile)
+    {
+        return core::Point(tile % TILES_PER_ROW, tile / TILES_PER_ROW);
+    }
+
+    QString tilePath(const int tile)
+    {
+        const core::Point pos = tilePosition(tile);
+        return QString("/%1/%2/%3.png").arg(TILE_ZOOM).arg(pos.X()).arg(pos.Y());
+    }
+
+    bool createTiles(const QString &directory, const int tiles)
+    {
+        QByteArray data(TILE_SIZE, 0);
+        for (int i = 0; i < TILE_SIZE; ++i)
+        {
+            data[i] = static_cast<char>((i * 7919) & 0xff);
+        }
+        for (int i = 0; i < tiles; ++i)
+        {
+            QFile file(directory + tilePath(i));
+            if (!QDir().mkpath(QFileInfo(file).path()) || !file.open(QIODevice::WriteOnly) ||
+                (file.write(data) != data.size()))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+class TileDownloadBenchmark : public Benchmark
+{
+public:
+    bool run(const QStringList &args, QTextStream &out)
+    {
+        const int tiles = qMax(1, option(args, "--tiles", "256").toInt());
+        const int latency = qMax(0, option(args, "--latency", "30").toInt());
+        const int perHost = qMax(1, option(args, "--perhost", "12").toInt());
+        QString directory = option(args, "--dir", QString());
+
+        QTemporaryDir tempDir;
+        if (directory.isEmpty())
+        {
+            if (!tempDir.isValid() || !createTiles(tempDir.path(), tiles))
+            {
+                out << "Unable to create tiles" << endl;
+                return false;
+            }
+            directory = tempDir.path();
+        }
+
+        LocalTileServer server(directory, latency);
+        if (!server.start())
+        {
+            out << "Unable to start the tile server" << endl;
+            return false;
+        }
+        const QString baseUrl = QString("http://127.0.0.1:%1").arg(server.port());
+
+        // One tile after the other, each waiting in its own event loop
+        QElapsedTimer timer;
+        timer.start();
+        qint64 sequentialBytes = 0;
+        {
+            QNetworkAccessManager network;
+            for (int i = 0; i < tiles; ++i)
+            {
+                QNetworkReply *reply = network.get(QNetworkRequest(QUrl(baseUrl + tilePath(i))));
+                QEventLoop loop;
+                QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+                loop.exec();
+                if (reply->error() != QNetworkReply::NoError)
+                {
+                    out << "Unable to download tile " << i << ": " << reply->errorString() << endl;
+                    delete reply;
+                    return false;
+                }
+                sequentialBytes += reply->readAll().size();
+                delete reply;
+            }
+        }
+        const double sequentialSeconds = timer.nsecsElapsed() / 1000000000.0;
+
+        // All tiles queued at once, each of them twice
+        const int requestsBefore = server.requestCount();
+        TileReceiver receiver;
+        core::TileDownloader downloader;
+        downloader.SetMaxRequestsPerHost(perHost);
+        QObject::connect(&downloader, SIGNAL(TileDownloaded(core::RawTile,QByteArray,int)),
+                         &receiver, SLOT(tileDownloaded(core::RawTile,QByteArray,int)), Qt::DirectConnection);
+        downloader.SetViewCenter(this, TILE_ZOOM, tilePosition(tiles / 2));
+
+        timer.restart();
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (int i = 0; i < tiles; ++i)
+            {
+                core::RawTile tile(core::MapType::GoogleSatellite, tilePosition(i), TILE_ZOOM);
+                downloader.Request(tile, QNetworkRequest(QUrl(baseUrl + tilePath(i))), DOWNLOAD_TIMEOUT, this);
+            }
+        }
+        if (!receiver.m_received.tryAcquire(tiles, DOWNLOAD_TIMEOUT))
+        {
+            out << "Only " << receiver.m_received.available() << " of " << tiles << " tiles were downloaded" << endl;
+            return false;
+        }
+        const double concurrentSeconds = timer.nsecsElapsed() / 1000000000.0;
+        const int requests = server.requestCount() - requestsBefore;
+
+        if (receiver.m_failures != 0)
+        {
+            out << receiver.m_failures << " tiles could not be downloaded" << endl;
+            return false;
+        }
+        if (receiver.m_bytes != sequentialBytes)
+        {
+            out << "Downloaded " << receiver.m_bytes << " bytes instead of " << sequentialBytes << endl;
+            return false;
+        }
+        if (requests != tiles)
+        {
+            out << "The server received " << requests << " requests for " << tiles << " tiles" << endl;
+            return false;
+        }
+
+        out << tiles << " tiles, " << latency << " ms latency, " << perHost << " requests per host" << endl;
+        out << "RESULT TileDownloadSequential: " << tiles / sequentialSeconds << " tiles/s" << endl;
+        out << "RESULT TileDownloadConcurrent: " << tiles / concurrentSeconds << " tiles/s" << endl;
+        out << "RESULT TileDownloadSpeedup: " << sequentialSeconds / concurrentSeconds << " x" << endl;
+        return true;
+    }
+};
+
+DECLARE_BENCHMARK(TileDownloadBenchmark)
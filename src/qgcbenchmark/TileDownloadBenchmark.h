@@ -0,0 +1,68 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Helpers of the tile download benchmark
+ */
+
+#ifndef TILEDOWNLOADBENCHMARK_H
+#define TILEDOWNLOADBENCHMARK_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QObject>
+#include <QSemaphore>
+#include "tiledownloader.h"
+
+/**
+ * @brief The TileReceiver class counts the tiles delivered by the TileDownloader.
+ *        Its slot is called from the thread of the downloader.
+ */
+class TileReceiver : public QObject
+{
+    Q_OBJECT
+public:
+    TileReceiver() : m_failures(0), m_bytes(0) {}
+
+    QSemaphore m_received;
+    int m_failures;
+    qint64 m_bytes;
+
+public slots:
+    void tileDownloaded(core::RawTile tile, QByteArray data, int result)
+    {
+        Q_UNUSED(tile);
+        m_mutex.lock();
+        if (result != core::TileDownloader::Success)
+        {
+            ++m_failures;
+        }
+        m_bytes += data.size();
+        m_mutex.unlock();
+        m_received.release();
+    }
+
+private:
+    QMutex m_mutex;
+};
+
+#endif // TILEDOWNLOADBENCHMARK_H
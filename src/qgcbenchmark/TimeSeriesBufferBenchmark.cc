@@ -0,0 +1,180 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Micro benchmark of the bounded live curve storage
+ *
+ *   Checks the retention of TimeSeriesBuffer and the bounding rect of
+ *   TimeSeriesCurveData against a plain scan of the samples, then compares
+ *   appending to the buffer against the unbounded arrays used before.
+ *
+ *   Options:
+ *      --samples <count>       Samples appended (default 2000000)
+ *      --capacity <count>      Samples kept at full rate (default 100000)
+ *      --decimation <count>    Samples per history bucket (default 10)
+ *      --history <count>       Samples kept in the history (default 100000)
+ */
+
+#include "AutoBenchmark.h"
+#include "TimeSeriesBuffer.h"
+#include "TimeSeriesCurveData.h"
+#include <QElapsedTimer>
+#include <QVector>
+#include <cmath>
+
+namespace
+{
+    const double SPIKE = 1000000.0;
+
+    // Deterministic noisy signal with one spike that has to survive the decimation
+    double sample(const int index, const int spikeIndex)
+    {
+        if (index == spikeIndex)
+        {
+            return SPIKE;
+        }
+        return std::sin(index * 0.01) * 100.0 + ((index * 7919) % 1000) * 0.01;
+    }
+}
+
+class TimeSeriesBufferBenchmark : public Benchmark
+{
+public:
+    bool run(const QStringList &args, QTextStream &out)
+    {
+        TimeSeriesBuffer::RetentionPolicy policy;
+        policy.m_fullRateCapacity = qMax(1, option(args, "--capacity", "100000").toInt());
+        policy.m_historyDecimation = qMax(1, option(args, "--decimation", "10").toInt());
+        policy.m_historyCapacity = qMax(2, option(args, "--history", "100000").toInt());
+        const int samples = qMax(policy.m_fullRateCapacity + policy.m_historyDecimation * 4,
+                                 option(args, "--samples", "2000000").toInt());
+        // The spike leaves the full rate part a few buckets before the end
+        const int spikeIndex = samples - policy.m_fullRateCapacity - policy.m_historyDecimation * 2;
+
+        // Reference: every sample kept in growing arrays
+        QElapsedTimer timer;
+        timer.start();
+        QVector<double> referenceX;
+        QVector<double> referenceY;
+        for (int i = 0; i < samples; ++i)
+        {
+            referenceX.append(i * 0.01);
+            referenceY.append(sample(i, spikeIndex));
+        }
+        const double referenceSeconds = timer.nsecsElapsed() / 1000000000.0;
+
+        timer.restart();
+        TimeSeriesBuffer buffer(policy);
+        for (int i = 0; i < samples; ++i)
+        {
+            buffer.append(i * 0.01, sample(i, spikeIndex));
+        }
+        const double bufferSeconds = timer.nsecsElapsed() / 1000000000.0;
+
+        if (!verify(buffer, policy, out))
+        {
+            return false;
+        }
+
+        out << samples << " samples, " << policy.m_fullRateCapacity << " at full rate, history decimated by "
+            << policy.m_historyDecimation << endl;
+        out << "Stored samples: reference " << referenceX.size() << ", buffer " << buffer.count() << endl;
+        out << "RESULT TimeSeriesAppendReference: " << samples / referenceSeconds << " samples/s" << endl;
+        out << "RESULT TimeSeriesBufferAppend: " << samples / bufferSeconds << " samples/s" << endl;
+
+        // Bounding rect of the whole curve as done for every replot
+        const TimeSeriesCurveData curve(&buffer, 0, buffer.count());
+        const int passes = qMax(1, 100000000 / buffer.count());
+        double width = 0.0;
+        timer.restart();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            width += curve.boundingRect().width();
+        }
+        const double rectSeconds = timer.nsecsElapsed() / 1000000000.0;
+        out << "Checksum: " << width << endl;
+        out << "RESULT TimeSeriesBoundingRect: "
+            << static_cast<double>(buffer.count()) * passes / rectSeconds / 1000000.0 << " Mpoints/s" << endl;
+        return true;
+    }
+
+private:
+    bool verify(const TimeSeriesBuffer &buffer, const TimeSeriesBuffer::RetentionPolicy &policy, QTextStream &out)
+    {
+        if ((buffer.recentCount() != policy.m_fullRateCapacity) ||
+            (buffer.historyCount() > policy.m_historyCapacity))
+        {
+            out << "Retention mismatch: " << buffer.recentCount() << " recent, "
+                << buffer.historyCount() << " history samples" << endl;
+            return false;
+        }
+
+        double minX = buffer.x(0);
+        double maxX = minX;
+        double minY = buffer.y(0);
+        double maxY = minY;
+        for (int i = 1; i < buffer.count(); ++i)
+        {
+            if (buffer.x(i) < buffer.x(i - 1))
+            {
+                out << "Samples not ascending at " << i << endl;
+                return false;
+            }
+            maxX = buffer.x(i);
+            minY = qMin(minY, buffer.y(i));
+            maxY = qMax(maxY, buffer.y(i));
+        }
+        if (maxY != SPIKE)
+        {
+            out << "Spike lost by the decimation, biggest value " << maxY << endl;
+            return false;
+        }
+
+        const QwtDoubleRect rect = TimeSeriesCurveData(&buffer, 0, buffer.count()).boundingRect();
+        if ((rect.x() != minX) || (rect.y() != minY) ||
+            (rect.width() != maxX - minX) || (rect.height() != maxY - minY))
+        {
+            out << "Bounding rect mismatch: " << rect.x() << "/" << rect.y() << " size "
+                << rect.width() << "/" << rect.height() << " expected " << minX << "/" << minY
+                << " size " << maxX - minX << "/" << maxY - minY << endl;
+            return false;
+        }
+
+        const double step = (maxX - minX) / 100.0;
+        for (double x = minX - step; x <= maxX + step; x += step)
+        {
+            int expected = 0;
+            while ((expected < buffer.count()) && (buffer.x(expected) < x))
+            {
+                ++expected;
+            }
+            if (buffer.lowerBound(x) != expected)
+            {
+                out << "lowerBound(" << x << ") is " << buffer.lowerBound(x) << ", expected " << expected << endl;
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+DECLARE_BENCHMARK(TimeSeriesBufferBenchmark)
@@ -0,0 +1,347 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Headless batch analysis of dataflash and telemetry logs
+ *
+ */
+
+#include "LogAnalyzer.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QSet>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    // Exported series are written in blocks of this size
+    const int WRITE_BLOCK_SIZE = 1024 * 1024;
+
+    /**
+     * @brief csvText delivers a text value quoted if needed
+     */
+    QByteArray csvText(const QString &text)
+    {
+        QByteArray value = text.toUtf8();
+        if (value.contains(',') || value.contains('"') || value.contains('\n'))
+        {
+            value.replace("\"", "\"\"");
+            value.prepend('"');
+            value.append('"');
+        }
+        return value;
+    }
+}
+
+LogAnalyzer::LogAnalyzer(QTextStream &out, QObject *parent) :
+    QObject(parent),
+    m_out(out),
+    m_outputDirectory("."),
+    m_useTimeAsIndex(false),
+    m_jobCount(QThread::idealThreadCount()),
+    m_failures(0),
+    m_totalBytes(0),
+    m_totalRows(0)
+{
+}
+
+LogAnalyzer::~LogAnalyzer()
+{
+    foreach (Job *job, m_jobs)
+    {
+        job->m_thread->stopLoad();
+        job->m_thread->wait();
+        delete job->m_thread;
+        delete job->m_model;
+        delete job;
+    }
+}
+
+void LogAnalyzer::setFiles(const QStringList &paths)
+{
+    m_files.clear();
+    foreach (const QString &path, paths)
+    {
+        QFileInfo info(path);
+        if (info.isDir())
+        {
+            QFileInfoList entries = QDir(path).entryInfoList(QStringList() << "*.bin" << "*.log" << "*.tlog",
+                                                             QDir::Files, QDir::Name);
+            foreach (const QFileInfo &entry, entries)
+            {
+                m_files.append(entry.filePath());
+            }
+        }
+        else
+        {
+            m_files.append(path);
+        }
+    }
+
+    // The output is named after the logs, so equal names get a number. Case is
+    // ignored as not all file systems tell names apart by case
+    m_logNames.clear();
+    QSet<QString> usedNames;
+    foreach (const QString &file, m_files)
+    {
+        const QString name = QFileInfo(file).fileName();
+        QString logName = name;
+        for (int i = 2; usedNames.contains(logName.toLower()); ++i)
+        {
+            logName = QString("%1_%2").arg(name).arg(i);
+        }
+        usedNames.insert(logName.toLower());
+        m_logNames.append(logName);
+    }
+}
+
+bool LogAnalyzer::start()
+{
+    if (!m_series.isEmpty() && !QDir().mkpath(m_outputDirectory))
+    {
+        m_out << "Unable to create output directory " << m_outputDirectory << endl;
+        return false;
+    }
+    if (!m_summaryFileName.isEmpty())
+    {
+        m_summaryFile.setFileName(m_summaryFileName);
+        if (!m_summaryFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            m_out << "Unable to create summary file " << m_summaryFileName << ": " << m_summaryFile.errorString() << endl;
+            return false;
+        }
+        m_summaryFile.write("log,series,count,min,max,mean,stddev\n");
+    }
+
+    m_out << "Analyzing " << m_files.size() << " logs, " << m_jobCount << " at once" << endl;
+    m_timer.start();
+    startJobs();
+    if (m_jobs.isEmpty())
+    {
+        QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+    }
+    return true;
+}
+
+void LogAnalyzer::startJobs()
+{
+    while ((m_jobs.size() < m_jobCount) && !m_files.isEmpty())
+    {
+        Job *job = new Job();
+        job->m_fileName = m_files.takeFirst();
+        job->m_logName = m_logNames.takeFirst();
+        job->m_model = new AP2DataPlot2DModel();
+        job->m_thread = new AP2DataPlotThread(job->m_model);
+        connect(job->m_thread, SIGNAL(done(AP2DataPlotStatus,MAV_TYPE)), this, SLOT(loadDone(AP2DataPlotStatus,MAV_TYPE)));
+        connect(job->m_thread, SIGNAL(error(QString)), this, SLOT(loadError(QString)));
+        connect(job->m_thread, SIGNAL(finished()), this, SLOT(loaderFinished()));
+        m_jobs.append(job);
+        job->m_timer.start();
+        job->m_thread->loadFile(job->m_fileName);
+    }
+}
+
+LogAnalyzer::Job *LogAnalyzer::jobForThread(QObject *thread)
+{
+    foreach (Job *job, m_jobs)
+    {
+        if (job->m_thread == thread)
+        {
+            return job;
+        }
+    }
+    return 0;
+}
+
+void LogAnalyzer::loadDone(AP2DataPlotStatus status, MAV_TYPE type)
+{
+    Q_UNUSED(status)
+    Q_UNUSED(type)
+    Job *job = jobForThread(sender());
+    if (job)
+    {
+        job->m_loaded = true;
+    }
+}
+
+void LogAnalyzer::loadError(QString errorstr)
+{
+    Job *job = jobForThread(sender());
+    if (job)
+    {
+        job->m_error = errorstr;
+    }
+}
+
+void LogAnalyzer::loaderFinished()
+{
+    Job *job = jobForThread(sender());
+    if (!job)
+    {
+        return;
+    }
+    m_jobs.removeOne(job);
+
+    // The loader emits done() even after reporting an error
+    if (job->m_loaded && job->m_error.isEmpty())
+    {
+        analyze(*job);
+    }
+    else
+    {
+        m_out << "FAIL: " << job->m_fileName << ": " << job->m_error << endl;
+        ++m_failures;
+    }
+    job->m_thread->deleteLater();
+    delete job->m_model;
+    delete job;
+
+    startJobs();
+    if (m_jobs.isEmpty())
+    {
+        const double seconds = m_timer.nsecsElapsed() / 1000000000.0;
+        const double megaBytes = m_totalBytes / (1024.0 * 1024.0);
+        m_out << "Analyzed " << megaBytes << " MB (" << m_totalRows << " rows) in " << seconds << " s: "
+              << megaBytes / seconds << " MB/s, " << m_failures << " failed" << endl;
+        m_summaryFile.close();
+        emit finished();
+    }
+}
+
+void LogAnalyzer::analyze(Job &job)
+{
+    const double seconds = job.m_timer.nsecsElapsed() / 1000000000.0;
+    const qint64 size = QFileInfo(job.m_fileName).size();
+    const double megaBytes = size / (1024.0 * 1024.0);
+    const int rows = job.m_model->rowCount();
+    m_totalBytes += size;
+    m_totalRows += rows;
+    m_out << job.m_fileName << ": " << megaBytes << " MB (" << rows << " rows) loaded in " << seconds << " s, "
+          << megaBytes / seconds << " MB/s, " << rows / seconds << " rows/s" << endl;
+
+    if (m_series.isEmpty() && !m_summaryFile.isOpen())
+    {
+        return;
+    }
+
+    // Without selected series the summary holds all numeric fields
+    QStringList names = m_series;
+    if (names.isEmpty())
+    {
+        const AP2DataPlotColumnStore &store = job.m_model->columnStore();
+        for (int i = 0; i < store.tableCount(); ++i)
+        {
+            const AP2DataPlotTable &table = store.table(i);
+            for (int j = 0; (table.rowCount() > 0) && (j < table.m_columns.size()); ++j)
+            {
+                if (!table.m_columns.at(j).isText())
+                {
+                    names.append(table.m_name + "." + table.m_labels.at(j));
+                }
+            }
+        }
+    }
+
+    const bool useTime = m_useTimeAsIndex && job.m_model->canUseTimeOnX();
+    const QVector<AP2DataPlot2DModel::Series> series = job.m_model->getSeries(names, useTime);
+    const QString logName = job.m_logName;
+    if (!m_series.isEmpty())
+    {
+        const QString fileName = QDir(m_outputDirectory).filePath(logName + ".csv");
+        if (!exportSeries(fileName, series))
+        {
+            m_out << "Unable to write " << fileName << endl;
+            ++m_failures;
+        }
+    }
+    if (m_summaryFile.isOpen())
+    {
+        writeStatistics(logName, series);
+    }
+}
+
+bool LogAnalyzer::exportSeries(const QString &fileName, const QVector<AP2DataPlot2DModel::Series> &series)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    QByteArray block = "series,x,value\n";
+    block.reserve(WRITE_BLOCK_SIZE + 1024);
+    foreach (const AP2DataPlot2DModel::Series &values, series)
+    {
+        const QByteArray name = values.m_name.toLatin1();
+        for (int i = 0; i < values.m_x.size(); ++i)
+        {
+            block.append(name);
+            block.append(',');
+            block.append(QByteArray::number(values.m_x.at(i), 'g', 15));
+            block.append(',');
+            block.append(values.m_isText ? csvText(values.m_text.at(i)) : QByteArray::number(values.m_y.at(i), 'g', 15));
+            block.append('\n');
+            if (block.size() >= WRITE_BLOCK_SIZE)
+            {
+                if (file.write(block) != block.size())
+                {
+                    return false;
+                }
+                block.resize(0);
+            }
+        }
+    }
+    return (file.write(block) == block.size());
+}
+
+void LogAnalyzer::writeStatistics(const QString &logName, const QVector<AP2DataPlot2DModel::Series> &series)
+{
+    foreach (const AP2DataPlot2DModel::Series &values, series)
+    {
+        if (values.m_isText || values.m_y.isEmpty())
+        {
+            continue;
+        }
+        // Welford's method keeps the variance stable for large values
+        double min = std::numeric_limits<double>::max();
+        double max = -std::numeric_limits<double>::max();
+        double mean = 0.0;
+        double m2 = 0.0;
+        for (int i = 0; i < values.m_y.size(); ++i)
+        {
+            const double value = values.m_y.at(i);
+            min = qMin(min, value);
+            max = qMax(max, value);
+            const double delta = value - mean;
+            mean += delta / (i + 1);
+            m2 += delta * (value - mean);
+        }
+        const double stddev = (values.m_y.size() > 1) ? std::sqrt(m2 / (values.m_y.size() - 1)) : 0.0;
+        QByteArray line = csvText(logName) + ',' + values.m_name.toLatin1() + ',';
+        line += QByteArray::number(values.m_y.size()) + ',' + QByteArray::number(min, 'g', 15) + ',';
+        line += QByteArray::number(max, 'g', 15) + ',' + QByteArray::number(mean, 'g', 15) + ',';
+        line += QByteArray::number(stddev, 'g', 15) + '\n';
+        m_summaryFile.write(line);
+    }
+}
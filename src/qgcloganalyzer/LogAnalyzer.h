@@ -0,0 +1,152 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Headless batch analysis of dataflash and telemetry logs
+ *
+ */
+
+#ifndef LOGANALYZER_H
+#define LOGANALYZER_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <QTextStream>
+#include "AP2DataPlot2DModel.h"
+#include "AP2DataPlotStatus.h"
+#include "AP2DataPlotThread.h"
+
+/**
+ * @brief The LogAnalyzer class loads a list of logs using the AP2DataPlotThread,
+ *        several logs at once, and analyzes each log as soon as it is loaded:
+ *
+ *        - The selected series are exported into "<output>/<log name>.csv" holding
+ *          one "series,x,value" line per sample. Logs sharing a file name, e.g. from
+ *          different directories, are numbered as "<log name>_2", "<log name>_3"...
+ *        - Count, min, max, mean and standard deviation of the selected series are
+ *          appended to a summary file. If no series are selected the summary holds
+ *          all numeric fields of the log.
+ *        - Size, rows and throughput of every log are reported to the console.
+ *
+ *        No widget and no part of the vehicle or link management is created.
+ */
+class LogAnalyzer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LogAnalyzer(QTextStream &out, QObject *parent = 0);
+    ~LogAnalyzer();
+
+    /**
+     * @brief setFiles sets the logs to analyze. Directories are replaced by all
+     *        .bin, .log and .tlog files they hold.
+     */
+    void setFiles(const QStringList &paths);
+
+    /**
+     * @brief setSeries selects the fields to export as "TYPE.field" like "ATT.Roll"
+     */
+    void setSeries(const QStringList &series) { m_series = series; }
+
+    void setOutputDirectory(const QString &directory) { m_outputDirectory = directory; }
+
+    /**
+     * @brief setSummaryFile sets the file receiving the statistics of the series.
+     *        No statistics are created if empty.
+     */
+    void setSummaryFile(const QString &fileName) { m_summaryFileName = fileName; }
+
+    /**
+     * @brief setUseTimeAsIndex exports the time instead of the log index as x
+     *        for logs having a valid time base.
+     */
+    void setUseTimeAsIndex(const bool useTime) { m_useTimeAsIndex = useTime; }
+
+    /**
+     * @brief setJobCount sets the number of logs loaded at once
+     */
+    void setJobCount(const int count) { m_jobCount = qMax(1, count); }
+
+    /**
+     * @brief start starts loading the logs. finished() is emitted when all
+     *        logs are analyzed.
+     *
+     * @return false if the summary file could not be created
+     */
+    bool start();
+
+    /**
+     * @brief failureCount delivers the number of logs which could not be analyzed
+     */
+    int failureCount() const { return m_failures; }
+
+signals:
+    void finished();
+
+private slots:
+    void loadDone(AP2DataPlotStatus status, MAV_TYPE type);
+    void loadError(QString errorstr);
+    void loaderFinished();
+
+private:
+    /**
+     * @brief The Job struct holds the state of a log being loaded
+     */
+    struct Job
+    {
+        QString m_fileName;
+        QString m_logName;          /// Unique name of the log in the output
+        AP2DataPlot2DModel *m_model;
+        AP2DataPlotThread *m_thread;
+        QElapsedTimer m_timer;
+        bool m_loaded;
+        QString m_error;
+
+        Job() : m_model(0), m_thread(0), m_loaded(false) {}
+    };
+
+    void startJobs();
+    Job *jobForThread(QObject *thread);
+    void analyze(Job &job);
+    bool exportSeries(const QString &fileName, const QVector<AP2DataPlot2DModel::Series> &series);
+    void writeStatistics(const QString &logName, const QVector<AP2DataPlot2DModel::Series> &series);
+
+    QTextStream &m_out;
+    QStringList m_files;            /// Logs waiting to be loaded
+    QStringList m_logNames;         /// Unique names of the logs waiting to be loaded
+    QList<Job*> m_jobs;             /// Logs being loaded
+    QStringList m_series;           /// Fields to export
+    QString m_outputDirectory;      /// Directory receiving the exported series
+    QString m_summaryFileName;
+    QFile m_summaryFile;
+    bool m_useTimeAsIndex;
+    int m_jobCount;
+    int m_failures;
+    qint64 m_totalBytes;            /// Size of all analyzed logs
+    qint64 m_totalRows;             /// Rows of all analyzed logs
+    QElapsedTimer m_timer;
+};
+
+#endif // LOGANALYZER_H
@@ -0,0 +1,108 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Entry point of the qgcloganalyzer application
+ *
+ *   Usage: qgcloganalyzer [--option value ...] <log or directory> ...
+ *
+ *   Options:
+ *      --series <TYPE.field,...>   Export these fields into <output>/<log name>.csv, logs
+ *                                  sharing a name are numbered as <log name>_2...
+ *      --output <directory>        Directory receiving the exported series (default .)
+ *      --summary <file.csv>        Write count, min, max, mean and stddev of the series.
+ *                                  All numeric fields are used if --series is not set
+ *      --x <index|time>            Use the log index or the time as x (default index)
+ *      --jobs <count>              Number of logs loaded at once (default: number of cores)
+ */
+
+#include <QCoreApplication>
+#include <QSettings>
+#include <QStringList>
+#include <QTextStream>
+#include "configuration.h"
+#include "LogAnalyzer.h"
+
+namespace
+{
+    /**
+     * @brief option delivers the value of a "--name value" command line option
+     * @return value of the option or defaultValue if the option is not set
+     */
+    QString option(const QStringList &args, const QString &name, const QString &defaultValue)
+    {
+        int index = args.indexOf(name);
+        if ((index >= 0) && (index + 1 < args.size()))
+        {
+            return args.at(index + 1);
+        }
+        return defaultValue;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Use the settings of APM Planner so the log cache is shared
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+    app.setApplicationName(QGC_APPLICATION_NAME);
+    app.setOrganizationName(QLatin1String("diydrones"));
+    app.setOrganizationDomain("com.diydrones");
+
+    QTextStream out(stdout);
+    QStringList args = app.arguments();
+
+    // Plain arguments are logs, "--name value" pairs are options
+    QStringList files;
+    for (int i = 1; i < args.size(); ++i)
+    {
+        if (args.at(i).startsWith("--"))
+        {
+            ++i;
+        }
+        else
+        {
+            files.append(args.at(i));
+        }
+    }
+    if (files.isEmpty())
+    {
+        out << "Usage: qgcloganalyzer [--series TYPE.field,...] [--output dir] [--summary file.csv]" << endl
+            << "                      [--x index|time] [--jobs count] <log or directory> ..." << endl;
+        return 1;
+    }
+
+    LogAnalyzer analyzer(out);
+    analyzer.setFiles(files);
+    analyzer.setSeries(option(args, "--series", "").split(',', QString::SkipEmptyParts));
+    analyzer.setOutputDirectory(option(args, "--output", "."));
+    analyzer.setSummaryFile(option(args, "--summary", ""));
+    analyzer.setUseTimeAsIndex(option(args, "--x", "index") == "time");
+    analyzer.setJobCount(option(args, "--jobs", QString::number(QThread::idealThreadCount())).toInt());
+    QObject::connect(&analyzer, SIGNAL(finished()), &app, SLOT(quit()));
+    if (!analyzer.start())
+    {
+        return 1;
+    }
+    app.exec();
+    return analyzer.failureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+#include "TileDownloaderTest.h"
+#include "LocalTileServer.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+namespace
+{
+    const int TILE_ZOOM = 17;
+    const int TILE_SIZE = 4096;
+    // Time in ms a tile must be downloaded in
+    const int DOWNLOAD_TIMEOUT = 10000;
+
+    QString tilePath(const int tile)
+    {
+        return QString("/%1/%2/0.png").arg(TILE_ZOOM).arg(tile);
+    }
+
+    bool createTile(const QString &directory, const int tile)
+    {
+        QFile file(directory + tilePath(tile));
+        return QDir().mkpath(QFileInfo(file).path()) && file.open(QIODevice::WriteOnly) &&
+               (file.write(QByteArray(TILE_SIZE, static_cast<char>(tile))) == TILE_SIZE);
+    }
+
+    void request(core::TileDownloader &downloader, const LocalTileServer &server, const int tile, const void *owner)
+    {
+        const QUrl url(QString("http://127.0.0.1:%1%2").arg(server.port()).arg(tilePath(tile)));
+        downloader.Request(core::RawTile(core::MapType::GoogleSatellite, core::Point(tile, 0), TILE_ZOOM),
+                           QNetworkRequest(url), DOWNLOAD_TIMEOUT, owner);
+    }
+}
+
+int TileRecorder::count()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_results.size();
+}
+
+int TileRecorder::result(const int index)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_results.value(index, -1);
+}
+
+QByteArray TileRecorder::data(const int index)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_data.value(index);
+}
+
+void TileRecorder::tileDownloaded(core::RawTile tile, QByteArray data, int result)
+{
+    Q_UNUSED(tile);
+    m_mutex.lock();
+    m_results.append(result);
+    m_data.append(data);
+    m_mutex.unlock();
+    m_received.release();
+}
+
+TileDownloaderTest::TileDownloaderTest() :
+    tileDir(NULL),
+    downloader(NULL),
+    recorder(NULL)
+{
+}
+
+//This function is called before every test
+void TileDownloaderTest::init()
+{
+    tileDir = new QTemporaryDir();
+    QVERIFY(tileDir->isValid());
+    for (int tile = 0; tile < 6; ++tile)
+    {
+        QVERIFY(createTile(tileDir->path(), tile));
+    }
+    recorder = new TileRecorder();
+    downloader = new core::TileDownloader();
+    connect(downloader, SIGNAL(TileDownloaded(core::RawTile,QByteArray,int)),
+            recorder, SLOT(tileDownloaded(core::RawTile,QByteArray,int)), Qt::DirectConnection);
+}
+
+//this function is called after every test
+void TileDownloaderTest::cleanup()
+{
+    delete downloader;
+    downloader = NULL;
+
+    delete recorder;
+    recorder = NULL;
+
+    delete tileDir;
+    tileDir = NULL;
+}
+
+void TileDownloaderTest::duplicateRequest_test()
+{
+    LocalTileServer server(tileDir->path(), 100);
+    QVERIFY(server.start());
+    int owner1 = 0;
+    int owner2 = 0;
+
+    // The same tile requested by two views is downloaded once
+    request(*downloader, server, 1, &owner1);
+    request(*downloader, server, 1, &owner1);
+    request(*downloader, server, 1, &owner2);
+    QVERIFY(recorder->m_received.tryAcquire(1, DOWNLOAD_TIMEOUT));
+    QCOMPARE(recorder->result(0), static_cast<int>(core::TileDownloader::Success));
+    QCOMPARE(recorder->data(0), QByteArray(TILE_SIZE, 1));
+
+    QTest::qWait(300);
+    QCOMPARE(recorder->count(), 1);
+    QCOMPARE(server.requestCount(), 1);
+}
+
+void TileDownloaderTest::maxRequestsPerHost_test()
+{
+    LocalTileServer server(tileDir->path(), 500);
+    QVERIFY(server.start());
+    downloader->SetMaxRequestsPerHost(2);
+    int owner = 0;
+
+    for (int tile = 0; tile < 6; ++tile)
+    {
+        request(*downloader, server, tile, &owner);
+    }
+    // Only two requests are in flight until the first answers arrive
+    QTRY_COMPARE(server.requestCount(), 2);
+    QTest::qWait(200);
+    QCOMPARE(server.requestCount(), 2);
+    QCOMPARE(recorder->count(), 0);
+
+    QVERIFY(recorder->m_received.tryAcquire(6, DOWNLOAD_TIMEOUT));
+    QCOMPARE(server.requestCount(), 6);
+    for (int i = 0; i < 6; ++i)
+    {
+        QCOMPARE(recorder->result(i), static_cast<int>(core::TileDownloader::Success));
+    }
+}
+
+void TileDownloaderTest::cancel_test()
+{
+    LocalTileServer server(tileDir->path(), 300);
+    QVERIFY(server.start());
+    downloader->SetMaxRequestsPerHost(1);
+    int owner1 = 0;
+    int owner2 = 0;
+
+    for (int tile = 0; tile < 4; ++tile)
+    {
+        request(*downloader, server, tile, &owner1);
+    }
+    QTRY_COMPARE(server.requestCount(), 1);
+
+    // The tile in flight is completed, the queued tiles of the view are dropped
+    downloader->Cancel(&owner1);
+    request(*downloader, server, 5, &owner2);
+    QVERIFY(recorder->m_received.tryAcquire(2, DOWNLOAD_TIMEOUT));
+    QTest::qWait(800);
+    QCOMPARE(recorder->count(), 2);
+    QCOMPARE(server.requestCount(), 2);
+    QCOMPARE(recorder->data(1), QByteArray(TILE_SIZE, 5));
+}
+
+void TileDownloaderTest::retryFailedTile_test()
+{
+    LocalTileServer server(tileDir->path(), 0);
+    QVERIFY(server.start());
+    int owner = 0;
+
+    // A failed tile is reported and a later request downloads it again
+    request(*downloader, server, 9, &owner);
+    QVERIFY(recorder->m_received.tryAcquire(1, DOWNLOAD_TIMEOUT));
+    QVERIFY(recorder->result(0) != static_cast<int>(core::TileDownloader::Success));
+    QVERIFY(recorder->data(0).isEmpty());
+
+    QVERIFY(createTile(tileDir->path(), 9));
+    request(*downloader, server, 9, &owner);
+    QVERIFY(recorder->m_received.tryAcquire(1, DOWNLOAD_TIMEOUT));
+    QCOMPARE(recorder->result(1), static_cast<int>(core::TileDownloader::Success));
+    QCOMPARE(recorder->data(1), QByteArray(TILE_SIZE, 9));
+    QCOMPARE(server.requestCount(), 2);
+}
@@ -0,0 +1,59 @@
+#ifndef TILEDOWNLOADERTEST_H
+#define TILEDOWNLOADERTEST_H
+
+#include <QObject>
+#include <QMutex>
+#include <QSemaphore>
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+#include "AutoTest.h"
+#include "tiledownloader.h"
+
+/**
+ * @brief The TileRecorder class records the tiles delivered by the TileDownloader.
+ *        Its slot is called from the thread of the downloader.
+ */
+class TileRecorder : public QObject
+{
+    Q_OBJECT
+public:
+    QSemaphore m_received;
+
+    int count();
+    int result(const int index);
+    QByteArray data(const int index);
+
+public slots:
+    void tileDownloaded(core::RawTile tile, QByteArray data, int result);
+
+private:
+    QMutex m_mutex;
+    QList<int> m_results;
+    QList<QByteArray> m_data;
+};
+
+class TileDownloaderTest : public QObject
+{
+    Q_OBJECT
+public:
+    TileDownloaderTest();
+
+private slots:
+    void init();
+    void cleanup();
+
+    void duplicateRequest_test();
+    void maxRequestsPerHost_test();
+    void cancel_test();
+    void retryFailedTile_test();
+
+private:
+    QTemporaryDir *tileDir;
+    core::TileDownloader *downloader;
+    TileRecorder *recorder;
+};
+
+DECLARE_TEST(TileDownloaderTest)
+
+#endif // TILEDOWNLOADERTEST_H
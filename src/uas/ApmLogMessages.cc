@@ -0,0 +1,358 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Classes for special log message handling (ERR, MODE, EV, MSG).
+ *          Kept apart from the UAS classes so the log model can be used
+ *          without them.
+ *
+ */
+
+#include "ApmLogMessages.h"
+#include "QsLog.h"
+#include <QTextStream>
+
+MessageBase::MessageBase() : m_Index(0), m_TimeStamp(0)
+{}
+
+MessageBase::MessageBase(const quint32 index, const double timeStamp, const QString &name, const QColor &color) :
+    m_Index(index),
+    m_TimeStamp(timeStamp),
+    m_TypeName(name),
+    m_Color(color)
+{}
+
+quint32 MessageBase::getIndex() const
+{
+    return m_Index;
+}
+
+double MessageBase::getTimeStamp() const
+{
+    return m_TimeStamp;
+}
+
+QString MessageBase::typeName() const
+{
+    return m_TypeName;
+}
+
+QColor MessageBase::typeColor() const
+{
+    return m_Color;
+}
+
+//********
+
+const QString ErrorMessage::TypeName("ERR");
+
+ErrorMessage::ErrorMessage() : m_SubSys(0), m_ErrorCode(0)
+{
+    // Set up base class vars for this message
+    m_TypeName = TypeName;
+    m_Color    = QColor(150,0,0);
+}
+
+ErrorMessage::ErrorMessage(const QString &TimeFieldName) : m_SubSys(0), m_ErrorCode(0)
+{
+    // Set up base class vars for this message
+    m_TypeName = TypeName;
+    m_Color    = QColor(150,0,0);
+    m_TimeFieldName = TimeFieldName;
+}
+
+
+ErrorMessage::ErrorMessage(const quint32 index, const double timeStamp, const quint32 subSys, const quint32 errCode) :
+    MessageBase(index, timeStamp, TypeName, QColor(150,0,0)),
+    m_SubSys(subSys),
+    m_ErrorCode(errCode)
+{}
+
+quint32 ErrorMessage::getSubsystemCode() const
+{
+    return m_SubSys;
+}
+
+quint32 ErrorMessage::getErrorCode() const
+{
+    return m_ErrorCode;
+}
+
+bool ErrorMessage::setFromSqlRecord(const QSqlRecord &record, const double timeDivider)
+{
+    bool rc1 = false;
+    bool rc2 = false;
+    bool rc3 = false;
+    bool rc4 = false;
+
+    if(record.value(0).isValid())
+    {
+        m_Index = static_cast<quint32>(record.value(0).toUInt());
+        rc1 = true;
+    }
+    if (record.contains(m_TimeFieldName))
+    {
+        m_TimeStamp = record.value(m_TimeFieldName).toDouble();
+        m_TimeStamp /= timeDivider;
+        rc2 = true;
+    }
+    if (record.contains("Subsys"))
+    {
+        m_SubSys = static_cast<quint32>(record.value("Subsys").toUInt());
+        rc3 = true;
+    }
+    if (record.contains("ECode"))
+    {
+        m_ErrorCode = static_cast<quint32>(record.value("ECode").toUInt());
+        rc4 = true;
+    }
+
+    return rc1 && rc2 && rc3 && rc4;
+}
+
+QString ErrorMessage::toString() const
+{
+    QString output;
+    QTextStream outputStream(&output);
+
+    outputStream << " Subsystem:" << m_SubSys << " Errorcode:" << m_ErrorCode;
+    return output;
+}
+
+//********
+
+const QString ModeMessage::TypeName("MODE");
+
+ModeMessage::ModeMessage() : m_Mode(0), m_ModeNum(0)
+{
+    // Set up base class vars for this message
+    m_TypeName = TypeName;
+    m_Color    = QColor(50,125,0);
+}
+
+ModeMessage::ModeMessage(const QString &TimeFieldName) : m_Mode(0), m_ModeNum(0)
+{
+    // Set up base class vars for this message
+    m_TypeName = TypeName;
+    m_Color    = QColor(50,125,0);
+    m_TimeFieldName = TimeFieldName;
+}
+
+ModeMessage::ModeMessage(const quint32 index, const double timeStamp, const quint32 mode, const quint32 modeNum) :
+    MessageBase(index, timeStamp, TypeName, QColor(50,125,0)),
+    m_Mode(mode),
+    m_ModeNum(modeNum)
+{}
+
+quint32 ModeMessage::getMode() const
+{
+    return m_Mode;
+}
+
+quint32 ModeMessage::getModeNum() const
+{
+    return m_ModeNum;
+}
+
+bool ModeMessage::setFromSqlRecord(const QSqlRecord &record, const double timeDivider)
+{
+    bool rc1 = false;
+    bool rc2 = false;
+    bool rc3 = false;
+
+    if(record.value(0).isValid())
+    {
+        m_Index = static_cast<quint32>(record.value(0).toUInt());
+        rc1 = true;
+    }
+    if (record.contains(m_TimeFieldName))
+    {
+        m_TimeStamp = record.value(m_TimeFieldName).toDouble();
+        m_TimeStamp /= timeDivider;
+        rc2 = true;
+    }
+    if (record.contains("Mode"))
+    {
+        m_Mode = static_cast<quint32>(record.value("Mode").toUInt());
+        rc3 = true;
+    }
+    if (record.contains("ModeNum"))
+    {
+        m_ModeNum = static_cast<quint32>(record.value("ModeNum").toUInt());
+       // ModeNum does not influence the returncode as its optional
+    }
+
+    return rc1 && rc2 && rc3;
+}
+
+QString ModeMessage::toString() const
+{
+    QString output;
+    QTextStream outputStream(&output);
+
+    outputStream << " Mode:" << m_Mode << " ModeNum:" << m_ModeNum;
+    return output;
+}
+
+//********
+
+const QString EventMessage::TypeName("EV");
+
+EventMessage::EventMessage() : m_EventID(0)
+{
+    // Set up base class vars for this message
+    m_TypeName = TypeName;
+    m_Color    = QColor(0,0,125);
+}
+
+EventMessage::EventMessage(const QString &TimeFieldName) : m_EventID(0)
+{
+    // Set up base class vars for this message
+    m_TypeName = TypeName;
+    m_Color    = QColor(0,0,125);
+    m_TimeFieldName = TimeFieldName;
+}
+
+EventMessage::EventMessage(const quint32 index, const double timeStamp, const quint32 eventID) :
+    MessageBase(index, timeStamp, TypeName, QColor(0,0,125)),
+    m_EventID(eventID)
+{}
+
+quint32 EventMessage::getEventID() const
+{
+    return m_EventID;
+}
+
+bool EventMessage::setFromSqlRecord(const QSqlRecord &record, const double timeDivider)
+{
+    bool rc1 = false;
+    bool rc2 = false;
+    bool rc3 = false;
+
+    if(record.value(0).isValid())
+    {
+        m_Index = static_cast<quint32>(record.value(0).toUInt());
+        rc1 = true;
+    }
+    if (record.contains(m_TimeFieldName))
+    {
+        m_TimeStamp = record.value(m_TimeFieldName).toDouble();
+        m_TimeStamp /= timeDivider;
+        rc2 = true;
+    }
+    if (record.contains("Id"))
+    {
+        m_EventID = static_cast<quint32>(record.value("Id").toUInt());
+        rc3 = true;
+    }
+
+    return rc1 && rc2 && rc3;
+}
+
+QString EventMessage::toString() const
+{
+    QString output;
+    QTextStream outputStream(&output);
+
+    outputStream << " Event ID:" << m_EventID;
+    return output;
+}
+
+//********
+
+const QString MsgMessage::TypeName("MSG");
+
+MsgMessage::MsgMessage()
+{
+    // Set up base class vars for this message
+    m_TypeName = TypeName;
+    m_Color    = QColor(0,0,0);
+}
+
+MsgMessage::MsgMessage(const QString &TimeFieldName)
+{
+    // Set up base class vars for this message
+    m_TypeName = TypeName;
+    m_Color    = QColor(0,0,0);
+    m_TimeFieldName = TimeFieldName;
+}
+
+MsgMessage::MsgMessage(const quint32 index, const double timeStamp, const QString &message) :
+    MessageBase(index, timeStamp, TypeName, QColor(0,0,0)),
+    m_Message(message)
+{}
+
+bool MsgMessage::setFromSqlRecord(const QSqlRecord &record, const double timeDivider)
+{
+    bool rc1 = false;
+    bool rc2 = false;
+    bool rc3 = false;
+
+    if(record.value(0).isValid())
+    {
+        m_Index = static_cast<quint32>(record.value(0).toUInt());
+        rc1 = true;
+    }
+    if (record.contains(m_TimeFieldName))
+    {
+        m_TimeStamp = record.value(m_TimeFieldName).toDouble();
+        m_TimeStamp /= timeDivider;
+        rc2 = true;
+    }
+    if (record.contains("Message"))
+    {
+        m_Message = record.value("Message").toString();
+        rc3 = true;
+    }
+
+    return rc1 && rc2 && rc3;
+}
+
+QString MsgMessage::toString() const
+{
+    return m_Message;
+}
+
+//********
+
+MessageBase::Ptr MessageFactory::getMessageOfType(const QString &type, const QString &TimeFieldName)
+{
+    if (type == ErrorMessage::TypeName)
+    {
+        return MessageBase::Ptr(new ErrorMessage(TimeFieldName));
+    }
+    else if (type == ModeMessage::TypeName)
+    {
+        return MessageBase::Ptr(new ModeMessage(TimeFieldName));
+    }
+    else if (type == EventMessage::TypeName)
+    {
+        return MessageBase::Ptr(new EventMessage(TimeFieldName));
+    }
+    else if (type == MsgMessage::TypeName)
+    {
+        return MessageBase::Ptr(new MsgMessage(TimeFieldName));
+    }
+    QLOG_WARN() << "MessageFactory::getMessageOfType: No message of type '" << type << "' could be created";
+    return MessageBase::Ptr();
+}
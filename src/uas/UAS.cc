@@ -181,7 +181,12 @@ UAS::UAS(MAVLinkProtocol* protocol, int id) : UASInterface(),
     systemId = QGC::defaultSystemId;
     componentId = QGC::defaultComponentId;
 
-    m_heartbeatsEnabled = MainWindow::instance()->heartbeatEnabled(); //Default to sending heartbeats
+    // Default to sending heartbeats. The setting is owned by the MainWindow
+    // but read here so vehicles can be created without a user interface.
+    QSettings settings;
+    settings.beginGroup("QGC_MAINWINDOW");
+    m_heartbeatsEnabled = settings.value("HEARTBEATS_ENABLED", true).toBool();
+    settings.endGroup();
     QTimer *heartbeattimer = new QTimer(this);
     connect(heartbeattimer,SIGNAL(timeout()),this,SLOT(sendHeartbeat()));
     heartbeattimer->start(MAVLINK_HEARTBEAT_DEFAULT_RATE * 1000);
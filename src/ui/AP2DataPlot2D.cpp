@@ -39,6 +39,7 @@ This file is part of the APM_PLANNER project
 #include "UAS.h"
 #include "UASManager.h"
 #include <QToolTip>
+#include <QHeaderView>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlRecord>
@@ -48,9 +49,11 @@ This file is part of the APM_PLANNER project
 #include "MainWindow.h"
 #include "AP2DataPlot2DModel.h"
 #include "ArduPilotMegaMAV.h"
+#include "LinkManager.h"
 #include <QSettings>
 
 #define ROW_HEIGHT_PADDING 3 //Number of additional pixels over font height for each row for the table/excel view.
+#define FRAME_INTERVAL 40 //Milliseconds between two updates of the graphs, new samples are batched in between.
 
 AP2DataPlot2D::AP2DataPlot2D(QWidget *parent,bool isIndependant) : QWidget(parent),
     m_updateTimer(NULL),
@@ -64,6 +67,8 @@ AP2DataPlot2D::AP2DataPlot2D(QWidget *parent,bool isIndependant) : QWidget(paren
     m_startIndex(0),
     m_addGraphAction(NULL),
     m_uas(NULL),
+    m_telemetryTimer(NULL),
+    m_telemetryReader(LinkManager::instance()->getProtocol()->telemetryStore()),
     m_axisGroupingDialog(NULL),
     m_tlogReplayEnabled(false),
     m_logDownloadDialog(NULL),
@@ -71,7 +76,12 @@ AP2DataPlot2D::AP2DataPlot2D(QWidget *parent,bool isIndependant) : QWidget(paren
     m_statusTextPos(0),
     m_useTimeOnX(false),
     m_lastHorizontalScrollerVal(0),
-    m_KmlExport(false)
+    m_KmlExport(false),
+    m_exportThread(NULL),
+    m_exportProgressDialog(NULL),
+    m_replotPending(false),
+    m_onlineSamplesPending(false),
+    m_onlineNewestKey(0.0)
 {
     ui.setupUi(this);
 
@@ -153,6 +163,8 @@ AP2DataPlot2D::AP2DataPlot2D(QWidget *parent,bool isIndependant) : QWidget(paren
 
     setExcelViewHidden(true);
     ui.tableWidget->verticalHeader()->setDefaultSectionSize(ui.tableWidget->fontMetrics().height() + ROW_HEIGHT_PADDING);
+    // Fixed row heights keep the view from measuring rows of huge logs
+    ui.tableWidget->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
     ui.hideExcelView->setVisible(false);
 
     connect(ui.loadOfflineLogButton,SIGNAL(clicked()),this,SLOT(loadButtonClicked()));
@@ -167,6 +179,7 @@ AP2DataPlot2D::AP2DataPlot2D(QWidget *parent,bool isIndependant) : QWidget(paren
     connect(ui.horizontalScrollBar, SIGNAL(valueChanged(int)), this, SLOT(horizontalScrollMoved(int)));
     connect(ui.verticalScrollBar, SIGNAL(valueChanged(int)), this, SLOT(verticalScrollMoved(int)));
     connect(m_wideAxisRect->axis(QCPAxis::atBottom), SIGNAL(rangeChanged(QCPRange)), this, SLOT(xAxisChanged(QCPRange)));
+    connect(m_wideAxisRect->axis(QCPAxis::atBottom), SIGNAL(rangeChanged(QCPRange)), this, SLOT(updateGraphDetail(QCPRange)));
     m_plot->setPlottingHint(QCP::phFastPolylines,true);
 
     connect(ui.downloadPushButton, SIGNAL(clicked()), this, SLOT(showLogDownloadDialog()));
@@ -236,6 +249,7 @@ void AP2DataPlot2D::graphColorsChanged(QMap<QString,QColor> colormap)
         m_graphClassMap[i.key()].axis->setTickLabelColor(i.value());
         m_graphClassMap[i.key()].axis->setTickLabelColor(i.value());
     }
+    m_replotPending = true;
 }
 
 void AP2DataPlot2D::graphGroupingChanged(QList<AP2DataPlotAxisDialog::GraphRange> graphRangeList)
@@ -330,6 +344,23 @@ void AP2DataPlot2D::xAxisChanged(QCPRange range)
     connect(ui.verticalScrollBar, SIGNAL(valueChanged(int)), this, SLOT(verticalScrollMoved(int)));
 }
 
+void AP2DataPlot2D::updateGraphDetail(QCPRange range)
+{
+    // The graphs only hold about two points per pixel column of the range
+    // which keeps panning and zooming fast on series with millions of samples
+    QVector<double> xlist;
+    QVector<double> ylist;
+    for (QMap<QString,Graph>::const_iterator i = m_graphClassMap.constBegin(); i != m_graphClassMap.constEnd(); ++i)
+    {
+        if (i.value().pyramid)
+        {
+            i.value().pyramid->visibleData(range.lower, range.upper, m_plot->width(), xlist, ylist);
+            i.value().graph->setData(xlist, ylist);
+        }
+    }
+    m_replotPending = true;
+}
+
 void AP2DataPlot2D::horizontalScrollMoved(int value)
 {
     if (value != m_lastHorizontalScrollerVal)
@@ -351,8 +382,9 @@ void AP2DataPlot2D::showEvent(QShowEvent *evt)
         m_updateTimer = NULL;
     }
     m_updateTimer = new QTimer(this);
-    connect(m_updateTimer,SIGNAL(timeout()),m_plot,SLOT(replot()));
-    m_updateTimer->start(500);
+    connect(m_updateTimer,SIGNAL(timeout()),this,SLOT(updateTimerTick()));
+    m_updateTimer->start(FRAME_INTERVAL);
+    m_replotPending = true;
     QWidget::showEvent(evt);
 }
 
@@ -394,7 +426,8 @@ void AP2DataPlot2D::plotDoubleClick(QMouseEvent * evt)
         // We scaled the time by timeDivisor when plotting the graph
         // therefore we have to scale when searching for the original timestamp
         timeStamp = key;
-        key = m_tableModel->getNearestIndexForTimestamp(timeStamp);
+        int row = m_tableModel->getRowForTimestamp(timeStamp);
+        key = (row < 0) ? 0 : row + m_tableModel->getFirstIndex();
     }
 
     quint64 position = floor(key);
@@ -416,25 +449,8 @@ void AP2DataPlot2D::plotDoubleClick(QMouseEvent * evt)
     else
     {
         //search for previous event (remember the table may be filtered)
-        QModelIndex sourceIndex = m_tableModel->index(position-min, 0);
-        QModelIndex index = m_tableFilterProxyModel->mapFromSource(sourceIndex);
-        while ( sourceIndex.row() >= static_cast<int>(min) && !index.isValid() )
-        {
-            sourceIndex = m_tableModel->index(sourceIndex.row() - 1, 0);
-            index = m_tableFilterProxyModel->mapFromSource(sourceIndex);
-        }
-
-        if ( !index.isValid() )
-        {
-            //couldn't find filtered index by looking back, try forward...
-            sourceIndex = m_tableModel->index(position-min, 0);
-            index = m_tableFilterProxyModel->mapFromSource(sourceIndex);
-            while ( sourceIndex.row() <= static_cast<int>(max) && !index.isValid() )
-            {
-                sourceIndex = m_tableModel->index(sourceIndex.row() + 1, 0);
-                index = m_tableFilterProxyModel->mapFromSource(sourceIndex);
-            }
-        }
+        int row = m_tableModel->rowForSourceRow(static_cast<int>(position - min));
+        QModelIndex index = m_tableModel->index(row, 0);
         ui.tableWidget->setCurrentIndex(index);
         ui.tableWidget->scrollTo(index);
     }
@@ -475,22 +491,13 @@ void AP2DataPlot2D::plotMouseMove(QMouseEvent *evt)
         {
             if (m_graphClassMap.value(m_graphClassMap.keys()[i]).messageMap.keys().size() > 1)
             {
-                for (QMap<double,QString>::const_iterator messagemapiterator = m_graphClassMap.value(m_graphClassMap.keys()[i]).messageMap.constBegin();messagemapiterator!=m_graphClassMap.value(m_graphClassMap.keys()[i]).messageMap.constEnd();messagemapiterator++)
+                // Use the last mode change in front of the cursor
+                const QMap<double,QString> messageMap = m_graphClassMap.value(m_graphClassMap.keys()[i]).messageMap;
+                QMap<double,QString>::const_iterator messagemapiterator = messageMap.lowerBound(key);
+                if (messagemapiterator != messageMap.constBegin())
                 {
-                    if (messagemapiterator.key() < key)
-                    {
-                        if (messagemapiterator==m_graphClassMap.value(m_graphClassMap.keys()[i]).messageMap.constEnd()-1)
-                        {
-                            //We're at the end, use the end
-                            newresult.append(m_graphClassMap.keys()[i] + ": " + messagemapiterator.value() + ((i == m_graphClassMap.keys().size()-1) ? "" : "\n"));
-                        }
-                        else if ((messagemapiterator+1).key() > key)
-                        {
-                            //This only gets hit if we're not at the end, and we have the proper value
-                            newresult.append(m_graphClassMap.keys()[i] + ": " + messagemapiterator.value() + ((i == m_graphClassMap.keys().size()-1) ? "" : "\n"));
-                            break;
-                        }
-                    }
+                    --messagemapiterator;
+                    newresult.append(m_graphClassMap.keys()[i] + ": " + messagemapiterator.value() + ((i == m_graphClassMap.keys().size()-1) ? "" : "\n"));
                 }
             }
             else if (m_graphClassMap.value(m_graphClassMap.keys()[i]).messageMap.keys().size() == 1)
@@ -508,6 +515,20 @@ void AP2DataPlot2D::plotMouseMove(QMouseEvent *evt)
         {
             //Ignore ERR / EV / MSG
         }
+        else if (m_graphClassMap.value(m_graphClassMap.keys()[i]).pyramid)
+        {
+            // The graph only holds the points of the current detail level
+            double value = 0.0;
+            if (m_graphClassMap.value(m_graphClassMap.keys()[i]).pyramid->valueAt(key, value))
+            {
+                QString str = QString().sprintf( "%.9g", value);
+                newresult.append(m_graphClassMap.keys()[i] + ": " + str + ((i == m_graphClassMap.keys().size()-1) ? "" : "\n"));
+            }
+            else
+            {
+                newresult.append(m_graphClassMap.keys()[i] + ": " + "ERR" + ((i == m_graphClassMap.keys().size()-1) ? "" : "\n"));
+            }
+        }
         else if (graph->data()->contains(key))
         {
             QString str = QString().sprintf( "%.9g", graph->data()->value(key).value);
@@ -601,20 +622,22 @@ void AP2DataPlot2D::selectedRowChanged(QModelIndex current,QModelIndex previous)
     {
         return;
     }
-    quint64 index =  m_tableFilterProxyModel->mapToSource(current).row() + m_tableModel->getFirstIndex();
+    quint64 index = m_tableModel->sourceRow(current.row()) + m_tableModel->getFirstIndex();
 
     if (m_useTimeOnX)
     {
-        // timestamp value of the current row is in colum 2
-        double item = ui.tableWidget->model()->itemData(ui.tableWidget->model()->index(current.row(),2)).value(Qt::DisplayRole).toInt();
-        plotCurrentIndex(item / m_tableModel->getTimeDivisor());
+        double timeStamp = 0.0;
+        if (m_tableModel->getTimestampForRow(m_tableModel->sourceRow(current.row()), timeStamp))
+        {
+            plotCurrentIndex(timeStamp);
+        }
     }
     else
     {
         plotCurrentIndex(index);
     }
 
-    m_tableModel->selectedRowChanged(m_tableFilterProxyModel->mapToSource(current),m_tableFilterProxyModel->mapToSource(previous));
+    m_tableModel->selectedRowChanged(current,previous);
 
     if (current.column() == 0 || current.column() == 1)
     {
@@ -689,9 +712,7 @@ void AP2DataPlot2D::showOnlyClicked()
         return;
     }
     QString itemtext = ui.tableWidget->model()->itemData(ui.tableWidget->model()->index(ui.tableWidget->selectionModel()->selectedIndexes().at(0).row(),1)).value(Qt::DisplayRole).toString();
-    m_tableFilterProxyModel->setFilterFixedString(itemtext);
-    m_tableFilterProxyModel->setFilterRole(Qt::DisplayRole);
-    m_tableFilterProxyModel->setFilterKeyColumn(1);
+    m_tableModel->setTypeFilter(QStringList() << itemtext);
     m_showOnlyActive = true;
 }
 
@@ -712,6 +733,7 @@ void AP2DataPlot2D::autoScrollClicked(bool checked)
             double difference = m_wideAxisRect->axis(QCPAxis::atBottom,0)->range().upper - m_wideAxisRect->axis(QCPAxis::atBottom,0)->range().lower;
             m_wideAxisRect->axis(QCPAxis::atBottom,0)->setRangeLower(msec_current - difference);
             m_wideAxisRect->axis(QCPAxis::atBottom,0)->setRangeUpper(msec_current);
+            m_replotPending = true;
         }
     }
 }
@@ -746,6 +768,33 @@ void AP2DataPlot2D::activeUASSet(UASInterface* uas)
     connect(m_uas,SIGNAL(disconnected()),this,SLOT(disconnected()));
     connected();
 
+    // Message fields are not signaled by the decoder any more, they are polled
+    // from the telemetry store. This has to run while hidden to record the history.
+    m_telemetryReader.setSystem(m_uas->getUASID());
+    if (!m_telemetryTimer)
+    {
+        m_telemetryTimer = new QTimer(this);
+        connect(m_telemetryTimer,SIGNAL(timeout()),this,SLOT(telemetryTimerTick()));
+        m_telemetryTimer->start(40);
+    }
+
+}
+
+void AP2DataPlot2D::telemetryTimerTick()
+{
+    if (!m_uas || m_logLoaded)
+    {
+        return;
+    }
+    m_telemetryChanges.clear();
+    m_telemetryReader.poll(m_telemetryChanges);
+    const TelemetryStore &store = m_telemetryReader.store();
+    for (int i = 0; i < m_telemetryChanges.size(); ++i)
+    {
+        const TelemetryStoreReader::Change &change = m_telemetryChanges.at(i);
+        updateValue(m_telemetryReader.system(), store.slotName(change.m_slot, change.m_component), store.slotType(change.m_slot),
+                    change.m_value.m_value, change.m_value.m_time, false);
+    }
 }
 
 void AP2DataPlot2D::connected()
@@ -809,6 +858,7 @@ void AP2DataPlot2D::navModeChanged(int uasid, int mode, const QString& text)
     int index = newmsec / 1000.0;
     m_graphClassMap["MODE"].messageMap[index] = text;
     plotTextArrow(index, text, "MODE", QColor(50,125,0), ui.modeDisplayCheckBox);
+    m_replotPending = true;
 
 }
 
@@ -826,86 +876,144 @@ void AP2DataPlot2D::updateValue(const int uasId, const QString& name, const QStr
         return;
     }
     QString propername  = name.mid(name.indexOf(":")+1);
-    if (!m_onlineValueMap.contains(propername))
+
+    qint64 msec_current = QDateTime::currentMSecsSinceEpoch();
+    m_currentIndex = msec_current;
+    qint64 newmsec = (msec_current - m_startIndex);// + m_timeDiff;
+
+    // The graphs are fed once per frame by updateTimerTick()
+    if (m_onlineHistory.append(propername, newmsec / 1000.0, value))
     {
         ui.dataSelectionScreen->addItem(propername);
+        if (integer)
+        {
+            m_integerSeries.insert(propername);
+        }
     }
+    m_onlineNewestKey = newmsec / 1000.0;
+    m_onlineSamplesPending = true;
+    compactOnlineHistory(m_onlineNewestKey);
+}
 
+void AP2DataPlot2D::updateTimerTick()
+{
+    if (m_onlineSamplesPending && !m_logLoaded)
+    {
+        flushOnlineSamples();
+    }
+    if (m_replotPending)
+    {
+        m_replotPending = false;
+        m_plot->replot();
+    }
+}
 
-    qint64 msec_current = QDateTime::currentMSecsSinceEpoch();
-    m_currentIndex = msec_current;
-    qint64 newmsec = (msec_current - m_startIndex);// + m_timeDiff;
+void AP2DataPlot2D::flushOnlineSamples()
+{
+    m_onlineSamplesPending = false;
     if (m_graphCount > 0 && ui.autoScrollCheckBox->isChecked())
     {
-        double diff = (newmsec / 1000.0) - m_wideAxisRect->axis(QCPAxis::atBottom,0)->range().upper;
-        m_wideAxisRect->axis(QCPAxis::atBottom,0)->setRangeLower(m_wideAxisRect->axis(QCPAxis::atBottom,0)->range().lower + diff);
-        m_wideAxisRect->axis(QCPAxis::atBottom,0)->setRangeUpper((newmsec / 1000.0));
+        QCPAxis *xAxis = m_wideAxisRect->axis(QCPAxis::atBottom,0);
+        double diff = m_onlineNewestKey - xAxis->range().upper;
+        if (diff != 0.0)
+        {
+            xAxis->setRange(xAxis->range().lower + diff, m_onlineNewestKey);
+            m_replotPending = true;
+        }
     }
 
-    if (m_graphClassMap.contains(propername))
+    QSet<QString> changedGroups;
+    for (QMap<QString,Graph>::iterator i = m_graphClassMap.begin(); i != m_graphClassMap.end(); ++i)
     {
-        m_graphClassMap[propername].axisIndex = newmsec / 1000.0;// + 18000000;
-        m_graphClassMap.value(propername).graph->addData(m_graphClassMap.value(propername).axisIndex,value);
-        m_scrollEndIndex = newmsec /  1000.0;
-        //ui.horizontalScrollBar->setMinimum(m_startIndex);
-        ui.horizontalScrollBar->setMaximum(m_scrollEndIndex);
-        //Set a timeout for 30 minutes from now, 1800 seconds.
-        qint64 current = QDateTime::currentMSecsSinceEpoch();
-        //This is 30 minutes
-        m_onlineValueTimeoutList.append(QPair<qint64,double>(current + 1800000,msec));
-        //This is 1 minute
-        //m_onlineValueTimeoutList.append(QPair<qint64,double>(current + 60000,m_currentIndex));
-        //if (m_onlineValueTimeoutList[0].first <= current)
-        //{
-          //  for (QMap<QString,Graph>::const_iterator i = m_graphClassMap.constBegin();i!=m_graphClassMap.constEnd();i++)
-           // {
-            //    i.value().graph->removeData(0,m_onlineValueTimeoutList[0].second);
-            //}
-            //m_onlineValueTimeoutList.removeAt(0);
-        //}
-        if (m_graphClassMap.value(propername).groupName != "" && m_graphClassMap.value(propername).groupName != "MANUAL")
+        Graph &graph = i.value();
+        m_onlineHistory.getSamplesAfter(i.key(), graph.axisIndex, m_frameKeys, m_frameValues);
+        if (m_frameKeys.isEmpty())
         {
-            //Current graph is in a group
-            if (!m_graphGroupRanges[m_graphClassMap.value(propername).groupName].contains(value))
+            continue;
+        }
+        graph.graph->addData(m_frameKeys, m_frameValues);
+        graph.axisIndex = m_frameKeys.last();
+        m_replotPending = true;
+
+        double min = m_frameValues.at(0);
+        double max = min;
+        for (int j = 1; j < m_frameValues.size(); ++j)
+        {
+            min = qMin(min, m_frameValues.at(j));
+            max = qMax(max, m_frameValues.at(j));
+        }
+
+        if (graph.groupName != "" && graph.groupName != "MANUAL")
+        {
+            //Current graph is in a group, expand the group range if out of scale
+            QCPRange &range = m_graphGroupRanges[graph.groupName];
+            if (!range.contains(min) || !range.contains(max))
             {
-                //It's out of scale for the group, expand it.
-                if (m_graphGroupRanges[m_graphClassMap.value(propername).groupName].lower > value)
-                {
-                    m_graphGroupRanges[m_graphClassMap.value(propername).groupName].lower = value;
-                }
-                else if (m_graphGroupRanges[m_graphClassMap.value(propername).groupName].upper < value)
-                {
-                    m_graphGroupRanges[m_graphClassMap.value(propername).groupName].upper = value;
-                }
-                for (int i=0;i<m_graphGrouping[m_graphClassMap.value(propername).groupName].size();i++)
-                {
-                    m_graphClassMap.value(m_graphGrouping[m_graphClassMap.value(propername).groupName][i]).axis->setRange(m_graphGroupRanges[m_graphClassMap.value(propername).groupName]);
-                }
-                if (m_axisGroupingDialog)
-                {
-                    m_axisGroupingDialog->updateAxis(propername,m_graphClassMap.value(propername).axis->range().lower,m_graphClassMap.value(propername).axis->range().upper);
-                }
+                range.lower = qMin(range.lower, min);
+                range.upper = qMax(range.upper, max);
+                changedGroups.insert(graph.groupName);
             }
         }
-        else if (!m_graphClassMap.value(propername).graph->keyAxis()->range().contains(value) && !m_graphClassMap.value(propername).isManualRange)
+        else if ((!graph.axis->range().contains(min) || !graph.axis->range().contains(max)) && !graph.isManualRange)
         {
-            m_graphClassMap.value(propername).graph->rescaleValueAxis();
+            graph.graph->rescaleValueAxis();
             if (m_axisGroupingDialog)
             {
-                m_axisGroupingDialog->updateAxis(propername,m_graphClassMap.value(propername).axis->range().lower,m_graphClassMap.value(propername).axis->range().upper);
+                m_axisGroupingDialog->updateAxis(i.key(),graph.axis->range().lower,graph.axis->range().upper);
             }
         }
-        //Harrisonheli
-        m_graphClassMap.value(propername).axis->setNumberPrecision(3);
-        m_graphClassMap.value(propername).axis->setNumberFormat("f");
+    }
 
-        if (integer)
+    // Ranges of groups are applied once per frame no matter how many samples expanded them
+    foreach (const QString &groupName, changedGroups)
+    {
+        const QList<QString> &members = m_graphGrouping[groupName];
+        for (int i=0;i<members.size();i++)
         {
-            m_graphClassMap.value(propername).axis->setNumberPrecision(0);
+            m_graphClassMap.value(members[i]).axis->setRange(m_graphGroupRanges[groupName]);
+            if (m_axisGroupingDialog)
+            {
+                m_axisGroupingDialog->updateAxis(members[i],m_graphGroupRanges[groupName].lower,m_graphGroupRanges[groupName].upper);
+            }
         }
+    }
 
+    if (m_scrollEndIndex != static_cast<qint64>(m_onlineNewestKey))
+    {
+        m_scrollEndIndex = m_onlineNewestKey;
+        ui.horizontalScrollBar->setMaximum(m_scrollEndIndex);
+    }
+}
+
+void AP2DataPlot2D::compactOnlineHistory(const double now)
+{
+    QList<AP2DataPlotOnlineHistory::Change> changes;
+    m_onlineHistory.compact(now, changes);
+    foreach (const AP2DataPlotOnlineHistory::Change &change, changes)
+    {
+        if (!m_graphClassMap.contains(change.m_name))
+        {
+            continue;
+        }
+        // Samples behind the last one fed to the graph are added by the next frame
+        const Graph &graph = m_graphClassMap[change.m_name];
+        if (change.m_from > graph.axisIndex)
+        {
+            continue;
+        }
+        // removeData(from, to) keeps the sample at 'from'
+        const double to = qMin(change.m_to, graph.axisIndex);
+        graph.graph->removeData(change.m_from);
+        graph.graph->removeData(change.m_from, to);
+        foreach (const AP2DataPlotOnlineHistory::Sample &sample, change.m_samples)
+        {
+            if (sample.m_key <= to)
+            {
+                graph.graph->addData(sample.m_key, sample.m_value);
+            }
+        }
+        m_replotPending = true;
     }
-    m_onlineValueMap[propername].append(QPair<double,double>(newmsec / 1000.0,value));
 }
 
 void AP2DataPlot2D::valueChanged(const int uasId, const QString& name, const QString& unit, const QVariant& value,const quint64 msec)
@@ -959,6 +1067,7 @@ void AP2DataPlot2D::loadDialogAccepted()
 void AP2DataPlot2D::loadLog(QString filename)
 {
     m_logLoaded = true;
+    m_seriesPyramids.clear();
     for (int i=0;i<m_graphNameList.size();i++)
     {
         m_wideAxisRect->removeAxis(m_graphClassMap.value(m_graphNameList[i]).axis);
@@ -1019,6 +1128,14 @@ AP2DataPlot2D::~AP2DataPlot2D()
         m_logLoaderThread->deleteLater();
         m_logLoaderThread = NULL;
     }
+    if (m_exportThread)
+    {
+        // The export reads the model so it has to end before the model is deleted
+        m_exportThread->stopExport();
+        m_exportThread->wait();
+        delete m_exportThread;
+        m_exportThread = NULL;
+    }
     if (m_axisGroupingDialog)
     {
         m_axisGroupingDialog->close();
@@ -1039,43 +1156,17 @@ void AP2DataPlot2D::itemEnabled(QString name)
 {
     if (m_logLoaded)
     {
-        QString parent = name.split(".")[0];
-        QString child = name.split(".")[1];
-        bool isstr = false;
-        QList<QPair<double,QString> > strlist;
-        QVector<double> xlist;
-        QVector<double> ylist;
-        QMap<double,QVariant> values = m_tableModel->getValues(parent, child, m_useTimeOnX);
-        if (values.size() == 0)
+        const AP2DataPlot2DModel::Series series = m_tableModel->getSeries(QStringList() << name, m_useTimeOnX).first();
+        if (series.m_x.isEmpty())
         {
             //No values!
             m_graphCount++; //Prevent crash when it tries to disable
             ui.dataSelectionScreen->disableItem(name);
             return;
         }
-        for (QMap<double,QVariant>::const_iterator i = values.constBegin();i!=values.constEnd();i++)
-        {
-            if (i.value().type() == QVariant::String)
-            {
-                QString graphvaluestr = i.value().toString();
-                strlist.append(QPair<double,QString>(i.key(),graphvaluestr));
-                isstr = true;
-            }
-            else
-            {
-                double graphvalue = i.value().toDouble();
-                ylist.append(graphvalue);
-            }
-            if(m_useTimeOnX)
-            {
-                xlist.append(static_cast<double>(i.key()));
-            }
-            else
-            {
-                xlist.append(i.key());
-            }
-
-        }
+        const bool isstr = series.m_isText;
+        QVector<double> xlist = series.m_x;
+        QVector<double> ylist = series.m_y;
         QCPAxis *yAxis = m_wideAxisRect->addAxis(QCPAxis::atLeft);
         yAxis->setLabel(name);
         yAxis->setNumberFormat("gb");
@@ -1095,15 +1186,14 @@ void AP2DataPlot2D::itemEnabled(QString name)
         Graph graph;
         graph.axis = yAxis;
         graph.graph=  mainGraph1;
-        m_graphClassMap[name] = graph;
         if (isstr)
         {
-            for (int i=0;i<strlist.size();i++)
+            for (int i=0;i<series.m_text.size();i++)
             {
                 QCPItemText *itemtext = new QCPItemText(m_plot);
-                itemtext->setText(strlist.at(i).second);
+                itemtext->setText(series.m_text.at(i));
                 itemtext->position->setAxes(xAxis,yAxis);
-                itemtext->position->setCoords(strlist.at(i).first,2.0);
+                itemtext->position->setCoords(series.m_x.at(i),2.0);
                 m_plot->addItem(itemtext);
                 graph.itemList.append(itemtext);
 
@@ -1113,7 +1203,7 @@ void AP2DataPlot2D::itemEnabled(QString name)
                 itemline->start->setAxes(xAxis, yAxis);
                 itemline->start->setCoords(0.0, 0.0);
                 itemline->end->setAxes(xAxis, yAxis);
-                itemline->end->setCoords(strlist.at(i).first, 0.0);
+                itemline->end->setCoords(series.m_x.at(i), 0.0);
                 itemline->setTail(QCPLineEnding::esDisc);
                 itemline->setHead(QCPLineEnding::esSpikeArrow);
                 m_plot->addItem(itemline);
@@ -1122,8 +1212,20 @@ void AP2DataPlot2D::itemEnabled(QString name)
         }
         else
         {
+            QSharedPointer<AP2DataPlotSeriesPyramid> pyramid = m_seriesPyramids.value(name);
+            if (!pyramid)
+            {
+                pyramid = QSharedPointer<AP2DataPlotSeriesPyramid>(new AP2DataPlotSeriesPyramid());
+                pyramid->build(xlist, ylist);
+                m_seriesPyramids.insert(name, pyramid);
+            }
+            graph.pyramid = pyramid;
+            const QCPRange range = xAxis->range();
+            pyramid->visibleData(range.lower, range.upper, m_plot->width(), xlist, ylist);
             mainGraph1->setData(xlist, ylist);
         }
+        m_graphClassMap[name] = graph;
+        // The points cover the whole series, so the value range is complete
         mainGraph1->rescaleValueAxis();
 
         if (m_axisGroupingDialog)
@@ -1161,27 +1263,11 @@ void AP2DataPlot2D::itemEnabled(QString name)
     } //if (m_logLoaded)
     else
     {
-        if (m_onlineValueMap.contains(name))
+        if (m_onlineHistory.contains(name))
         {
             QVector<double> xlist;
             QVector<double> ylist;
-
-            float min = m_onlineValueMap[name][0].second;
-            float max = m_onlineValueMap[name][0].second;
-            for (int j=0;j<m_onlineValueMap[name].size();j++)
-            {
-                xlist.append(m_onlineValueMap[name][j].first);
-                double val = m_onlineValueMap[name][j].second;
-                if (val > max)
-                {
-                    max = val;
-                }
-                if (val < min)
-                {
-                    min = val;
-                }
-                ylist.append(val);
-            }
+            m_onlineHistory.getSeries(name, xlist, ylist);
             QCPAxis *axis = m_wideAxisRect->addAxis(QCPAxis::atLeft);
             axis->setLabel(name);
             QColor color = QColor::fromRgb(rand()%255,rand()%255,rand()%255);
@@ -1211,9 +1297,13 @@ void AP2DataPlot2D::itemEnabled(QString name)
             Graph graph;
             graph.axis = axis;
             graph.graph=  mainGraph1;
+            graph.axisIndex = xlist.isEmpty() ? -1.0 : xlist.last();
             m_graphClassMap[name] = graph;
 
+            axis->setNumberFormat("f");
+            axis->setNumberPrecision(m_integerSeries.contains(name) ? 0 : 3);
             mainGraph1->setPen(QPen(color, 1));
+            m_replotPending = true;
         }
     }
 }
@@ -1251,6 +1341,7 @@ void AP2DataPlot2D::itemDisabled(QString name)
         {
             m_axisGroupingDialog->removeAxis(name);
         }
+        m_replotPending = true;
     }
 }
 
@@ -1281,6 +1372,7 @@ void AP2DataPlot2D::clearGraph()
     {
         //Unload the log.
         m_logLoaded = false;
+        m_seriesPyramids.clear();
         ui.loadOfflineLogButton->setText("Open Log");
         ui.hideExcelView->setVisible(false);
         ui.hideExcelView->setChecked(false);
@@ -1292,7 +1384,9 @@ void AP2DataPlot2D::clearGraph()
     }
     m_currentIndex = QDateTime::currentMSecsSinceEpoch();
     m_startIndex = m_currentIndex;
-    m_onlineValueMap.clear();
+    m_onlineHistory.clear();
+    m_integerSeries.clear();
+    m_onlineSamplesPending = false;
     m_plot->replot();
 }
 
@@ -1355,6 +1449,7 @@ void AP2DataPlot2D::plotTextArrow(double index, const QString &text, const QStri
         itemtext->setVisible(false);
         itemline->setVisible(false);
     }
+    m_replotPending = true;
 }
 
 
@@ -1367,6 +1462,7 @@ void AP2DataPlot2D::removeTextArrows(const QString &graphName)
             m_plot->removeItem(ptr);
         }
         m_graphClassMap[graphName].itemList.clear();
+        m_replotPending = true;
     }
 }
 
@@ -1475,9 +1571,7 @@ void AP2DataPlot2D::threadDone(AP2DataPlotStatus state, MAV_TYPE type)
     ui.verticalScrollBar->setValue(ui.verticalScrollBar->maximum());
 
     // Set up proxy for table filtering
-    m_tableFilterProxyModel = new QSortFilterProxyModel(this);
-    m_tableFilterProxyModel->setSourceModel(m_tableModel);
-    ui.tableWidget->setModel(m_tableFilterProxyModel);
+    ui.tableWidget->setModel(m_tableModel);
     connect(ui.tableWidget->selectionModel(),SIGNAL(currentChanged(QModelIndex,QModelIndex)),this,SLOT(selectedRowChanged(QModelIndex,QModelIndex)));
 
     m_progressDialog->hide();
@@ -1576,7 +1670,15 @@ void AP2DataPlot2D::exportButtonClicked()
     QString exportFilename = m_filename.replace(".bin",exportExtension, Qt::CaseInsensitive); // remove extension
     QFileDialog *dialog = new QFileDialog(this,"Save Log File",QGC::logDirectory());
     dialog->setAcceptMode(QFileDialog::AcceptSave);
-    dialog->setNameFilter("*" + exportExtension);
+    if (m_KmlExport)
+    {
+        dialog->setNameFilter("*" + exportExtension);
+    }
+    else
+    {
+        // Besides the log format the loaded data can be exported into a sqlite database
+        dialog->setNameFilters(QStringList() << "*" + exportExtension << "*.sqlite");
+    }
     dialog->selectFile(exportFilename);
     QLOG_DEBUG() << " Suggested Export Filename: " << exportFilename;
     dialog->open(this,SLOT(exportDialogAccepted()));
@@ -1597,101 +1699,80 @@ void AP2DataPlot2D::exportDialogAccepted()
     }
     QString outputFileName = dialog->selectedFiles().at(0);
     dialog->close();
-
-    QFile outputfile;
-    kml::KMLCreator kmlExporter;
-
-    if (m_KmlExport)
+    if (m_exportThread)
     {
-
-        kmlExporter.start(outputFileName);
+        QMessageBox::information(this,"Error","An export is already running");
+        return;
     }
-    else
+
+    if (!m_KmlExport && outputFileName.endsWith(".sqlite", Qt::CaseInsensitive))
     {
-        outputfile.setFileName(outputFileName);
-        if (!outputfile.open(QIODevice::ReadWrite | QIODevice::Truncate))
+        QFile::remove(outputFileName);
+        if (!m_tableModel->exportToDatabase(outputFileName))
         {
-            QMessageBox::information(this,"Error","Unable to open output file: " + outputfile.errorString());
-            return;
+            QMessageBox::information(this,"Error","Unable to export database: " + m_tableModel->getError());
         }
+        QLOG_DEBUG() << "Database export took " << timer1.elapsed() << "ms";
+        return;
     }
 
-    QProgressDialog *progressDialog = new QProgressDialog("Exporting File","Cancel",0,100,this);
-    progressDialog->setWindowModality(Qt::WindowModal);
-    progressDialog->show();
-    QApplication::processEvents();
+    // The rows are formatted and written in the background
+    m_exportThread = new AP2DataPlotExportThread(m_tableModel);
+    connect(m_exportThread,SIGNAL(exportProgress(qint64,qint64)),this,SLOT(exportProgress(qint64,qint64)));
+    connect(m_exportThread,SIGNAL(done(QString)),this,SLOT(exportDone(QString)));
+    connect(m_exportThread,SIGNAL(error(QString)),this,SLOT(exportError(QString)));
+    connect(m_exportThread,SIGNAL(canceled()),this,SLOT(exportCanceled()));
+    connect(m_exportThread,SIGNAL(finished()),this,SLOT(exportThreadTerminated()));
 
-    QString formatheader = "FMT, 128, 89, FMT, BBnNZ, Type,Length,Name,Format,Columns\r\n";
-    QMap<QString,QList<QString> > fmtlist = m_tableModel->getFmtValues();
-    for (QMap<QString,QList<QString> >::const_iterator i = fmtlist.constBegin();i!=fmtlist.constEnd();i++)
+    m_exportProgressDialog = new QProgressDialog("Exporting File","Cancel",0,100,this);
+    m_exportProgressDialog->setWindowModality(Qt::WindowModal);
+    connect(m_exportProgressDialog,SIGNAL(canceled()),m_exportThread,SLOT(stopExport()));
+    m_exportProgressDialog->show();
+
+    m_exportThread->exportFile(outputFileName, m_KmlExport ? AP2DataPlotExportThread::KmlFormat
+                                                           : AP2DataPlotExportThread::LogFormat);
+}
+
+void AP2DataPlot2D::exportProgress(qint64 pos, qint64 size)
+{
+    if (m_exportProgressDialog && (size > 0))
     {
-        QString fmtname = i.key();
-        QString line = m_tableModel->getFmtLine(fmtname);
-        if (line != "")
-        {
-            formatheader += line + "\r\n";
-        }
+        m_exportProgressDialog->setValue(100.0 * ((double)pos / (double)size));
     }
+}
+
+void AP2DataPlot2D::exportDone(QString fileName)
+{
     if (m_KmlExport)
     {
-        kmlExporter.processLine(formatheader);
-    }
-    else
-    {
-        outputfile.write(formatheader.toLatin1());
+        QString msg = QString("Generated %1.").arg(fileName);
+        QMessageBox::information(this, "Log to KML", msg);
     }
+}
 
-    for (int i=0;i<m_tableModel->rowCount();i++)
-    {
-        int j=1;
-        QVariant val = m_tableModel->data(m_tableModel->index(i,j++));
-        QString line = val.toString();
-        val = m_tableModel->data(m_tableModel->index(i,j++));
-        while (!val.isNull())
-        {
-            line += ", " + val.toString();
-            val = m_tableModel->data(m_tableModel->index(i,j++));
-        }
-        if (m_KmlExport)
-        {
-            kmlExporter.processLine(line.append("\r\n"));
-        }
-        else
-        {
-            outputfile.write(line.append("\r\n").toLatin1());
-        }
-        if (i % 5)
-        {
-            progressDialog->setValue(100.0 * ((double)i / (double)m_tableModel->rowCount()));
-        }
-        QApplication::processEvents();
-        if (progressDialog->wasCanceled())
-        {
-            outputfile.close();
-            progressDialog->hide();
-            progressDialog->deleteLater();
-            progressDialog=NULL;
-            QMessageBox::information(0,"Warning","Export was canceled");
-            return;
-        }
-    }
+void AP2DataPlot2D::exportError(QString errorstr)
+{
+    QMessageBox::information(this,"Error",errorstr);
+}
 
-    if (m_KmlExport)
-    {
-        QString generated = kmlExporter.finish(true);
+void AP2DataPlot2D::exportCanceled()
+{
+    QMessageBox::information(0,"Warning","Export was canceled");
+}
 
-        QString msg = QString("Generated %1.").arg(generated);
-        QMessageBox::information(this, "Log to KML", msg);
+void AP2DataPlot2D::exportThreadTerminated()
+{
+    if (m_exportProgressDialog)
+    {
+        m_exportProgressDialog->hide();
+        m_exportProgressDialog->deleteLater();
+        m_exportProgressDialog = NULL;
     }
-    else
+    if (m_exportThread)
     {
-        outputfile.close();
+        m_exportThread->deleteLater();
+        m_exportThread = NULL;
     }
-    progressDialog->hide();
-    progressDialog->deleteLater();
-    progressDialog=NULL;
-
-    QLOG_DEBUG() << "Log export took " << timer1.elapsed() << "ms";
 }
 
 void AP2DataPlot2D::modeCheckBoxClicked(bool checked)
@@ -1724,6 +1805,7 @@ void AP2DataPlot2D::hideShowTextArrows(bool checked, const QString &type)
     {
         m_graphClassMap[type].itemList.at(i)->setVisible(checked);
     }
+    m_replotPending = true;
 }
 
 void AP2DataPlot2D::indexTypeCheckBoxClicked(bool checked)
@@ -1731,6 +1813,8 @@ void AP2DataPlot2D::indexTypeCheckBoxClicked(bool checked)
     if (m_useTimeOnX != checked)
     {
         m_useTimeOnX = checked;
+        // The detail levels were built using the old x axis
+        m_seriesPyramids.clear();
         // We have to remove all graphs when changing x-axis storing the active selection
         QList<QString> reEnableList = ui.dataSelectionScreen->disableAllItems();
 
@@ -1789,26 +1873,15 @@ void AP2DataPlot2D::sortItemChanged(QTreeWidgetItem* item,int col)
 }
 void AP2DataPlot2D::sortAcceptClicked()
 {
-    QString sortstring = "";
     // All elements selected -> filter is disabled
     if (ui.sortSelectTreeWidget->topLevelItemCount() == m_tableFilterList.size())
     {
         disableTableFilter();
         m_showOnlyActive = false;
     }
-    // one or more elements selected -> RegEx must be used
     else
     {
-        // It is VERY important to disable the filtering prior to set up a new one
-        // If this is not done the regex filter gets terribly slow!!!
-        disableTableFilter();
-        for (int i=0;i<m_tableFilterList.size();i++)
-        {
-            sortstring += m_tableFilterList.at(i) + ((i == m_tableFilterList.size()-1) ? "" : "|");
-        }
-        m_tableFilterProxyModel->setFilterRegExp(sortstring);
-        m_tableFilterProxyModel->setFilterRole(Qt::DisplayRole);
-        m_tableFilterProxyModel->setFilterKeyColumn(1);
+        m_tableModel->setTypeFilter(m_tableFilterList);
     }
 
     ui.tableSortGroupBox->setVisible(false);
@@ -1906,12 +1979,7 @@ void AP2DataPlot2D::logToKmlClicked()
 
 void AP2DataPlot2D::disableTableFilter()
 {
-    // The order of the statements is important to be fast on huge logs (15MB)
-    // It does not really disable the filter but sets the rules to get a fast
-    // result without any filtering
-    m_tableFilterProxyModel->setFilterKeyColumn(0);
-    m_tableFilterProxyModel->setFilterRole(Qt::DisplayRole);
-    m_tableFilterProxyModel->setFilterFixedString("");
+    m_tableModel->setTypeFilter(QStringList());
 }
 
 
@@ -1944,7 +2012,7 @@ void AP2DataPlot2D::plotCurrentIndex(double index)
     QLOG_DEBUG() << index;
     m_timeLine->start->setCoords(index, 999999);
     m_timeLine->end->setCoords(index, -999999);
-    //m_plot->replot();
+    m_replotPending = true;
 }
 
 void AP2DataPlot2D::insertCurrentIndex()
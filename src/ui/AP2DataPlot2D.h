@@ -32,18 +32,22 @@ This file is part of the APM_PLANNER project
 
 #include "UASInterface.h"
 #include "MAVLinkDecoder.h"
+#include "TelemetryStore.h"
 #include "kmlcreator.h"
 #include "qcustomplot.h"
 
 #include "AP2DataPlotThread.h"
+#include "AP2DataPlotExportThread.h"
 #include "dataselectionscreen.h"
 #include "AP2DataPlotAxisDialog.h"
 #include "AP2DataPlot2DModel.h"
+#include "AP2DataPlotSeriesPyramid.h"
+#include "AP2DataPlotOnlineHistory.h"
 #include "ui_AP2DataPlot2D.h"
 
 #include <QWidget>
 #include <QProgressDialog>
-#include <QSortFilterProxyModel>
+#include <QSet>
 #include <QTextBrowser>
 #include <QSqlDatabase>
 #include <QStandardItemModel>
@@ -107,6 +111,10 @@ private slots:
     //Called by every valueChanged function to actually save the value/graph it.
     void updateValue(const int uasId, const QString& name, const QString& unit, const double value, const quint64 msec,bool integer = true);
 
+    //Polls all message fields changed since the last call from the telemetry store
+    void telemetryTimerTick();
+    void updateTimerTick();
+
     void navModeChanged(int uasid, int mode, const QString& text);
 
     void autoScrollClicked(bool checked);
@@ -121,12 +129,19 @@ private slots:
     void horizontalScrollMoved(int value);
     void verticalScrollMoved(int value);
     void xAxisChanged(QCPRange range);
+    //Feeds the graphs of a loaded log with the points needed for the visible range
+    void updateGraphDetail(QCPRange range);
     void replyTLogButtonClicked();
 
     void exportLogClicked();
     void exportKmlClicked();
     void exportButtonClicked();
     void exportDialogAccepted();
+    void exportProgress(qint64 pos, qint64 size);
+    void exportDone(QString fileName);
+    void exportError(QString errorstr);
+    void exportCanceled();
+    void exportThreadTerminated();
 
     void graphGroupingChanged(QList<AP2DataPlotAxisDialog::GraphRange> graphRangeList);
     void graphColorsChanged(QMap<QString,QColor> colormap);
@@ -153,7 +168,6 @@ private:
     void showEvent(QShowEvent *evt);
     void hideEvent(QHideEvent *evt);
     AP2DataPlot2DModel *m_tableModel;
-    QSortFilterProxyModel *m_tableFilterProxyModel;
     QList<QString> m_tableFilterList;
     int getStatusTextPos();
     void plotTextArrow(double index, const QString& text, const QString& graph, const QColor& color, QCheckBox *checkBox = NULL);
@@ -168,7 +182,7 @@ private:
     void hideShowTextArrows(bool show, const QString &graphName);
 
     /**
-     * @brief This method disables the filtering of m_tableFilterProxyModel
+     * @brief This method disables the type filter of m_tableModel
      *        After a call the table model will show all rows again.
      */
     void disableTableFilter();
@@ -204,6 +218,21 @@ private:
      */
     void plotCurrentIndex(double index);
 
+    /**
+     * @brief compactOnlineHistory applies the retention policy of the online
+     *        history and updates the graphs of all compacted or dropped samples.
+     *
+     * @param now - key of the newest sample
+     */
+    void compactOnlineHistory(const double now);
+
+    /**
+     * @brief flushOnlineSamples feeds all online samples received since the last
+     *        frame to the enabled graphs, scrolls the x axis and rescales each
+     *        value axis and axis group once.
+     */
+    void flushOnlineSamples();
+
 
 private:
     Ui::AP2DataPlot2D ui;
@@ -215,11 +244,12 @@ private:
         bool isManualRange;
         QString groupName;
         bool isInGroup;
-        double axisIndex;
+        double axisIndex;   /// In online mode key of the last sample fed to the graph
         QCPAxis *axis;
         QCPGraph *graph;
         QList<QCPAbstractItem*> itemList;
         QMap<double,QString> messageMap;
+        QSharedPointer<AP2DataPlotSeriesPyramid> pyramid; /// All samples of a log series, NULL in online mode
 
         Graph() : isManualRange(false), isInGroup(false), axisIndex(0), axis(NULL), graph(NULL){}
     };
@@ -233,8 +263,10 @@ private:
     QMap<QString,QCPRange> m_graphGroupRanges;
     //Map from the spreadsheet view row name (ATT,GPS,etc), to the header names (roll,pitch,yaw or long,lat,alt)
     QMap<QString,QString> m_tableHeaderNameMap;
-    //Graph name to list of values for "online" mode
-    QMap<QString,QList<QPair<double,double> > > m_onlineValueMap;
+    //Graph name to list of values for "online" mode, bounded by its retention policy
+    AP2DataPlotOnlineHistory m_onlineHistory;
+    //Map from graph name to the samples of a loaded log, built once per series
+    QHash<QString,QSharedPointer<AP2DataPlotSeriesPyramid> > m_seriesPyramids;
     //Map from graph name to list of values for "offline" mode
     QMap<QString,QList<QPair<int,QVariantMap> > > m_dataList;
     QList<QString> loglines;
@@ -243,8 +275,6 @@ private:
 
     QList<QWidget*> m_childGraphList;
 
-    QList<QPair<qint64,double> > m_onlineValueTimeoutList;
-
     //List of graph names, used in m_axisList, m_graphMap,m_graphToGroupMap and the like as the graph name
     QList<QString> m_graphNameList;
     int m_graphCount;
@@ -257,6 +287,9 @@ private:
     qint64 m_startIndex; //epoch msecs since graphing started
     QAction *m_addGraphAction;
     UASInterface *m_uas;
+    QTimer *m_telemetryTimer;           /// Polls the telemetry store while a UAS is active
+    TelemetryStoreReader m_telemetryReader;
+    QVector<TelemetryStoreReader::Change> m_telemetryChanges;
     QSharedPointer<QProgressDialog> m_progressDialog;
     AP2DataPlotAxisDialog *m_axisGroupingDialog;
     //qint64 m_timeDiff;
@@ -279,6 +312,15 @@ private:
     QMap<quint64, MessageBase::Ptr> m_indexToMessageMap;    /// Map holding all Messages which are printed as arrows
     int m_lastHorizontalScrollerVal;                        /// Used to avoid multiple calls with same value
     bool m_KmlExport;                                       /// True if exporting to Kml
+    AP2DataPlotExportThread *m_exportThread;                /// Running log export, NULL if none
+    QProgressDialog *m_exportProgressDialog;                /// Progress of the running log export
+
+    bool m_replotPending;                                   /// True if the plot changed since the last frame
+    bool m_onlineSamplesPending;                            /// True if online samples arrived since the last frame
+    double m_onlineNewestKey;                               /// Key of the newest online sample
+    QSet<QString> m_integerSeries;                          /// Online series delivering integer values
+    QVector<double> m_frameKeys;                            /// Keys fed to a graph in the current frame
+    QVector<double> m_frameValues;                          /// Values fed to a graph in the current frame
 
 };
 
@@ -35,10 +35,45 @@ This file is part of the APM_PLANNER project
 #include <QSqlError>
 #include <QUuid>
 #include <QsLog.h>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Number of rows materialised at once for the table view
+    const int ROW_BLOCK_SIZE = 256;
+
+    // Type of the QSqlField holding the values of a column
+    QVariant::Type fieldType(const AP2DataPlotColumn::Kind kind)
+    {
+        switch (kind)
+        {
+        case AP2DataPlotColumn::Int32Kind:
+            return QVariant::Int;
+        case AP2DataPlotColumn::UInt32Kind:
+            return QVariant::UInt;
+        case AP2DataPlotColumn::Int64Kind:
+            return QVariant::LongLong;
+        case AP2DataPlotColumn::UInt64Kind:
+            return QVariant::ULongLong;
+        case AP2DataPlotColumn::FloatKind:
+        case AP2DataPlotColumn::DoubleKind:
+            return QVariant::Double;
+        case AP2DataPlotColumn::TextKind:
+            return QVariant::String;
+        }
+        return QVariant::Double;
+    }
+}
 
 /*
- * This model holds everything in memory in a sqlite database.
- * There are two system tables, then unlimited number of message tables.
+ * This model holds everything in memory in an AP2DataPlotColumnStore.
+ * For every message type (defined by a FMT message) a table is created which
+ * holds one typed column per message field. A global row index keeps the order
+ * of all rows as they were read from the log. See AP2DataPlotColumnStore.h
+ *
+ * The data can be exported into a sqlite database using exportToDatabase().
+ * The database has two system tables, then unlimited number of message tables.
  *
  * System Tables:
  *
@@ -63,118 +98,53 @@ This file is part of the APM_PLANNER project
 
 AP2DataPlot2DModel::AP2DataPlot2DModel(QObject *parent) :
     QAbstractTableModel(parent),
-    m_databaseName(QUuid::createUuid().toString()),
     m_allRowsHaveTime(false),
     m_canUseTimeOnX(false),
     m_minTime(0),
     m_maxTime(0),
+    m_tsScaleDivisor(1.0),
     m_rowCount(0),
     m_columnCount(0),
+    m_filterActive(false),
+    m_nextRowBlock(0),
     m_currentRow(0),
     m_fmtIndex(0),
     m_firstIndex(0),
     m_lastIndex(0)
 {
-    m_sharedDb = QSqlDatabase::addDatabase("QSQLITE",m_databaseName);
-    m_sharedDb.setDatabaseName(":memory:");
-
-    //  Open DB and start transaction
-    if (!m_sharedDb.open())
-    {
-        setError("Error opening shared database " + m_sharedDb.lastError().text());
-        return;
-    }
-    if (!m_sharedDb.transaction())
-    {
-        setError("Unable to start database transaction "  + m_sharedDb.lastError().text());
-        return;
-    }
-
-    // Create FMT Table and prepare insert query
-    if (!createFMTTable())
-    {
-        return; //Error already emitted.
-    }
-    m_fmtInsertQuery = queryPtr(new QSqlQuery(m_sharedDb));
-    if (!createFMTInsert(m_fmtInsertQuery))
-    {
-        return;  //Error already emitted.
-    }
-
-    // Create index table and prepare insert query
-    if (!createIndexTable())
-    {
-        return;   //Error already emitted.
-    }
-    m_indexinsertquery = queryPtr(new QSqlQuery(m_sharedDb));
-    if (!createIndexInsert(m_indexinsertquery))
-    {
-        return;  //Error already emitted.
-    }
-
-    if (!m_sharedDb.commit())
-    {
-        setError("Unable to commit database transaction "  + m_sharedDb.lastError().text());
-        return;
-    }
 }
 
 AP2DataPlot2DModel::~AP2DataPlot2DModel()
 {
-    QSqlDatabase::removeDatabase(m_databaseName);
 }
 
 QMap<QString,QList<QString> > AP2DataPlot2DModel::getFmtValues()
 {
     QMap<QString,QList<QString> > retval;
-    QSqlQuery fmtquery(m_sharedDb);
-    fmtquery.prepare("SELECT * FROM 'FMT';");
-    fmtquery.exec();
-    while (fmtquery.next())
+    for (int i = 0; i < m_store.tableCount(); ++i)
     {
-        QSqlRecord record = fmtquery.record();
-        QString name = record.value(3).toString();
-        QSqlQuery indexquery(m_sharedDb);
-        if (!indexquery.prepare("SELECT * FROM 'INDEX' WHERE value = '" + name + "';"))
-        {
-            continue;
-        }
-        if (!indexquery.exec())
-        {
-            continue;
-        }
-        if (!indexquery.next())
+        const AP2DataPlotTable &table = m_store.table(i);
+        if (table.rowCount() == 0)
         {
             //No records
             continue;
         }
-        if (!m_headerStringList.contains(name))
+        if (!m_headerStringList.contains(table.m_name))
         {
             continue;
         }
-        retval.insert(name,QList<QString>());
-        for (int i=0;i<m_headerStringList[name].size();i++)
-        {
-            retval[name].append(m_headerStringList[name].at(i));
-        }
+        retval.insert(table.m_name, m_headerStringList.value(table.m_name));
     }
     return retval;
 }
 QString AP2DataPlot2DModel::getFmtLine(const QString& name)
 {
-    QSqlQuery fmtquery(m_sharedDb);
-    fmtquery.prepare("SELECT * FROM 'FMT' WHERE name = '" + name + "';");
-    if (!fmtquery.exec())
-    {
-        //QMessageBox::information(0,"Error","Error selecting from table 'FMT' " + m_sharedDb.lastError().text());
-        //return;
-    }
-    if (fmtquery.next())
+    int tableID = m_store.tableID(name);
+    if (tableID >= 0)
     {
-        QSqlRecord record = fmtquery.record();
-        QString name = record.value(3).toString();
-        QString vars = record.value(5).toString();
-        QString format = record.value(4).toString();
+        const AP2DataPlotTable &table = m_store.table(tableID);
+        QString vars = table.m_labels.join(",");
+        QString format = table.m_format;
         int size = 0;
         for (int i=0;i<format.size();i++)
         {
@@ -217,7 +187,7 @@ QString AP2DataPlot2DModel::getFmtLine(const QString& name)
                 QLOG_DEBUG() << "Unknown format character (" << format.at(i).toLatin1() << "); export will be bad";
             }
         }
-        QString formatline = "FMT, " + QString::number(record.value(1).toInt()) + ", " + QString::number(size+3) + ", " + name + ", " + format + ", " + vars;
+        QString formatline = "FMT, " + QString::number(table.m_typeID) + ", " + QString::number(size+3) + ", " + name + ", " + format + ", " + vars;
         return formatline;
     }
     return "";
@@ -225,27 +195,39 @@ QString AP2DataPlot2DModel::getFmtLine(const QString& name)
 
 void AP2DataPlot2DModel::getMessagesOfType(const QString &type, QMap<quint64, MessageBase::Ptr> &indexToMessageMap)
 {
-    QSqlQuery query(m_sharedDb);
-    query.prepare("SELECT * FROM '" + type + "';");
-    if (query.exec())
+    int tableID = m_store.tableID(type);
+    if (tableID < 0)
     {
-        while (query.next())
-        {
-            MessageBase::Ptr p_msg = MessageFactory::getMessageOfType(type, m_timeStampColumName);
-            QSqlRecord record = query.record();
+        //no data for this type
+        QLOG_DEBUG() << "Graph loaded with no table of type " << type << ". This is strange!";
+        return;
+    }
 
-            if (!p_msg->setFromSqlRecord(record, m_tsScaleDivisor))
-            {
-                QLOG_DEBUG() << "Not all data could be read from SQL-Record. Schema mismatch?! "
-                             << "The data of type " << type << " might be corrupted.";
-            }
-            indexToMessageMap.insert(p_msg->getIndex(), p_msg);
-        }
+    // The messages are able to read a QSqlRecord so we build one for every row
+    // using the same layout as the sqlite export: idx followed by all fields.
+    const AP2DataPlotTable &table = m_store.table(tableID);
+    QSqlRecord record;
+    record.append(QSqlField("idx", QVariant::ULongLong));
+    for (int i = 0; i < table.m_labels.size(); ++i)
+    {
+        record.append(QSqlField(table.m_labels.at(i), fieldType(table.m_columns.at(i).kind())));
     }
-    else
+
+    for (int row = 0; row < table.rowCount(); ++row)
     {
-        //query returned no result
-        QLOG_DEBUG() << "Graph loaded with no table of type " << type << ". This is strange!";
+        MessageBase::Ptr p_msg = MessageFactory::getMessageOfType(type, m_timeStampColumName);
+        record.setValue(0, table.m_index.at(row));
+        for (int i = 0; i < table.m_columns.size(); ++i)
+        {
+            record.setValue(i + 1, table.m_columns.at(i).toVariant(row));
+        }
+
+        if (!p_msg->setFromSqlRecord(record, m_tsScaleDivisor))
+        {
+            QLOG_DEBUG() << "Not all data could be read from SQL-Record. Schema mismatch?! "
+                         << "The data of type " << type << " might be corrupted.";
+        }
+        indexToMessageMap.insert(p_msg->getIndex(), p_msg);
     }
 }
 
@@ -282,7 +264,7 @@ QVariant AP2DataPlot2DModel::headerData ( int section, Qt::Orientation orientati
 int AP2DataPlot2DModel::rowCount( const QModelIndex & parent) const
 {
     Q_UNUSED(parent)
-    return m_rowCount;
+    return m_filterActive ? m_filteredRows.size() : m_rowCount;
 }
 
 int AP2DataPlot2DModel::columnCount ( const QModelIndex & parent) const
@@ -297,60 +279,123 @@ QVariant AP2DataPlot2DModel::data ( const QModelIndex & index, int role) const
     {
         return QVariant();
     }
-    if (index.row() >= m_rowCount)
+    if (index.row() >= rowCount() || index.column() >= m_columnCount)
     {
         QLOG_ERROR() << "Accessing a Database row that does not exist! Row was: " << index.row();
         return QVariant();
     }
 
-    if (index.column() == 0)
+    const int firstRow = index.row() - (index.row() % ROW_BLOCK_SIZE);
+    const QVector<QVariant> &block = rowBlock(firstRow);
+    return block.at((index.row() - firstRow) * m_columnCount + index.column());
+}
+
+const QVector<QVariant> &AP2DataPlot2DModel::rowBlock(const int firstRow) const
+{
+    for (int i = 0; i < 2; ++i)
     {
-        // Column 0 is the DB index of the log data
-        return QVariant(QString::number(m_rowIndexToDBIndex[index.row()].first));
+        if (m_rowBlocks[i].m_firstRow == firstRow)
+        {
+            m_nextRowBlock = 1 - i;
+            return m_rowBlocks[i].m_values;
+        }
     }
-    if (index.column() == 1)
+
+    // Materialise the whole block. The other block stays as the view often
+    // shows rows of two blocks at once.
+    RowBlock &block = m_rowBlocks[m_nextRowBlock];
+    m_nextRowBlock = 1 - m_nextRowBlock;
+    const int lastRow = qMin(firstRow + ROW_BLOCK_SIZE, rowCount());
+    block.m_firstRow = firstRow;
+    block.m_values.clear();
+    block.m_values.reserve((lastRow - firstRow) * m_columnCount);
+    for (int row = firstRow; row < lastRow; ++row)
     {
+        const AP2DataPlotColumnStore::RowRef &ref = m_store.rowAt(sourceRow(row));
+        const AP2DataPlotTable &table = m_store.table(ref.m_tableID);
+        // Column 0 is the DB index of the log data
+        block.m_values.append(QVariant(QString::number(table.m_index.at(ref.m_row))));
         // Column 1 is the name of the log data (ATT,ATUN...)
-        return QVariant(m_rowIndexToDBIndex[index.row()].second);
+        block.m_values.append(QVariant(table.m_name));
+        // All other columns are the fields of the message
+        for (int field = 0; field < m_columnCount - 2; ++field)
+        {
+            if (field < table.m_columns.size())
+            {
+                block.m_values.append(table.m_columns.at(field).toVariant(ref.m_row));
+            }
+            else
+            {
+                block.m_values.append(QVariant());
+            }
+        }
     }
+    return block.m_values;
+}
 
-    // The data is mostly read row by row. This means first all columns of row 1 are read and then
-    // all columns of row 2 and than all colums of row 3 and so on.
-    // This cache reads a whole row from DB and caches it internally. All consecutive accesses to this
-    // row will be answered from the cache.
-    if (index.row() != m_prefetchedRowIndex.row())
+void AP2DataPlot2DModel::invalidateRowBlocks()
+{
+    for (int i = 0; i < 2; ++i)
     {
-        m_prefetchedRowData.clear();
-        QString tableIndex = QString::number(m_rowIndexToDBIndex[index.row()].first);
-        QString tableName  = m_rowIndexToDBIndex[index.row()].second;
+        m_rowBlocks[i].m_firstRow = -1;
+        m_rowBlocks[i].m_values.clear();
+    }
+}
 
-        queryPtr selectRowQuery = m_msgNameToPrepearedSelectQuery.value(tableName);
-        selectRowQuery->bindValue(":val", tableIndex);
-        if (selectRowQuery->exec())
+void AP2DataPlot2DModel::setTypeFilter(const QStringList &types)
+{
+    beginResetModel();
+    invalidateRowBlocks();
+    m_filteredRows.clear();
+    m_filterActive = !types.isEmpty();
+    if (m_filterActive)
+    {
+        QVector<bool> accepted(m_store.tableCount(), false);
+        foreach (const QString &type, types)
         {
-            int recordCount = selectRowQuery->record().count();
-            if (!selectRowQuery->next())
-            {
-                return QVariant();
-            }
-            for (int i = 0; i < recordCount; ++i)
+            int tableID = m_store.tableID(type);
+            if (tableID >= 0)
             {
-                m_prefetchedRowData.push_back(selectRowQuery->value(i));
+                accepted[tableID] = true;
             }
-            m_prefetchedRowIndex = index;
-            selectRowQuery->finish();   // must be called because we will reuse this query
         }
-        else
+        for (int row = 0; row < m_rowCount; ++row)
         {
-            qDebug() << "Unable to exec table query:" << selectRowQuery->lastError().text();
+            if (accepted.at(m_store.rowAt(row).m_tableID))
+            {
+                m_filteredRows.append(static_cast<quint32>(row));
+            }
         }
+        m_filteredRows.squeeze();
     }
+    m_currentRow = 0;
+    endResetModel();
+}
 
-    if ((index.column()-1) >= m_prefetchedRowData.size())
+int AP2DataPlot2DModel::sourceRow(const int row) const
+{
+    return m_filterActive ? static_cast<int>(m_filteredRows.at(row)) : row;
+}
+
+int AP2DataPlot2DModel::rowForSourceRow(const int sourceRow) const
+{
+    const int rows = rowCount();
+    if (rows == 0)
     {
-        return QVariant();
+        return -1;
+    }
+    if (!m_filterActive)
+    {
+        return qBound(0, sourceRow, rows - 1);
     }
-    return m_prefetchedRowData[index.column()-1];
+    // First shown row behind sourceRow, the one in front of it is preferred
+    QVector<quint32>::const_iterator pos = std::upper_bound(m_filteredRows.constBegin(), m_filteredRows.constEnd(),
+                                                            static_cast<quint32>(qMax(0, sourceRow)));
+    if (pos == m_filteredRows.constBegin())
+    {
+        return 0;
+    }
+    return static_cast<int>(pos - m_filteredRows.constBegin()) - 1;
 }
 
 void AP2DataPlot2DModel::selectedRowChanged(QModelIndex current,QModelIndex previous)
@@ -373,9 +418,9 @@ void AP2DataPlot2DModel::selectedRowChanged(QModelIndex current,QModelIndex prev
     }
     //Grab the index
 
-    if (current.row() < m_rowCount)
+    if (current.row() < rowCount())
     {
-        m_currentHeaderItems = m_headerStringList.value(m_rowIndexToDBIndex[current.row()].second);
+        m_currentHeaderItems = m_headerStringList.value(m_store.table(m_store.rowAt(sourceRow(current.row())).m_tableID).m_name);
     }
     else
     {
@@ -386,74 +431,27 @@ void AP2DataPlot2DModel::selectedRowChanged(QModelIndex current,QModelIndex prev
 
 bool AP2DataPlot2DModel::hasType(const QString& name)
 {
-    return m_msgNameToPrepearedInsertQuery.contains(name);
+    return m_store.tableID(name) >= 0;
 }
 
-bool AP2DataPlot2DModel::addType(const QString &name, const unsigned int type, const int length, const QString &types, const QStringList &names)
+bool AP2DataPlot2DModel::addType(const QString &name, const unsigned int type, const int length, const QString &types, const QStringList &names,
+                                 const bool textFlightModes)
 {
-    if (!m_msgNameToPrepearedInsertQuery.contains(name))
+    if (m_store.tableID(name) < 0)
     {
-        QString createstring = makeCreateTableString(name,types,names);
         QString variablenames = names.join(",");
-        QString insertstring = makeInsertTableString(name,names);
-
-        //if (!query->prepare("INSERT INTO 'FMT' (idx,typeid,length,name,format,val) values (:idx,:typeid,:length,:name,:format,:val);"))
-        m_fmtInsertQuery->bindValue(":idx",m_fmtIndex++);
-        m_fmtInsertQuery->bindValue(":typeid",type);
-        m_fmtInsertQuery->bindValue(":length",length);
-        m_fmtInsertQuery->bindValue(":name",name);
-        m_fmtInsertQuery->bindValue(":format",types);
-        m_fmtInsertQuery->bindValue(":val",variablenames);
+
         QList<QString> list;
         list.append("FMT");
-        list.append(QString::number(m_fmtIndex-1));
+        list.append(QString::number(m_fmtIndex++));
         list.append(QString::number(type));
         list.append(QString::number(length));
         list.append(types);
         list.append(variablenames);
         m_fmtStringList.append(list);
-        if (!m_fmtInsertQuery->exec())
-        {
-            setError("FAILED TO FMT: " + m_fmtInsertQuery->lastError().text());
-            return false;
-        }
-        m_indexinsertquery->bindValue(":idx",m_fmtIndex-1);
-        m_indexinsertquery->bindValue(":value","FMT");
-        if (!m_indexinsertquery->exec())
-        {
-            setError("Error execing index: " + name + " " + m_indexinsertquery->lastError().text());
-            return false;
-        }
 
         // Create table for measurement of type "name"
-        QSqlQuery create(m_sharedDb);
-        if (!create.prepare(createstring))
-        {
-            setError("Unable to create: " + create.lastError().text());
-            return false;
-        }
-        if (!create.exec())
-        {
-            setError("Unable to exec create: " + create.lastError().text());
-            return false;
-        }
-        // Prepare an insert query for the created table above and store it to speed up the inserting process later
-        queryPtr prepQuery = queryPtr(new QSqlQuery(m_sharedDb));
-        if (!prepQuery->prepare(insertstring.replace("insert or replace","insert")))
-        {
-            setError("Error preparing insertquery: " + name + " " + prepQuery->lastError().text());
-            return false;
-        }
-        m_msgNameToPrepearedInsertQuery.insert(name, prepQuery);
-        // And prepare a select query for rows of this table
-        prepQuery = queryPtr(new QSqlQuery(m_sharedDb));
-        if (!prepQuery->prepare("SELECT * FROM " + name + " WHERE idx = :val"))
-        {
-            setError("Error preparing select query: " + name + " " + prepQuery->lastError().text());
-            return false;
-        }
-        m_msgNameToPrepearedSelectQuery.insert(name, prepQuery);
-
+        m_store.addTable(name, type, length, types, names, textFlightModes);
     }
     if (!m_headerStringList.contains(name))
     {
@@ -463,28 +461,139 @@ bool AP2DataPlot2DModel::addType(const QString &name, const unsigned int type, c
 }
 QMap<double,QVariant> AP2DataPlot2DModel::getValues(const QString& parent, const QString& child, bool useTimeAsIndex)
 {
-    int valueColum = getChildColum(parent,child);
-    int indexColum = 0; // Default index is always colum 0
     QMap<double,QVariant> retval;
-
-    if (useTimeAsIndex)
+    int tableID = m_store.tableID(parent);
+    if (tableID < 0)
     {
-        indexColum = getChildColum(parent, m_timeStampColumName);
+        return retval;  // looks like we do not have this data.
     }
-    QSqlQuery itemquery(m_sharedDb);
-    itemquery.prepare("SELECT * FROM '" + parent + "';");
-    itemquery.exec();
-    while (itemquery.next())
+    const AP2DataPlotTable &table = m_store.table(tableID);
+    int valueColumn = table.columnIndex(child);
+    if (valueColumn < 0)
     {
-        QSqlRecord record = itemquery.record();
-        double graphindex = useTimeAsIndex ? record.value(indexColum).toDouble() / m_tsScaleDivisor : record.value(indexColum).toDouble();
-        QVariant graphvalue = record.value(valueColum);
-        retval.insert(graphindex,graphvalue);
+        return retval;
+    }
+    int timeColumn = useTimeAsIndex ? table.columnIndex(m_timeStampColumName) : -1;
+    const AP2DataPlotColumn &values = table.m_columns.at(valueColumn);
+
+    for (int row = 0; row < table.rowCount(); ++row)
+    {
+        // Default index is the log index of the row
+        double graphindex = timeColumn >= 0 ? table.m_columns.at(timeColumn).toDouble(row) / m_tsScaleDivisor
+                                            : static_cast<double>(table.m_index.at(row));
+        retval.insert(graphindex, values.toVariant(row));
     }
 
     return retval;
 }
 
+QVector<AP2DataPlot2DModel::Series> AP2DataPlot2DModel::getSeries(const QStringList &names, const bool useTimeAsIndex,
+                                                                  const double lower, const double upper,
+                                                                  const int decimation) const
+{
+    QVector<Series> result(names.size());
+
+    // Group the requested fields by message type
+    QMap<int, QList<int> > tableToRequests;
+    for (int i = 0; i < names.size(); ++i)
+    {
+        result[i].m_name = names.at(i);
+        const int dot = names.at(i).indexOf('.');
+        const int tableID = (dot > 0) ? m_store.tableID(names.at(i).left(dot)) : -1;
+        if (tableID >= 0)
+        {
+            tableToRequests[tableID].append(i);
+        }
+    }
+
+    const int step = qMax(1, decimation);
+    for (QMap<int, QList<int> >::const_iterator iter = tableToRequests.constBegin(); iter != tableToRequests.constEnd(); ++iter)
+    {
+        const AP2DataPlotTable &table = m_store.table(iter.key());
+        const int timeColumn = useTimeAsIndex ? table.columnIndex(m_timeStampColumName) : -1;
+
+        // The log index is ascending so the window start can be searched
+        int row = 0;
+        if ((timeColumn < 0) && (lower > 0.0))
+        {
+            const quint32 start = (lower < 4294967295.0) ? static_cast<quint32>(std::ceil(lower)) : 0xFFFFFFFFu;
+            row = std::lower_bound(table.m_index.constBegin(), table.m_index.constEnd(), start) - table.m_index.constBegin();
+        }
+
+        // One scan selects the rows of the window and calculates their x
+        QVector<int> rows;
+        QVector<double> keys;
+        bool sorted = true;
+        int selected = 0;
+        for (; row < table.rowCount(); ++row)
+        {
+            const double key = (timeColumn >= 0) ? table.m_columns.at(timeColumn).toDouble(row) / m_tsScaleDivisor
+                                                 : static_cast<double>(table.m_index.at(row));
+            if (key < lower)
+            {
+                continue;
+            }
+            if (key > upper)
+            {
+                if (timeColumn < 0)
+                {
+                    break;
+                }
+                continue;
+            }
+            if (selected++ % step != 0)
+            {
+                continue;
+            }
+            sorted &= keys.isEmpty() || (key >= keys.last());
+            rows.append(row);
+            keys.append(key);
+        }
+
+        if (!sorted)
+        {
+            // Time stamps may jump backwards, deliver the samples in time order
+            QVector<QPair<double, int> > order(rows.size());
+            for (int i = 0; i < rows.size(); ++i)
+            {
+                order[i] = qMakePair(keys.at(i), rows.at(i));
+            }
+            std::stable_sort(order.begin(), order.end());
+            for (int i = 0; i < order.size(); ++i)
+            {
+                keys[i] = order.at(i).first;
+                rows[i] = order.at(i).second;
+            }
+        }
+
+        foreach (const int request, iter.value())
+        {
+            Series &series = result[request];
+            const int column = table.columnIndex(series.m_name.mid(series.m_name.indexOf('.') + 1));
+            if (column < 0)
+            {
+                continue;
+            }
+            const AP2DataPlotColumn &values = table.m_columns.at(column);
+            series.m_x = keys;
+            series.m_isText = values.isText();
+            if (series.m_isText)
+            {
+                series.m_text.reserve(rows.size());
+                foreach (const int textRow, rows)
+                {
+                    series.m_text.append(values.toText(textRow));
+                }
+            }
+            else
+            {
+                values.appendDoubles(rows, series.m_y);
+            }
+        }
+    }
+    return result;
+}
+
 int AP2DataPlot2DModel::getChildColum(const QString& parent,const QString& child)
 {
     // From headerStringList we can determine which index (colum) is used for child data
@@ -510,20 +619,13 @@ int AP2DataPlot2DModel::getChildColum(const QString& parent,const QString& child
 
 bool AP2DataPlot2DModel::startTransaction()
 {
-    if (!m_sharedDb.transaction())
-    {
-        setError("Unable to start transaction to database: " + m_sharedDb.lastError().text());
-        return false;
-    }
+    // Nothing to do for the in memory storage. Kept to bracket the loading process.
     return true;
 }
 bool AP2DataPlot2DModel::endTransaction()
 {
-    if (!m_sharedDb.commit())
-    {
-        setError("Unable to commit to database: " + m_sharedDb.lastError().text());
-        return false;
-    }
+    // Loading is done - release the memory reserved for growing
+    m_store.squeeze();
     return true;
 }
 
@@ -535,39 +637,20 @@ bool AP2DataPlot2DModel::addRow(const QString &name, const QList<QPair<QString,Q
     }
     m_lastIndex = index;
 
-    //Add a row to a previously defined message type using the already prepared insert query
-    queryPtr insertQuery = m_msgNameToPrepearedInsertQuery.value(name);
-    if (!insertQuery)
+    //Add a row to a previously defined message type
+    int tableID = m_store.tableID(name);
+    if (!m_store.appendRow(tableID, static_cast<quint32>(index), values))
     {
-        setError("No prepared insert query available for message: " + name);
+        setError("No table available for message: " + name);
         return false;
     }
-    insertQuery->bindValue(":idx", index);
-    bool timeFound = false;
-    for (int i=0;i<values.size();i++)
-    {
-        insertQuery->bindValue(":" + values.at(i).first, values.at(i).second);
-        if (!timeFound && (values.at(i).first == timeColName))
-        {
-            m_TimeIndexList.push_back(QPair<quint64, quint64>(values.at(i).second.toInt(), index));
-            timeFound = true;
-        }
-    }
-    if (!insertQuery->exec())
-    {
-        setError("Error execing insert query: " + insertQuery->lastError().text());
-        return false;
-    }
-    else
+
+    const AP2DataPlotTable &table = m_store.table(tableID);
+    int timeColumn = table.columnIndex(timeColName);
+    if (timeColumn >= 0)
     {
-        insertQuery->finish();  // must be called in case of a reusage of this query
-        m_indexinsertquery->bindValue(":idx", index);
-        m_indexinsertquery->bindValue(":value", name);
-        if (!m_indexinsertquery->exec())
-        {
-            setError("Error execing:" + m_indexinsertquery->executedQuery() + " error was " + m_indexinsertquery->lastError().text());
-            return false;
-        }
+        m_timeIndex.append(table.m_columns.at(timeColumn).toUnsigned(table.rowCount() - 1),
+                           static_cast<quint32>(m_store.rowCount() - 1), static_cast<quint32>(tableID));
     }
 
     // Our table model is larger than the number of columns we insert:
@@ -578,10 +661,143 @@ bool AP2DataPlot2DModel::addRow(const QString &name, const QList<QPair<QString,Q
         m_columnCount = values.size() +2;
     }
 
-    m_rowIndexToDBIndex.push_back(QPair<quint64,QString>(index,name));
     m_rowCount++;
+    invalidateRowBlocks();
+    return true;
+}
+
+bool AP2DataPlot2DModel::appendBatch(const AP2DataPlotRecordBatch &batch)
+{
+    const quint32 firstRow = static_cast<quint32>(m_store.rowCount());
+    if (!m_store.appendRows(batch.store()))
+    {
+        setError("Unable to add log data: message types do not match");
+        return false;
+    }
+    if (batch.isEmpty())
+    {
+        return true;
+    }
+
+    if (m_firstIndex == 0)
+    {
+        m_firstIndex = batch.firstIndex();
+    }
+    m_lastIndex = batch.lastIndex();
+
+    m_timeIndex.append(batch.timeIndex(), firstRow);
+
+    // +2 for the index and the message type column
+    if (batch.maxValueCount() + 2 > m_columnCount)
+    {
+        m_columnCount = batch.maxValueCount() + 2;
+    }
+
+    m_rowCount += batch.rowCount();
+    invalidateRowBlocks();
     return true;
 }
+
+bool AP2DataPlot2DModel::exportToDatabase(const QString &fileName)
+{
+    QString connectionName = QUuid::createUuid().toString();
+    bool result = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(fileName);
+
+        if (!db.open())
+        {
+            setError("Error opening database " + db.lastError().text());
+        }
+        else if (!db.transaction())
+        {
+            setError("Unable to start database transaction "  + db.lastError().text());
+        }
+        else if (createFMTTable(db) && createIndexTable(db))
+        {
+            queryPtr fmtInsertQuery = queryPtr(new QSqlQuery(db));
+            queryPtr indexInsertQuery = queryPtr(new QSqlQuery(db));
+            QVector<queryPtr> tableInsertQueries;
+            result = createFMTInsert(fmtInsertQuery) && createIndexInsert(indexInsertQuery);
+
+            // One table for each message type
+            for (int i = 0; result && (i < m_store.tableCount()); ++i)
+            {
+                const AP2DataPlotTable &table = m_store.table(i);
+                fmtInsertQuery->bindValue(":idx", i);
+                fmtInsertQuery->bindValue(":typeid", table.m_typeID);
+                fmtInsertQuery->bindValue(":length", table.m_length);
+                fmtInsertQuery->bindValue(":name", table.m_name);
+                fmtInsertQuery->bindValue(":format", table.m_format);
+                fmtInsertQuery->bindValue(":val", table.m_labels.join(","));
+                if (!fmtInsertQuery->exec())
+                {
+                    setError("FAILED TO FMT: " + fmtInsertQuery->lastError().text());
+                    result = false;
+                    break;
+                }
+
+                QSqlQuery create(db);
+                if (!create.exec(makeCreateTableString(table.m_name, table.m_format, table.m_labels)))
+                {
+                    setError("Unable to exec create: " + create.lastError().text());
+                    result = false;
+                    break;
+                }
+                queryPtr insertQuery = queryPtr(new QSqlQuery(db));
+                if (!insertQuery->prepare(makeInsertTableString(table.m_name, table.m_labels).replace("insert or replace","insert")))
+                {
+                    setError("Error preparing insertquery: " + table.m_name + " " + insertQuery->lastError().text());
+                    result = false;
+                    break;
+                }
+                tableInsertQueries.push_back(insertQuery);
+            }
+
+            // All rows in log order
+            for (int row = 0; result && (row < m_store.rowCount()); ++row)
+            {
+                const AP2DataPlotColumnStore::RowRef &ref = m_store.rowAt(row);
+                const AP2DataPlotTable &table = m_store.table(ref.m_tableID);
+                queryPtr insertQuery = tableInsertQueries.at(ref.m_tableID);
+                quint32 logIndex = table.m_index.at(ref.m_row);
+
+                insertQuery->bindValue(":idx", logIndex);
+                for (int i = 0; i < table.m_columns.size(); ++i)
+                {
+                    insertQuery->bindValue(":" + table.m_labels.at(i), table.m_columns.at(i).toVariant(ref.m_row));
+                }
+                if (!insertQuery->exec())
+                {
+                    setError("Error execing insert query: " + insertQuery->lastError().text());
+                    result = false;
+                    break;
+                }
+                insertQuery->finish();
+
+                indexInsertQuery->bindValue(":idx", logIndex);
+                indexInsertQuery->bindValue(":value", table.m_name);
+                if (!indexInsertQuery->exec())
+                {
+                    setError("Error execing:" + indexInsertQuery->executedQuery() + " error was " + indexInsertQuery->lastError().text());
+                    result = false;
+                    break;
+                }
+            }
+
+            if (result && !db.commit())
+            {
+                setError("Unable to commit database transaction "  + db.lastError().text());
+                result = false;
+            }
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return result;
+}
+
 QString AP2DataPlot2DModel::makeCreateTableString(QString tablename, QString formatstr,QStringList variablestr)
 {
     QString mktable = "CREATE TABLE '" + tablename + "' (idx integer PRIMARY KEY";
@@ -685,9 +901,9 @@ QString AP2DataPlot2DModel::makeInsertTableString(QString tablename, QStringList
     QString final = inserttable + " values " + insertvalues + ";";
     return final;
 }
-bool AP2DataPlot2DModel::createFMTTable()
+bool AP2DataPlot2DModel::createFMTTable(QSqlDatabase &db)
 {
-    QSqlQuery fmttablecreate(m_sharedDb);
+    QSqlQuery fmttablecreate(db);
     if (!fmttablecreate.prepare("CREATE TABLE 'FMT' (idx integer PRIMARY KEY, typeid integer,length integer,name varchar(200),format varchar(6000),val varchar(6000));"))
     {
         setError("Prapre create FMT table failed: " + fmttablecreate.lastError().text());
@@ -710,17 +926,17 @@ bool AP2DataPlot2DModel::createFMTInsert(queryPtr &query)
     }
     return true;
 }
-bool AP2DataPlot2DModel::createIndexTable()
+bool AP2DataPlot2DModel::createIndexTable(QSqlDatabase &db)
 {
-    QSqlQuery indextablecreate(m_sharedDb);
+    QSqlQuery indextablecreate(db);
     if (!indextablecreate.prepare("CREATE TABLE 'INDEX' (idx integer PRIMARY KEY, value varchar(200));"))
     {
-        setError("Error preparing INDEX table: " + m_sharedDb.lastError().text());
+        setError("Error preparing INDEX table: " + db.lastError().text());
         return false;
     }
     if (!indextablecreate.exec())
     {
-        setError("Error creating INDEX table: " + m_sharedDb.lastError().text());
+        setError("Error creating INDEX table: " + db.lastError().text());
         return false;
     }
     return true;
@@ -754,6 +970,7 @@ void AP2DataPlot2DModel::setAllRowsHaveTime(bool allHaveTime, const QString &tim
     m_timeStampColumName = timeColumName;
     m_tsScaleDivisor = scaling;
     m_allRowsHaveTime = allHaveTime;
+    m_timeIndex.finalize();
     m_canUseTimeOnX  = true;
     m_canUseTimeOnX &= setUpMaxTime();
     setUpMinTime();     // if this fails min time will be set to 0 whih is OK
@@ -769,19 +986,20 @@ bool AP2DataPlot2DModel::setUpMinTime()
     m_minTime = 0;    // force to be 0 in case of a failure
     if (m_allRowsHaveTime)
     {
-        QSqlQuery minTimeQuery(m_sharedDb);
-        minTimeQuery.prepare("SELECT " + m_timeStampColumName + " from 'STRT';");
-        if (!minTimeQuery.exec())
+        int tableID = m_store.tableID("STRT");
+        if (tableID < 0)
         {
-            setError("Unable to exec getMinTime query: " + minTimeQuery.lastError().text());
+            setError("Unable to get min time: No 'STRT' data available");
             return false;
         }
-        if (!minTimeQuery.next())
+        const AP2DataPlotTable &table = m_store.table(tableID);
+        int timeColumn = table.columnIndex(m_timeStampColumName);
+        if ((timeColumn < 0) || (table.rowCount() == 0))
         {
             setError("Result of getMinTime query was empty!");
             return false;
         }
-        m_minTime = minTimeQuery.value(0).toLongLong();
+        m_minTime = table.m_columns.at(timeColumn).toUnsigned(0);
         return true;
     }
     return false;
@@ -792,34 +1010,21 @@ bool AP2DataPlot2DModel::setUpMaxTime()
     m_maxTime = 0; // Always force to 0
     if (m_allRowsHaveTime)
     {
-        QString maxTableName;
-        QSqlQuery maxTimeQuery(m_sharedDb);
-        maxTimeQuery.prepare("SELECT value FROM 'INDEX' WHERE idx = (select max(idx) from 'INDEX');");
-        if (!maxTimeQuery.exec())
-        {
-            setError("Unable to select max index from 'INDEX': " + maxTimeQuery.lastError().text());
-            return false;
-        }
-        if (!maxTimeQuery.next())
-        {
-            setError("Result of select max index from 'INDEX' was empty!");
-            return false;
-        }
-        maxTableName = maxTimeQuery.value(0).toString();
-
-        QSqlQuery maxTimeQuery2(m_sharedDb);
-        maxTimeQuery2.prepare("SELECT " + m_timeStampColumName + " FROM '" + maxTableName + "' WHERE idx = (select max(idx) from '" + maxTableName + "');");
-        if (!maxTimeQuery2.exec())
+        if (m_store.rowCount() == 0)
         {
-            setError("Unable to select max " + m_timeStampColumName + " from " + maxTableName + ": " + maxTimeQuery2.lastError().text());
+            setError("Unable to get max time: Model is empty!");
             return false;
         }
-        if (!maxTimeQuery2.next())
+        // The last row in log order holds the biggest time stamp
+        const AP2DataPlotColumnStore::RowRef &ref = m_store.rowAt(m_store.rowCount() - 1);
+        const AP2DataPlotTable &table = m_store.table(ref.m_tableID);
+        int timeColumn = table.columnIndex(m_timeStampColumName);
+        if (timeColumn < 0)
         {
-            setError("Result of select max " + m_timeStampColumName + " from " + maxTableName + " query was empty!");
+            setError("Unable to select max " + m_timeStampColumName + " from " + table.m_name);
             return false;
         }
-        m_maxTime = maxTimeQuery2.value(0).toLongLong();
+        m_maxTime = table.m_columns.at(timeColumn).toUnsigned(ref.m_row);
         return true;
     }
     return false;
@@ -845,30 +1050,54 @@ double AP2DataPlot2DModel::getTimeDivisor()
     return m_tsScaleDivisor;
 }
 
-quint64 AP2DataPlot2DModel::getNearestIndexForTimestamp(const double timevalue)
+int AP2DataPlot2DModel::getRowForTimestamp(const double timevalue, const QString &type) const
 {
-    if (m_allRowsHaveTime)
+    if (!m_allRowsHaveTime)
+    {
+        return -1;
+    }
+    int tableID = -1;
+    if (!type.isEmpty())
+    {
+        tableID = m_store.tableID(type);
+        if (tableID < 0)
+        {
+            return -1;
+        }
+    }
+    quint64 time = static_cast<quint64>(qMax(0.0, m_tsScaleDivisor * timevalue));
+    int pos = m_timeIndex.nearest(time, tableID);
+    return (pos < 0) ? -1 : static_cast<int>(m_timeIndex.at(pos).m_row);
+}
+
+bool AP2DataPlot2DModel::getTimestampForRow(const int row, double &timevalue) const
+{
+    quint64 time = 0;
+    if (!m_allRowsHaveTime || (row < 0) || !m_timeIndex.timeForRow(static_cast<quint32>(row), time))
     {
-        quint64 time = static_cast<quint64>(m_tsScaleDivisor * timevalue);
-        int intervalSize = m_TimeIndexList.size();
-        int intervalStart = 0;
-        int middle = 0;
+        return false;
+    }
+    timevalue = time / m_tsScaleDivisor;
+    return true;
+}
 
-        while (intervalSize > 1)
+QVector<quint32> AP2DataPlot2DModel::getRowsInTimeRange(const double first, const double last, const QString &type) const
+{
+    QVector<quint32> rows;
+    if (!m_allRowsHaveTime || (last < first))
+    {
+        return rows;
+    }
+    int tableID = -1;
+    if (!type.isEmpty())
+    {
+        tableID = m_store.tableID(type);
+        if (tableID < 0)
         {
-            middle = intervalStart + intervalSize / 2;
-            quint64 temp = m_TimeIndexList[middle].first;
-            if (time > temp)
-            {
-                intervalStart = middle;
-            }
-            else if (time == temp)
-            {
-                break;
-            }
-            intervalSize = intervalSize / 2;
+            return rows;
         }
-        return m_TimeIndexList[middle].second;
     }
-    return 0;
+    m_timeIndex.rowsInRange(static_cast<quint64>(qMax(0.0, m_tsScaleDivisor * first)),
+                            static_cast<quint64>(qMax(0.0, m_tsScaleDivisor * last)), tableID, rows);
+    return rows;
 }
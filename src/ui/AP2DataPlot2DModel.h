@@ -31,8 +31,14 @@ This file is part of the APM_PLANNER project
 #define AP2DATAPLOT2DMODEL_H
 
 #include <QAbstractTableModel>
+#include <QFile>
+#include <QSharedPointer>
 #include <QSqlDatabase>
-#include <ArduPilotMegaMAV.h>
+#include <ApmLogMessages.h>
+#include <limits>
+#include "AP2DataPlotColumnStore.h"
+#include "AP2DataPlotRecordBatch.h"
+#include "AP2DataPlotTimeIndex.h"
 
 
 class AP2DataPlot2DModel : public QAbstractTableModel
@@ -46,13 +52,46 @@ public:
     int columnCount(const QModelIndex& parent = QModelIndex() ) const;
     QVariant data(const QModelIndex& index, int role = Qt::DisplayRole ) const;
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const;
-    bool addType(const QString &name, const unsigned int type, const int length, const QString &types, const QStringList &names);
+    bool addType(const QString &name, const unsigned int type, const int length, const QString &types, const QStringList &names,
+                 const bool textFlightModes = false);
     bool addRow(const QString &name, const QList<QPair<QString,QVariant> >  &values, const int index, const QString &timeColName);
     QMap<QString,QList<QString> > getFmtValues();
     QString getFmtLine(const QString& name);
     void getMessagesOfType(const QString &type, QMap<quint64, MessageBase::Ptr> &indexToMessageMap);
     bool hasType(const QString& name);
     QMap<double, QVariant> getValues(const QString& parent, const QString& child, bool useTimeAsIndex);
+
+    /**
+     * @brief The Series struct holds the samples of one field in contiguous arrays
+     */
+    struct Series
+    {
+        QString m_name;             /// Field name as "TYPE.field" like "ATT.Roll"
+        bool m_isText;              /// True for text fields, the values are in m_text then
+        QVector<double> m_x;        /// Log index or time of each sample, ascending
+        QVector<double> m_y;        /// Value of each sample of a numeric field
+        QVector<QString> m_text;    /// Value of each sample of a text field
+
+        Series() : m_isText(false) {}
+    };
+
+    /**
+     * @brief getSeries delivers the samples of several fields at once. Every
+     *        message type is scanned only once no matter how many of its
+     *        fields are requested.
+     *
+     * @param names - Fields as "TYPE.field" like "ATT.Roll"
+     * @param useTimeAsIndex - deliver the time instead of the log index as x
+     * @param lower - smallest x to deliver
+     * @param upper - biggest x to deliver
+     * @param decimation - deliver only every n-th sample inside [lower, upper]
+     * @return One series per name in the same order. Unknown fields deliver an
+     *         empty series.
+     */
+    QVector<Series> getSeries(const QStringList &names, const bool useTimeAsIndex,
+                              const double lower = -std::numeric_limits<double>::max(),
+                              const double upper = std::numeric_limits<double>::max(),
+                              const int decimation = 1) const;
     int getChildColum(const QString& parent,const QString& child);
     QString getError() { return m_error; }
     bool endTransaction();
@@ -121,13 +160,88 @@ public:
     double getTimeDivisor();
 
     /**
-     * @brief getNearestIndexForTimestamp delivers the row index which has the
-     *        smallest deviation in its timeStamp to the delivered timeValue.
+     * @brief getRowForTimestamp delivers the global row which has the smallest
+     *        deviation in its timestamp to the delivered time value.
+     *
+     * @param timevalue - The timestamp to search for in seconds
+     * @param type - only search rows of this message type, all rows if empty
+     * @return The row with the best timestamp match or -1 if there is none
+     */
+    int getRowForTimestamp(const double timevalue, const QString &type = QString()) const;
+
+    /**
+     * @brief getTimestampForRow delivers the timestamp of a global row. Rows
+     *        without a timestamp deliver the one of the nearest row in front of them.
+     *
+     * @param row - The global row
+     * @param timevalue - receives the timestamp in seconds
+     * @return true on success, false if there is no timestamp
+     */
+    bool getTimestampForRow(const int row, double &timevalue) const;
+
+    /**
+     * @brief getRowsInTimeRange delivers all global rows with a timestamp
+     *        within [first, last] in time order.
+     *
+     * @param first - Start of the range in seconds
+     * @param last - End of the range in seconds
+     * @param type - only deliver rows of this message type, all rows if empty
+     */
+    QVector<quint32> getRowsInTimeRange(const double first, const double last, const QString &type = QString()) const;
+
+    /**
+     * @brief timeIndex delivers the time index of all rows having a timestamp
+     */
+    const AP2DataPlotTimeIndex &timeIndex() const { return m_timeIndex; }
+
+    /**
+     * @brief exportToDatabase writes all data held in the model into a sqlite
+     *        database file. The created database contains a 'FMT' and an 'INDEX'
+     *        table and one table for each message type.
+     *
+     * @param fileName - Name of the database file to create
+     * @return true on success, false otherwise. Use getError() for details.
+     */
+    bool exportToDatabase(const QString &fileName);
+
+    /**
+     * @brief columnStore delivers the column store holding all data of the model.
+     */
+    const AP2DataPlotColumnStore &columnStore() const { return m_store; }
+
+    /**
+     * @brief appendBatch appends all rows of a record batch behind the rows of this
+     *        model. The batch must hold the same message types in the same order
+     *        as the model, it may hold less types. This is the bulk counterpart of
+     *        addRow used by the log parsers.
      *
-     * @param timevalue - The timeStamp to search for
-     * @return The index with the best timestamp match.
+     * @param batch - batch holding the decoded rows
+     * @return true on success, false otherwise. Use getError() for details.
      */
-    quint64 getNearestIndexForTimestamp(const double timevalue);
+    bool appendBatch(const AP2DataPlotRecordBatch &batch);
+
+    /**
+     * @brief setTypeFilter restricts the rows of the model to some message types.
+     *        The visible rows are held as a compact list of global rows which is
+     *        built from the row index without converting any value.
+     *
+     * @param types - Names of the message types to show, all rows are shown if empty
+     */
+    void setTypeFilter(const QStringList &types);
+
+    /**
+     * @brief sourceRow delivers the global row of the log shown in a row of the model
+     */
+    int sourceRow(const int row) const;
+
+    /**
+     * @brief rowForSourceRow delivers the row of the model showing a global row of
+     *        the log. If the global row is filtered the nearest row in front of it is
+     *        delivered or the first row behind it if there is none in front.
+     *
+     * @return The row or -1 if the model has no rows
+     */
+    int rowForSourceRow(const int sourceRow) const;
 
 
 public slots:
@@ -140,29 +254,28 @@ private slots:
 private: //helpers
     typedef QSharedPointer<QSqlQuery> queryPtr;              /// Shared pointer type for QSqlQueries
 
-    bool createFMTTable();
+    bool createFMTTable(QSqlDatabase &db);
     bool createFMTInsert(queryPtr &query);
-    bool createIndexTable();
+    bool createIndexTable(QSqlDatabase &db);
     bool createIndexInsert(queryPtr &query);
     void setError(QString error);
     QString makeCreateTableString(QString tablename, QString formatstr,QStringList variablestr);
     QString makeInsertTableString(QString tablename, QStringList variablestr);
     bool setUpMinTime();
     bool setUpMaxTime();
+    void invalidateRowBlocks();
+    const QVector<QVariant> &rowBlock(const int firstRow) const;
 
 private:
+    friend class AP2DataPlotLogCache;   /// Restores the model from a log cache file
+
     QString m_error;
-    QString m_databaseName;
-    QSqlDatabase m_sharedDb;
-    QVector<QPair<quint64,QString> > m_rowIndexToDBIndex;   /// stores relation between Table row index
-                                                            /// and DB index and DB table name
+    AP2DataPlotColumnStore m_store;     /// Holds all log data in typed columns
+    QSharedPointer<QFile> m_cacheFile;  /// Mapped log cache file the columns refer to, if any
     QMap<QString,QList<QString> > m_headerStringList;
     QList<QString> m_currentHeaderItems;
     QList<QList<QString> > m_fmtStringList;
 
-    QMap<QString,queryPtr> m_msgNameToPrepearedInsertQuery;  /// Map holding prepared insert queries to speed up inserts
-    QMap<QString,queryPtr> m_msgNameToPrepearedSelectQuery;  /// Map holding prepared select queries to speed up selects
-
     bool m_allRowsHaveTime;         /// True if all rows have a timestamp
     bool m_canUseTimeOnX;           /// True if all rows have time and min & max time could be selected
     quint64 m_minTime;              /// smallest timestamp im model
@@ -170,22 +283,34 @@ private:
     QString m_timeStampColumName;   /// Name of the table colum holding the timestamp
     double  m_tsScaleDivisor;       /// Divisor to scale timestamps to seconds
 
-    QList<QPair<quint64, quint64> > m_TimeIndexList;    /// List holding pairs of time stamp and table row index
+    AP2DataPlotTimeIndex m_timeIndex;   /// Maps between timestamps and rows
 
 
     int m_rowCount;                 /// Stores the number of rows held in model.
     int m_columnCount;
+    bool m_filterActive;            /// True if only the rows in m_filteredRows are shown
+    QVector<quint32> m_filteredRows;/// Global rows shown while the type filter is active
+
+    /**
+     * @brief The RowBlock struct holds the display values of consecutive rows of the
+     *        model. Views request cells one by one so a whole block is materialised
+     *        on first access and scrolling only touches the column store once per block.
+     */
+    struct RowBlock
+    {
+        int m_firstRow;             /// First row of the block, -1 if the block is unused
+        QVector<QVariant> m_values; /// Values of all cells of the block row by row
+
+        RowBlock() : m_firstRow(-1) {}
+    };
+
+    mutable RowBlock m_rowBlocks[2];/// Blocks last used by the view
+    mutable int m_nextRowBlock;     /// Block to be replaced next
     int m_currentRow;
     int m_fmtIndex;
 
     quint64 m_firstIndex;
     quint64 m_lastIndex;
-
-    queryPtr m_indexinsertquery;
-    queryPtr m_fmtInsertQuery;
-
-    mutable QVector<QVariant> m_prefetchedRowData;  /// holds the cached data used in data(...) method
-    mutable QModelIndex m_prefetchedRowIndex;       /// Stores the index which which is actually in cache
 };
 
 
@@ -0,0 +1,626 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot in place parser for binary dataflash logs
+ *
+ */
+
+#include "AP2DataPlotBinaryParser.h"
+#include <QtEndian>
+#include "QsLog.h"
+
+AP2DataPlotBinaryParser::AP2DataPlotBinaryParser(AP2DataPlot2DModel *model, AP2DataPlotStatus *status) :
+    m_dataModel(model),
+    m_plotState(status),
+    m_loadedLogType(MAV_TYPE_GENERIC),
+    m_timeStampHasToBeAddedCount(0),
+    m_paramType(-1),
+    m_index(0),
+    m_lastValidTS(0),
+    m_scanOnly(false)
+{
+    // flash logs and exported logs can have different timestamps
+    m_possibleTimestamps.push_back(timeStampType("TimeUS", 1000000.0));
+    m_possibleTimestamps.push_back(timeStampType("TimeMS", 1000.0));
+}
+
+qint64 AP2DataPlotBinaryParser::parse(const uchar *data, const qint64 size, const qint64 start, const qint64 end)
+{
+    qint64 pos = start;
+    int nonpacketcounter = 0;
+
+    while ((pos < end) && (pos + s_headerSize < size))
+    {
+        if ((data[pos] != 0xA3) || (data[pos + 1] != 0x95))
+        {
+            //Non packet
+            nonpacketcounter++;
+            pos++;
+            continue;
+        }
+
+        const unsigned char type = data[pos + 2];
+        if (type == s_fmtType)
+        {
+            //Message format packet
+            if (pos + s_fmtPacketSize > size)
+            {
+                break;  // Truncated packet at the end of the log
+            }
+            if (!parseFMT(data + pos + s_headerSize))
+            {
+                flush();
+                return -1;
+            }
+            pos += s_fmtPacketSize;
+            continue;
+        }
+
+        //Data packet
+        messageLayout &layout = m_layouts[type];
+        if (!layout.m_hasDescriptor || (layout.m_desc.m_length < s_headerSize))
+        {
+            QLOG_DEBUG() << "AP2DataPlotBinaryParser::parse(): No entry in typeToDescriptorMap for type:" << type;
+            m_plotState->corruptDataRead(m_index, "No length information for message type:0x" + QString::number(type, 16));
+            // Skip the header and try to find the next valid packet
+            pos++;
+            continue;
+        }
+        if (pos + layout.m_desc.m_length > size)
+        {
+            break;  // Truncated packet at the end of the log
+        }
+        if (!parseData(type, data + pos + s_headerSize))
+        {
+            flush();
+            return -1;
+        }
+        pos += layout.m_desc.m_length;
+    }
+
+    if ((nonpacketcounter > 0) && !m_scanOnly)
+    {
+        QLOG_DEBUG() << "AP2DataPlotBinaryParser::parse(): Non packet bytes found in log file" << nonpacketcounter << "bytes filtered out. This may be a corrupt log";
+        m_plotState->corruptDataRead(m_index, "Non packet bytes found in log file " + QString::number(nonpacketcounter) + " bytes filtered out");
+    }
+    return flush() ? pos : -1;
+}
+
+qint64 AP2DataPlotBinaryParser::scan(const uchar *data, const qint64 size, const qint64 start, const qint64 end)
+{
+    m_scanOnly = true;
+    qint64 pos = parse(data, size, start, end);
+    m_scanOnly = false;
+    return pos;
+}
+
+void AP2DataPlotBinaryParser::detach(AP2DataPlotStatus *status)
+{
+    m_dataModel = 0;
+    m_plotState = status;
+}
+
+bool AP2DataPlotBinaryParser::flush()
+{
+    if (!m_dataModel || m_batch.isEmpty())
+    {
+        return true;
+    }
+    if (!m_dataModel->appendBatch(m_batch))
+    {
+        return false;
+    }
+    m_batch.clear();
+    return true;
+}
+
+bool AP2DataPlotBinaryParser::parseFMT(const uchar *packet)
+{
+    const unsigned char msg_type = packet[0]; //Message type defined in the format struct
+
+    typeDescriptor desc;
+    desc.m_length = packet[1];                  //Message length
+    desc.m_name   = readText(packet + 2, 4);    //Name of the message
+    desc.m_format = readText(packet + 6, 16);   //Format of the variables
+    desc.m_labels = readText(packet + 22, 64);  //comma delimited list of variable names.
+
+    messageLayout &layout = m_layouts[msg_type];
+    layout.m_hasDescriptor = true;
+    layout.m_compiled = false;
+    layout.m_desc = desc;           // store descriptor for parsing
+
+    if (desc.m_name == "PARM")
+    {
+        m_paramType = msg_type;
+    }
+    if (msg_type == s_fmtType)
+    {
+        //Message is a format type, we don't want to include it
+        return true;
+    }
+    if (desc.m_format.isEmpty() || desc.m_labels.isEmpty())
+    {
+        // "STRT" message is a special case in older logs - ignore
+        if (desc.m_name != "STRT")
+        {
+            QLOG_DEBUG() << "AP2DataPlotBinaryParser::parseFMT(): empty format string or labels string for type" << msg_type << desc.m_name;
+            m_plotState->corruptFMTRead(m_index, desc.m_name + " format data: Corrupt or missing. Message type is:0x" +
+                                        QString::number(msg_type, 16));
+            return true;
+        }
+    }
+
+    // Following code shall detect the name of the timestamp field and add such a
+    // field to all types that do not have one.
+    if (m_tables.contains(desc.m_name))
+    {
+        return true;
+    }
+
+    // try to find the name of timestamp column
+    if (m_timeStamp.m_name.isEmpty())
+    {
+        foreach (const timeStampType &ts, m_possibleTimestamps)
+        {
+            if (desc.m_labels.contains(ts.m_name))
+            {
+                // found
+                m_timeStamp = ts;
+                break;
+            }
+        }
+        // check again and if not found store type for delayed transfer to data model
+        // as we haven't detected the right name
+        if (m_timeStamp.m_name.isEmpty())
+        {
+            m_typesWithoutTimeStamp.push_back(msg_type);
+            return true;
+        }
+    }
+
+    // we have a valid timestamp column name
+    // first check if we have to process delayed messages without a timestamp
+    foreach (const unsigned char delayedType, m_typesWithoutTimeStamp)
+    {
+        typeDescriptor delayedDesc = m_layouts[delayedType].m_desc;
+        addTimeToDescriptor(delayedDesc);
+        m_layouts[delayedType].m_addTime = true;
+        ++m_timeStampHasToBeAddedCount;
+        if (!addType(delayedDesc, delayedType))
+        {
+            return false;
+        }
+    }
+    m_typesWithoutTimeStamp.clear();
+
+    // Now check if the actual message conains a timestamp if not add it
+    if (!desc.m_labels.contains(m_timeStamp.m_name))
+    {
+        addTimeToDescriptor(desc);
+        layout.m_addTime = true;
+        ++m_timeStampHasToBeAddedCount;
+    }
+    // Special handling for "GPS" messages that have a "TimeMS" timestamp but scaling
+    // and value does not mach all other time stamps
+    if ((desc.m_name == "GPS") && desc.m_labels.contains("TimeMS"))
+    {
+        QStringList labels = desc.m_labels.split(",");
+        for (QStringList::Iterator iter = labels.begin(); iter != labels.end(); ++iter)
+        {
+            if (*iter == "TimeMS")
+            {
+                *iter = "GPSTimeMS";
+                break;
+            }
+        }
+        // Force the decoder to use the new time stamp name
+        layout.m_desc.m_labels = labels.join(",");
+        // add default time stamp name
+        labels.prepend(m_timeStamp.m_name);
+        desc.m_labels = labels.join(",");
+        desc.m_format.prepend('Q');
+        desc.m_length += 8;
+        layout.m_addTime = true;
+        ++m_timeStampHasToBeAddedCount;
+    }
+
+    return addType(desc, msg_type);
+}
+
+bool AP2DataPlotBinaryParser::addType(const typeDescriptor &desc, const unsigned char type)
+{
+    const QStringList labels = desc.m_labels.split(",");
+    if (m_dataModel && !m_dataModel->addType(desc.m_name, type, desc.m_length, desc.m_format, labels))
+    {
+        return false;
+    }
+    // Model and batch get the types in the same order so both use the same table id
+    m_batch.addType(desc.m_name, type, desc.m_length, desc.m_format, labels);
+    m_tables.insert(desc.m_name);
+    m_index++;
+
+    // A new table changes the target of already compiled layouts
+    for (int i = 0; i < 256; ++i)
+    {
+        m_layouts[i].m_compiled = false;
+    }
+    return true;
+}
+
+void AP2DataPlotBinaryParser::compileLayout(messageLayout &layout)
+{
+    layout.m_fields.clear();
+    layout.m_nameField = -1;
+    layout.m_timeColumn = -1;
+    layout.m_tableID = m_tables.contains(layout.m_desc.m_name) ? m_batch.tableID(layout.m_desc.m_name) : -1;
+    layout.m_compiled = true;
+
+    if (layout.m_tableID < 0)
+    {
+        return;
+    }
+
+    const AP2DataPlotTable &table = m_batch.table(layout.m_tableID);
+    const QStringList labels = layout.m_desc.m_labels.split(",");
+    const QString &format = layout.m_desc.m_format;
+    const int columnOffset = layout.m_addTime ? 1 : 0;
+    int offset = 0;
+
+    layout.m_timeColumn = table.columnIndex(m_timeStamp.m_name);
+    layout.m_fields.reserve(format.size());
+
+    for (int j = 0; j < format.size(); ++j)
+    {
+        fieldLayout field;
+        field.m_typeCode = format.at(j).toLatin1();
+        field.m_offset = offset;
+        offset += fieldSize(field.m_typeCode);
+
+        if (j < labels.size())
+        {
+            const QString &label = labels.at(j);
+            // Values are matched by position first like AP2DataPlotColumnStore::appendRow does
+            int column = j + columnOffset;
+            if ((column >= table.m_labels.size()) || (table.m_labels.at(column) != label))
+            {
+                column = table.columnIndex(label);
+            }
+            field.m_column = column;
+            field.m_isTime = !layout.m_addTime && (label == m_timeStamp.m_name);
+            if ((layout.m_nameField < 0) && (label == "Name"))
+            {
+                layout.m_nameField = j;
+            }
+        }
+        layout.m_fields.push_back(field);
+    }
+
+    // Only the first field carrying the timestamp name is checked
+    bool timeFound = false;
+    for (int j = 0; j < layout.m_fields.size(); ++j)
+    {
+        if (layout.m_fields.at(j).m_isTime)
+        {
+            layout.m_fields[j].m_isTime = !timeFound;
+            timeFound = true;
+        }
+    }
+}
+
+bool AP2DataPlotBinaryParser::parseData(const unsigned char type, const uchar *payload)
+{
+    messageLayout &layout = m_layouts[type];
+    if (!layout.m_compiled)
+    {
+        compileLayout(layout);
+    }
+
+    if (layout.m_tableID < 0)
+    {
+        QLOG_DEBUG() << "AP2DataPlotBinaryParser::parseData(): No table available for message type" << layout.m_desc.m_name;
+        m_plotState->corruptDataRead(m_index, "No format information available for message type:0x" + QString::number(type, 16));
+        return true;
+    }
+
+    m_index++;
+
+    if (m_scanOnly)
+    {
+        // Only keep the last valid timestamp up to date
+        if (m_timeStampHasToBeAddedCount > 0)
+        {
+            const int payloadSize = layout.m_desc.m_length - s_headerSize;
+            foreach (const fieldLayout &field, layout.m_fields)
+            {
+                if (field.m_isTime && (field.m_offset + fieldSize(field.m_typeCode) <= payloadSize))
+                {
+                    m_lastValidTS = qMax(m_lastValidTS, readTimeStamp(field, payload + field.m_offset));
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    const int tableID = layout.m_tableID;
+    const int row = m_batch.table(tableID).rowCount();
+    const bool checkTime = m_timeStampHasToBeAddedCount > 0;
+    const int payloadSize = layout.m_desc.m_length - s_headerSize;
+    bool noCorruptDataFound = true;
+    int valueCount = 0;
+
+    for (int j = 0; j < layout.m_fields.size(); ++j)
+    {
+        const fieldLayout &field = layout.m_fields.at(j);
+        const uchar *src = payload + field.m_offset;
+
+        if (field.m_offset + fieldSize(field.m_typeCode) > payloadSize)
+        {
+            // Format string describes more data than the packet holds
+            m_plotState->corruptDataRead(m_index, "Message too short when decoding " + layout.m_desc.m_name);
+            noCorruptDataFound = false;
+            break;
+        }
+
+        AP2DataPlotColumn *column = 0;
+        if (field.m_column >= 0)
+        {
+            column = &m_batch.column(tableID, field.m_column);
+            if (column->size() != row)
+            {
+                column = 0; // column already has a value
+            }
+        }
+
+        if (checkTime && field.m_isTime)
+        {
+            const quint64 timeStamp = readTimeStamp(field, src);
+            const quint64 validTimeStamp = checkTimeStamp(timeStamp);
+            if ((validTimeStamp != timeStamp) && column)
+            {
+                // store corrected value
+                column->appendUnsigned(validTimeStamp);
+                ++valueCount;
+                continue;
+            }
+        }
+
+        switch (field.m_typeCode)
+        {
+        case 'b': //int8_t
+        case 'M':
+            if (column) column->appendInteger(static_cast<qint8>(src[0]));
+            break;
+        case 'B': //uint8_t
+            if (column) column->appendInteger(src[0]);
+            break;
+        case 'h': //int16_t
+            if (column) column->appendInteger(qFromLittleEndian<qint16>(src));
+            break;
+        case 'H': //uint16_t
+            if (column) column->appendInteger(qFromLittleEndian<quint16>(src));
+            break;
+        case 'i': //int32_t
+            if (column) column->appendInteger(qFromLittleEndian<qint32>(src));
+            break;
+        case 'I': //uint32_t
+            if (column) column->appendUnsigned(qFromLittleEndian<quint32>(src));
+            break;
+        case 'f': //float
+        {
+            const quint32 bits = qFromLittleEndian<quint32>(src);
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            if (f != f) // This tests for not a number
+            {
+                QLOG_WARN() << "Corrupted log data found - Graphing may not work as expected for data of type" << layout.m_desc.m_name;
+                noCorruptDataFound = false;
+                m_plotState->corruptDataRead(m_index, "Corrupt data element found when decoding " + layout.m_desc.m_name + " data.");
+                continue;
+            }
+            if (column) column->appendDouble(f);
+            break;
+        }
+        case 'n': //char(4)
+        case 'N': //char(16)
+        case 'Z': //char(64)
+            if (column) column->appendText(readText(src, fieldSize(field.m_typeCode)));
+            break;
+        case 'c': //int16_t * 100
+            if (column) column->appendDouble(qFromLittleEndian<qint16>(src) / 100.0);
+            break;
+        case 'C': //uint16_t * 100
+            if (column) column->appendDouble(qFromLittleEndian<quint16>(src) / 100.0);
+            break;
+        case 'e': //int32_t * 100
+            if (column) column->appendDouble(qFromLittleEndian<qint32>(src) / 100.0);
+            break;
+        case 'E': //uint32_t * 100
+            if (column) column->appendDouble(qFromLittleEndian<quint32>(src) / 100.0);
+            break;
+        case 'L': //int32_t GPS Lon/Lat * 10000000
+            if (column) column->appendDouble(qFromLittleEndian<qint32>(src) / 10000000.0);
+            break;
+        case 'q': //int64_t
+            if (column) column->appendInteger(qFromLittleEndian<qint64>(src));
+            break;
+        case 'Q': //uint64_t
+            if (column) column->appendUnsigned(qFromLittleEndian<quint64>(src));
+            break;
+        default:
+            //Unknown!
+            QLOG_DEBUG() << "AP2DataPlotBinaryParser::parseData(): ERROR UNKNOWN DATA TYPE" << field.m_typeCode;
+            m_plotState->corruptDataRead(m_index, "Unknown data type: " + QString(QChar::fromLatin1(field.m_typeCode)) +
+                                         " when decoding " + layout.m_desc.m_name);
+            continue;
+        }
+        ++valueCount;
+    }
+
+    // check if a synthetic timestamp has to added
+    if (layout.m_addTime)
+    {
+        if (layout.m_timeColumn >= 0)
+        {
+            AP2DataPlotColumn &timeColumn = m_batch.column(tableID, layout.m_timeColumn);
+            if (timeColumn.size() == row)
+            {
+                timeColumn.appendUnsigned(m_lastValidTS);
+            }
+        }
+        ++valueCount;
+    }
+
+    if (noCorruptDataFound && (valueCount >= 1))
+    {
+        m_batch.commitRow(tableID, m_index, layout.m_timeColumn, valueCount);
+        m_plotState->validDataRead();
+        if (m_batch.isFull() && !flush())
+        {
+            return false;
+        }
+    }
+    else
+    {
+        m_batch.discardRow(tableID);
+    }
+
+    if ((type == m_paramType) && (m_loadedLogType == MAV_TYPE_GENERIC) && (layout.m_nameField >= 0))
+    {
+        const fieldLayout &nameField = layout.m_fields.at(layout.m_nameField);
+        if (nameField.m_offset + fieldSize(nameField.m_typeCode) <= payloadSize)
+        {
+            checkLogType(readText(payload + nameField.m_offset, fieldSize(nameField.m_typeCode)));
+        }
+    }
+    return true;
+}
+
+int AP2DataPlotBinaryParser::fieldSize(const char typeCode)
+{
+    switch (typeCode)
+    {
+    case 'b':
+    case 'B':
+    case 'M':
+        return 1;
+    case 'h':
+    case 'H':
+    case 'c':
+    case 'C':
+        return 2;
+    case 'i':
+    case 'I':
+    case 'f':
+    case 'e':
+    case 'E':
+    case 'L':
+    case 'n':
+        return 4;
+    case 'q':
+    case 'Q':
+        return 8;
+    case 'N':
+        return 16;
+    case 'Z':
+        return 64;
+    default:
+        return 0;   // unknown types do not consume data
+    }
+}
+
+quint64 AP2DataPlotBinaryParser::readTimeStamp(const fieldLayout &field, const uchar *src)
+{
+    switch (field.m_typeCode)
+    {
+    case 'I':
+        return qFromLittleEndian<quint32>(src);
+    case 'Q':
+        return qFromLittleEndian<quint64>(src);
+    case 'q':
+        return static_cast<quint64>(qFromLittleEndian<qint64>(src));
+    case 'i':
+        return static_cast<quint64>(static_cast<qint64>(qFromLittleEndian<qint32>(src)));
+    default:
+        return 0;
+    }
+}
+
+QString AP2DataPlotBinaryParser::readText(const uchar *data, const int length)
+{
+    char buffer[64];
+    int size = 0;
+    for (int i = 0; i < length; ++i)
+    {
+        if (data[i])
+        {
+            buffer[size++] = static_cast<char>(data[i]);
+        }
+    }
+    return QString::fromLatin1(buffer, size);
+}
+
+quint64 AP2DataPlotBinaryParser::checkTimeStamp(const quint64 timeStamp)
+{
+    // check if time is increasing
+    if (timeStamp >= m_lastValidTS)
+    {
+        m_lastValidTS = timeStamp;
+        return timeStamp;
+    }
+
+    QLOG_ERROR() << "Corrupt data read: Time is not increasing! Last valid time stamp:"
+                 << QString::number(m_lastValidTS) << " actual read time stamp is:"
+                 << QString::number(timeStamp);
+    m_plotState->corruptTimeRead(m_index, "Log time is not increasing! Last Time:" +
+                                 QString::number(m_lastValidTS) + " new Time:" +
+                                 QString::number(timeStamp));
+    // if not increasing set to last valid value
+    return m_lastValidTS;
+}
+
+void AP2DataPlotBinaryParser::addTimeToDescriptor(typeDescriptor &desc)
+{
+    // Add name of the timestamp column adding a "," only if needed
+    desc.m_labels = desc.m_labels.size() != 0 ? m_timeStamp.m_name + ',' + desc.m_labels : m_timeStamp.m_name;
+    // Add timestamp format code to format string
+    desc.m_format.prepend('Q');
+    // and increase the length by 8 bytes ('Q' is a quint_64)
+    desc.m_length += 8;
+}
+
+void AP2DataPlotBinaryParser::checkLogType(const QString &paramName)
+{
+    if (paramName == "RATE_RLL_P" || paramName == "H_SWASH_PLATE")
+    {
+        m_loadedLogType = MAV_TYPE_QUADROTOR;
+    }
+    else if (paramName == "PTCH2SRV_P")
+    {
+        m_loadedLogType = MAV_TYPE_FIXED_WING;
+    }
+    else if (paramName == "SKID_STEER_OUT")
+    {
+        m_loadedLogType = MAV_TYPE_GROUND_ROVER;
+    }
+}
@@ -0,0 +1,261 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot in place parser for binary dataflash logs
+ *
+ */
+
+#ifndef AP2DATAPLOTBINARYPARSER_H
+#define AP2DATAPLOTBINARYPARSER_H
+
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "AP2DataPlot2DModel.h"
+#include "AP2DataPlotRecordBatch.h"
+#include "AP2DataPlotStatus.h"
+#include "libs/mavlink/include/mavlink/v1.0/ardupilotmega/mavlink.h"
+
+/**
+ * @brief The AP2DataPlotBinaryParser class decodes binary dataflash logs directly
+ *        from a memory buffer (normally a memory mapped file) into a typed record
+ *        batch which is handed to an AP2DataPlot2DModel whenever it is full.
+ *
+ *        For every message type a field layout (offset, size and target column of
+ *        each field) is compiled once from its FMT packet. Data packets are then
+ *        decoded in place using this layout without copying the packet or boxing
+ *        the values in QVariants.
+ *
+ *        The parser keeps the semantics of AP2DataPlotThread::loadBinaryLog:
+ *        timestamp detection, synthetic timestamps for messages without one, the
+ *        special GPS time handling, the time monotonic check, dropping of rows
+ *        containing NaN values and the log type detection using PARM messages.
+ */
+class AP2DataPlotBinaryParser
+{
+public:
+    /**
+     * @brief AP2DataPlotBinaryParser CTOR
+     * @param model - Data model to store the decoded data in
+     * @param status - Status object to report parsing errors to
+     */
+    AP2DataPlotBinaryParser(AP2DataPlot2DModel *model, AP2DataPlotStatus *status);
+
+    /**
+     * @brief parse decodes all packets whose header starts in the range [start, end)
+     *        of data. Packets may reach behind end as long as they are within size.
+     *        Parsing can be continued by calling parse again with the returned
+     *        position as start.
+     *
+     * @param data - Pointer to the whole log
+     * @param size - Size of the whole log
+     * @param start - Position to start parsing
+     * @param end - Position to stop parsing
+     * @return Position where parsing has to be continued or -1 if the data model
+     *         reported an error. Use AP2DataPlot2DModel::getError() for details.
+     *         All rows decoded so far are handed to the model before returning.
+     */
+    qint64 parse(const uchar *data, const qint64 size, const qint64 start, const qint64 end);
+
+    /**
+     * @brief scan works like parse but only FMT packets are fully processed. Data
+     *        packets are skipped, only the log index and the last valid timestamp
+     *        are updated. After scanning a range the parser has the same state as
+     *        if the range was parsed. Used to find the start state of log parts
+     *        which are parsed in parallel. Errors of data packets are not reported.
+     *
+     * @see parse
+     */
+    qint64 scan(const uchar *data, const qint64 size, const qint64 start, const qint64 end);
+
+    /**
+     * @brief detach disconnects the parser from the data model. Afterwards all
+     *        decoded rows and new message types are only kept in batch(). A copy
+     *        of a parser can be detached to parse a part of the log in another
+     *        thread. Its batch is then appended to the model by the caller.
+     *
+     * @param status - Status object to report parsing errors to
+     */
+    void detach(AP2DataPlotStatus *status);
+
+    /**
+     * @brief batch delivers the batch holding the rows not yet handed to the model
+     */
+    const AP2DataPlotRecordBatch &batch() const { return m_batch; }
+
+    /**
+     * @brief timeStampName delivers the name of the detected timestamp field
+     * @return - name of timestamp field, empty if none was detected
+     */
+    QString timeStampName() const { return m_timeStamp.m_name; }
+
+    /**
+     * @brief timeStampDivisor delivers the divisor to scale the timestamp to seconds
+     */
+    double timeStampDivisor() const { return m_timeStamp.m_divisor; }
+
+    /**
+     * @brief logType delivers the vehicle type detected using the PARM messages
+     */
+    MAV_TYPE logType() const { return m_loadedLogType; }
+
+private:
+    static const int s_headerSize = 3;      /// Every packet starts with 0xA3 0x95 type
+    static const int s_fmtPacketSize = 89;  /// Size of a FMT packet including header
+    static const unsigned char s_fmtType = 0x80;    /// Message type of FMT packets
+
+    /**
+     * @brief The timeStampType struct
+     *        Used to hold the name and the scaling of a time stamp.
+     */
+    struct timeStampType
+    {
+        QString m_name;     /// Name of the time stamp
+        double  m_divisor;  /// Divisor to scale time stamp to seconds
+
+        timeStampType() : m_divisor(0.0) {}
+        timeStampType(const QString &name, const double divisor) : m_name(name), m_divisor(divisor) {}
+    };
+
+    /**
+     * @brief The typeDescriptor struct
+     *        Used to hold all data needed to describe a message type
+     */
+    struct typeDescriptor
+    {
+        int m_length;       /// Length of the message
+        QString m_name;     /// Name of the message
+        QString m_format;   /// Format string like "QbbI"
+        QString m_labels;   /// Name of each value in message. Comma seperated like "lat,lon,time"
+
+        typeDescriptor() : m_length(0){}
+    };
+
+    /**
+     * @brief The fieldLayout struct
+     *        Describes where a field is found in a packet and where it is stored.
+     */
+    struct fieldLayout
+    {
+        char m_typeCode;    /// Format character of the field
+        int  m_offset;      /// Offset of the field in the packet payload
+        int  m_column;      /// Column in the data model table, -1 if not stored
+        bool m_isTime;      /// True if the field holds the timestamp
+
+        fieldLayout() : m_typeCode(0), m_offset(0), m_column(-1), m_isTime(false) {}
+    };
+
+    /**
+     * @brief The messageLayout struct
+     *        Precompiled decoding information of one message type
+     */
+    struct messageLayout
+    {
+        bool m_hasDescriptor;   /// True if a FMT packet for this type was read
+        bool m_compiled;        /// True if m_fields matches the actual descriptor and table
+        bool m_addTime;         /// True if a synthetic timestamp has to be added
+        int  m_tableID;         /// Table id in the data model, -1 if not in model
+        int  m_timeColumn;      /// Column holding the timestamp, -1 if none
+        int  m_nameField;       /// Index of the "Name" field, used for PARM messages
+        typeDescriptor m_desc;  /// Descriptor as read from the log
+        QVector<fieldLayout> m_fields;  /// Layout of all fields
+
+        messageLayout() : m_hasDescriptor(false), m_compiled(false), m_addTime(false),
+                          m_tableID(-1), m_timeColumn(-1), m_nameField(-1) {}
+    };
+
+    /**
+     * @brief parseFMT handles a FMT packet and adds the message type to the data model
+     * @return false if the data model reported an error
+     */
+    bool parseFMT(const uchar *packet);
+
+    /**
+     * @brief parseData decodes a data packet into the data model
+     * @return false if the data model reported an error
+     */
+    bool parseData(const unsigned char type, const uchar *payload);
+
+    /**
+     * @brief addType stores a message type in the data model
+     * @return false if the data model reported an error
+     */
+    bool addType(const typeDescriptor &desc, const unsigned char type);
+
+    /**
+     * @brief flush hands all rows of the batch to the data model
+     * @return false if the data model reported an error
+     */
+    bool flush();
+
+    /**
+     * @brief compileLayout builds the field layout of a message type
+     */
+    void compileLayout(messageLayout &layout);
+
+    /**
+     * @brief fieldSize delivers the size of a field in bytes
+     * @return size in bytes or 0 for unknown format characters
+     */
+    static int fieldSize(const char typeCode);
+
+    /**
+     * @brief readText reads a zero padded char array skipping all zeros
+     */
+    static QString readText(const uchar *data, const int length);
+
+    /**
+     * @brief checkTimeStamp checks if the time is increasing and updates the last
+     *        valid time stamp.
+     * @return The valid time stamp to be stored
+     */
+    quint64 checkTimeStamp(const quint64 timeStamp);
+
+    /**
+     * @brief readTimeStamp reads a timestamp field as unsigned value
+     */
+    static quint64 readTimeStamp(const fieldLayout &field, const uchar *src);
+
+    void addTimeToDescriptor(typeDescriptor &desc);
+    void checkLogType(const QString &paramName);
+
+    AP2DataPlot2DModel *m_dataModel;
+    AP2DataPlotStatus  *m_plotState;
+    AP2DataPlotRecordBatch m_batch;         /// Decoded rows not yet handed to the model
+    MAV_TYPE m_loadedLogType;
+
+    messageLayout m_layouts[256];           /// Layout for every possible message type
+    QList<unsigned char> m_typesWithoutTimeStamp;   /// Types waiting for the timestamp detection
+    QSet<QString> m_tables;                 /// Names of all types added by this parser
+    int m_timeStampHasToBeAddedCount;       /// Number of types getting a synthetic timestamp
+    int m_paramType;                        /// Message type of PARM messages
+    int m_index;                            /// Actual log index
+    quint64 m_lastValidTS;                  /// Last valid timestamp
+    bool m_scanOnly;                        /// True while scanning, data packets are not decoded
+
+    QList<timeStampType> m_possibleTimestamps;
+    timeStampType m_timeStamp;
+};
+
+#endif // AP2DATAPLOTBINARYPARSER_H
@@ -0,0 +1,648 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot columnar in memory storage for log data
+ *
+ */
+
+#include "AP2DataPlotColumnStore.h"
+#include <QsLog.h>
+#include <algorithm>
+
+AP2DataPlotColumn::AP2DataPlotColumn() :
+    m_kind(DoubleKind),
+    m_size(0)
+{
+}
+
+AP2DataPlotColumn::AP2DataPlotColumn(const Kind kind) :
+    m_kind(kind),
+    m_size(0)
+{
+}
+
+AP2DataPlotColumn::Kind AP2DataPlotColumn::kindForTypeCode(const QChar typeCode, const bool textFlightModes)
+{
+    switch (typeCode.toLatin1())
+    {
+    case 'b':   // int8_t
+    case 'B':   // uint8_t
+    case 'h':   // int16_t
+    case 'H':   // uint16_t
+    case 'i':   // int32_t
+        return Int32Kind;
+    case 'M':   // uint8_t flight mode - ASCII logs write the mode name
+        return textFlightModes ? TextKind : Int32Kind;
+    case 'I':   // uint32_t
+        return UInt32Kind;
+    case 'q':   // int64_t
+        return Int64Kind;
+    case 'Q':   // uint64_t
+        return UInt64Kind;
+    case 'f':   // float
+        return FloatKind;
+    case 'd':   // double
+    case 'c':   // int16_t * 100
+    case 'C':   // uint16_t * 100
+    case 'e':   // int32_t * 100
+    case 'E':   // uint32_t * 100
+    case 'L':   // int32_t latitude/longitude
+        return DoubleKind;
+    case 'n':   // char[4]
+    case 'N':   // char[16]
+    case 'Z':   // char[64]
+        return TextKind;
+    default:
+        QLOG_DEBUG() << "AP2DataPlotColumn::kindForTypeCode(): Unknown type code" << typeCode << "using double";
+        return DoubleKind;
+    }
+}
+
+int AP2DataPlotColumn::elementSize(const Kind kind)
+{
+    switch (kind)
+    {
+    case Int32Kind:
+        return sizeof(qint32);
+    case UInt32Kind:
+        return sizeof(quint32);
+    case Int64Kind:
+        return sizeof(qint64);
+    case UInt64Kind:
+        return sizeof(quint64);
+    case FloatKind:
+        return sizeof(float);
+    case DoubleKind:
+        return sizeof(double);
+    case TextKind:
+        return sizeof(quint32);
+    }
+    return sizeof(double);
+}
+
+void AP2DataPlotColumn::reserve(const int rows)
+{
+    m_data.reserve(rows * elementSize(m_kind));
+}
+
+void AP2DataPlotColumn::squeeze()
+{
+    m_data.squeeze();
+    m_dictionary.squeeze();
+    m_nullRows.squeeze();
+}
+
+void AP2DataPlotColumn::truncate(const int rows)
+{
+    if (rows < m_size)
+    {
+        m_data.resize(rows * elementSize(m_kind));
+        m_size = rows;
+        while (!m_nullRows.isEmpty() && (m_nullRows.last() >= rows))
+        {
+            m_nullRows.removeLast();
+        }
+    }
+}
+
+void AP2DataPlotColumn::append(const AP2DataPlotColumn &other)
+{
+    if (other.m_kind != m_kind)
+    {
+        for (int row = 0; row < other.size(); ++row)
+        {
+            append(other.toVariant(row));
+        }
+        return;
+    }
+
+    for (int i = 0; i < other.m_nullRows.size(); ++i)
+    {
+        m_nullRows.push_back(m_size + other.m_nullRows.at(i));
+    }
+    if (m_kind == TextKind)
+    {
+        // dictionary ids of the other column have to be mapped to ours
+        QVector<quint32> idMap(other.m_dictionary.size());
+        for (int i = 0; i < other.m_dictionary.size(); ++i)
+        {
+            const QString &text = other.m_dictionary.at(i);
+            QHash<QString, quint32>::const_iterator iter = m_dictionaryLookup.constFind(text);
+            if (iter != m_dictionaryLookup.constEnd())
+            {
+                idMap[i] = iter.value();
+            }
+            else
+            {
+                idMap[i] = static_cast<quint32>(m_dictionary.size());
+                m_dictionary.push_back(text);
+                m_dictionaryLookup.insert(text, idMap[i]);
+            }
+        }
+        for (int row = 0; row < other.size(); ++row)
+        {
+            push<quint32>(idMap.at(other.at<quint32>(row)));
+        }
+    }
+    else
+    {
+        m_data.append(other.m_data.constData(), other.m_size * elementSize(m_kind));
+        m_size += other.m_size;
+    }
+}
+
+void AP2DataPlotColumn::append(const QVariant &value)
+{
+    if (!value.isValid())
+    {
+        m_nullRows.push_back(m_size);
+    }
+    switch (m_kind)
+    {
+    case Int32Kind:
+    case Int64Kind:
+        appendInteger(value.toLongLong());
+        break;
+    case UInt32Kind:
+    case UInt64Kind:
+        appendUnsigned(value.toULongLong());
+        break;
+    case FloatKind:
+    case DoubleKind:
+        appendDouble(value.toDouble());
+        break;
+    case TextKind:
+        appendText(value.toString());
+        break;
+    }
+}
+
+void AP2DataPlotColumn::appendInteger(const qint64 value)
+{
+    switch (m_kind)
+    {
+    case Int32Kind:
+        push<qint32>(static_cast<qint32>(value));
+        break;
+    case UInt32Kind:
+        push<quint32>(static_cast<quint32>(value));
+        break;
+    case Int64Kind:
+        push<qint64>(value);
+        break;
+    case UInt64Kind:
+        push<quint64>(static_cast<quint64>(value));
+        break;
+    case FloatKind:
+        push<float>(static_cast<float>(value));
+        break;
+    case DoubleKind:
+        push<double>(static_cast<double>(value));
+        break;
+    case TextKind:
+        appendText(QString::number(value));
+        break;
+    }
+}
+
+void AP2DataPlotColumn::appendUnsigned(const quint64 value)
+{
+    switch (m_kind)
+    {
+    case UInt64Kind:
+        push<quint64>(value);
+        break;
+    case UInt32Kind:
+        push<quint32>(static_cast<quint32>(value));
+        break;
+    case TextKind:
+        appendText(QString::number(value));
+        break;
+    default:
+        appendInteger(static_cast<qint64>(value));
+        break;
+    }
+}
+
+void AP2DataPlotColumn::appendDouble(const double value)
+{
+    switch (m_kind)
+    {
+    case FloatKind:
+        push<float>(static_cast<float>(value));
+        break;
+    case DoubleKind:
+        push<double>(value);
+        break;
+    case TextKind:
+        appendText(QString::number(value));
+        break;
+    case UInt32Kind:
+    case UInt64Kind:
+        appendUnsigned(static_cast<quint64>(value));
+        break;
+    default:
+        appendInteger(static_cast<qint64>(value));
+        break;
+    }
+}
+
+void AP2DataPlotColumn::appendText(const QString &value)
+{
+    if (m_kind != TextKind)
+    {
+        append(QVariant(value));
+        return;
+    }
+    QHash<QString, quint32>::const_iterator iter = m_dictionaryLookup.constFind(value);
+    if (iter != m_dictionaryLookup.constEnd())
+    {
+        push<quint32>(iter.value());
+    }
+    else
+    {
+        quint32 id = static_cast<quint32>(m_dictionary.size());
+        m_dictionary.push_back(value);
+        m_dictionaryLookup.insert(value, id);
+        push<quint32>(id);
+    }
+}
+
+double AP2DataPlotColumn::toDouble(const int row) const
+{
+    switch (m_kind)
+    {
+    case Int32Kind:
+        return at<qint32>(row);
+    case UInt32Kind:
+        return at<quint32>(row);
+    case Int64Kind:
+        return static_cast<double>(at<qint64>(row));
+    case UInt64Kind:
+        return static_cast<double>(at<quint64>(row));
+    case FloatKind:
+        return at<float>(row);
+    case DoubleKind:
+        return at<double>(row);
+    case TextKind:
+        return toText(row).toDouble();
+    }
+    return 0.0;
+}
+
+void AP2DataPlotColumn::formatValue(const int row, QByteArray &out) const
+{
+    if (isNull(row))
+    {
+        return;     // NULL values stay empty
+    }
+    switch (m_kind)
+    {
+    case Int32Kind:
+        out.append(QByteArray::number(at<qint32>(row)));
+        break;
+    case UInt32Kind:
+        out.append(QByteArray::number(at<quint32>(row)));
+        break;
+    case Int64Kind:
+        out.append(QByteArray::number(at<qint64>(row)));
+        break;
+    case UInt64Kind:
+        out.append(QByteArray::number(at<quint64>(row)));
+        break;
+    case FloatKind:
+        out.append(QByteArray::number(static_cast<double>(at<float>(row)), 'g', 9));
+        break;
+    case DoubleKind:
+        out.append(QByteArray::number(at<double>(row), 'g', 15));
+        break;
+    case TextKind:
+        out.append(m_dictionary.at(at<quint32>(row)).toLatin1());
+        break;
+    }
+}
+
+void AP2DataPlotColumn::appendDoubles(const QVector<int> &rows, QVector<double> &values) const
+{
+    values.reserve(values.size() + rows.size());
+    switch (m_kind)
+    {
+    case Int32Kind:
+        gather<qint32>(rows, values);
+        break;
+    case UInt32Kind:
+        gather<quint32>(rows, values);
+        break;
+    case Int64Kind:
+        gather<qint64>(rows, values);
+        break;
+    case UInt64Kind:
+        gather<quint64>(rows, values);
+        break;
+    case FloatKind:
+        gather<float>(rows, values);
+        break;
+    case DoubleKind:
+        gather<double>(rows, values);
+        break;
+    case TextKind:
+        foreach (const int row, rows)
+        {
+            values.append(toText(row).toDouble());
+        }
+        break;
+    }
+}
+
+qint64 AP2DataPlotColumn::toInteger(const int row) const
+{
+    switch (m_kind)
+    {
+    case Int32Kind:
+        return at<qint32>(row);
+    case UInt32Kind:
+        return at<quint32>(row);
+    case Int64Kind:
+        return at<qint64>(row);
+    case UInt64Kind:
+        return static_cast<qint64>(at<quint64>(row));
+    case TextKind:
+        return toText(row).toLongLong();
+    default:
+        return static_cast<qint64>(toDouble(row));
+    }
+}
+
+quint64 AP2DataPlotColumn::toUnsigned(const int row) const
+{
+    switch (m_kind)
+    {
+    case UInt64Kind:
+        return at<quint64>(row);
+    case UInt32Kind:
+        return at<quint32>(row);
+    case TextKind:
+        return toText(row).toULongLong();
+    default:
+        return static_cast<quint64>(toInteger(row));
+    }
+}
+
+QString AP2DataPlotColumn::toText(const int row) const
+{
+    if (m_kind == TextKind)
+    {
+        return m_dictionary.at(at<quint32>(row));
+    }
+    return toVariant(row).toString();
+}
+
+QVariant AP2DataPlotColumn::toVariant(const int row) const
+{
+    if ((row < 0) || (row >= m_size) || isNull(row))
+    {
+        return QVariant();
+    }
+    switch (m_kind)
+    {
+    case Int32Kind:
+        return QVariant(at<qint32>(row));
+    case UInt32Kind:
+        return QVariant(at<quint32>(row));
+    case Int64Kind:
+        return QVariant(at<qint64>(row));
+    case UInt64Kind:
+        return QVariant(at<quint64>(row));
+    case FloatKind:
+        return QVariant(static_cast<double>(at<float>(row)));
+    case DoubleKind:
+        return QVariant(at<double>(row));
+    case TextKind:
+        return QVariant(m_dictionary.at(at<quint32>(row)));
+    }
+    return QVariant();
+}
+
+bool AP2DataPlotColumn::isNull(const int row) const
+{
+    return !m_nullRows.isEmpty() && std::binary_search(m_nullRows.constBegin(), m_nullRows.constEnd(), row);
+}
+
+//********
+
+AP2DataPlotColumnStore::AP2DataPlotColumnStore()
+{
+}
+
+int AP2DataPlotColumnStore::addTable(const QString &name, const unsigned int typeID, const int length,
+                                     const QString &format, const QStringList &labels, const bool textFlightModes)
+{
+    int id = tableID(name);
+    if (id >= 0)
+    {
+        return id;
+    }
+
+    AP2DataPlotTable table;
+    table.m_name   = name;
+    table.m_typeID = typeID;
+    table.m_length = length;
+    table.m_format = format;
+    table.m_textFlightModes = textFlightModes;
+    for (int i = 0; i < labels.size(); ++i)
+    {
+        QString label = labels.at(i).trimmed();
+        QChar typeCode = i < format.size() ? format.at(i) : QChar('d');
+        table.m_labels.push_back(label);
+        table.m_labelToColumn.insert(label, i);
+        table.m_columns.push_back(AP2DataPlotColumn(AP2DataPlotColumn::kindForTypeCode(typeCode, textFlightModes)));
+    }
+
+    id = m_tables.size();
+    m_tables.push_back(table);
+    m_nameToTableID.insert(name, id);
+    return id;
+}
+
+bool AP2DataPlotColumnStore::appendRow(const int tableID, const quint32 index, const QList<QPair<QString,QVariant> > &values)
+{
+    if ((tableID < 0) || (tableID >= m_tables.size()))
+    {
+        return false;
+    }
+
+    AP2DataPlotTable &table = m_tables[tableID];
+    const int row = table.rowCount();
+    const int columnCount = table.m_columns.size();
+
+    for (int i = 0; i < values.size(); ++i)
+    {
+        // The parsers deliver the values in label order, so the name lookup
+        // is only needed if the order does not match.
+        int column = i;
+        if ((column >= columnCount) || (table.m_labels.at(column) != values.at(i).first))
+        {
+            column = table.columnIndex(values.at(i).first);
+            if (column < 0)
+            {
+                continue;
+            }
+        }
+        AP2DataPlotColumn &col = table.m_columns[column];
+        if (col.size() == row)
+        {
+            col.append(values.at(i).second);
+        }
+    }
+
+    // Fill up all columns which did not get a value
+    for (int i = 0; i < columnCount; ++i)
+    {
+        if (table.m_columns.at(i).size() == row)
+        {
+            table.m_columns[i].append(QVariant());
+        }
+    }
+
+    table.m_index.push_back(index);
+    m_rows.push_back(RowRef(static_cast<quint32>(tableID), static_cast<quint32>(row)));
+    return true;
+}
+
+bool AP2DataPlotColumnStore::appendRows(const AP2DataPlotColumnStore &other)
+{
+    if (other.m_tables.size() > m_tables.size())
+    {
+        return false;
+    }
+
+    QVector<quint32> rowOffsets(other.m_tables.size());
+    for (int i = 0; i < other.m_tables.size(); ++i)
+    {
+        AP2DataPlotTable &table = m_tables[i];
+        const AP2DataPlotTable &otherTable = other.m_tables.at(i);
+        if ((table.m_name != otherTable.m_name) || (table.m_columns.size() != otherTable.m_columns.size()))
+        {
+            return false;
+        }
+        rowOffsets[i] = static_cast<quint32>(table.rowCount());
+        for (int column = 0; column < table.m_columns.size(); ++column)
+        {
+            table.m_columns[column].append(otherTable.m_columns.at(column));
+        }
+        table.m_index += otherTable.m_index;
+    }
+
+    m_rows.reserve(m_rows.size() + other.m_rows.size());
+    foreach (const RowRef &ref, other.m_rows)
+    {
+        m_rows.push_back(RowRef(ref.m_tableID, ref.m_row + rowOffsets.at(ref.m_tableID)));
+    }
+    return true;
+}
+
+bool AP2DataPlotColumnStore::commitRow(const int tableID, const quint32 index)
+{
+    if ((tableID < 0) || (tableID >= m_tables.size()))
+    {
+        return false;
+    }
+
+    AP2DataPlotTable &table = m_tables[tableID];
+    const int row = table.rowCount();
+    for (int i = 0; i < table.m_columns.size(); ++i)
+    {
+        if (table.m_columns.at(i).size() == row)
+        {
+            table.m_columns[i].append(QVariant());
+        }
+    }
+
+    table.m_index.push_back(index);
+    m_rows.push_back(RowRef(static_cast<quint32>(tableID), static_cast<quint32>(row)));
+    return true;
+}
+
+void AP2DataPlotColumnStore::discardRow(const int tableID)
+{
+    if ((tableID < 0) || (tableID >= m_tables.size()))
+    {
+        return;
+    }
+
+    AP2DataPlotTable &table = m_tables[tableID];
+    for (int i = 0; i < table.m_columns.size(); ++i)
+    {
+        table.m_columns[i].truncate(table.rowCount());
+    }
+}
+
+QVariant AP2DataPlotColumnStore::value(const int row, const int field) const
+{
+    if ((row < 0) || (row >= m_rows.size()))
+    {
+        return QVariant();
+    }
+    const RowRef &ref = m_rows.at(row);
+    const AP2DataPlotTable &table = m_tables.at(ref.m_tableID);
+    if ((field < 0) || (field >= table.m_columns.size()))
+    {
+        return QVariant();
+    }
+    return table.m_columns.at(field).toVariant(ref.m_row);
+}
+
+void AP2DataPlotColumnStore::squeeze()
+{
+    for (int i = 0; i < m_tables.size(); ++i)
+    {
+        AP2DataPlotTable &table = m_tables[i];
+        table.m_index.squeeze();
+        for (int j = 0; j < table.m_columns.size(); ++j)
+        {
+            table.m_columns[j].squeeze();
+        }
+    }
+    m_rows.squeeze();
+}
+
+void AP2DataPlotColumnStore::clearRows()
+{
+    for (int i = 0; i < m_tables.size(); ++i)
+    {
+        AP2DataPlotTable &table = m_tables[i];
+        table.m_index.resize(0);
+        for (int j = 0; j < table.m_columns.size(); ++j)
+        {
+            table.m_columns[j].truncate(0);
+        }
+    }
+    m_rows.resize(0);
+}
+
+void AP2DataPlotColumnStore::clear()
+{
+    m_tables.clear();
+    m_nameToTableID.clear();
+    m_rows.clear();
+}
@@ -0,0 +1,325 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot columnar in memory storage for log data
+ *
+ */
+
+#ifndef AP2DATAPLOTCOLUMNSTORE_H
+#define AP2DATAPLOTCOLUMNSTORE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+/**
+ * @brief The AP2DataPlotColumn class holds all values of one field of a message
+ *        type in a contiguous typed buffer. The storage type is derived from the
+ *        format character of the FMT descriptor. Text values are interned in a
+ *        per column dictionary so repeated strings (parameter names, messages) are
+ *        only stored once.
+ */
+class AP2DataPlotColumn
+{
+public:
+    /**
+     * @brief The Kind enum
+     *        All storage types a column can have
+     */
+    enum Kind
+    {
+        Int32Kind,      /// b, B, h, H, i, M (binary logs)
+        UInt32Kind,     /// I
+        Int64Kind,      /// q
+        UInt64Kind,     /// Q
+        FloatKind,      /// f
+        DoubleKind,     /// c, C, e, E, L, d (scaled values)
+        TextKind        /// n, N, Z, M (ASCII logs)
+    };
+
+    AP2DataPlotColumn();
+    explicit AP2DataPlotColumn(const Kind kind);
+
+    /**
+     * @brief kindForTypeCode delivers the storage kind for a format character
+     *        as used in the FMT descriptors (see DataFlash.h).
+     *
+     * @param typeCode - format character like 'f' or 'Q'
+     * @param textFlightModes - true if flight modes are stored as names like
+     *                          in ASCII logs instead of mode numbers
+     * @return - The matching storage kind, DoubleKind for unknown characters
+     */
+    static Kind kindForTypeCode(const QChar typeCode, const bool textFlightModes = false);
+
+    Kind kind() const { return m_kind; }
+    int size() const { return m_size; }
+    bool isText() const { return m_kind == TextKind; }
+
+    void reserve(const int rows);
+    void squeeze();
+
+    /**
+     * @brief truncate removes all values behind rows
+     */
+    void truncate(const int rows);
+
+    /**
+     * @brief append appends all values of another column of the same kind
+     */
+    void append(const AP2DataPlotColumn &other);
+
+    /**
+     * @brief append converts the value to the storage type of this column and
+     *        appends it. Invalid values are stored as 0 or empty string and
+     *        the row is marked as NULL.
+     */
+    void append(const QVariant &value);
+
+    void appendInteger(const qint64 value);
+    void appendUnsigned(const quint64 value);
+    void appendDouble(const double value);
+    void appendText(const QString &value);
+
+    double toDouble(const int row) const;
+    qint64 toInteger(const int row) const;
+    quint64 toUnsigned(const int row) const;
+    QString toText(const int row) const;
+    QVariant toVariant(const int row) const;
+
+    /**
+     * @brief isNull checks if a row has no value. NULL rows deliver an invalid
+     *        QVariant by toVariant() and 0 or an empty string otherwise.
+     */
+    bool isNull(const int row) const;
+
+    /**
+     * @brief formatValue appends the value of a row as text to out. Floats are
+     *        written with 9 significant digits which restore every float exactly,
+     *        doubles with 15 significant digits. NULL values append nothing.
+     */
+    void formatValue(const int row, QByteArray &out) const;
+
+    /**
+     * @brief appendDoubles converts the values of the given rows to double and
+     *        appends them to values. The storage type is only dispatched once.
+     */
+    void appendDoubles(const QVector<int> &rows, QVector<double> &values) const;
+
+    /**
+     * @brief rawData delivers a pointer to the contiguous typed buffer. The element
+     *        type depends on kind(). Text columns hold quint32 dictionary ids.
+     */
+    const char *rawData() const { return m_data.constData(); }
+
+    bool operator==(const AP2DataPlotColumn &other) const
+    {
+        return (m_kind == other.m_kind) && (m_size == other.m_size) &&
+               (m_data == other.m_data) && (m_dictionary == other.m_dictionary) &&
+               (m_nullRows == other.m_nullRows);
+    }
+
+private:
+    friend class AP2DataPlotLogCache;   /// Maps columns from a log cache file
+
+    template <typename T> inline void push(const T value)
+    {
+        m_data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        ++m_size;
+    }
+
+    template <typename T> inline T at(const int row) const
+    {
+        return reinterpret_cast<const T*>(m_data.constData())[row];
+    }
+
+    template <typename T> inline void gather(const QVector<int> &rows, QVector<double> &values) const
+    {
+        const T *data = reinterpret_cast<const T*>(m_data.constData());
+        for (QVector<int>::const_iterator row = rows.constBegin(); row != rows.constEnd(); ++row)
+        {
+            values.append(static_cast<double>(data[*row]));
+        }
+    }
+
+    static int elementSize(const Kind kind);
+
+    Kind m_kind;                            /// Storage type of this column
+    int m_size;                             /// Number of stored values
+    QByteArray m_data;                      /// Typed contiguous value buffer
+    QVector<QString> m_dictionary;          /// Interned strings of a text column
+    QVector<qint32> m_nullRows;             /// Ascending rows without a value
+    QHash<QString, quint32> m_dictionaryLookup; /// String to dictionary id
+};
+
+/**
+ * @brief The AP2DataPlotTable struct holds all data of one message type. It is
+ *        created from a FMT descriptor and holds one column per label.
+ */
+struct AP2DataPlotTable
+{
+    QString m_name;                     /// Name of the message type like "ATT"
+    unsigned int m_typeID;              /// Type id from FMT message
+    int m_length;                       /// Length from FMT message
+    QString m_format;                   /// Format string like "QccC"
+    QStringList m_labels;               /// Name of each field
+    QHash<QString, int> m_labelToColumn;/// Field name to column index
+    QVector<quint32> m_index;           /// Log index of each row
+    QVector<AP2DataPlotColumn> m_columns;/// One column per field
+    bool m_textFlightModes;             /// 'M' fields hold mode names instead of numbers
+
+    AP2DataPlotTable() : m_typeID(0), m_length(0), m_textFlightModes(false) {}
+
+    int rowCount() const { return m_index.size(); }
+
+    /**
+     * @brief columnIndex delivers the column index of a field.
+     * @return column index or -1 if the field does not exist.
+     */
+    int columnIndex(const QString &label) const { return m_labelToColumn.value(label, -1); }
+};
+
+/**
+ * @brief The AP2DataPlotColumnStore class is the columnar in memory storage used
+ *        by the AP2DataPlot2DModel. It holds a table per message type and a compact
+ *        global row index which keeps the order of all rows as they were read from
+ *        the log.
+ */
+class AP2DataPlotColumnStore
+{
+public:
+    /**
+     * @brief The RowRef struct references a row of a table. It is used as global
+     *        row index and is 8 bytes in size.
+     */
+    struct RowRef
+    {
+        quint32 m_tableID;  /// Index of the table
+        quint32 m_row;      /// Row within the table
+
+        RowRef() : m_tableID(0), m_row(0) {}
+        RowRef(const quint32 tableID, const quint32 row) : m_tableID(tableID), m_row(row) {}
+    };
+
+    AP2DataPlotColumnStore();
+
+    /**
+     * @brief addTable adds a new message type. If a table with this name already
+     *        exists its id is returned and nothing is changed.
+     *
+     * @param textFlightModes - true if 'M' fields hold mode names (ASCII logs)
+     * @return id of the table
+     */
+    int addTable(const QString &name, const unsigned int typeID, const int length,
+                 const QString &format, const QStringList &labels, const bool textFlightModes = false);
+
+    /**
+     * @brief tableID delivers the id of a table
+     * @return id of the table or -1 if there is no table with this name
+     */
+    int tableID(const QString &name) const { return m_nameToTableID.value(name, -1); }
+
+    int tableCount() const { return m_tables.size(); }
+    const AP2DataPlotTable &table(const int tableID) const { return m_tables.at(tableID); }
+
+    /**
+     * @brief appendRow appends a row to a table and to the global row index.
+     *        The values are matched to the columns by their name. Columns
+     *        without a value get a default value.
+     *
+     * @param tableID - id of the table to add the row to
+     * @param index - log index of the row
+     * @param values - name value pairs of the row
+     * @return true on success, false if tableID is invalid
+     */
+    bool appendRow(const int tableID, const quint32 index, const QList<QPair<QString,QVariant> > &values);
+
+    /**
+     * @brief column delivers a column for direct typed appending. After all
+     *        columns of a table got their value commitRow() must be called to
+     *        complete the row, or discardRow() to drop the appended values.
+     */
+    AP2DataPlotColumn &column(const int tableID, const int column) { return m_tables[tableID].m_columns[column]; }
+
+    /**
+     * @brief commitRow completes a row whose values were appended directly to
+     *        the columns. Columns without a value get a default value.
+     *
+     * @param tableID - id of the table
+     * @param index - log index of the row
+     * @return true on success, false if tableID is invalid
+     */
+    bool commitRow(const int tableID, const quint32 index);
+
+    /**
+     * @brief discardRow drops all values appended directly to the columns
+     *        since the last complete row.
+     */
+    void discardRow(const int tableID);
+
+    /**
+     * @brief appendRows appends all rows of another store behind the rows of this
+     *        store. The other store must hold the same tables in the same order,
+     *        it may hold less tables.
+     *
+     * @return true on success, false if the tables do not match
+     */
+    bool appendRows(const AP2DataPlotColumnStore &other);
+
+    int rowCount() const { return m_rows.size(); }
+    const RowRef &rowAt(const int row) const { return m_rows.at(row); }
+
+    /**
+     * @brief value delivers a field of a row in global row order
+     *
+     * @param row - global row
+     * @param field - field index within the message type
+     * @return The value or an invalid QVariant if field does not exist
+     */
+    QVariant value(const int row, const int field) const;
+
+    /**
+     * @brief squeeze releases all memory reserved for growing
+     */
+    void squeeze();
+
+    /**
+     * @brief clearRows removes all rows but keeps the tables and their columns
+     */
+    void clearRows();
+
+    void clear();
+
+private:
+    friend class AP2DataPlotLogCache;   /// Restores the store from a log cache file
+
+    QVector<AP2DataPlotTable> m_tables;     /// All message tables
+    QHash<QString, int> m_nameToTableID;    /// Table name to table id
+    QVector<RowRef> m_rows;                 /// Global row index
+};
+
+#endif // AP2DATAPLOTCOLUMNSTORE_H
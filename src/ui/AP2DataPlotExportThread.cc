@@ -0,0 +1,245 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot background export of loaded logs
+ *
+ */
+
+#include "AP2DataPlotExportThread.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QVector>
+#include "QsLog.h"
+#include "kmlcreator.h"
+
+namespace
+{
+    // Number of rows formatted by one task
+    const int CHUNK_ROWS = 16384;
+    // Each thread may have this number of formatted chunks waiting to be written
+    const int CHUNKS_PER_THREAD = 2;
+}
+
+/**
+ * @brief The ChunkTask class formats a range of rows of the column store into
+ *        log lines.
+ */
+class AP2DataPlotExportThread::ChunkTask : public QRunnable
+{
+public:
+    ChunkTask(const AP2DataPlotColumnStore &store, const QVector<QByteArray> &names,
+              const int firstRow, const int lastRow) :
+        m_lastRow(lastRow),
+        m_store(store),
+        m_names(names),
+        m_firstRow(firstRow)
+    {
+        setAutoDelete(false);
+    }
+
+    void run()
+    {
+        // Estimate the size to avoid reallocations while formatting
+        m_output.reserve((m_lastRow - m_firstRow) * 64);
+        for (int row = m_firstRow; row < m_lastRow; ++row)
+        {
+            const AP2DataPlotColumnStore::RowRef &ref = m_store.rowAt(row);
+            const AP2DataPlotTable &table = m_store.table(ref.m_tableID);
+            m_output.append(m_names.at(ref.m_tableID));
+            for (int column = 0; column < table.m_columns.size(); ++column)
+            {
+                m_output.append(", ");
+                table.m_columns.at(column).formatValue(ref.m_row, m_output);
+            }
+            m_output.append("\r\n");
+        }
+        m_done.release();
+    }
+
+    /**
+     * @brief waitForDone blocks until the chunk is formatted
+     */
+    void waitForDone() { m_done.acquire(); }
+
+    QByteArray m_output;                    /// Formatted lines of the chunk
+    const int m_lastRow;
+
+private:
+    const AP2DataPlotColumnStore &m_store;
+    const QVector<QByteArray> &m_names;
+    const int m_firstRow;
+    QSemaphore m_done;
+};
+
+AP2DataPlotExportThread::AP2DataPlotExportThread(AP2DataPlot2DModel *model, QObject *parent) :
+    QThread(parent),
+    m_dataModel(model),
+    m_format(LogFormat),
+    m_threadCount(QThread::idealThreadCount()),
+    m_stop(false)
+{
+}
+
+AP2DataPlotExportThread::~AP2DataPlotExportThread()
+{
+    m_stop = true;
+    wait();
+}
+
+void AP2DataPlotExportThread::exportFile(const QString &fileName, const Format format)
+{
+    m_fileName = fileName;
+    m_format = format;
+    m_stop = false;
+    start();
+}
+
+void AP2DataPlotExportThread::setThreadCount(const int count)
+{
+    m_threadCount = qMax(1, count);
+}
+
+QByteArray AP2DataPlotExportThread::formatHeader() const
+{
+    QByteArray header = "FMT, 128, 89, FMT, BBnNZ, Type,Length,Name,Format,Columns\r\n";
+    QMap<QString,QList<QString> > fmtlist = m_dataModel->getFmtValues();
+    for (QMap<QString,QList<QString> >::const_iterator i = fmtlist.constBegin(); i != fmtlist.constEnd(); ++i)
+    {
+        QString line = m_dataModel->getFmtLine(i.key());
+        if (!line.isEmpty())
+        {
+            header += line.toLatin1();
+            header += "\r\n";
+        }
+    }
+    return header;
+}
+
+void AP2DataPlotExportThread::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile outputfile(m_fileName);
+    kml::KMLCreator kmlExporter;
+    if (m_format == KmlFormat)
+    {
+        kmlExporter.start(m_fileName);
+    }
+    else if (!outputfile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        emit error("Unable to open output file: " + outputfile.errorString());
+        return;
+    }
+
+    const AP2DataPlotColumnStore &store = m_dataModel->columnStore();
+    QVector<QByteArray> names(store.tableCount());
+    for (int i = 0; i < store.tableCount(); ++i)
+    {
+        names[i] = store.table(i).m_name.toLatin1();
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_threadCount);
+    QList<ChunkTask*> pending;      // Chunks in log order waiting to be written
+    const int rowCount = store.rowCount();
+    int nextRow = 0;
+    bool failed = false;
+
+    QByteArray output = formatHeader();
+    while (!m_stop && !failed)
+    {
+        // Write the next chunk in log order
+        if (m_format == KmlFormat)
+        {
+            int start = 0;
+            int end = output.indexOf('\n');
+            while (end >= 0)
+            {
+                QString line = QString::fromLatin1(output.constData() + start, end + 1 - start);
+                kmlExporter.processLine(line);
+                start = end + 1;
+                end = output.indexOf('\n', start);
+            }
+        }
+        else if (outputfile.write(output) != output.size())
+        {
+            emit error("Unable to write output file: " + outputfile.errorString());
+            failed = true;
+            break;
+        }
+
+        // Keep all threads busy formatting the next chunks
+        while ((nextRow < rowCount) && (pending.size() < m_threadCount * CHUNKS_PER_THREAD))
+        {
+            ChunkTask *task = new ChunkTask(store, names, nextRow, qMin(nextRow + CHUNK_ROWS, rowCount));
+            nextRow = task->m_lastRow;
+            pending.append(task);
+            pool.start(task);
+        }
+        if (pending.isEmpty())
+        {
+            break;
+        }
+
+        ChunkTask *task = pending.takeFirst();
+        task->waitForDone();
+        output.clear();
+        output.swap(task->m_output);
+        emit exportProgress(task->m_lastRow, rowCount);
+        delete task;
+    }
+
+    pool.clear();
+    pool.waitForDone();
+    qDeleteAll(pending);
+
+    if (failed)
+    {
+        outputfile.close();
+        return;
+    }
+    if (m_stop)
+    {
+        outputfile.close();
+        QLOG_INFO() << "Log export was canceled after" << timer.elapsed() << "ms";
+        emit canceled();
+        return;
+    }
+
+    QString generated = m_fileName;
+    if (m_format == KmlFormat)
+    {
+        generated = kmlExporter.finish(true);
+    }
+    else
+    {
+        outputfile.close();
+    }
+    QLOG_INFO() << "Log export of" << rowCount << "rows took" << timer.elapsed() << "ms";
+    emit done(generated);
+}
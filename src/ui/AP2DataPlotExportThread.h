@@ -0,0 +1,101 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot background export of loaded logs
+ *
+ */
+
+#ifndef AP2DATAPLOTEXPORTTHREAD_H
+#define AP2DATAPLOTEXPORTTHREAD_H
+
+#include <QThread>
+#include <QString>
+#include "AP2DataPlot2DModel.h"
+
+/**
+ * @brief The AP2DataPlotExportThread class exports all rows of a loaded log into
+ *        a text log or a KML file without blocking the GUI. The values are read
+ *        directly from the typed columns of the model. The rows are split into
+ *        chunks which are formatted by a thread pool, while this thread writes
+ *        the formatted chunks in log order to the output file.
+ *
+ *        The model must not be changed while the export is running.
+ */
+class AP2DataPlotExportThread : public QThread
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief The Format enum
+     *        All supported output formats
+     */
+    enum Format
+    {
+        LogFormat,      /// Text dataflash log
+        KmlFormat       /// KML file created by the KMLCreator
+    };
+
+    explicit AP2DataPlotExportThread(AP2DataPlot2DModel *model, QObject *parent = 0);
+    ~AP2DataPlotExportThread();
+
+    /**
+     * @brief exportFile starts exporting the model into a file
+     *
+     * @param fileName - Name of the file to create
+     * @param format - Format of the file
+     */
+    void exportFile(const QString &fileName, const Format format);
+
+    /**
+     * @brief setThreadCount sets the number of threads used for formatting.
+     *        Default is QThread::idealThreadCount().
+     */
+    void setThreadCount(const int count);
+
+public slots:
+    void stopExport() { m_stop = true; }
+
+signals:
+    void exportProgress(qint64 pos, qint64 size);
+    void done(QString fileName);
+    void error(QString errorstr);
+    void canceled();
+
+private:
+    class ChunkTask;
+
+    void run(); // from QThread;
+
+    /**
+     * @brief formatHeader delivers the FMT lines of all message types of the log
+     */
+    QByteArray formatHeader() const;
+
+    AP2DataPlot2DModel *m_dataModel;
+    QString m_fileName;
+    Format m_format;
+    int m_threadCount;
+    bool m_stop;
+};
+
+#endif // AP2DATAPLOTEXPORTTHREAD_H
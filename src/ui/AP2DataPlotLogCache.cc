@@ -0,0 +1,433 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot persistent cache for decoded logs
+ *
+ */
+
+#include "AP2DataPlotLogCache.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QVector>
+#include <cstring>
+#include "QsLog.h"
+
+namespace
+{
+    // The key is built from this number of samples spread over the whole log
+    const int KEY_SAMPLE_COUNT = 16;
+    // Size of each sample
+    const qint64 KEY_SAMPLE_SIZE = 64 * 1024;
+    // Default maximum size of all cache files
+    const qint64 DEFAULT_MAX_SIZE = Q_INT64_C(4) * 1024 * 1024 * 1024;
+    // All data blocks start at a multiple of this value
+    const qint64 BLOCK_ALIGNMENT = 8;
+
+    qint64 alignBlock(const qint64 pos)
+    {
+        return (pos + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1);
+    }
+
+    /**
+     * @brief The blockRef struct describes a data block in the mapped cache file
+     */
+    struct blockRef
+    {
+        qint64 m_offset;    /// Offset of the block in the file
+        qint64 m_size;      /// Size of the block in bytes
+
+        blockRef() : m_offset(0), m_size(0) {}
+    };
+
+    /**
+     * @brief locateBlock places a block of size bytes at the next aligned position
+     *        behind pos like AP2DataPlotLogCache::writeBlock does.
+     *
+     * @param pos - end of the previous block, moved behind this block
+     * @param end - receives the end of this block
+     */
+    void locateBlock(blockRef &block, const qint64 size, qint64 &pos, qint64 &end)
+    {
+        block.m_offset = alignBlock(pos);
+        block.m_size = size;
+        pos = block.m_offset + size;
+        end = pos;
+    }
+
+    /**
+     * @brief The cachedColumn struct holds the description of a stored column
+     */
+    struct cachedColumn
+    {
+        qint32 m_kind;
+        qint32 m_size;
+        QVector<QString> m_dictionary;
+        QVector<qint32> m_nullRows;
+        blockRef m_block;
+    };
+
+    /**
+     * @brief The cachedTable struct holds the description of a stored table
+     */
+    struct cachedTable
+    {
+        QString m_name;
+        quint32 m_typeID;
+        qint32 m_length;
+        QString m_format;
+        QStringList m_labels;
+        qint32 m_rows;
+        blockRef m_index;
+        QVector<cachedColumn> m_columns;
+    };
+}
+
+AP2DataPlotLogCache::AP2DataPlotLogCache(const QString &directory) :
+    m_directory(directory),
+    m_maxSize(DEFAULT_MAX_SIZE)
+{
+}
+
+bool AP2DataPlotLogCache::open(QFile &logfile)
+{
+    const qint64 pos = logfile.pos();
+    const qint64 size = logfile.size();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(ParserVersion));
+    hash.addData(QByteArray::number(size));
+    hash.addData(QFileInfo(logfile).suffix().toLower().toLatin1());
+
+    // Logs differ in their timestamps all over the file, so some samples are
+    // enough to identify a log. The last sample always covers the end.
+    const int samples = size > KEY_SAMPLE_SIZE ? KEY_SAMPLE_COUNT : 0;
+    for (int i = 0; i <= samples; ++i)
+    {
+        const qint64 samplePos = samples > 0 ? ((size - KEY_SAMPLE_SIZE) * i) / samples : 0;
+        if (!logfile.seek(samplePos))
+        {
+            m_key.clear();
+            logfile.seek(pos);
+            return false;
+        }
+        hash.addData(logfile.read(KEY_SAMPLE_SIZE));
+    }
+    logfile.seek(pos);
+
+    m_key = hash.result().toHex();
+    return true;
+}
+
+QString AP2DataPlotLogCache::fileName() const
+{
+    return QDir(m_directory).filePath(QString::fromLatin1(m_key) + ".apc");
+}
+
+bool AP2DataPlotLogCache::load(AP2DataPlot2DModel *model, AP2DataPlotStatus &status, MAV_TYPE &logType,
+                               QString &timeStampName, double &timeStampDivisor)
+{
+    if (m_key.isEmpty() || (model->m_store.tableCount() != 0))
+    {
+        return false;
+    }
+
+    QSharedPointer<QFile> file(new QFile(fileName()));
+    if (!file->exists() || !file->open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    const qint64 size = file->size();
+    const uchar *data = file->map(0, size);
+    if (!data || (size < 8))
+    {
+        return false;
+    }
+
+    // Magic and version are stored in native byte order like the data blocks,
+    // so a cache of a machine with other endianness is rejected here.
+    quint32 magic = 0;
+    quint32 formatVersion = 0;
+    memcpy(&magic, data, sizeof(magic));
+    memcpy(&formatVersion, data + sizeof(magic), sizeof(formatVersion));
+    if ((magic != s_magic) || (formatVersion != s_formatVersion))
+    {
+        QLOG_DEBUG() << "AP2DataPlotLogCache::load(): Cache file" << file->fileName() << "has an unknown format";
+        return false;
+    }
+
+    // Read the directory
+    file->seek(8);
+    QDataStream in(file.data());
+    in.setVersion(QDataStream::Qt_5_0);
+
+    QByteArray key;
+    qint32 type = 0;
+    QString tsName;
+    double tsDivisor = 0.0;
+    AP2DataPlotStatus cachedStatus;
+    quint64 firstIndex = 0;
+    quint64 lastIndex = 0;
+    qint32 rowCount = 0;
+    qint32 columnCount = 0;
+    qint32 tableCount = 0;
+    in >> key >> type >> tsName >> tsDivisor >> cachedStatus;
+    in >> firstIndex >> lastIndex >> rowCount >> columnCount >> tableCount;
+    if ((in.status() != QDataStream::Ok) || (key != m_key) || (tableCount < 0) || (rowCount < 0))
+    {
+        return false;
+    }
+
+    QVector<cachedTable> tables(tableCount);
+    for (int i = 0; i < tableCount; ++i)
+    {
+        cachedTable &table = tables[i];
+        qint32 columns = 0;
+        in >> table.m_name >> table.m_typeID >> table.m_length >> table.m_format >> table.m_labels;
+        in >> table.m_rows >> columns;
+        if ((in.status() != QDataStream::Ok) || (table.m_rows < 0) || (columns != table.m_labels.size()))
+        {
+            return false;
+        }
+        table.m_columns.resize(columns);
+        for (int j = 0; j < columns; ++j)
+        {
+            cachedColumn &column = table.m_columns[j];
+            in >> column.m_kind >> column.m_size >> column.m_dictionary >> column.m_nullRows;
+            if ((column.m_kind < AP2DataPlotColumn::Int32Kind) || (column.m_kind > AP2DataPlotColumn::TextKind) ||
+                (column.m_size != table.m_rows))
+            {
+                return false;
+            }
+            for (int k = 0; k < column.m_nullRows.size(); ++k)
+            {
+                if ((column.m_nullRows.at(k) < (k > 0 ? column.m_nullRows.at(k - 1) + 1 : 0)) ||
+                    (column.m_nullRows.at(k) >= column.m_size))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    qint32 timeIndexCount = 0;
+    in >> timeIndexCount;
+    if ((in.status() != QDataStream::Ok) || (timeIndexCount < 0))
+    {
+        return false;
+    }
+
+    // Locate all data blocks and check that they are within the file
+    qint64 pos = file->pos();
+    qint64 end = pos;
+    for (int i = 0; i < tables.size(); ++i)
+    {
+        cachedTable &table = tables[i];
+        locateBlock(table.m_index, static_cast<qint64>(table.m_rows) * sizeof(quint32), pos, end);
+        for (int j = 0; j < table.m_columns.size(); ++j)
+        {
+            cachedColumn &column = table.m_columns[j];
+            locateBlock(column.m_block, static_cast<qint64>(column.m_size) *
+                        AP2DataPlotColumn::elementSize(static_cast<AP2DataPlotColumn::Kind>(column.m_kind)), pos, end);
+        }
+    }
+    blockRef rows;
+    locateBlock(rows, static_cast<qint64>(rowCount) * sizeof(AP2DataPlotColumnStore::RowRef), pos, end);
+    blockRef timeIndex;
+    locateBlock(timeIndex, static_cast<qint64>(timeIndexCount) * sizeof(AP2DataPlotTimeIndex::Entry), pos, end);
+    if (end > size)
+    {
+        QLOG_DEBUG() << "AP2DataPlotLogCache::load(): Cache file" << file->fileName() << "is truncated";
+        return false;
+    }
+
+    // All checks passed - fill the model
+    for (int i = 0; i < tables.size(); ++i)
+    {
+        const cachedTable &table = tables.at(i);
+        // ASCII logs store flight modes as text
+        bool textFlightModes = false;
+        for (int j = 0; j < table.m_columns.size() && j < table.m_format.size(); ++j)
+        {
+            textFlightModes |= (table.m_format.at(j) == 'M') &&
+                               (table.m_columns.at(j).m_kind == AP2DataPlotColumn::TextKind);
+        }
+        model->addType(table.m_name, table.m_typeID, table.m_length, table.m_format, table.m_labels, textFlightModes);
+    }
+    AP2DataPlotColumnStore &store = model->m_store;
+    for (int i = 0; i < tables.size(); ++i)
+    {
+        const cachedTable &cached = tables.at(i);
+        AP2DataPlotTable &table = store.m_tables[store.tableID(cached.m_name)];
+        table.m_index.resize(cached.m_rows);
+        memcpy(table.m_index.data(), data + cached.m_index.m_offset, cached.m_index.m_size);
+        for (int j = 0; j < cached.m_columns.size(); ++j)
+        {
+            const cachedColumn &cachedCol = cached.m_columns.at(j);
+            AP2DataPlotColumn &column = table.m_columns[j];
+            // The column refers to the mapped data. It is only copied if it is changed.
+            column.m_kind = static_cast<AP2DataPlotColumn::Kind>(cachedCol.m_kind);
+            column.m_data = QByteArray::fromRawData(reinterpret_cast<const char*>(data + cachedCol.m_block.m_offset),
+                                                    static_cast<int>(cachedCol.m_block.m_size));
+            column.m_size = cachedCol.m_size;
+            column.m_dictionary = cachedCol.m_dictionary;
+            column.m_nullRows = cachedCol.m_nullRows;
+            column.m_dictionaryLookup.clear();
+            for (int k = 0; k < column.m_dictionary.size(); ++k)
+            {
+                column.m_dictionaryLookup.insert(column.m_dictionary.at(k), static_cast<quint32>(k));
+            }
+        }
+    }
+    store.m_rows.resize(rowCount);
+    memcpy(store.m_rows.data(), data + rows.m_offset, rows.m_size);
+    model->m_timeIndex.append(reinterpret_cast<const AP2DataPlotTimeIndex::Entry*>(data + timeIndex.m_offset),
+                              timeIndexCount, 0);
+    model->m_firstIndex = firstIndex;
+    model->m_lastIndex = lastIndex;
+    model->m_rowCount = rowCount;
+    model->m_columnCount = columnCount;
+    model->m_cacheFile = file;  // keeps the mapping alive as long as the model exists
+
+    status = cachedStatus;
+    logType = static_cast<MAV_TYPE>(type);
+    timeStampName = tsName;
+    timeStampDivisor = tsDivisor;
+    return true;
+}
+
+bool AP2DataPlotLogCache::save(const AP2DataPlot2DModel &model, const AP2DataPlotStatus &status, const MAV_TYPE logType,
+                               const QString &timeStampName, const double timeStampDivisor)
+{
+    if (m_key.isEmpty())
+    {
+        setError("No log opened for caching");
+        return false;
+    }
+    if (!QDir().mkpath(m_directory))
+    {
+        setError("Unable to create log cache directory " + m_directory);
+        return false;
+    }
+
+    QSaveFile file(fileName());
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        setError("Unable to create log cache file " + file.fileName() + ": " + file.errorString());
+        return false;
+    }
+
+    const quint32 magic = s_magic;
+    const quint32 formatVersion = s_formatVersion;
+    writeBlock(file, reinterpret_cast<const char*>(&magic), sizeof(magic));
+    writeBlock(file, reinterpret_cast<const char*>(&formatVersion), sizeof(formatVersion));
+
+    // Directory
+    const AP2DataPlotColumnStore &store = model.m_store;
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << m_key << static_cast<qint32>(logType) << timeStampName << timeStampDivisor << status;
+    out << static_cast<quint64>(model.m_firstIndex) << static_cast<quint64>(model.m_lastIndex);
+    out << static_cast<qint32>(model.m_rowCount) << static_cast<qint32>(model.m_columnCount);
+    out << static_cast<qint32>(store.tableCount());
+    for (int i = 0; i < store.tableCount(); ++i)
+    {
+        const AP2DataPlotTable &table = store.table(i);
+        out << table.m_name << static_cast<quint32>(table.m_typeID) << static_cast<qint32>(table.m_length);
+        out << table.m_format << table.m_labels;
+        out << static_cast<qint32>(table.rowCount()) << static_cast<qint32>(table.m_columns.size());
+        for (int j = 0; j < table.m_columns.size(); ++j)
+        {
+            const AP2DataPlotColumn &column = table.m_columns.at(j);
+            out << static_cast<qint32>(column.kind()) << static_cast<qint32>(column.size()) << column.m_dictionary
+                << column.m_nullRows;
+        }
+    }
+    out << static_cast<qint32>(model.m_timeIndex.size());
+
+    // Data blocks
+    bool ok = (out.status() == QDataStream::Ok);
+    for (int i = 0; ok && (i < store.tableCount()); ++i)
+    {
+        const AP2DataPlotTable &table = store.table(i);
+        ok = writeBlock(file, reinterpret_cast<const char*>(table.m_index.constData()),
+                        static_cast<qint64>(table.m_index.size()) * sizeof(quint32));
+        for (int j = 0; ok && (j < table.m_columns.size()); ++j)
+        {
+            const AP2DataPlotColumn &column = table.m_columns.at(j);
+            ok = writeBlock(file, column.rawData(),
+                            static_cast<qint64>(column.size()) * AP2DataPlotColumn::elementSize(column.kind()));
+        }
+    }
+    ok = ok && writeBlock(file, reinterpret_cast<const char*>(store.m_rows.constData()),
+                          static_cast<qint64>(store.m_rows.size()) * sizeof(AP2DataPlotColumnStore::RowRef));
+    ok = ok && writeBlock(file, reinterpret_cast<const char*>(model.m_timeIndex.entries().constData()),
+                          static_cast<qint64>(model.m_timeIndex.size()) * sizeof(AP2DataPlotTimeIndex::Entry));
+
+    if (!ok || !file.commit())
+    {
+        setError("Unable to write log cache file " + file.fileName() + ": " + file.errorString());
+        file.cancelWriting();
+        return false;
+    }
+
+    removeOldFiles();
+    return true;
+}
+
+bool AP2DataPlotLogCache::writeBlock(QIODevice &device, const char *data, const qint64 size)
+{
+    // Every block starts aligned so it can be used directly from the mapped file
+    static const char padding[BLOCK_ALIGNMENT] = { 0 };
+    const qint64 paddingSize = alignBlock(device.pos()) - device.pos();
+    if ((paddingSize > 0) && (device.write(padding, paddingSize) != paddingSize))
+    {
+        return false;
+    }
+    return (size == 0) || (device.write(data, size) == size);
+}
+
+void AP2DataPlotLogCache::removeOldFiles()
+{
+    const QFileInfoList files = QDir(m_directory).entryInfoList(QStringList("*.apc"), QDir::Files, QDir::Time);
+    const QString current = QFileInfo(fileName()).fileName();
+    qint64 totalSize = 0;
+    // newest files first
+    foreach (const QFileInfo &info, files)
+    {
+        totalSize += info.size();
+        if ((totalSize > m_maxSize) && (info.fileName() != current))
+        {
+            QLOG_DEBUG() << "AP2DataPlotLogCache::removeOldFiles(): Removing" << info.fileName();
+            QFile::remove(info.absoluteFilePath());
+            totalSize -= info.size();
+        }
+    }
+}
+
+void AP2DataPlotLogCache::setError(const QString &error)
+{
+    QLOG_ERROR() << error;
+    m_error = error;
+}
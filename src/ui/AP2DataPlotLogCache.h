@@ -0,0 +1,124 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot persistent cache for decoded logs
+ *
+ */
+
+#ifndef AP2DATAPLOTLOGCACHE_H
+#define AP2DATAPLOTLOGCACHE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include "AP2DataPlot2DModel.h"
+#include "AP2DataPlotStatus.h"
+#include "libs/mavlink/include/mavlink/v1.0/ardupilotmega/mavlink.h"
+
+/**
+ * @brief The AP2DataPlotLogCache class stores the decoded data of a log in a cache
+ *        file so reopening the same log does not need to parse it again.
+ *
+ *        Cache files are named by a key built from the content of the log, the
+ *        log type and the parser version, so a copied or renamed log still hits
+ *        the cache and a changed parser never delivers stale data. Only samples
+ *        of the log are hashed to keep the key fast even for huge logs.
+ *
+ *        The typed columns are stored 8 byte aligned exactly as they are held in
+ *        memory. When loading, the cache file is memory mapped and the columns of
+ *        the model refer directly to the mapped data, so only the row indexes are
+ *        copied.
+ */
+class AP2DataPlotLogCache
+{
+public:
+    /**
+     * @brief ParserVersion has to be increased whenever a log parser changes the
+     *        data it stores in the model. All existing cache files become invalid.
+     */
+    static const quint32 ParserVersion = 2;
+
+    /**
+     * @brief AP2DataPlotLogCache CTOR
+     * @param directory - Directory holding the cache files
+     */
+    explicit AP2DataPlotLogCache(const QString &directory);
+
+    /**
+     * @brief setMaxSize sets the maximum size of all cache files. The oldest files
+     *        are deleted when a new file is stored. Default is 4GB.
+     */
+    void setMaxSize(const qint64 bytes) { m_maxSize = bytes; }
+
+    /**
+     * @brief open computes the cache key of a log.
+     *
+     * @param logfile - opened log file. The file position is restored.
+     * @return true on success, false if the log could not be read
+     */
+    bool open(QFile &logfile);
+
+    /**
+     * @brief load fills an empty data model from the cache file of the opened log.
+     *
+     * @param model - empty data model
+     * @param status - receives the parsing status stored with the log
+     * @param logType - receives the vehicle type of the log
+     * @param timeStampName - receives the name of the timestamp field
+     * @param timeStampDivisor - receives the divisor scaling timestamps to seconds
+     * @return true on success, false if there is no valid cache file
+     */
+    bool load(AP2DataPlot2DModel *model, AP2DataPlotStatus &status, MAV_TYPE &logType,
+              QString &timeStampName, double &timeStampDivisor);
+
+    /**
+     * @brief save writes the data of a completely loaded model to the cache file
+     *        of the opened log.
+     *
+     * @return true on success, false otherwise. Use getError() for details.
+     */
+    bool save(const AP2DataPlot2DModel &model, const AP2DataPlotStatus &status, const MAV_TYPE logType,
+              const QString &timeStampName, const double timeStampDivisor);
+
+    QString getError() const { return m_error; }
+
+    /**
+     * @brief fileName delivers the name of the cache file of the opened log
+     */
+    QString fileName() const;
+
+private:
+    static const quint32 s_magic = 0x43504C41;     /// "ALPC" little endian
+    static const quint32 s_formatVersion = 4;      /// Version of the file layout
+
+    bool writeBlock(QIODevice &device, const char *data, const qint64 size);
+    void removeOldFiles();
+    void setError(const QString &error);
+
+    QString m_directory;    /// Directory holding the cache files
+    QByteArray m_key;       /// Cache key of the opened log
+    qint64 m_maxSize;       /// Maximum size of all cache files
+    QString m_error;
+};
+
+#endif // AP2DATAPLOTLOGCACHE_H
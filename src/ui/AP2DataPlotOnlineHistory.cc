@@ -0,0 +1,410 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot bounded history of the online graphs
+ *
+ */
+
+#include "AP2DataPlotOnlineHistory.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    bool keyLess(const double key, const AP2DataPlotOnlineHistory::Sample &sample)
+    {
+        return key < sample.m_key;
+    }
+}
+
+AP2DataPlotOnlineHistory::AP2DataPlotOnlineHistory() :
+    m_bucketInterval(m_policy.m_bucketInterval),
+    m_nextCompaction(0.0),
+    m_sampleCount(0),
+    m_compactedCount(0)
+{
+}
+
+void AP2DataPlotOnlineHistory::setPolicy(const Policy &policy)
+{
+    m_policy = policy;
+    m_policy.m_bucketInterval = qMax(0.001, policy.m_bucketInterval);
+    m_policy.m_maxBucketInterval = qMax(m_policy.m_bucketInterval, policy.m_maxBucketInterval);
+    m_policy.m_maxSamples = qMax(1, policy.m_maxSamples);
+    m_bucketInterval = m_policy.m_bucketInterval;
+    m_nextCompaction = 0.0;
+}
+
+bool AP2DataPlotOnlineHistory::append(const QString &name, const double key, const double value)
+{
+    QHash<QString, Series>::iterator it = m_series.find(name);
+    const bool created = (it == m_series.end());
+    if (created)
+    {
+        it = m_series.insert(name, Series());
+    }
+    it.value().m_recent.append(Sample(key, value));
+    ++m_sampleCount;
+    return created;
+}
+
+void AP2DataPlotOnlineHistory::getSeries(const QString &name, QVector<double> &keys, QVector<double> &values) const
+{
+    keys.clear();
+    values.clear();
+    QHash<QString, Series>::const_iterator it = m_series.constFind(name);
+    if (it == m_series.constEnd())
+    {
+        return;
+    }
+    const Series &series = it.value();
+    keys.reserve(series.compactedCount() + series.recentCount());
+    values.reserve(series.compactedCount() + series.recentCount());
+    for (int i = series.m_compactedHead; i < series.m_compacted.size(); ++i)
+    {
+        keys.append(series.m_compacted.at(i).m_key);
+        values.append(series.m_compacted.at(i).m_value);
+    }
+    for (int i = series.m_recentHead; i < series.m_recent.size(); ++i)
+    {
+        keys.append(series.m_recent.at(i).m_key);
+        values.append(series.m_recent.at(i).m_value);
+    }
+}
+
+void AP2DataPlotOnlineHistory::getSamplesAfter(const QString &name, const double key,
+                                               QVector<double> &keys, QVector<double> &values) const
+{
+    keys.clear();
+    values.clear();
+    QHash<QString, Series>::const_iterator it = m_series.constFind(name);
+    if (it == m_series.constEnd())
+    {
+        return;
+    }
+    const Series &series = it.value();
+    const Sample *compactedBegin = series.m_compacted.constData() + series.m_compactedHead;
+    const Sample *compactedEnd = series.m_compacted.constData() + series.m_compacted.size();
+    const Sample *recentBegin = series.m_recent.constData() + series.m_recentHead;
+    const Sample *recentEnd = series.m_recent.constData() + series.m_recent.size();
+
+    for (const Sample *sample = std::upper_bound(compactedBegin, compactedEnd, key, keyLess);
+         sample != compactedEnd; ++sample)
+    {
+        keys.append(sample->m_key);
+        values.append(sample->m_value);
+    }
+    for (const Sample *sample = std::upper_bound(recentBegin, recentEnd, key, keyLess);
+         sample != recentEnd; ++sample)
+    {
+        keys.append(sample->m_key);
+        values.append(sample->m_value);
+    }
+}
+
+void AP2DataPlotOnlineHistory::compact(const double now, QList<Change> &changes)
+{
+    if (now < m_nextCompaction)
+    {
+        return;
+    }
+    m_nextCompaction = now + m_bucketInterval;
+
+    const double limit = now - m_policy.m_fullRateInterval;
+    for (QHash<QString, Series>::iterator it = m_series.begin(); it != m_series.end(); ++it)
+    {
+        compactSeries(it.key(), it.value(), limit, changes);
+    }
+
+    while (m_sampleCount > m_policy.m_maxSamples)
+    {
+        if ((m_compactedCount > m_policy.m_maxSamples / 2) &&
+            (m_bucketInterval * 2.0 <= m_policy.m_maxBucketInterval))
+        {
+            coarsen(changes);
+            continue;
+        }
+        // Drop the oldest quarter of the stored time span. The span ends at
+        // the newest sample if it is newer than now (e.g. after a clock jump)
+        double oldest;
+        double newest;
+        if (!oldestKey(oldest) || !newestKey(newest))
+        {
+            break;
+        }
+        const int sampleCount = m_sampleCount;
+        dropUpTo(oldest + (qMax(now, newest) - oldest) / 4.0, changes);
+        if (m_sampleCount == sampleCount)
+        {
+            break;
+        }
+    }
+}
+
+void AP2DataPlotOnlineHistory::clear()
+{
+    m_series.clear();
+    m_bucketInterval = m_policy.m_bucketInterval;
+    m_nextCompaction = 0.0;
+    m_sampleCount = 0;
+    m_compactedCount = 0;
+}
+
+void AP2DataPlotOnlineHistory::compactSeries(const QString &name, Series &series, const double limit,
+                                             QList<Change> &changes)
+{
+    const Sample *data = series.m_recent.constData();
+    const int end = series.m_recent.size();
+    int pos = series.m_recentHead;
+    Change change;
+
+    while (pos < end)
+    {
+        // Only complete buckets are compacted
+        const double bucketEnd = (std::floor(data[pos].m_key / m_bucketInterval) + 1.0) * m_bucketInterval;
+        if (bucketEnd > limit)
+        {
+            break;
+        }
+        Sample min = data[pos];
+        Sample max = data[pos];
+        int last = pos;
+        while ((last + 1 < end) && (data[last + 1].m_key < bucketEnd))
+        {
+            ++last;
+            if (data[last].m_value < min.m_value)
+            {
+                min = data[last];
+            }
+            else if (data[last].m_value > max.m_value)
+            {
+                max = data[last];
+            }
+        }
+        if (change.m_name.isEmpty())
+        {
+            change.m_name = name;
+            change.m_from = data[pos].m_key;
+        }
+        change.m_to = data[last].m_key;
+
+        const int compactedSize = series.m_compacted.size();
+        appendBucket(min, max, series.m_compacted);
+        change.m_samples += series.m_compacted.mid(compactedSize);
+        const int added = series.m_compacted.size() - compactedSize;
+        m_compactedCount += added;
+        m_sampleCount += added - (last - pos + 1);
+        pos = last + 1;
+    }
+
+    if (pos != series.m_recentHead)
+    {
+        // Buckets of one or two samples stay as they are, graphs need no update then
+        if (change.m_samples.size() != pos - series.m_recentHead)
+        {
+            changes.append(change);
+        }
+        series.m_recentHead = pos;
+        shrink(series.m_recent, series.m_recentHead);
+    }
+}
+
+void AP2DataPlotOnlineHistory::coarsen(QList<Change> &changes)
+{
+    m_bucketInterval *= 2.0;
+    for (QHash<QString, Series>::iterator it = m_series.begin(); it != m_series.end(); ++it)
+    {
+        Series &series = it.value();
+        const int count = series.compactedCount();
+        if (count == 0)
+        {
+            continue;
+        }
+        const Sample *data = series.m_compacted.constData() + series.m_compactedHead;
+        QVector<Sample> merged;
+        merged.reserve(count);
+        int pos = 0;
+        while (pos < count)
+        {
+            const double bucketEnd = (std::floor(data[pos].m_key / m_bucketInterval) + 1.0) * m_bucketInterval;
+            Sample min = data[pos];
+            Sample max = data[pos];
+            while ((++pos < count) && (data[pos].m_key < bucketEnd))
+            {
+                if (data[pos].m_value < min.m_value)
+                {
+                    min = data[pos];
+                }
+                else if (data[pos].m_value > max.m_value)
+                {
+                    max = data[pos];
+                }
+            }
+            appendBucket(min, max, merged);
+        }
+
+        if (merged.size() != count)
+        {
+            Change change;
+            change.m_name = it.key();
+            change.m_from = data[0].m_key;
+            change.m_to = data[count - 1].m_key;
+            change.m_samples = merged;
+            changes.append(change);
+
+            m_compactedCount += merged.size() - count;
+            m_sampleCount += merged.size() - count;
+            series.m_compacted = merged;
+            series.m_compactedHead = 0;
+        }
+    }
+}
+
+void AP2DataPlotOnlineHistory::dropUpTo(const double key, QList<Change> &changes)
+{
+    for (QHash<QString, Series>::iterator it = m_series.begin(); it != m_series.end(); ++it)
+    {
+        Series &series = it.value();
+        Change change;
+        int dropped = 0;
+
+        int head = series.m_compactedHead;
+        while ((head < series.m_compacted.size()) && (series.m_compacted.at(head).m_key <= key))
+        {
+            if (dropped++ == 0)
+            {
+                change.m_from = series.m_compacted.at(head).m_key;
+            }
+            change.m_to = series.m_compacted.at(head).m_key;
+            ++head;
+        }
+        m_compactedCount -= head - series.m_compactedHead;
+        series.m_compactedHead = head;
+        shrink(series.m_compacted, series.m_compactedHead);
+
+        head = series.m_recentHead;
+        while ((head < series.m_recent.size()) && (series.m_recent.at(head).m_key <= key))
+        {
+            if (dropped++ == 0)
+            {
+                change.m_from = series.m_recent.at(head).m_key;
+            }
+            change.m_to = series.m_recent.at(head).m_key;
+            ++head;
+        }
+        series.m_recentHead = head;
+        shrink(series.m_recent, series.m_recentHead);
+
+        if (dropped > 0)
+        {
+            m_sampleCount -= dropped;
+            change.m_name = it.key();
+            changes.append(change);
+        }
+    }
+}
+
+bool AP2DataPlotOnlineHistory::oldestKey(double &key) const
+{
+    bool found = false;
+    for (QHash<QString, Series>::const_iterator it = m_series.constBegin(); it != m_series.constEnd(); ++it)
+    {
+        const Series &series = it.value();
+        double first;
+        if (series.compactedCount() > 0)
+        {
+            first = series.m_compacted.at(series.m_compactedHead).m_key;
+        }
+        else if (series.recentCount() > 0)
+        {
+            first = series.m_recent.at(series.m_recentHead).m_key;
+        }
+        else
+        {
+            continue;
+        }
+        if (!found || (first < key))
+        {
+            key = first;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool AP2DataPlotOnlineHistory::newestKey(double &key) const
+{
+    bool found = false;
+    for (QHash<QString, Series>::const_iterator it = m_series.constBegin(); it != m_series.constEnd(); ++it)
+    {
+        const Series &series = it.value();
+        double last;
+        if (series.recentCount() > 0)
+        {
+            last = series.m_recent.last().m_key;
+        }
+        else if (series.compactedCount() > 0)
+        {
+            last = series.m_compacted.last().m_key;
+        }
+        else
+        {
+            continue;
+        }
+        if (!found || (last > key))
+        {
+            key = last;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void AP2DataPlotOnlineHistory::appendBucket(const Sample &min, const Sample &max, QVector<Sample> &samples)
+{
+    // Keep the key order of the samples
+    if (min.m_key == max.m_key)
+    {
+        samples.append(min);
+    }
+    else if (min.m_key < max.m_key)
+    {
+        samples.append(min);
+        samples.append(max);
+    }
+    else
+    {
+        samples.append(max);
+        samples.append(min);
+    }
+}
+
+void AP2DataPlotOnlineHistory::shrink(QVector<Sample> &samples, int &head)
+{
+    // Removing the head only when it is half of the vector keeps the cost per sample constant
+    if ((head > 0) && (head * 2 >= samples.size()))
+    {
+        samples.remove(0, head);
+        head = 0;
+    }
+}
@@ -0,0 +1,178 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot bounded history of the online graphs
+ *
+ */
+
+#ifndef AP2DATAPLOTONLINEHISTORY_H
+#define AP2DATAPLOTONLINEHISTORY_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief The AP2DataPlotOnlineHistory class holds the samples of all series
+ *        received in online mode and keeps their memory bounded:
+ *
+ *        - Samples of the last minutes are kept at full rate.
+ *        - Older samples are compacted into buckets of a fixed interval, each
+ *          bucket keeps its smallest and its biggest sample so spikes stay
+ *          visible.
+ *        - If the total number of samples exceeds the limit the buckets are
+ *          coarsened by doubling their interval. If that is not possible or not
+ *          enough the oldest samples are dropped.
+ *
+ *        Every modification of older samples is reported as a Change, so graphs
+ *        showing a series can follow without being rebuilt.
+ */
+class AP2DataPlotOnlineHistory
+{
+public:
+    struct Sample
+    {
+        double m_key;       /// Seconds since graphing started
+        double m_value;
+
+        Sample() : m_key(0.0), m_value(0.0) {}
+        Sample(const double key, const double value) : m_key(key), m_value(value) {}
+    };
+
+    /**
+     * @brief The Policy struct defines which samples are kept
+     */
+    struct Policy
+    {
+        double m_fullRateInterval;  /// Seconds the newest samples are kept at full rate
+        double m_bucketInterval;    /// Seconds of samples compacted into one bucket
+        double m_maxBucketInterval; /// Buckets are not coarsened beyond this interval
+        int m_maxSamples;           /// Hard limit of the samples of all series
+
+        Policy() :
+            m_fullRateInterval(600.0),
+            m_bucketInterval(1.0),
+            m_maxBucketInterval(3600.0),
+            m_maxSamples(4 * 1024 * 1024) {}
+    };
+
+    /**
+     * @brief The Change struct reports that all samples of a series with keys
+     *        within [m_from, m_to] were replaced by m_samples.
+     */
+    struct Change
+    {
+        QString m_name;             /// Name of the series
+        double m_from;              /// Key of the first replaced sample
+        double m_to;                /// Key of the last replaced sample
+        QVector<Sample> m_samples;  /// New samples of the range, may be empty
+    };
+
+    AP2DataPlotOnlineHistory();
+
+    /**
+     * @brief setPolicy sets the retention policy. Stored samples are kept and
+     *        adapted on the next compaction.
+     */
+    void setPolicy(const Policy &policy);
+    const Policy &policy() const { return m_policy; }
+
+    /**
+     * @brief append appends a sample to a series. The series is created if it
+     *        does not exist. Keys must be ascending within a series.
+     *
+     * @return true if the series was created, false otherwise
+     */
+    bool append(const QString &name, const double key, const double value);
+
+    bool contains(const QString &name) const { return m_series.contains(name); }
+
+    /**
+     * @brief getSeries delivers all stored samples of a series in key order
+     */
+    void getSeries(const QString &name, QVector<double> &keys, QVector<double> &values) const;
+
+    /**
+     * @brief getSamplesAfter delivers the stored samples of a series whose key is
+     *        bigger than key in key order. Used to feed graphs with new samples.
+     */
+    void getSamplesAfter(const QString &name, const double key, QVector<double> &keys, QVector<double> &values) const;
+
+    /**
+     * @brief sampleCount delivers the number of samples of all series
+     */
+    int sampleCount() const { return m_sampleCount; }
+
+    /**
+     * @brief bucketInterval delivers the interval of the compacted buckets, which
+     *        grows beyond the one of the policy if buckets had to be coarsened.
+     */
+    double bucketInterval() const { return m_bucketInterval; }
+
+    /**
+     * @brief compact applies the retention policy. Does nothing if it was called
+     *        less than a bucket interval ago, so it can be called for every sample.
+     *
+     * @param now - key of the newest sample
+     * @param changes - receives the modified ranges of the series
+     */
+    void compact(const double now, QList<Change> &changes);
+
+    void clear();
+
+private:
+    /**
+     * @brief The Series struct holds the samples of one series. Samples are removed
+     *        from the front by advancing the head, the vectors are shrunk from
+     *        time to time.
+     */
+    struct Series
+    {
+        QVector<Sample> m_compacted;    /// Min and max samples of the buckets
+        int m_compactedHead;            /// First valid sample of m_compacted
+        QVector<Sample> m_recent;       /// Samples at full rate
+        int m_recentHead;               /// First valid sample of m_recent
+
+        Series() : m_compactedHead(0), m_recentHead(0) {}
+        int compactedCount() const { return m_compacted.size() - m_compactedHead; }
+        int recentCount() const { return m_recent.size() - m_recentHead; }
+    };
+
+    void compactSeries(const QString &name, Series &series, const double limit, QList<Change> &changes);
+    void coarsen(QList<Change> &changes);
+    void dropUpTo(const double key, QList<Change> &changes);
+    bool oldestKey(double &key) const;
+    bool newestKey(double &key) const;
+    static void appendBucket(const Sample &min, const Sample &max, QVector<Sample> &samples);
+    static void shrink(QVector<Sample> &samples, int &head);
+
+    Policy m_policy;
+    double m_bucketInterval;        /// Current bucket interval
+    double m_nextCompaction;        /// Key of the next compaction
+    int m_sampleCount;              /// Samples of all series
+    int m_compactedCount;           /// Compacted samples of all series
+    QHash<QString, Series> m_series;/// Series name to its samples
+};
+
+#endif // AP2DATAPLOTONLINEHISTORY_H
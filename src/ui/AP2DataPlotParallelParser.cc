@@ -0,0 +1,220 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot multi threaded parser for binary dataflash logs
+ *
+ */
+
+#include "AP2DataPlotParallelParser.h"
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QScopedPointer>
+#include <QtAlgorithms>
+#include <QThread>
+#include <QThreadPool>
+#include "QsLog.h"
+
+namespace
+{
+    // Each thread gets about this number of parts so threads finishing early can help
+    const int PARTS_PER_THREAD = 4;
+    // Parts should not be smaller than this to keep the merge overhead low
+    const qint64 MIN_PART_SIZE = 1024 * 1024;
+    // Parts are parsed in steps of this size to report progress and react on stop requests
+    const qint64 PARSE_STEP_SIZE = 4 * 1024 * 1024;
+}
+
+/**
+ * @brief The PartTask class decodes one part of the log. The parser must hold
+ *        the state of the scanning parser at the start of the part.
+ */
+class AP2DataPlotParallelParser::PartTask : public QRunnable
+{
+public:
+    PartTask(const AP2DataPlotBinaryParser &parser, const uchar *data, const qint64 size,
+             const qint64 start, const qint64 end, const bool &stop, QAtomicInt &progressKB) :
+        m_parser(new AP2DataPlotBinaryParser(parser)),
+        m_data(data),
+        m_size(size),
+        m_start(start),
+        m_end(end),
+        m_result(start),
+        m_stop(stop),
+        m_progressKB(progressKB),
+        m_done(0)
+    {
+        setAutoDelete(false);
+    }
+
+    void run()
+    {
+        qint64 pos = m_start;
+        while ((pos < m_end) && !m_stop)
+        {
+            qint64 nextPos = m_parser->parse(m_data, m_size, pos, qMin(pos + PARSE_STEP_SIZE, m_end));
+            if (nextPos < 0)
+            {
+                m_result = -1;
+                break;
+            }
+            m_progressKB.fetchAndAddRelaxed(static_cast<int>((nextPos - pos) / 1024));
+            if (nextPos == pos)
+            {
+                break;  // Only a truncated packet is left
+            }
+            pos = nextPos;
+            m_result = pos;
+        }
+        m_done.storeRelease(1);
+    }
+
+    bool isDone() const { return m_done.loadAcquire() != 0; }
+
+    QScopedPointer<AP2DataPlotBinaryParser> m_parser;  /// Parser holding the state at the start of the part
+    AP2DataPlotStatus m_status;             /// Parsing status of this part
+
+    const uchar *m_data;
+    const qint64 m_size;
+    const qint64 m_start;                   /// First byte of the part
+    const qint64 m_end;                     /// First byte behind the part
+    qint64 m_result;                        /// Position parsing stopped, -1 on error
+
+private:
+    const bool &m_stop;
+    QAtomicInt &m_progressKB;
+    QAtomicInt m_done;
+};
+
+AP2DataPlotParallelParser::AP2DataPlotParallelParser(AP2DataPlot2DModel *model, AP2DataPlotStatus *status, QObject *parent) :
+    QObject(parent),
+    m_dataModel(model),
+    m_plotState(status),
+    m_threadCount(QThread::idealThreadCount()),
+    m_timeStampDivisor(0.0),
+    m_loadedLogType(MAV_TYPE_GENERIC)
+{
+}
+
+AP2DataPlotParallelParser::~AP2DataPlotParallelParser()
+{
+}
+
+void AP2DataPlotParallelParser::setThreadCount(const int count)
+{
+    m_threadCount = qMax(1, count);
+}
+
+qint64 AP2DataPlotParallelParser::parse(const uchar *data, const qint64 size, const bool &stop)
+{
+    const qint64 partSize = qMax(MIN_PART_SIZE, size / (m_threadCount * PARTS_PER_THREAD));
+    QAtomicInt progressKB(0);
+    QList<PartTask*> tasks;
+
+    // Pass 1: process all FMT packets and split the log in parts at packet boundaries.
+    // The scanner reports to its own status as all errors are reported by the parts.
+    AP2DataPlotStatus scanStatus;
+    AP2DataPlotBinaryParser scanner(m_dataModel, &scanStatus);
+    qint64 pos = 0;
+    while ((pos < size) && !stop)
+    {
+        AP2DataPlotBinaryParser partStart(scanner);
+        qint64 nextPos = scanner.scan(data, size, pos, qMin(pos + partSize, size));
+        if (nextPos < 0)
+        {
+            m_error = m_dataModel->getError();
+            qDeleteAll(tasks);
+            return -1;
+        }
+        if (nextPos == pos)
+        {
+            break;  // Only a truncated packet is left
+        }
+        tasks.append(new PartTask(partStart, data, size, pos, nextPos, stop, progressKB));
+        pos = nextPos;
+    }
+    m_timeStampName = scanner.timeStampName();
+    m_timeStampDivisor = scanner.timeStampDivisor();
+
+    QLOG_DEBUG() << "AP2DataPlotParallelParser::parse(): Log split into" << tasks.size()
+                 << "parts, using" << m_threadCount << "threads";
+
+    // Pass 2: decode all parts in parallel. Each part is decoded into the record
+    // batch of its detached parser which already holds the message types known at
+    // the start of the part.
+    for (int i = 0; i < tasks.size(); ++i)
+    {
+        PartTask *task = tasks.at(i);
+        if (i != 0)
+        {
+            task->m_status.setPartial();
+        }
+        task->m_parser->detach(&task->m_status);
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_threadCount);
+    foreach (PartTask *task, tasks)
+    {
+        pool.start(task);
+    }
+
+    // Merge the parts in log order as soon as they are done
+    qint64 result = 0;
+    bool failed = false;
+    for (int i = 0; i < tasks.size(); ++i)
+    {
+        PartTask *task = tasks.at(i);
+        while (!task->isDone())
+        {
+            emit progress(qMin(static_cast<qint64>(progressKB.load()) * 1024, size), size);
+            pool.waitForDone(50);
+        }
+        if (failed || stop)
+        {
+            continue;
+        }
+        if (task->m_result < 0)
+        {
+            m_error = "Unable to decode log part at position " + QString::number(task->m_start);
+            failed = true;
+            continue;
+        }
+        if (!m_dataModel->appendBatch(task->m_parser->batch()))
+        {
+            m_error = m_dataModel->getError();
+            failed = true;
+            continue;
+        }
+        m_plotState->append(task->m_status);
+        if (m_loadedLogType == MAV_TYPE_GENERIC)
+        {
+            m_loadedLogType = task->m_parser->logType();
+        }
+        task->m_parser.reset();     // release memory as early as possible
+        result = task->m_result;
+    }
+    pool.waitForDone();
+    qDeleteAll(tasks);
+
+    return failed ? -1 : result;
+}
@@ -0,0 +1,101 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot multi threaded parser for binary dataflash logs
+ *
+ */
+
+#ifndef AP2DATAPLOTPARALLELPARSER_H
+#define AP2DATAPLOTPARALLELPARSER_H
+
+#include <QObject>
+#include <QString>
+#include "AP2DataPlot2DModel.h"
+#include "AP2DataPlotBinaryParser.h"
+#include "AP2DataPlotStatus.h"
+
+/**
+ * @brief The AP2DataPlotParallelParser class parses a memory mapped binary log
+ *        using several threads. Parsing is done in two passes:
+ *
+ *        1. A fast sequential scan processes all FMT packets, stores the message
+ *           types in the data model and splits the log into parts at packet
+ *           boundaries. For every part the state of the scanning parser (formats,
+ *           log index and last valid timestamp) is stored.
+ *        2. The parts are decoded in parallel, each part into its own record batch
+ *           continuing from the stored parser state. The batches and the parsing
+ *           status of the parts are then appended to the model in log order.
+ *
+ *        The resulting model is identical to the one created by the sequential
+ *        AP2DataPlotBinaryParser.
+ */
+class AP2DataPlotParallelParser : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief AP2DataPlotParallelParser CTOR
+     * @param model - Data model to store the decoded data in
+     * @param status - Status object to report parsing errors to
+     */
+    AP2DataPlotParallelParser(AP2DataPlot2DModel *model, AP2DataPlotStatus *status, QObject *parent = 0);
+    ~AP2DataPlotParallelParser();
+
+    /**
+     * @brief setThreadCount sets the number of threads used for decoding.
+     *        Default is QThread::idealThreadCount().
+     */
+    void setThreadCount(const int count);
+
+    /**
+     * @brief parse parses the whole log. Blocks until parsing is done.
+     *
+     * @param data - Pointer to the log
+     * @param size - Size of the log
+     * @param stop - Parsing is canceled as soon as this is set to true
+     * @return Number of bytes parsed or -1 on error. Use getError() for details.
+     */
+    qint64 parse(const uchar *data, const qint64 size, const bool &stop);
+
+    QString getError() const { return m_error; }
+    QString timeStampName() const { return m_timeStampName; }
+    double timeStampDivisor() const { return m_timeStampDivisor; }
+    MAV_TYPE logType() const { return m_loadedLogType; }
+
+signals:
+    void progress(qint64 pos, qint64 size);
+
+private:
+    class PartTask;
+
+    AP2DataPlot2DModel *m_dataModel;
+    AP2DataPlotStatus  *m_plotState;
+    int m_threadCount;
+
+    QString m_error;
+    QString m_timeStampName;
+    double m_timeStampDivisor;
+    MAV_TYPE m_loadedLogType;
+};
+
+#endif // AP2DATAPLOTPARALLELPARSER_H
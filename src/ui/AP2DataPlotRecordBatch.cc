@@ -0,0 +1,89 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot typed record batch used to hand decoded log rows to the model
+ *
+ */
+
+#include "AP2DataPlotRecordBatch.h"
+
+AP2DataPlotRecordBatch::AP2DataPlotRecordBatch(const int capacity) :
+    m_capacity(capacity),
+    m_firstIndex(0),
+    m_lastIndex(0),
+    m_maxValueCount(0)
+{
+    m_timeIndex.reserve(capacity);
+}
+
+int AP2DataPlotRecordBatch::addType(const QString &name, const unsigned int typeID, const int length,
+                                    const QString &format, const QStringList &labels, const bool textFlightModes)
+{
+    return m_store.addTable(name, typeID, length, format, labels, textFlightModes);
+}
+
+void AP2DataPlotRecordBatch::copyTypes(const AP2DataPlotColumnStore &store)
+{
+    for (int tableID = 0; tableID < store.tableCount(); ++tableID)
+    {
+        const AP2DataPlotTable &table = store.table(tableID);
+        m_store.addTable(table.m_name, table.m_typeID, table.m_length, table.m_format, table.m_labels,
+                           table.m_textFlightModes);
+    }
+}
+
+bool AP2DataPlotRecordBatch::commitRow(const int tableID, const quint32 index, const int timeColumn, const int valueCount)
+{
+    if (!m_store.commitRow(tableID, index))
+    {
+        return false;
+    }
+
+    if (m_store.rowCount() == 1)
+    {
+        m_firstIndex = index;
+    }
+    m_lastIndex = index;
+
+    if (timeColumn >= 0)
+    {
+        const AP2DataPlotTable &table = m_store.table(tableID);
+        m_timeIndex.append(table.m_columns.at(timeColumn).toUnsigned(table.rowCount() - 1),
+                           static_cast<quint32>(m_store.rowCount() - 1), static_cast<quint32>(tableID));
+    }
+
+    if (valueCount > m_maxValueCount)
+    {
+        m_maxValueCount = valueCount;
+    }
+    return true;
+}
+
+void AP2DataPlotRecordBatch::clear()
+{
+    m_store.clearRows();
+    m_timeIndex.clear();
+    m_firstIndex = 0;
+    m_lastIndex = 0;
+    m_maxValueCount = 0;
+}
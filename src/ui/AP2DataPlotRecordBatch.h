@@ -0,0 +1,142 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot typed record batch used to hand decoded log rows to the model
+ *
+ */
+
+#ifndef AP2DATAPLOTRECORDBATCH_H
+#define AP2DATAPLOTRECORDBATCH_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "AP2DataPlotColumnStore.h"
+#include "AP2DataPlotTimeIndex.h"
+
+/**
+ * @brief The AP2DataPlotRecordBatch class collects decoded log rows in typed
+ *        column buffers before they are handed to the AP2DataPlot2DModel in one
+ *        call using AP2DataPlot2DModel::appendBatch().
+ *
+ *        The schema of a message type (its table and columns) is created once
+ *        when its FMT descriptor is read. Parsers then append the values of each
+ *        row directly to the typed columns and complete the row with commitRow().
+ *        No QVariant or name value pair is created per value.
+ *
+ *        Message types have to be added to the batch in the same order as they
+ *        are added to the model so both use the same table ids.
+ */
+class AP2DataPlotRecordBatch
+{
+public:
+    /**
+     * @brief DefaultCapacity is the number of rows a batch should hold before it
+     *        is handed to the model.
+     */
+    static const int DefaultCapacity = 4096;
+
+    /**
+     * @brief AP2DataPlotRecordBatch CTOR
+     * @param capacity - number of rows after which isFull() returns true
+     */
+    explicit AP2DataPlotRecordBatch(const int capacity = DefaultCapacity);
+
+    /**
+     * @brief addType adds the schema of a message type. If the type already
+     *        exists nothing is changed.
+     *
+     * @param textFlightModes - true if 'M' fields hold mode names (ASCII logs)
+     * @return id of the table holding the rows of this type
+     */
+    int addType(const QString &name, const unsigned int typeID, const int length,
+                const QString &format, const QStringList &labels, const bool textFlightModes = false);
+
+    /**
+     * @brief copyTypes adds all message types of a column store so the batch
+     *        uses the same table ids.
+     */
+    void copyTypes(const AP2DataPlotColumnStore &store);
+
+    /**
+     * @brief tableID delivers the id of the table of a message type
+     * @return id of the table or -1 if the type was not added
+     */
+    int tableID(const QString &name) const { return m_store.tableID(name); }
+
+    const AP2DataPlotTable &table(const int tableID) const { return m_store.table(tableID); }
+
+    /**
+     * @brief column delivers a column for typed appending of a value.
+     *        After all values of a row are appended commitRow() must be
+     *        called to complete the row, or discardRow() to drop it.
+     */
+    AP2DataPlotColumn &column(const int tableID, const int column) { return m_store.column(tableID, column); }
+
+    /**
+     * @brief commitRow completes a row. Columns without a value get a default value.
+     *
+     * @param tableID - id of the table the row belongs to
+     * @param index - log index of the row
+     * @param timeColumn - column holding the timestamp, -1 if none
+     * @param valueCount - number of values the parser delivered for this row
+     * @return true on success, false if tableID is invalid
+     */
+    bool commitRow(const int tableID, const quint32 index, const int timeColumn, const int valueCount);
+
+    /**
+     * @brief discardRow drops all values appended since the last complete row
+     */
+    void discardRow(const int tableID) { m_store.discardRow(tableID); }
+
+    int rowCount() const { return m_store.rowCount(); }
+    bool isEmpty() const { return m_store.rowCount() == 0; }
+    bool isFull() const { return m_store.rowCount() >= m_capacity; }
+
+    /**
+     * @brief clear removes all rows. The message types are kept.
+     */
+    void clear();
+
+    const AP2DataPlotColumnStore &store() const { return m_store; }
+
+    /**
+     * @brief timeIndex delivers the timestamps of all rows holding one. The
+     *        rows are relative to the first row of the batch.
+     */
+    const AP2DataPlotTimeIndex &timeIndex() const { return m_timeIndex; }
+
+    quint32 firstIndex() const { return m_firstIndex; }
+    quint32 lastIndex() const { return m_lastIndex; }
+    int maxValueCount() const { return m_maxValueCount; }
+
+private:
+    int m_capacity;                     /// Number of rows the batch should hold
+    AP2DataPlotColumnStore m_store;     /// Typed columns of all message types
+    AP2DataPlotTimeIndex m_timeIndex;   /// Timestamps of the rows
+    quint32 m_firstIndex;               /// Log index of the first row
+    quint32 m_lastIndex;                /// Log index of the last row
+    int m_maxValueCount;                /// Largest number of values in a row
+};
+
+#endif // AP2DATAPLOTRECORDBATCH_H
@@ -0,0 +1,211 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot multi resolution min/max envelope of a graph series
+ *
+ */
+
+#include "AP2DataPlotSeriesPyramid.h"
+#include <algorithm>
+
+namespace
+{
+    // Number of buckets of a level combined to a bucket of the next level
+    const int BRANCHING = 4;
+}
+
+AP2DataPlotSeriesPyramid::AP2DataPlotSeriesPyramid()
+{
+}
+
+void AP2DataPlotSeriesPyramid::build(const QVector<double> &x, const QVector<double> &y)
+{
+    clear();
+    if (x.size() != y.size())
+    {
+        return;
+    }
+    m_x = x;
+    m_y = y;
+    const int size = m_x.size();
+    if (size < 2)
+    {
+        return;
+    }
+
+    // Level 0 directly from the samples
+    QVector<Bucket> level((size + BRANCHING - 1) / BRANCHING);
+    for (int i = 0; i < level.size(); ++i)
+    {
+        Bucket &bucket = level[i];
+        bucket.m_min = bucket.m_max = i * BRANCHING;
+        const int end = qMin(size, (i + 1) * BRANCHING);
+        for (int j = bucket.m_min + 1; j < end; ++j)
+        {
+            if (m_y.at(j) < m_y.at(bucket.m_min))
+            {
+                bucket.m_min = j;
+            }
+            if (m_y.at(j) > m_y.at(bucket.m_max))
+            {
+                bucket.m_max = j;
+            }
+        }
+    }
+    m_levels.append(level);
+
+    // Every further level from the one below until a single bucket covers all
+    while (m_levels.last().size() > 1)
+    {
+        const QVector<Bucket> &below = m_levels.last();
+        QVector<Bucket> next((below.size() + BRANCHING - 1) / BRANCHING);
+        for (int i = 0; i < next.size(); ++i)
+        {
+            Bucket &bucket = next[i];
+            bucket = below.at(i * BRANCHING);
+            const int end = qMin(below.size(), (i + 1) * BRANCHING);
+            for (int j = i * BRANCHING + 1; j < end; ++j)
+            {
+                if (m_y.at(below.at(j).m_min) < m_y.at(bucket.m_min))
+                {
+                    bucket.m_min = below.at(j).m_min;
+                }
+                if (m_y.at(below.at(j).m_max) > m_y.at(bucket.m_max))
+                {
+                    bucket.m_max = below.at(j).m_max;
+                }
+            }
+        }
+        m_levels.append(next);
+    }
+}
+
+void AP2DataPlotSeriesPyramid::clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_levels.clear();
+}
+
+void AP2DataPlotSeriesPyramid::visibleData(const double lower, const double upper, const int pixelColumns,
+                                           QVector<double> &x, QVector<double> &y) const
+{
+    x.clear();
+    y.clear();
+    const int size = m_x.size();
+    if (size == 0)
+    {
+        return;
+    }
+
+    // Visible samples plus one on each side so the lines reach the border
+    const int first = qMax(0, lowerBound(lower) - 1);
+    const int end = qMin(size, static_cast<int>(std::upper_bound(m_x.constBegin(), m_x.constEnd(), upper) - m_x.constBegin()) + 1);
+    const qint64 count = end - first;
+
+    // Finest level with no more buckets than pixel columns
+    const qint64 columns = qMax(1, pixelColumns);
+    int level = -1;
+    while ((count > columns * bucketSize(level)) && (level + 1 < m_levels.size()))
+    {
+        ++level;
+    }
+    const int detailSize = bucketSize(level);
+    const int detailFirst = (first / detailSize) * detailSize;
+    const int detailEnd = qMin(size, ((end + detailSize - 1) / detailSize) * detailSize);
+
+    x.reserve(static_cast<int>(4 * columns) + 8 * BRANCHING * m_levels.size());
+    y.reserve(x.capacity());
+    const int topLevel = m_levels.size() - 1;
+    appendRange(0, detailFirst, topLevel, x, y);
+    appendRange(detailFirst, detailEnd, level, x, y);
+    appendRange(detailEnd, size, topLevel, x, y);
+
+    // Buckets are drawn by their min and max, keep the key range complete
+    if (x.first() != m_x.first())
+    {
+        x.prepend(m_x.first());
+        y.prepend(m_y.first());
+    }
+    if (x.last() != m_x.last())
+    {
+        appendPoint(size - 1, x, y);
+    }
+}
+
+bool AP2DataPlotSeriesPyramid::valueAt(const double key, double &value) const
+{
+    if (m_x.isEmpty())
+    {
+        return false;
+    }
+    int index = qMin(lowerBound(key), m_x.size() - 1);
+    if ((index > 0) && (key - m_x.at(index - 1) < m_x.at(index) - key))
+    {
+        index--;
+    }
+    value = m_y.at(index);
+    return true;
+}
+
+void AP2DataPlotSeriesPyramid::appendRange(int first, const int end, const int maxLevel, QVector<double> &x, QVector<double> &y) const
+{
+    const int size = m_x.size();
+    while (first < end)
+    {
+        // Biggest bucket starting at first which does not reach behind end
+        int level = maxLevel;
+        while (level >= 0)
+        {
+            const int bucket = bucketSize(level);
+            if ((first % bucket == 0) && (qMin(first + bucket, size) <= end))
+            {
+                break;
+            }
+            --level;
+        }
+        if (level < 0)
+        {
+            appendPoint(first++, x, y);
+            continue;
+        }
+
+        const int bucket = bucketSize(level);
+        const Bucket &minMax = m_levels.at(level).at(first / bucket);
+        if (minMax.m_min == minMax.m_max)
+        {
+            appendPoint(minMax.m_min, x, y);
+        }
+        else
+        {
+            appendPoint(qMin(minMax.m_min, minMax.m_max), x, y);
+            appendPoint(qMax(minMax.m_min, minMax.m_max), x, y);
+        }
+        first += bucket;
+    }
+}
+
+int AP2DataPlotSeriesPyramid::lowerBound(const double key) const
+{
+    return static_cast<int>(std::lower_bound(m_x.constBegin(), m_x.constEnd(), key) - m_x.constBegin());
+}
@@ -0,0 +1,123 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot multi resolution min/max envelope of a graph series
+ *
+ */
+
+#ifndef AP2DATAPLOTSERIESPYRAMID_H
+#define AP2DATAPLOTSERIESPYRAMID_H
+
+#include <QVector>
+
+/**
+ * @brief The AP2DataPlotSeriesPyramid class holds a series of samples and a
+ *        pyramid of min/max buckets over it. Level 0 buckets cover 4 samples,
+ *        each following level combines 4 buckets of the level below.
+ *
+ *        visibleData() delivers about two points per pixel column for the
+ *        visible range, so a graph holds a few thousand points regardless of
+ *        the size of the series. Each bucket is drawn by its min and max
+ *        sample, so peaks are never lost. Zoomed in far enough the samples are
+ *        delivered at full resolution.
+ */
+class AP2DataPlotSeriesPyramid
+{
+public:
+    AP2DataPlotSeriesPyramid();
+
+    /**
+     * @brief build takes over the samples and builds the pyramid
+     *
+     * @param x - keys of the samples, must be sorted ascending
+     * @param y - values of the samples, same size as x
+     */
+    void build(const QVector<double> &x, const QVector<double> &y);
+
+    void clear();
+
+    int size() const { return m_x.size(); }
+    bool isEmpty() const { return m_x.isEmpty(); }
+    int levelCount() const { return m_levels.size(); }
+
+    /**
+     * @brief visibleData delivers the points to draw for a key range. Inside
+     *        the range one bucket per pixel column is used. The rest of the
+     *        series is covered by buckets getting coarser with the distance to
+     *        the range, so lines leave the visible area correctly and the value
+     *        range of the points is the value range of the whole series.
+     *
+     * @param lower - lower bound of the visible key range
+     * @param upper - upper bound of the visible key range
+     * @param pixelColumns - width of the visible range in pixels
+     * @param x - receives the keys of the points
+     * @param y - receives the values of the points
+     */
+    void visibleData(const double lower, const double upper, const int pixelColumns,
+                     QVector<double> &x, QVector<double> &y) const;
+
+    /**
+     * @brief valueAt delivers the value of the sample with the key nearest
+     *        to key.
+     *
+     * @return true on success, false if the series is empty
+     */
+    bool valueAt(const double key, double &value) const;
+
+private:
+    /**
+     * @brief The Bucket struct references the samples holding the minimum and
+     *        the maximum value of a bucket.
+     */
+    struct Bucket
+    {
+        quint32 m_min;  /// Index of the sample with the smallest value
+        quint32 m_max;  /// Index of the sample with the biggest value
+    };
+
+    /**
+     * @brief bucketSize delivers the number of samples covered by a bucket of
+     *        a level. Level -1 are the samples.
+     */
+    static int bucketSize(const int level) { return 1 << (2 * (level + 1)); }
+
+    /**
+     * @brief appendRange appends the points of the samples [first, end) using
+     *        the biggest buckets up to maxLevel fitting in the range.
+     */
+    void appendRange(int first, const int end, const int maxLevel, QVector<double> &x, QVector<double> &y) const;
+
+    void appendPoint(const int index, QVector<double> &x, QVector<double> &y) const
+    {
+        x.append(m_x.at(index));
+        y.append(m_y.at(index));
+    }
+
+    int lowerBound(const double key) const;
+
+    QVector<double> m_x;                /// Keys of all samples
+    QVector<double> m_y;                /// Values of all samples
+    QVector<QVector<Bucket> > m_levels; /// Min/max buckets, finest level first
+};
+
+#endif // AP2DATAPLOTSERIESPYRAMID_H
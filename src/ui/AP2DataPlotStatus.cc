@@ -0,0 +1,182 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2015 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot log parsing status
+ *
+ *   @author Michael Carpenter <malcom2073@gmail.com>
+ */
+
+
+#include "AP2DataPlotStatus.h"
+#include <QTextStream>
+
+AP2DataPlotStatus::AP2DataPlotStatus() : m_lastParsingState(OK), m_globalState(OK)
+{
+}
+
+void AP2DataPlotStatus::corruptDataRead(const int index, const QString &errorMessage)
+{
+    // When here we just know that we have an error but not if it is at the end
+    // or in the middle of the logfile. So we set truncation error. Data error will
+    // be set as soon as valid data is read again.
+    m_globalState = m_globalState == OK ? TruncationError : m_globalState;
+    m_lastParsingState = DataError;
+    errorEntry entry(m_lastParsingState, index, errorMessage);
+    m_errors.push_back(entry);
+}
+
+void AP2DataPlotStatus::corruptFMTRead(const int index, const QString &errorMessage)
+{
+    m_globalState = m_globalState == OK ? FmtError : m_globalState;
+    m_lastParsingState = FmtError;
+    errorEntry entry(m_lastParsingState, index, errorMessage);
+    m_errors.push_back(entry);
+}
+
+void AP2DataPlotStatus::corruptTimeRead(const int index, const QString &errorMessage)
+{
+    m_globalState = m_globalState == OK ? TimeError : m_globalState;
+    m_lastParsingState = TimeError;
+    errorEntry entry(m_lastParsingState, index, errorMessage);
+    m_errors.push_back(entry);
+}
+
+void AP2DataPlotStatus::setPartial()
+{
+    // The state before this part is unknown. Pretend an error so the first
+    // valid read creates an entry which can be replayed.
+    m_lastParsingState = DataError;
+}
+
+void AP2DataPlotStatus::append(const AP2DataPlotStatus &other)
+{
+    foreach (const errorEntry &entry, other.m_errors)
+    {
+        switch (entry.m_state)
+        {
+        case OK:
+            validDataRead();
+            break;
+        case FmtError:
+            corruptFMTRead(entry.m_index, entry.m_errortext);
+            break;
+        case TimeError:
+            corruptTimeRead(entry.m_index, entry.m_errortext);
+            break;
+        default:
+            corruptDataRead(entry.m_index, entry.m_errortext);
+            break;
+        }
+    }
+}
+
+AP2DataPlotStatus::parsingState AP2DataPlotStatus::getParsingState() const
+{
+    return m_globalState;
+}
+
+
+QString AP2DataPlotStatus::getErrorOverview() const
+{
+    int timeErrorCount = 0;
+    int dataErrorCount = 0;
+    int fmtErrorCount  = 0;
+    int unknownErrorCount = 0;
+    QString out;
+    QTextStream outStream(&out);
+
+    foreach (const errorEntry &entry, m_errors)
+    {
+        switch (entry.m_state)
+        {
+        case OK:
+            break;
+        case FmtError:
+            fmtErrorCount++;
+            break;
+        case TimeError:
+            timeErrorCount++;
+            break;
+        case DataError:
+            dataErrorCount++;
+            break;
+        default:
+            unknownErrorCount++;
+            break;
+        }
+    }
+
+    if (fmtErrorCount     > 0) outStream << fmtErrorCount << " format corruptions" << endl;
+    if (timeErrorCount    > 0) outStream << timeErrorCount << " time corruptions" << endl;
+    if (dataErrorCount    > 0) outStream << dataErrorCount << " data corruptions" << endl;
+    if (unknownErrorCount > 0) outStream << unknownErrorCount << " unspecific corruptions" << endl;
+
+    return out;
+}
+
+QString AP2DataPlotStatus::getDetailedErrorText() const
+{
+    QString out;
+    QTextStream outStream(&out);
+
+    foreach (const errorEntry &entry, m_errors)
+    {
+        if (entry.m_state != OK)    // Only if a error
+        {
+            outStream << "Logline " << entry.m_index << ": " << entry.m_errortext << endl;
+        }
+    }
+    outStream << endl << " There were " << m_errors.size() << " errors during log parsing." << endl;
+    return out;
+}
+
+QDataStream &operator<<(QDataStream &stream, const AP2DataPlotStatus &status)
+{
+    stream << static_cast<qint32>(status.m_lastParsingState) << static_cast<qint32>(status.m_globalState);
+    stream << static_cast<qint32>(status.m_errors.size());
+    foreach (const AP2DataPlotStatus::errorEntry &entry, status.m_errors)
+    {
+        stream << static_cast<qint32>(entry.m_state) << static_cast<qint32>(entry.m_index) << entry.m_errortext;
+    }
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, AP2DataPlotStatus &status)
+{
+    qint32 lastState = 0;
+    qint32 globalState = 0;
+    qint32 count = 0;
+    stream >> lastState >> globalState >> count;
+    status.m_lastParsingState = static_cast<AP2DataPlotStatus::parsingState>(lastState);
+    status.m_globalState = static_cast<AP2DataPlotStatus::parsingState>(globalState);
+    status.m_errors.clear();
+    for (int i = 0; (i < count) && (stream.status() == QDataStream::Ok); ++i)
+    {
+        qint32 state = 0;
+        qint32 index = 0;
+        QString text;
+        stream >> state >> index >> text;
+        status.m_errors.push_back(AP2DataPlotStatus::errorEntry(static_cast<AP2DataPlotStatus::parsingState>(state), index, text));
+    }
+    return stream;
+}
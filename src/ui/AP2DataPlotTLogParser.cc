@@ -0,0 +1,509 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot streaming decoder for MAVLink telemetry logs (tlogs)
+ *
+ */
+
+#include "AP2DataPlotTLogParser.h"
+#include <QtEndian>
+#include <cstring>
+#include "QsLog.h"
+
+namespace
+{
+    // Message info of all known message ids. Unknown ids are named "EMPTY".
+    const mavlink_message_info_t MESSAGE_INFO[256] = MAVLINK_MESSAGE_INFO;
+
+    // Messages whose fields are not delivered by the MAVLinkDecoder. Only a
+    // leading time field is decoded for them.
+    bool isFiltered(const quint8 msgid)
+    {
+        switch (msgid)
+        {
+        case MAVLINK_MSG_ID_COMMAND_LONG:
+        case MAVLINK_MSG_ID_COMMAND_ACK:
+        case MAVLINK_MSG_ID_PARAM_SET:
+        case MAVLINK_MSG_ID_PARAM_VALUE:
+        case MAVLINK_MSG_ID_MISSION_ITEM:
+        case MAVLINK_MSG_ID_MISSION_COUNT:
+        case MAVLINK_MSG_ID_MISSION_ACK:
+        case MAVLINK_MSG_ID_DATA_STREAM:
+        case MAVLINK_MSG_ID_GPS_STATUS:
+#ifdef MAVLINK_MSG_ID_ENCAPSULATED_DATA
+        case MAVLINK_MSG_ID_ENCAPSULATED_DATA:
+#endif
+#ifdef MAVLINK_MSG_ID_DATA_TRANSMISSION_HANDSHAKE
+        case MAVLINK_MSG_ID_DATA_TRANSMISSION_HANDSHAKE:
+#endif
+        case MAVLINK_MSG_ID_EXTENDED_MESSAGE:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Messages which never deliver values. Their type is created anyway.
+    bool hasNoValues(const quint8 msgid)
+    {
+#ifndef ENABLE_DEBUG_DATALOG_PARSING
+        if (msgid == MAVLINK_MSG_ID_LOG_DATA)
+        {
+            return true;
+        }
+#endif
+        return msgid == MAVLINK_MSG_ID_SYSTEM_TIME;
+    }
+}
+
+const char AP2DataPlotTLogParser::s_timeStampName[] = "time_boot_ms";
+
+AP2DataPlotTLogParser::AP2DataPlotTLogParser(AP2DataPlot2DModel *model, AP2DataPlotStatus *status) :
+    m_dataModel(model),
+    m_plotState(status),
+    m_loadedLogType(MAV_TYPE_GENERIC),
+    m_modeTableID(-1),
+    m_msgTableID(-1),
+    m_timeStampHasToBeAddedCount(0),
+    m_emptyMessageCount(0),
+    m_index(100),
+    m_lastValidTS(0),
+    m_lastModeVal(255)
+{
+    memset(&m_rxMessage, 0, sizeof(m_rxMessage));
+    memset(&m_rxStatus, 0, sizeof(m_rxStatus));
+
+    // Ids without message info are named "EMPTY" and cannot be inserted into the datamodel
+    for (int i = 0; i < 256; ++i)
+    {
+        m_layouts[i].m_isEmpty = (strcmp(MESSAGE_INFO[i].name, "EMPTY") == 0);
+    }
+}
+
+bool AP2DataPlotTLogParser::start()
+{
+    const QString timeStamp = timeStampName();
+
+    // Tlog does not contain MODE messages the mode information is transmitted in
+    // a heartbeat message. So we create the datatype for MODE here.
+    QStringList modeVarNames;
+    modeVarNames << timeStamp << "Mode" << "ModeNum" << "Info";
+    m_modeTableID = addType(ModeMessage::TypeName, "QMBZ", modeVarNames);
+
+    // Tlog does not contain MSG messages. The information is gathered from STATUSTEXT
+    // messages. So we create the datatype for MSG here.
+    QStringList msgVarNames;
+    msgVarNames << timeStamp << "Message" << "Info";
+    m_msgTableID = addType(MsgMessage::TypeName, "QZZ", msgVarNames);
+
+    return (m_modeTableID >= 0) && (m_msgTableID >= 0);
+}
+
+bool AP2DataPlotTLogParser::parse(const uchar *data, const qint64 size)
+{
+    mavlink_message_t message;
+    mavlink_status_t status;
+
+    for (qint64 i = 0; i < size; ++i)
+    {
+        const uint8_t decodeState = mavlink_frame_char_buffer(&m_rxMessage, &m_rxStatus, data[i], &message, &status);
+        if (decodeState == MAVLINK_FRAMING_OK)
+        {
+            if (!decodeMessage(message))
+            {
+                flush();
+                return false;
+            }
+        }
+        else if (decodeState == MAVLINK_FRAMING_BAD_CRC)
+        {
+            // Restart framing like mavlink_parse_char does, this byte may start the next packet
+            m_rxStatus.msg_received = MAVLINK_FRAMING_INCOMPLETE;
+            m_rxStatus.parse_state = MAVLINK_PARSE_STATE_IDLE;
+            if (data[i] == MAVLINK_STX)
+            {
+                m_rxStatus.parse_state = MAVLINK_PARSE_STATE_GOT_STX;
+                m_rxMessage.len = 0;
+                mavlink_start_checksum(&m_rxMessage);
+            }
+        }
+    }
+    return true;
+}
+
+bool AP2DataPlotTLogParser::finish()
+{
+    if (m_emptyMessageCount != 0) // Did we have messages named "EMPTY" ?
+    {
+        m_plotState->corruptDataRead(0, "Found " + QString::number(m_emptyMessageCount) +
+                                     " 'EMPTY' messages wich could not be processed");
+    }
+    return flush();
+}
+
+bool AP2DataPlotTLogParser::decodeMessage(const mavlink_message_t &message)
+{
+    messageLayout &layout = m_layouts[message.msgid];
+    if (layout.m_isEmpty)
+    {
+        m_emptyMessageCount++;
+        return true;
+    }
+    if (message.sysid == s_gcsSystemID) // [TODO] GCS packet is not always 255 sysid.
+    {
+        return true;
+    }
+    if (!layout.m_compiled)
+    {
+        if (!compileLayout(message.msgid))
+        {
+            return false;
+        }
+    }
+    if (layout.m_fields.isEmpty())
+    {
+        return true;
+    }
+
+    const uchar *payload = reinterpret_cast<const uchar*>(_MAV_PAYLOAD(&message));
+    const int tableID = layout.m_tableID;
+    const bool checkTime = m_timeStampHasToBeAddedCount > 0;
+    int valueCount = 0;
+
+    for (int j = 0; j < layout.m_fields.size(); ++j)
+    {
+        const fieldLayout &field = layout.m_fields.at(j);
+        const uchar *src = payload + field.m_offset;
+        AP2DataPlotColumn &column = m_batch.column(tableID, field.m_column);
+        ++valueCount;
+
+        switch (field.m_type)
+        {
+        case MAVLINK_TYPE_CHAR:
+            if (field.m_arrayLength > 0)
+            {
+                column.appendText(readText(src, field.m_arrayLength));
+            }
+            else
+            {
+                column.appendInteger(static_cast<qint8>(src[0]));
+            }
+            break;
+        case MAVLINK_TYPE_UINT8_T:
+            column.appendInteger(src[0]);
+            break;
+        case MAVLINK_TYPE_INT8_T:
+            column.appendInteger(static_cast<qint8>(src[0]));
+            break;
+        case MAVLINK_TYPE_UINT16_T:
+            column.appendInteger(qFromLittleEndian<quint16>(src));
+            break;
+        case MAVLINK_TYPE_INT16_T:
+            column.appendInteger(qFromLittleEndian<qint16>(src));
+            break;
+        case MAVLINK_TYPE_UINT32_T:
+            if (checkTime && field.m_isTime)
+            {
+                // store the corrected value if time is not increasing
+                column.appendUnsigned(checkTimeStamp(qFromLittleEndian<quint32>(src)));
+            }
+            else
+            {
+                column.appendUnsigned(qFromLittleEndian<quint32>(src));
+            }
+            break;
+        case MAVLINK_TYPE_INT32_T:
+            column.appendInteger(qFromLittleEndian<qint32>(src));
+            break;
+        case MAVLINK_TYPE_FLOAT:
+        {
+            const quint32 bits = qFromLittleEndian<quint32>(src);
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            column.appendDouble(f);
+            break;
+        }
+        case MAVLINK_TYPE_DOUBLE:
+        {
+            const quint64 bits = qFromLittleEndian<quint64>(src);
+            double d;
+            memcpy(&d, &bits, sizeof(d));
+            column.appendDouble(d);
+            break;
+        }
+        case MAVLINK_TYPE_UINT64_T:
+            column.appendUnsigned(qFromLittleEndian<quint64>(src));
+            break;
+        case MAVLINK_TYPE_INT64_T:
+            column.appendInteger(qFromLittleEndian<qint64>(src));
+            break;
+        default:
+            --valueCount;
+            break;
+        }
+    }
+
+    // check if a synthetic timestamp has to added
+    if (layout.m_addTime)
+    {
+        m_batch.column(tableID, 0).appendUnsigned(m_lastValidTS);
+        ++valueCount;
+    }
+
+    if (!commitRow(tableID, layout.m_timeColumn, valueCount) || !addGeneratedRows(message))
+    {
+        return false;
+    }
+    m_plotState->validDataRead();    // tell plot state that we have a valid message
+    return true;
+}
+
+bool AP2DataPlotTLogParser::addGeneratedRows(const mavlink_message_t &message)
+{
+    if (message.msgid == MAVLINK_MSG_ID_HEARTBEAT)
+    {
+        // Only if mode val has changed
+        const quint8 modeVal = static_cast<quint8>(mavlink_msg_heartbeat_get_custom_mode(&message));
+        if (modeVal != m_lastModeVal)
+        {
+            m_lastModeVal = modeVal;
+            m_batch.column(m_modeTableID, 0).appendUnsigned(m_lastValidTS);
+            m_batch.column(m_modeTableID, 1).appendInteger(modeVal);
+            m_batch.column(m_modeTableID, 2).appendInteger(modeVal);
+            m_batch.column(m_modeTableID, 3).appendText("Generated Value");
+            if (!commitRow(m_modeTableID, 0, 4))
+            {
+                return false;
+            }
+
+            // Mav type can be extracted from heartbeat too. So lets set the Mav type
+            // if not already set
+            if (m_loadedLogType == MAV_TYPE_GENERIC)
+            {
+                m_loadedLogType = static_cast<MAV_TYPE>(mavlink_msg_heartbeat_get_type(&message));
+            }
+        }
+    }
+    else if (message.msgid == MAVLINK_MSG_ID_STATUSTEXT)
+    {
+        // Create a MsgMessage from STATUSTEXT
+        char text[MAVLINK_MSG_STATUSTEXT_FIELD_TEXT_LEN];
+        mavlink_msg_statustext_get_text(&message, text);
+        m_batch.column(m_msgTableID, 0).appendUnsigned(m_lastValidTS);
+        m_batch.column(m_msgTableID, 1).appendText(readText(reinterpret_cast<const uchar*>(text), sizeof(text)));
+        m_batch.column(m_msgTableID, 2).appendText("Generated Value");
+        if (!commitRow(m_msgTableID, 0, 3))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AP2DataPlotTLogParser::compileLayout(const quint8 msgid)
+{
+    messageLayout &layout = m_layouts[msgid];
+    const mavlink_message_info_t &info = MESSAGE_INFO[msgid];
+    const QString name(info.name);
+    layout.m_compiled = true;
+
+    QString format;
+    QStringList labels;
+    for (unsigned int j = 0; j < info.num_fields; ++j)
+    {
+        const mavlink_field_info_t &field = info.fields[j];
+        labels << QString(field.name);
+        const char code = formatCode(field);
+        if (code)
+        {
+            format += QChar::fromLatin1(code);
+        }
+        else
+        {
+            QLOG_ERROR() << "Unknown type:" << QString::number(field.type);
+            m_plotState->corruptDataRead(m_index, name + " data: Unknown data type:" + QString::number(field.type));
+        }
+    }
+
+    // Now check if the message contains a timestamp if not add it
+    layout.m_addTime = !labels.join(",").contains(s_timeStampName);
+    if (layout.m_addTime)
+    {
+        labels.prepend(timeStampName());
+        format.prepend('Q');
+        m_timeStampHasToBeAddedCount++;
+    }
+
+    layout.m_tableID = addType(name, format, labels);
+    if (layout.m_tableID < 0)
+    {
+        return false;
+    }
+    const AP2DataPlotTable &table = m_batch.table(layout.m_tableID);
+    layout.m_timeColumn = table.columnIndex(timeStampName());
+
+    if (hasNoValues(msgid))
+    {
+        return true;
+    }
+
+    const bool filtered = isFiltered(msgid);
+    const int columnOffset = layout.m_addTime ? 1 : 0;
+    bool timeFound = false;
+    for (unsigned int j = 0; j < info.num_fields; ++j)
+    {
+        const mavlink_field_info_t &infoField = info.fields[j];
+        const QString fieldName(infoField.name);
+
+        // A leading time field is always delivered, all other fields only if the
+        // message is not filtered. Arrays are only delivered as text.
+        bool delivered;
+        if ((j == 0) && (fieldName == s_timeStampName) && (infoField.type == MAVLINK_TYPE_UINT32_T))
+        {
+            delivered = true;
+        }
+        else if ((j == 0) && fieldName.contains("usec") && (infoField.type == MAVLINK_TYPE_UINT64_T))
+        {
+            delivered = true;
+        }
+        else
+        {
+            delivered = !filtered && ((infoField.array_length == 0) || (infoField.type == MAVLINK_TYPE_CHAR));
+        }
+        if (!delivered)
+        {
+            continue;
+        }
+
+        fieldLayout field;
+        field.m_type = infoField.type;
+        field.m_offset = static_cast<int>(infoField.wire_offset);
+        field.m_arrayLength = static_cast<int>(infoField.array_length);
+        // Values are matched by position first like AP2DataPlotColumnStore::appendRow does
+        int column = static_cast<int>(j) + columnOffset;
+        if ((column >= table.m_labels.size()) || (table.m_labels.at(column) != fieldName))
+        {
+            column = table.columnIndex(fieldName);
+        }
+        if (column < 0)
+        {
+            continue;
+        }
+        field.m_column = column;
+        // Only the first field carrying the timestamp name is checked
+        field.m_isTime = !timeFound && !layout.m_addTime && (fieldName == s_timeStampName);
+        timeFound = timeFound || field.m_isTime;
+        layout.m_fields.push_back(field);
+    }
+    return true;
+}
+
+int AP2DataPlotTLogParser::addType(const QString &name, const QString &format, const QStringList &labels)
+{
+    if (!m_dataModel->addType(name, 0, 0, format, labels))
+    {
+        return -1;
+    }
+    // Model and batch get the types in the same order so both use the same table id
+    return m_batch.addType(name, 0, 0, format, labels);
+}
+
+bool AP2DataPlotTLogParser::commitRow(const int tableID, const int timeColumn, const int valueCount)
+{
+    m_batch.commitRow(tableID, static_cast<quint32>(m_index++), timeColumn, valueCount);
+    return !m_batch.isFull() || flush();
+}
+
+bool AP2DataPlotTLogParser::flush()
+{
+    if (m_batch.isEmpty())
+    {
+        return true;
+    }
+    if (!m_dataModel->appendBatch(m_batch))
+    {
+        return false;
+    }
+    m_batch.clear();
+    return true;
+}
+
+char AP2DataPlotTLogParser::formatCode(const mavlink_field_info_t &field)
+{
+    switch (field.type)
+    {
+    case MAVLINK_TYPE_CHAR:
+        return field.array_length == 0 ? 'b' : 'Z';    // single byte or string
+    case MAVLINK_TYPE_UINT8_T:
+        return 'B';
+    case MAVLINK_TYPE_INT8_T:
+        return 'b';
+    case MAVLINK_TYPE_UINT16_T:
+        return 'H';
+    case MAVLINK_TYPE_INT16_T:
+        return 'h';
+    case MAVLINK_TYPE_UINT32_T:
+        return 'I';
+    case MAVLINK_TYPE_INT32_T:
+        return 'i';
+    case MAVLINK_TYPE_FLOAT:
+        return 'f';
+    case MAVLINK_TYPE_DOUBLE:
+        return 'd';
+    case MAVLINK_TYPE_UINT64_T:
+        return 'Q';
+    case MAVLINK_TYPE_INT64_T:
+        return 'q';
+    default:
+        return 0;
+    }
+}
+
+QString AP2DataPlotTLogParser::readText(const uchar *data, const int length)
+{
+    int size = 0;
+    while ((size < length - 1) && data[size])
+    {
+        ++size;
+    }
+    return QString::fromUtf8(reinterpret_cast<const char*>(data), size);
+}
+
+quint64 AP2DataPlotTLogParser::checkTimeStamp(const quint64 timeStamp)
+{
+    // check if time is increasing
+    if (timeStamp >= m_lastValidTS)
+    {
+        m_lastValidTS = timeStamp;
+        return timeStamp;
+    }
+
+    QLOG_ERROR() << "Corrupt data read: Time is not increasing! Last valid time stamp:"
+                 << QString::number(m_lastValidTS) << " actual read time stamp is:"
+                 << QString::number(timeStamp);
+    m_plotState->corruptTimeRead(m_index, "Log time is not increasing! Last Time:" +
+                                 QString::number(m_lastValidTS) + " new Time:" +
+                                 QString::number(timeStamp));
+    // if not increasing set to last valid value
+    return m_lastValidTS;
+}
@@ -0,0 +1,220 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot streaming decoder for MAVLink telemetry logs (tlogs)
+ *
+ */
+
+#ifndef AP2DATAPLOTTLOGPARSER_H
+#define AP2DATAPLOTTLOGPARSER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "AP2DataPlot2DModel.h"
+#include "AP2DataPlotRecordBatch.h"
+#include "AP2DataPlotStatus.h"
+#include "libs/mavlink/include/mavlink/v1.0/ardupilotmega/mavlink.h"
+
+/**
+ * @brief The AP2DataPlotTLogParser class decodes MAVLink telemetry logs into a
+ *        typed record batch which is handed to an AP2DataPlot2DModel whenever it
+ *        is full.
+ *
+ *        For every message id a field layout (wire offset, type and target column
+ *        of each field) is compiled once from the mavlink_message_info_t table
+ *        when the message is seen for the first time. Packets are then decoded
+ *        straight from the payload into the typed columns. Unlike the
+ *        MAVLinkDecoder no names are built and no QVariants are created per value
+ *        and neither the UASManager nor any other singleton is used, so the parser
+ *        can run in any thread.
+ *
+ *        The parser keeps the semantics of the former MAVLinkDecoder based
+ *        AP2DataPlotThread::loadTLog: "time_boot_ms" is the timestamp, messages
+ *        without it get a synthetic one, MODE rows are generated from HEARTBEAT and
+ *        MSG rows from STATUSTEXT messages, GCS packets and "EMPTY" messages are
+ *        skipped and the vehicle type is taken from the first mode change.
+ */
+class AP2DataPlotTLogParser
+{
+public:
+    /**
+     * @brief AP2DataPlotTLogParser CTOR
+     * @param model - Data model to store the decoded data in
+     * @param status - Status object to report parsing errors to
+     */
+    AP2DataPlotTLogParser(AP2DataPlot2DModel *model, AP2DataPlotStatus *status);
+
+    /**
+     * @brief start adds the MODE and MSG message types to the data model.
+     *        Must be called once before parsing.
+     *
+     * @return false if the data model reported an error
+     */
+    bool start();
+
+    /**
+     * @brief parse decodes all packets of the data. A packet may be split over
+     *        several calls as the framing state is kept between the calls.
+     *
+     * @param data - Pointer to the next part of the log
+     * @param size - Size of the data
+     * @return false if the data model reported an error. Use
+     *         AP2DataPlot2DModel::getError() for details.
+     */
+    bool parse(const uchar *data, const qint64 size);
+
+    /**
+     * @brief finish hands all remaining rows to the data model and reports the
+     *        number of skipped "EMPTY" messages.
+     *
+     * @return false if the data model reported an error
+     */
+    bool finish();
+
+    /**
+     * @brief logType delivers the vehicle type taken from the HEARTBEAT messages
+     */
+    MAV_TYPE logType() const { return m_loadedLogType; }
+
+    /**
+     * @brief timeStampName delivers the name of the timestamp field of tlogs
+     */
+    static QString timeStampName() { return QString(s_timeStampName); }
+
+    /**
+     * @brief timeStampDivisor delivers the divisor to scale the timestamp to seconds
+     */
+    static double timeStampDivisor() { return 1000.0; }
+
+private:
+    static const char s_timeStampName[];    /// tlogs only have one possible time stamp
+    static const quint8 s_gcsSystemID = 255;    /// Packets of this system are not decoded
+
+    /**
+     * @brief The fieldLayout struct
+     *        Describes where a field is found in a payload and where it is stored.
+     */
+    struct fieldLayout
+    {
+        mavlink_message_type_t m_type;  /// MAVLink type of the field
+        int  m_offset;      /// Offset of the field in the payload
+        int  m_arrayLength; /// Array length, 0 for single values
+        int  m_column;      /// Column in the data model table, -1 if not stored
+        bool m_isTime;      /// True if the field holds the timestamp
+
+        fieldLayout() : m_type(MAVLINK_TYPE_CHAR), m_offset(0), m_arrayLength(0), m_column(-1), m_isTime(false) {}
+    };
+
+    /**
+     * @brief The messageLayout struct
+     *        Precompiled decoding information of one message id
+     */
+    struct messageLayout
+    {
+        bool m_compiled;        /// True if the layout was built
+        bool m_isEmpty;         /// True if the id has no message info ("EMPTY")
+        bool m_addTime;         /// True if a synthetic timestamp has to be added
+        int  m_tableID;         /// Table id in the data model
+        int  m_timeColumn;      /// Column holding the timestamp, -1 if none
+        QVector<fieldLayout> m_fields;  /// Layout of all fields delivering a value
+
+        messageLayout() : m_compiled(false), m_isEmpty(false), m_addTime(false),
+                          m_tableID(-1), m_timeColumn(-1) {}
+    };
+
+    /**
+     * @brief compileLayout builds the field layout of a message id and adds its
+     *        message type to the data model
+     * @return false if the data model reported an error
+     */
+    bool compileLayout(const quint8 msgid);
+
+    /**
+     * @brief decodeMessage decodes a complete packet into the batch
+     * @return false if the data model reported an error
+     */
+    bool decodeMessage(const mavlink_message_t &message);
+
+    /**
+     * @brief addGeneratedRows adds the MODE and MSG rows derived from HEARTBEAT
+     *        and STATUSTEXT messages
+     * @return false if the data model reported an error
+     */
+    bool addGeneratedRows(const mavlink_message_t &message);
+
+    /**
+     * @brief addType stores a message type in the data model and the batch
+     * @return id of the table or -1 if the data model reported an error
+     */
+    int addType(const QString &name, const QString &format, const QStringList &labels);
+
+    /**
+     * @brief commitRow completes a row and hands the batch to the model if it is full
+     * @return false if the data model reported an error
+     */
+    bool commitRow(const int tableID, const int timeColumn, const int valueCount);
+
+    /**
+     * @brief flush hands all rows of the batch to the data model
+     * @return false if the data model reported an error
+     */
+    bool flush();
+
+    /**
+     * @brief formatCode delivers the format character of a MAVLink field type
+     * @return format character or 0 for unknown types
+     */
+    static char formatCode(const mavlink_field_info_t &field);
+
+    /**
+     * @brief readText reads a char array up to the first zero. Like the
+     *        MAVLinkDecoder the last character is always treated as terminator.
+     */
+    static QString readText(const uchar *data, const int length);
+
+    /**
+     * @brief checkTimeStamp checks if the time is increasing and updates the last
+     *        valid time stamp.
+     * @return The valid time stamp to be stored
+     */
+    quint64 checkTimeStamp(const quint64 timeStamp);
+
+    AP2DataPlot2DModel *m_dataModel;
+    AP2DataPlotStatus  *m_plotState;
+    AP2DataPlotRecordBatch m_batch;         /// Decoded rows not yet handed to the model
+    MAV_TYPE m_loadedLogType;
+
+    messageLayout m_layouts[256];           /// Layout for every possible message id
+    mavlink_message_t m_rxMessage;          /// Framing buffer of the actual packet
+    mavlink_status_t m_rxStatus;            /// Framing state of the actual packet
+    int m_modeTableID;                      /// Table id of the generated MODE messages
+    int m_msgTableID;                       /// Table id of the generated MSG messages
+    int m_timeStampHasToBeAddedCount;       /// Number of types getting a synthetic timestamp
+    int m_emptyMessageCount;                /// Number of skipped "EMPTY" messages
+    int m_index;                            /// Actual log index
+    quint64 m_lastValidTS;                  /// Last valid timestamp
+    quint8 m_lastModeVal;                   /// Last mode read from a HEARTBEAT
+};
+
+#endif // AP2DATAPLOTTLOGPARSER_H
@@ -38,8 +38,12 @@ This file is part of the APM_PLANNER project
 #include <QSqlField>
 #include <QSqlError>
 #include <QByteArray>
+#include <QHash>
 #include <QDataStream>
-#include "MAVLinkDecoder.h"
+#include "AP2DataPlotBinaryParser.h"
+#include "AP2DataPlotLogCache.h"
+#include "AP2DataPlotParallelParser.h"
+#include "AP2DataPlotTLogParser.h"
 #include "QsLog.h"
 #include "QGC.h"
 
@@ -47,6 +51,7 @@ This file is part of the APM_PLANNER project
 AP2DataPlotThread::AP2DataPlotThread(AP2DataPlot2DModel *model,QObject *parent) :
     QThread(parent),
     m_stop(false),
+    m_loadSucceeded(false),
     m_dataModel(model)
 {
     QLOG_DEBUG() << "Created AP2DataPlotThread:" << this;
@@ -77,17 +82,9 @@ bool AP2DataPlotThread::isMainThread()
 
 void AP2DataPlotThread::loadBinaryLog(QFile &logfile)
 {
-    typedef QPair<unsigned int, typeDescriptor> typeToDescPair; // Pair holding message type and format descriptor
-    QMap<unsigned int, typeDescriptor> typeToDescriptorMap;     // Map to get a format descriptor for every message type
-    QList<typeToDescPair> typesWithoutTimeStamp;        // list storing all descriptors without a timestamp field
-    QList<unsigned int> timeStampHasToBeAdded;          // list holding all message types without a timestamp
-    QStringList tables;
-
-    QByteArray block;
-    int paramtype = -1;
-    int index = 0;
-    quint64 lastValidTS = 0;
-    m_loadedLogType = MAV_TYPE_GENERIC;
+    // Read in steps of 1MB. A step ends within the last packet in most cases, this
+    // packet is kept and completed by the next step.
+    static const qint64 readStepSize = 1024 * 1024;
 
     if (!m_dataModel->startTransaction())
     {
@@ -95,388 +92,107 @@ void AP2DataPlotThread::loadBinaryLog(QFile &logfile)
         return;
     }
 
+    AP2DataPlotBinaryParser parser(m_dataModel, &m_plotState);
+    QByteArray buffer;
     while (!logfile.atEnd() && !m_stop)
     {
-        int nonpacketcounter = 0;
         emit loadProgress(logfile.pos(),logfile.size());
-        block.append(logfile.read(8192));
-        for (int i=0;i<block.size();i++)
+        buffer.append(logfile.read(readStepSize));
+        const uchar *data = reinterpret_cast<const uchar*>(buffer.constData());
+        qint64 pos = parser.parse(data, buffer.size(), 0, buffer.size());
+        if (pos < 0)
         {
-            if (i+3 < block.size()) //Enough room for a header
-            {
-                if (static_cast<unsigned char>(block.at(i)) == 0xA3 && static_cast<unsigned char>(block.at(i+1)) == 0x95)
-                {
-                    //It's a valid header.
-                    unsigned char type = static_cast<unsigned char>(block.at(i+2));
-                    if (type == 0x80)
-                    {
-                        //Message format packet
-                        if (i+92 >= block.size())
-                        {
-                            //Not enough data in the block
-                            break; //Break out of the for loop to let the file load more
-                        }
-
-                        QByteArray packet = block.mid(i+3,86);
-                        block = block.remove(i,89); //Remove both the 3 byte header and the packet
-                        i--;
-
-                        unsigned char msg_type = static_cast<unsigned char>(packet.at(0)); //Message type defined in the format struct
-
-                        typeDescriptor desc;
-                        desc.m_length = static_cast<int>(static_cast<unsigned>(packet.at(1)));    //Message length
-                        desc.m_name   = packet.mid(2,4);    //Name of the message
-                        desc.m_format = packet.mid(6,16);   //Format of the variables
-                        desc.m_labels = packet.mid(22,64);  //comma delimited list of variable names.
-                        typeToDescriptorMap.insert(msg_type, desc); // store descriptor for parsing
-
-                        if (desc.m_name == "PARM")
-                        {
-                            paramtype = msg_type;
-                        }
-                        if (msg_type == 0x80)
-                        {
-                            //Message is a format type, we don't want to include it
-                            continue;
-                        }
-                        if (desc.m_format == "" || desc.m_labels == "")
-                        {
-                            // "STRT" message is a special case in older logs - ignore
-                            if (desc.m_name != "STRT")
-                            {
-                                QLOG_DEBUG() << "AP2DataPlotThread::run(): empty format string or labels string for type" << msg_type << desc.m_name;
-                                m_plotState.corruptFMTRead(index, desc.m_name + " format data: Corrupt or missing. Message type is:0x" +
-                                                           QString::number(msg_type, 16));
-                                continue;
-                            }
-                        }
-
-                        // All parsing is done now. following code shall detect the name of the timestamp field
-                        // and add such a field to all lines that do not have one.
-                        if (!tables.contains(desc.m_name))
-                        {
-                            // try to find the name of timestamp column
-                            if (m_timeStamp.m_name.size() == 0)
-                            {
-                                foreach(const timeStampType &ts, m_possibleTimestamps)
-                                {
-                                    if (desc.m_labels.contains(ts.m_name))
-                                    {
-                                        // found
-                                        m_timeStamp = ts;
-                                        break;
-                                    }
-                                }
-                                // check again and if not found store descriptor for delayed transfer to data model
-                                // as we haven't detected the right name
-                                if(m_timeStamp.m_name.size() == 0)
-                                {
-                                    typesWithoutTimeStamp.push_back(typeToDescPair(msg_type, desc));
-                                }
-                            }
-                            if (m_timeStamp.m_name.size() != 0)
-                            {   // we have a valid timestamp column name
-                                // first check if we have to process delayed messages without a timestamp
-                                foreach (typeToDescPair typeDescPair, typesWithoutTimeStamp)
-                                {
-                                    addTimeToDescriptor(typeDescPair.second);
-                                    // store message type for later processing
-                                    timeStampHasToBeAdded.push_back(typeDescPair.first);
-                                    // store adapted message
-                                    if (!m_dataModel->addType(typeDescPair.second.m_name, typeDescPair.first,
-                                                              typeDescPair.second.m_length, typeDescPair.second.m_format,
-                                                              typeDescPair.second.m_labels.split(",")))
-                                    {
-                                        QString actualerror = m_dataModel->getError();
-                                        m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
-                                        emit error(actualerror);
-                                        return;
-                                    }
-                                    tables.append(typeDescPair.second.m_name);
-                                    index++;
-                                }
-                                typesWithoutTimeStamp.clear();
-
-                                // Now check if the actual message conains a timestamp if not add it
-                                if (!desc.m_labels.contains(m_timeStamp.m_name))
-                                {
-                                    // Add timestamp to descriptor
-                                    addTimeToDescriptor(desc);
-                                    timeStampHasToBeAdded.push_back(msg_type);// store message type for later processing
-                                }
-                                // Special handling for "GPS" messages that have a "TimeMS" timestamp but scaling
-                                // and value does not mach all other time stamps
-                                if ((desc.m_name == "GPS") && desc.m_labels.contains("TimeMS"))
-                                {
-                                    // replace the original timestamp name
-                                    adaptGPSDescriptor(typeToDescriptorMap, desc, msg_type);
-                                    timeStampHasToBeAdded.push_back(msg_type);// store message type for later processing
-                                }
-
-                                // store in datamodel
-                                if (!m_dataModel->addType(desc.m_name, msg_type, desc.m_length, desc.m_format, desc.m_labels.split(",")))
-                                {
-                                    QString actualerror = m_dataModel->getError();
-                                    m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
-                                    emit error(actualerror);
-                                    return;
-                                }
-                                tables.append(desc.m_name);
-                                index++;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        //Data packet
-                        if (!typeToDescriptorMap.contains(type))
-                        {
-                            QLOG_DEBUG() << "AP2DataPlotThread::run(): No entry in typeToDescriptorMap for type:" << type;
-                            m_plotState.corruptDataRead(index, "No length information for message type:0x" + QString::number(type, 16));
-                            break;
-                        }
-                        if (i+3+typeToDescriptorMap.value(type).m_length >= block.size())
-                        {
-                            //Not enough data yet, read more from the file
-                            break;
-                        }
-                        QByteArray packet = block.mid(i + 3, typeToDescriptorMap.value(type).m_length - 3);
-                        block.remove(i,packet.size()+3); //Remove both the 3 byte header and the packet
-                        i--;
-                        QDataStream packetstream(packet);
-                        packetstream.setByteOrder(QDataStream::LittleEndian);
-                        packetstream.setFloatingPointPrecision(QDataStream::SinglePrecision);
-
-                        QString name = typeToDescriptorMap.value(type).m_name;
-                        if (tables.contains(name))
-                        {
-                            index++;
-                            QList<QPair<QString,QVariant> > valuepairlist;
-                            QString formatstr = typeToDescriptorMap.value(type).m_format;
-                            QString labelstr = typeToDescriptorMap.value(type).m_labels;
-                            QStringList labelstrsplit = labelstr.split(",");
-                            bool noCorruptDataFound = true;
+            QString actualerror = m_dataModel->getError();
+            m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
+            emit error(actualerror);
+            return;
+        }
+        buffer.remove(0, static_cast<int>(pos));
+    }
+    m_loadedLogType = parser.logType();
+    m_timeStamp = timeStampType(parser.timeStampName(), parser.timeStampDivisor());
 
-                            for (int j=0;j<formatstr.size();j++)
-                            {
-                                QChar typeCode = formatstr.at(j);
-                                if (typeCode == 'b') //int8_t
-                                {
-                                    qint8 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val));
-                                }
-                                else if (typeCode == 'B') //uint8_t
-                                {
-                                    quint8 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val));
-                                }
-                                else if (typeCode == 'h') //int16_t
-                                {
-                                    qint16 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val));
-                                }
-                                else if (typeCode == 'H') //uint16_t
-                                {
-                                    quint16 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val));
-                                }
-                                else if (typeCode == 'i') //int32_t
-                                {
-                                    qint32 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val));
-                                }
-                                else if (typeCode == 'I') //uint32_t
-                                {
-                                    quint32 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val));
-                                }
-                                else if (typeCode == 'f') //float
-                                {
-                                    float f;
-                                    packetstream >> f;
-                                    if (f != f) // This tests for not a number
-                                    {
-                                        QLOG_WARN() << "Corrupted log data found - Graphing may not work as expected for data of type" << name;
-                                        noCorruptDataFound = false;
-                                        m_plotState.corruptDataRead(index, "Corrupt data element found when decoding " + name + " data.");
-                                    }
-                                    else
-                                    {
-                                        valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),f));
-                                    }
-                                }
-                                else if (typeCode == 'n') //char(4)
-                                {
+    if (!m_dataModel->endTransaction())
+    {
+        emit error(m_dataModel->getError());
+        return;
+    }
+    loadFinished();
+}
 
-                                    QString val = "";
-                                    for (int i=0;i<4;i++)
-                                    {
-                                        quint8 ch;
-                                        packetstream >> ch;
-                                        if (ch)
-                                        {
-                                            val += static_cast<char>(ch);
-                                        }
-                                    }
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val));
-                                }
-                                else if (typeCode == 'N') //char(16)
-                                {
-                                    QString val = "";
-                                    for (int i=0;i<16;i++)
-                                    {
-                                        quint8 ch;
-                                        packetstream >> ch;
-                                        if (ch)
-                                        {
-                                            val += static_cast<char>(ch);
-                                        }
-                                    }
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val));
-                                }
-                                else if (typeCode == 'Z') //char(64)
-                                {
-                                    QString val = "";
-                                    for (int i=0;i<64;i++)
-                                    {
-                                        quint8 ch;
-                                        packetstream >> ch;
-                                        if (ch)
-                                        {
-                                            val += static_cast<char>(ch);
-                                        }
-                                    }
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val));
-                                }
-                                else if (typeCode == 'c') //int16_t * 100
-                                {
-                                    qint16 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val / 100.0));
-                                }
-                                else if (typeCode == 'C') //uint16_t * 100
-                                {
-                                    quint16 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val / 100.0));
-                                }
-                                else if (typeCode == 'e') //int32_t * 100
-                                {
-                                    qint32 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val / 100.0));
-                                }
-                                else if (typeCode == 'E') //uint32_t * 100
-                                {
-                                    quint32 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val / 100.0));
-                                }
-                                else if (typeCode == 'L') //uint32_t GPS Lon/Lat * 10000000
-                                {
-                                    qint32 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val / 10000000.0));
-                                }
-                                else if (typeCode == 'M')
-                                {
-                                    qint8 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val));
-                                }
-                                else if (typeCode == 'q')
-                                {
-                                    qint64 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val));
-                                }
-                                else if (typeCode == 'Q')
-                                {
-                                    quint64 val;
-                                    packetstream >> val;
-                                    valuepairlist.append(QPair<QString,QVariant>(labelstrsplit.at(j),val));
-                                }
-                                else
-                                {
-                                    //Unknown!
-                                    QLOG_DEBUG() << "AP2DataPlotThread::run(): ERROR UNKNOWN DATA TYPE" << typeCode;
-                                    m_plotState.corruptDataRead(index, "Unknown data type: " + QString(typeCode) + " when decoding " + name);
-                                }
-                            }
-                            // check if a synthetic timestamp has to added
-                            handleMissingTimeStamps(timeStampHasToBeAdded, type, valuepairlist, lastValidTS, index);
+bool AP2DataPlotThread::loadBinaryLogMapped(QFile &logfile)
+{
+    // Parse in steps of 4MB to be able to report the progress and to react on stop requests
+    static const qint64 parseStepSize = 4 * 1024 * 1024;
+    // Smaller logs are loaded faster than the threads can be set up
+    static const qint64 parallelParsingMinSize = 32 * 1024 * 1024;
+
+    const qint64 size = logfile.size();
+    const uchar *data = logfile.map(0, size);
+    if (!data)
+    {
+        return false;
+    }
 
-                            if (noCorruptDataFound && (valuepairlist.size() >= 1))
-                            {
-                                if (!m_dataModel->addRow(name, valuepairlist, index, m_timeStamp.m_name))
-                                {
-                                    QString actualerror = m_dataModel->getError();
-                                    m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
-                                    emit error(actualerror);
-                                    return;
-                                }
-                                m_plotState.validDataRead();
-                            }
+    if (!m_dataModel->startTransaction())
+    {
+        logfile.unmap(const_cast<uchar*>(data));
+        emit error(m_dataModel->getError());
+        return true;
+    }
 
-                            if (type == paramtype && m_loadedLogType == MAV_TYPE_GENERIC)
-                            {
-                                // Name field is not always on same Index. So first search for the right position...
-                                int nameIndex = 0;
-                                for (int i = 0; i < valuepairlist.size(); ++i)
-                                {
-                                    if (valuepairlist[i].first == "Name")
-                                    {
-                                        nameIndex = i;
-                                        break;
-                                    }
-                                }
-                                //...and then use it to check the values.
-                                if (valuepairlist[nameIndex].second == "RATE_RLL_P" || valuepairlist[nameIndex].second == "H_SWASH_PLATE")
-                                {
-                                    m_loadedLogType = MAV_TYPE_QUADROTOR;
-                                }
-                                else if (valuepairlist[nameIndex].second == "PTCH2SRV_P")
-                                {
-                                    m_loadedLogType = MAV_TYPE_FIXED_WING;
-                                }
-                                else if (valuepairlist[nameIndex].second == "SKID_STEER_OUT")
-                                {
-                                    m_loadedLogType = MAV_TYPE_GROUND_ROVER;
-                                }
-                            }
-                        }
-                        else
-                        {
-                            QLOG_DEBUG() << "AP2DataPlotThread::run(): No query available for param category" << name;
-                            m_plotState.corruptDataRead(index, "No format information available for message type:0x" + QString::number(type, 16));
-                        }
-                    }
-                }
-                else
-                {
-                    //Non packet
-                    nonpacketcounter++;
-                }
-            }
-        }
-        if (nonpacketcounter > 0)
+    qint64 pos = 0;
+    QString actualerror;
+    if ((size >= parallelParsingMinSize) && (QThread::idealThreadCount() > 1))
+    {
+        AP2DataPlotParallelParser parser(m_dataModel, &m_plotState);
+        connect(&parser, SIGNAL(progress(qint64,qint64)), this, SIGNAL(loadProgress(qint64,qint64)));
+        pos = parser.parse(data, size, m_stop);
+        actualerror = parser.getError();
+        m_loadedLogType = parser.logType();
+        m_timeStamp = timeStampType(parser.timeStampName(), parser.timeStampDivisor());
+    }
+    else
+    {
+        AP2DataPlotBinaryParser parser(m_dataModel, &m_plotState);
+        while ((pos < size) && !m_stop)
         {
-            QLOG_DEBUG() << "AP2DataPlotThread::run(): Non packet bytes found in log file" << nonpacketcounter << "bytes filtered out. This may be a corrupt log";
-            m_plotState.corruptDataRead(index, "Non packet bytes found in log file " + QString::number(nonpacketcounter) + " bytes filtered out");
+            emit loadProgress(pos, size);
+            qint64 nextPos = parser.parse(data, size, pos, qMin(pos + parseStepSize, size));
+            if (nextPos < 0)
+            {
+                actualerror = m_dataModel->getError();
+                pos = nextPos;
+                break;
+            }
+            if (nextPos == pos)
+            {
+                // Only a truncated packet is left
+                break;
+            }
+            pos = nextPos;
         }
+        m_loadedLogType = parser.logType();
+        m_timeStamp = timeStampType(parser.timeStampName(), parser.timeStampDivisor());
     }
+    logfile.unmap(const_cast<uchar*>(data));
+
+    if (pos < 0)
+    {
+        m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
+        emit error(actualerror);
+        return true;
+    }
+    // keep the file position up to date as it is used for the final log message
+    logfile.seek(pos);
+
     if (!m_dataModel->endTransaction())
     {
         emit error(m_dataModel->getError());
-        return;
+        return true;
     }
-    m_dataModel->setAllRowsHaveTime(true, m_timeStamp.m_name, m_timeStamp.m_divisor);
+    loadFinished();
+    return true;
 }
 
 void AP2DataPlotThread::loadAsciiLog(QFile &logfile)
@@ -486,9 +202,11 @@ void AP2DataPlotThread::loadAsciiLog(QFile &logfile)
 
     typedef QPair<unsigned int, typeDescriptor> typeToDescPair; // Pair holding message type and format descriptor
     QMap<QString, typeDescriptor> nameToDescriptorMap;     // Map to get a format descriptor for every message type
+    QHash<QString, asciiLayout> nameToLayoutMap;        // Map holding the compiled layout of every message type
     QList<typeToDescPair> typesWithoutTimeStamp;        // list storing all descriptors without a timestamp field
     QStringList timeStampHasToBeAdded;          // list holding all message types without a timestamp
     quint64 lastValidTS = 0;
+    AP2DataPlotRecordBatch batch;
 
     if (!m_dataModel->startTransaction())
     {
@@ -527,6 +245,8 @@ void AP2DataPlotThread::loadAsciiLog(QFile &logfile)
                     desc.m_name = linesplit[3].trimmed();
                     if (desc.m_name != "FMT")
                     {
+                        // descriptors may change - layouts have to be rebuilt
+                        nameToLayoutMap.clear();
                         desc.m_format = linesplit[4].trimmed();
                         nameToDescriptorMap.insert(desc.m_name, desc);
                         if (desc.m_format == "")
@@ -573,9 +293,7 @@ void AP2DataPlotThread::loadAsciiLog(QFile &logfile)
                                 // store message type for later processing
                                 timeStampHasToBeAdded.push_back(typeDescPair.second.m_name);
                                 // store adapted message
-                                if (!m_dataModel->addType(typeDescPair.second.m_name, typeDescPair.first,
-                                                          typeDescPair.second.m_length, typeDescPair.second.m_format,
-                                                          typeDescPair.second.m_labels.split(",")))
+                                if (!addType(batch, typeDescPair.first, typeDescPair.second))
                                 {
                                     QString actualerror = m_dataModel->getError();
                                     m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
@@ -605,7 +323,7 @@ void AP2DataPlotThread::loadAsciiLog(QFile &logfile)
                             }
                         }
 
-                        if (!m_dataModel->addType(desc.m_name, type_id, desc.m_length, desc.m_format, desc.m_labels.split(",")))
+                        if (!addType(batch, type_id, desc))
                         {
                             QString actualerror = m_dataModel->getError();
                             m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
@@ -648,7 +366,8 @@ void AP2DataPlotThread::loadAsciiLog(QFile &logfile)
                           q   : int64_t
                           Q   : uint64_t
                         */
-                        QString typestr = nameToDescriptorMap.value(name).m_format;
+                        const typeDescriptor &desc = nameToDescriptorMap[name];
+                        const QString &typestr = desc.m_format;
                         static QString intdef("bBhHiI"); // 32 bit max types.
                         static QString floatdef("cCeEfL");
                         static QString chardef("nNZM");
@@ -659,21 +378,41 @@ void AP2DataPlotThread::loadAsciiLog(QFile &logfile)
                         }
                         else
                         {
-                            QList<QPair<QString,QVariant> > valuepairlist;
-                            QStringList valuestrlist = nameToDescriptorMap.value(name).m_labels.split(",");
+                            QHash<QString, asciiLayout>::iterator layoutIter = nameToLayoutMap.find(name);
+                            if (layoutIter == nameToLayoutMap.end())
+                            {
+                                layoutIter = nameToLayoutMap.insert(name, compileLayout(batch, desc, timeStampHasToBeAdded.contains(name)));
+                            }
+                            const asciiLayout &layout = layoutIter.value();
+                            if (layout.m_tableID < 0)
+                            {
+                                m_dataModel->endTransaction();
+                                emit error("No table available for message: " + name);
+                                return;
+                            }
 
+                            const int row = batch.table(layout.m_tableID).rowCount();
+                            AP2DataPlotColumn *timeColumn = 0;  // column the time stamp was stored in
+                            quint64 timeStamp = 0;
+                            bool timeFound = false;
+                            int valueCount = 0;
                             bool foundError = false;
                             for (int i = 1; i < linesplit.size(); i++)
                             {
-                                QString subname = "";
-                                if (valuestrlist.size() > i-1)
+                                if (layout.m_columns.size() <= i-1)
                                 {
-                                    subname = valuestrlist.at(i-1);
+                                    continue;
                                 }
-                                else
+                                AP2DataPlotColumn *column = 0;
+                                if (layout.m_columns.at(i-1) >= 0)
                                 {
-                                    continue;
+                                    column = &batch.column(layout.m_tableID, layout.m_columns.at(i-1));
+                                    if (column->size() != row)
+                                    {
+                                        column = 0; // column already has a value
+                                    }
                                 }
+                                const bool isTime = (layout.m_timeField == i-1);
                                 bool ok;
                                 QChar typeCode = typestr.at(i - 1);
                                 QString valStr = linesplit[i].trimmed();
@@ -682,31 +421,36 @@ void AP2DataPlotThread::loadAsciiLog(QFile &logfile)
                                     int val = valStr.toInt(&ok);
                                     if (ok)
                                     {
-                                        valuepairlist.append(QPair<QString,QVariant>(subname,val));
+                                        if (isTime) timeStamp = static_cast<quint64>(static_cast<qint64>(val));
+                                        if (column) column->appendInteger(val);
                                     }
                                     else
                                     {
                                         QLOG_DEBUG() << "Failed to convert " << valStr << " to an integer number.";
                                         m_plotState.corruptDataRead(index, name + " data: Failed to convert " + valStr + " to an integer number.");
                                         foundError = true;
+                                        continue;
                                     }
                                 }
                                 else if (chardef.contains(typeCode))
                                 {
-                                    valuepairlist.append(QPair<QString,QVariant>(subname,valStr));
+                                    if (isTime) timeStamp = valStr.toULongLong();
+                                    if (column) column->appendText(valStr);
                                 }
                                 else if (floatdef.contains(typeCode))
                                 {
                                     double val = valStr.toDouble(&ok);
                                     if (ok && !isinf(val) && !isnan(val))
                                     {
-                                        valuepairlist.append(QPair<QString,QVariant>(subname,val));
+                                        if (isTime) timeStamp = static_cast<quint64>(qRound64(val));
+                                        if (column) column->appendDouble(val);
                                     }
                                     else
                                     {
                                         QLOG_DEBUG() << "Failed to convert " << valStr << " to a floating point number.";
                                         m_plotState.corruptDataRead(index, name + " data: Failed to convert " + valStr + " to a floating point number.");
                                         foundError = true;
+                                        continue;
                                     }
                                 }
                                 else if (QString('q').contains(typeCode) )
@@ -714,13 +458,15 @@ void AP2DataPlotThread::loadAsciiLog(QFile &logfile)
                                     qint64 val = valStr.toLongLong(&ok);
                                     if (ok)
                                     {
-                                        valuepairlist.append(QPair<QString,QVariant>(subname,val));
+                                        if (isTime) timeStamp = static_cast<quint64>(val);
+                                        if (column) column->appendInteger(val);
                                     }
                                     else
                                     {
                                         QLOG_DEBUG() << "Failed to convert " << valStr << " to an qint64 number.";
                                         m_plotState.corruptDataRead(index, name + " data: Failed to convert " + valStr + " to an qint64 number.");
                                         foundError = true;
+                                        continue;
                                     }
                                 }
                                 else if (QString('Q').contains(typeCode) )
@@ -728,39 +474,74 @@ void AP2DataPlotThread::loadAsciiLog(QFile &logfile)
                                     quint64 val = valStr.toULongLong(&ok);
                                     if (ok)
                                     {
-                                        valuepairlist.append(QPair<QString,QVariant>(subname,val));
+                                        if (isTime) timeStamp = val;
+                                        if (column) column->appendUnsigned(val);
                                     }
                                     else
                                     {
                                         QLOG_DEBUG() << "Failed to convert " << valStr << " to an quint64 number.";
                                         m_plotState.corruptDataRead(index, name + " data: Failed to convert " + valStr + " to an quint64 number.");
                                         foundError = true;
+                                        continue;
                                     }
                                 }
                                 else
                                 {
                                     QLOG_DEBUG() << "AP2DataPlotThread::run(): Unknown data value found" << typeCode;
                                     m_plotState.corruptDataRead(index, name + " data: Unknown data value found: %1" + QString(typeCode));
+                                    batch.discardRow(layout.m_tableID);
+                                    m_dataModel->appendBatch(batch);    // keep the rows read so far
                                     return;
                                 }
+                                if (isTime)
+                                {
+                                    timeFound = true;
+                                    timeColumn = column;
+                                }
+                                ++valueCount;
                             }
                             if (!foundError)
                             {
                                 // check if a synthetic timestamp has to added
-                                handleMissingTimeStamps(timeStampHasToBeAdded, name, valuepairlist, lastValidTS, index);
+                                if (timeStampHasToBeAdded.size() > 0)
+                                {
+                                    if (layout.m_addTime)
+                                    {
+                                        if (layout.m_timeColumn >= 0)
+                                        {
+                                            AP2DataPlotColumn &column = batch.column(layout.m_tableID, layout.m_timeColumn);
+                                            if (column.size() == row)
+                                            {
+                                                column.appendUnsigned(lastValidTS);
+                                            }
+                                        }
+                                        ++valueCount;
+                                    }
+                                    // if not check the actual time stamp
+                                    else if (timeFound)
+                                    {
+                                        const quint64 validTimeStamp = checkTimeStamp(timeStamp, index, lastValidTS);
+                                        if ((validTimeStamp != timeStamp) && timeColumn)
+                                        {
+                                            // replace by the corrected value
+                                            timeColumn->truncate(row);
+                                            timeColumn->appendUnsigned(validTimeStamp);
+                                        }
+                                    }
+                                }
 
-                                if (valuepairlist.size() >= 1)
+                                if (valueCount >= 1)
                                 {
-                                    if (!m_dataModel->addRow(name,valuepairlist,index++, m_timeStamp.m_name))
+                                    batch.commitRow(layout.m_tableID, index++, layout.m_timeColumn, valueCount);
+                                    m_plotState.validDataRead();
+                                    if (batch.isFull() && !flushBatch(batch))
                                     {
-                                        QString actualerror = m_dataModel->getError();
-                                        m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
-                                        emit error(actualerror);
                                         return;
                                     }
-                                    m_plotState.validDataRead();
+                                    continue;
                                 }
                             }
+                            batch.discardRow(layout.m_tableID);
                         }
                     }
                     else
@@ -773,29 +554,26 @@ void AP2DataPlotThread::loadAsciiLog(QFile &logfile)
             }
         }
     }
+    if (!flushBatch(batch))
+    {
+        return;
+    }
     if (!m_dataModel->endTransaction())
     {
         emit error(m_dataModel->getError());
         return;
     }
-    m_dataModel->setAllRowsHaveTime(true, m_timeStamp.m_name , m_timeStamp.m_divisor);
+    loadFinished();
 }
 
 
 void AP2DataPlotThread::loadTLog(QFile &logfile)
 {
-    m_loadedLogType = MAV_TYPE_GENERIC;
-    int nrOfEmptyMsg = 0;
-    int bytesize = 0;
-    int index = 100;
-    quint8 lastModeVal = 255;
-    QStringList timeStampHasToBeAdded;
-    quint64 lastValidTS = 0;
-    m_timeStamp = timeStampType("time_boot_ms", 1000.0); // tlogs only have one possible time stamp
+    // Read in steps of 1MB. The parser keeps the framing state so packets may
+    // be split between two steps.
+    static const qint64 readStepSize = 1024 * 1024;
 
-    mavlink_message_t message;
-    mavlink_status_t status;
-    QScopedPointer<MAVLinkDecoder> decoder(new MAVLinkDecoder());
+    m_timeStamp = timeStampType(AP2DataPlotTLogParser::timeStampName(), AP2DataPlotTLogParser::timeStampDivisor());
 
     if (!m_dataModel->startTransaction())
     {
@@ -803,263 +581,31 @@ void AP2DataPlotThread::loadTLog(QFile &logfile)
         return;
     }
 
-    // Tlog does not contain MODE messages the mode information ins transmitted in
-    // a heartbeat message. So we create the datatype for MODE here and put it into data model
-    QStringList modeVarNames;
-    modeVarNames.push_back(QString(m_timeStamp.m_name));
-    modeVarNames.push_back(QString("Mode"));
-    modeVarNames.push_back(QString("ModeNum"));
-    modeVarNames.push_back(QString("Info"));
-    if (!m_dataModel->addType(ModeMessage::TypeName,0,0,"QMBZ",modeVarNames))
+    AP2DataPlotTLogParser parser(m_dataModel, &m_plotState);
+    bool success = parser.start();
+    QByteArray buffer;
+    while (success && !logfile.atEnd() && !m_stop)
     {
-        QString actualerror = m_dataModel->getError();
-        m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
-        emit error(actualerror);
-        return;
+        emit loadProgress(logfile.pos(),logfile.size());
+        buffer = logfile.read(readStepSize);
+        success = parser.parse(reinterpret_cast<const uchar*>(buffer.constData()), buffer.size());
     }
+    success = success && parser.finish();
+    m_loadedLogType = parser.logType();
 
-    // Tlog does not contain MSG messages. The information is gathered from STATUSTEXT tlog
-    // messages. So we create the datatype for MSG here and put it into data model.
-    QStringList msgVarNames;
-    msgVarNames.push_back(QString(m_timeStamp.m_name));
-    msgVarNames.push_back(QString("Message"));
-    msgVarNames.push_back(QString("Info"));
-    if (!m_dataModel->addType(MsgMessage::TypeName,0,0,"QZZ",msgVarNames))
+    if (!success)
     {
         QString actualerror = m_dataModel->getError();
         m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
         emit error(actualerror);
         return;
     }
-
-    while (!logfile.atEnd() && !m_stop)
-    {
-        emit loadProgress(logfile.pos(),logfile.size());
-        QByteArray bytes = logfile.read(8192);
-        bytesize += bytes.size();
-
-        for (int i=0;i<bytes.size();i++)
-        {
-            unsigned int decodeState = mavlink_parse_char(14, static_cast<uint8_t>(bytes[i]), &message, &status);
-            if (decodeState == MAVLINK_FRAMING_OK)
-            {
-                // Good decode. Now check message name. If its "EMPTY" we cannot insert it into datamodel
-                // We will count those messages and inform the user.
-                typeDescriptor desc;
-                desc.m_name = decoder->getMessageName(message.msgid);
-                if (desc.m_name != "EMPTY")
-                {
-                    if (message.sysid != 255) // [TODO] GCS packet is not always 255 sysid.
-                    {
-                        QList<QPair<QString,QVariant> > retvals = decoder->receiveMessage(0,message);
-                        if (!m_dataModel->hasType(desc.m_name))
-                        {
-                            // If we don't have a format description by now extract and store it
-                            QList<QString> fieldnames = decoder->getFieldList(desc.m_name);
-                            QStringList variablenames;
-                            for (int i=0;i<fieldnames.size();i++)
-                            {
-                                mavlink_field_info_t fieldinfo = decoder->getFieldInfo(desc.m_name,fieldnames.at(i));
-                                variablenames <<  QString(fieldinfo.name);
-                                switch (fieldinfo.type)
-                                {
-                                    case MAVLINK_TYPE_CHAR:
-                                    {
-                                        if (fieldinfo.array_length == 0)
-                                        {
-                                            desc.m_format += "b";   // it is a single byte
-                                        }
-                                        else
-                                        {
-                                            desc.m_format += "Z";   // everything else is a string
-                                        }
-                                    }
-                                    break;
-                                    case MAVLINK_TYPE_UINT8_T:
-                                    {
-                                        desc.m_format += "B";
-                                    }
-                                    break;
-                                    case MAVLINK_TYPE_INT8_T:
-                                    {
-                                        desc.m_format += "b";
-                                    }
-                                    break;
-                                    case MAVLINK_TYPE_UINT16_T:
-                                    {
-                                        desc.m_format += "H";
-                                    }
-                                    break;
-                                    case MAVLINK_TYPE_INT16_T:
-                                    {
-                                        desc.m_format += "h";
-                                    }
-                                    break;
-                                    case MAVLINK_TYPE_UINT32_T:
-                                    {
-                                        desc.m_format += "I";
-                                    }
-                                        break;
-                                    case MAVLINK_TYPE_INT32_T:
-                                    {
-                                        desc.m_format += "i";
-                                    }
-                                    break;
-                                    case MAVLINK_TYPE_FLOAT:
-                                    {
-                                        desc.m_format += "f";
-                                    }
-                                    break;
-                                    case MAVLINK_TYPE_UINT64_T:
-                                    {
-                                        desc.m_format += "Q";
-                                    }
-                                    break;
-                                    case MAVLINK_TYPE_INT64_T:
-                                    {
-                                        desc.m_format += "q";
-                                    }
-                                    break;
-                                    default:
-                                    {
-                                        QLOG_ERROR() << "Unknown type:" << QString::number(fieldinfo.type);
-                                        m_plotState.corruptDataRead(i, desc.m_name + " data: Unknown data type:" + QString::number(fieldinfo.type));
-                                    }
-                                    break;
-                                }
-                            }
-                            desc.m_labels = variablenames.join(",");    // complete descriptor
-
-                            // Handle time stamps
-                            if (m_timeStamp.m_name.size() != 0)
-                            {
-                                // Now check if the actual message conains a timestamp if not add it
-                                if (!desc.m_labels.contains(m_timeStamp.m_name))
-                                {
-                                    addTimeToDescriptor(desc);
-                                    // store message type for later processing
-                                    timeStampHasToBeAdded.push_back(desc.m_name);
-                                }
-
-                                if (!m_dataModel->addType(desc.m_name,0,0, desc.m_format, desc.m_labels.split(",")))
-                                {
-                                    QString actualerror = m_dataModel->getError();
-                                    m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
-                                    emit error(actualerror);
-                                    return;
-                                }
-                            }
-                        }
-
-                        // Read packet data if there is something
-                        QList<QPair<QString,QVariant> > valuepairlist;
-                        for (int i=0;i<retvals.size();i++)
-                        {
-                            QStringList list = retvals.at(i).first.split(".");
-                            if (list.size() >= 2)
-                            {
-                                valuepairlist.append(QPair<QString,QVariant>(list[1],retvals.at(i).second));
-                            }
-                            else
-                            {
-                                m_plotState.corruptDataRead(index, "Missing type information. Message:" + retvals.at(i).first + ":" + retvals.at(i).second.toString());
-                            }
-                        }
-
-                        // Check if we have some valid data to store
-                        if (valuepairlist.size() >= 1)
-                        {
-                            // check if a synthetic timestamp has to added
-                            handleMissingTimeStamps(timeStampHasToBeAdded, desc.m_name, valuepairlist, lastValidTS, index);
-
-                            if (!m_dataModel->addRow(desc.m_name,valuepairlist, index++, m_timeStamp.m_name))
-                            {
-                                QString actualerror = m_dataModel->getError();
-                                m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
-                                emit error(actualerror);
-                                return;
-                            }
-
-                            // Tlog does not contain MODE messages the mode information ins transmitted in
-                            // a heartbeat message. So here we extract MODE data from hertbeat
-                            if ((message.msgid == MAVLINK_MSG_ID_HEARTBEAT) && (valuepairlist.size() > 1))
-                            {
-                                // Only if mode val has canged
-                                if (lastModeVal != static_cast<quint8>(valuepairlist[1].second.toInt()))
-                                {
-                                    QList<QPair<QString,QVariant> > specialValuepairlist;
-                                    // Extract MODE messages from heratbeat messages
-                                    lastModeVal = static_cast<quint8>(valuepairlist[1].second.toInt());
-
-                                    specialValuepairlist.append(QPair<QString, QVariant>(modeVarNames[0], lastValidTS));
-                                    specialValuepairlist.append(QPair<QString, QVariant>(modeVarNames[1], lastModeVal));
-                                    specialValuepairlist.append(QPair<QString, QVariant>(modeVarNames[2], lastModeVal));
-                                    specialValuepairlist.append(QPair<QString, QVariant>(modeVarNames[3], "Generated Value"));
-                                    if (!m_dataModel->addRow(ModeMessage::TypeName, specialValuepairlist, index++, m_timeStamp.m_name))
-                                    {
-                                        QString actualerror = m_dataModel->getError();
-                                        m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
-                                        emit error(actualerror);
-                                        return;
-                                    }
-
-                                    // Mav type can be extracted from heartbeat too. So lets set the Mav type
-                                    // if not already set
-                                    if (m_loadedLogType == MAV_TYPE_GENERIC)
-                                    {
-                                        // Name field is not always on same Index. So first search for the right position...
-                                        for (int i = 0; i < valuepairlist.size(); ++i)
-                                        {
-                                            if (valuepairlist[i].first == "type")   // "type" field holds MAV_TYPE
-                                            {
-                                                m_loadedLogType = static_cast<MAV_TYPE>(valuepairlist[i].second.toInt());
-                                                break;
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-
-                            if((message.msgid == MAVLINK_MSG_ID_STATUSTEXT) && (valuepairlist.size() > 2))
-                            {
-                                // Create a MsgMessage from STATUSTEXT
-                                QList<QPair<QString,QVariant> > specialValuepairlist;
-                                specialValuepairlist.append(QPair<QString, QVariant>(msgVarNames[0], lastValidTS));
-                                specialValuepairlist.append(QPair<QString, QVariant>(msgVarNames[1], valuepairlist[2].second));
-                                specialValuepairlist.append(QPair<QString, QVariant>(msgVarNames[2], "Generated Value"));
-                                if (!m_dataModel->addRow(MsgMessage::TypeName, specialValuepairlist, index++, m_timeStamp.m_name))
-                                {
-                                    QString actualerror = m_dataModel->getError();
-                                    m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
-                                    emit error(actualerror);
-                                    return;
-                                }
-                            }
-                            m_plotState.validDataRead();    // tell plot state that we have a valid message
-                        }
-                    }
-                }
-                else
-                {
-                    nrOfEmptyMsg++;
-                }
-            }
-            else if (decodeState == MAVLINK_FRAMING_BAD_CRC)
-            {
-                m_plotState.corruptDataRead(index, "Bad CRC");
-            }
-        }
-    }
-    if (nrOfEmptyMsg != 0) // Did we have messages named "EMPTY" ?
-    {
-        m_plotState.corruptDataRead(0, "Found " + QString::number(nrOfEmptyMsg) +" 'EMPTY' messages wich could not be processed");
-    }
     if (!m_dataModel->endTransaction())
     {
         emit error(m_dataModel->getError());
         return;
     }
-    m_dataModel->setAllRowsHaveTime(true, m_timeStamp.m_name, m_timeStamp.m_divisor);
+    loadFinished();
 }
 
 void AP2DataPlotThread::run()
@@ -1078,26 +624,46 @@ void AP2DataPlotThread::run()
 
     QLOG_DEBUG() << "AP2DataPlotThread::run(): Log loading start -" << logfile.size() << "bytes";
 
-    if (m_fileName.toLower().endsWith(".bin"))
+    const QString fileName = m_fileName.toLower();
+    if (!fileName.endsWith(".bin") && !fileName.endsWith(".log") && !fileName.endsWith(".tlog"))
+    {
+        emit error("Unable to detect file type from filename. Ensure the file has a .bin or .log extension");
+        return;
+    }
+
+    // Reopening a log is done using the cache holding the already decoded data
+    AP2DataPlotLogCache cache(QGC::appDataDirectory() + "/logcache/");
+    if (cache.open(logfile) &&
+        cache.load(m_dataModel, m_plotState, m_loadedLogType, m_timeStamp.m_name, m_timeStamp.m_divisor))
+    {
+        m_dataModel->setAllRowsHaveTime(true, m_timeStamp.m_name, m_timeStamp.m_divisor);
+        QLOG_INFO() << "Plot Log loading from cache" << cache.fileName() << "took"
+                    << (QDateTime::currentMSecsSinceEpoch() - msecs) / 1000.0 << "seconds";
+        emit loadProgress(logfile.size(), logfile.size());
+        emit done(m_plotState, m_loadedLogType);
+        return;
+    }
+
+    m_loadSucceeded = false;
+    if (fileName.endsWith(".bin"))
     {
         //It's a binary file
-        loadBinaryLog(logfile);
+        if (!loadBinaryLogMapped(logfile))
+        {
+            QLOG_WARN() << "AP2DataPlotThread::run(): Unable to map log file - using buffered reading";
+            loadBinaryLog(logfile);
+        }
     }
-    else if (m_fileName.toLower().endsWith(".log"))
+    else if (fileName.endsWith(".log"))
     {
         //It's a ascii log.
         loadAsciiLog(logfile);
     }
-    else if (m_fileName.toLower().endsWith(".tlog"))
+    else
     {
         //It's a tlog
         loadTLog(logfile);
     }
-    else
-    {
-        emit error("Unable to detect file type from filename. Ensure the file has a .bin or .log extension");
-        return;
-    }
 
 
     if (m_stop)
@@ -1108,10 +674,20 @@ void AP2DataPlotThread::run()
     else
     {
         QLOG_INFO() << "Plot Log loading took" << (QDateTime::currentMSecsSinceEpoch() - msecs) / 1000.0 << "seconds -" << logfile.pos() << "of" << logfile.size() << "bytes used";
+        if (m_loadSucceeded && !cache.save(*m_dataModel, m_plotState, m_loadedLogType, m_timeStamp.m_name, m_timeStamp.m_divisor))
+        {
+            QLOG_WARN() << "AP2DataPlotThread::run(): Unable to cache log -" << cache.getError();
+        }
         emit done(m_plotState, m_loadedLogType);
     }
 }
 
+void AP2DataPlotThread::loadFinished()
+{
+    m_dataModel->setAllRowsHaveTime(true, m_timeStamp.m_name, m_timeStamp.m_divisor);
+    m_loadSucceeded = true;
+}
+
 void AP2DataPlotThread::addTimeToDescriptor(typeDescriptor &desc)
 {
     // Add name of the timestamp column adding a "," only if needed
@@ -1122,27 +698,6 @@ void AP2DataPlotThread::addTimeToDescriptor(typeDescriptor &desc)
     desc.m_length += 8;
 }
 
-void AP2DataPlotThread::adaptGPSDescriptor(QMap<unsigned int, typeDescriptor> &typeToDescriptorMap, typeDescriptor &desc, const unsigned char msg_type)
-{
-    QStringList labels = desc.m_labels.split(",");
-    for (QStringList::Iterator iter = labels.begin(); iter != labels.end(); ++iter)
-    {
-        if (*iter == "TimeMS")
-        {
-            *iter = "GPSTimeMS";
-            break;
-        }
-    }
-    // Very special - manipulate parsing info here to force
-    // parser to use the new time stamp name.
-    typeToDescriptorMap.find(msg_type)->m_labels = labels.join(",");
-    // add default time stamp name
-    labels.prepend(m_timeStamp.m_name);
-    desc.m_labels = labels.join(",");
-    desc.m_format.prepend("Q");     // Add timestamp format code to format string
-    desc.m_length += 8;
-}
-
 bool AP2DataPlotThread::adaptGPSDescriptor(QMap<QString, typeDescriptor> &nameToDescriptorMap, typeDescriptor &desc)
 {
     if (desc.m_labels.contains("GPSTimeMS"))
@@ -1171,161 +726,81 @@ bool AP2DataPlotThread::adaptGPSDescriptor(QMap<QString, typeDescriptor> &nameTo
     return true;
 }
 
-void AP2DataPlotThread::handleMissingTimeStamps(const QStringList &timeStampHasToBeAdded, const QString &name,
-                                                QList<QPair<QString,QVariant> > &valuepairlist,
-                                                quint64 &lastValidTS, const int index)
+bool AP2DataPlotThread::addType(AP2DataPlotRecordBatch &batch, const unsigned int typeID, const typeDescriptor &desc)
 {
-    if (timeStampHasToBeAdded.size() > 0)
+    // ASCII logs write flight modes as names like "STABILIZE"
+    const QStringList labels = desc.m_labels.split(",");
+    if (!m_dataModel->addType(desc.m_name, typeID, desc.m_length, desc.m_format, labels, true))
     {
-        if (timeStampHasToBeAdded.contains(name))
-        {
-            valuepairlist.prepend(QPair<QString, QVariant>(m_timeStamp.m_name, lastValidTS));
-        }
-        // if not store actual time stamp
-        else
-        {
-            getTimeStamp(valuepairlist, index, lastValidTS);
-        }
+        return false;
     }
+    // batch gets the types in the same order so both use the same table id
+    batch.addType(desc.m_name, typeID, desc.m_length, desc.m_format, labels, true);
+    return true;
 }
 
-void AP2DataPlotThread::handleMissingTimeStamps(const QList<unsigned int> &timeStampHasToBeAdded, const unsigned char type,
-                                                QList<QPair<QString,QVariant> > &valuepairlist,
-                                                quint64 &lastValidTS, const int index)
+AP2DataPlotThread::asciiLayout AP2DataPlotThread::compileLayout(const AP2DataPlotRecordBatch &batch, const typeDescriptor &desc,
+                                                                const bool addTime)
 {
-    if (timeStampHasToBeAdded.size() > 0)
+    asciiLayout layout;
+    layout.m_tableID = batch.tableID(desc.m_name);
+    layout.m_addTime = addTime;
+    if (layout.m_tableID < 0)
+    {
+        return layout;
+    }
+
+    const AP2DataPlotTable &table = batch.table(layout.m_tableID);
+    const QStringList labels = desc.m_labels.split(",");
+    const int columnOffset = addTime ? 1 : 0;
+    layout.m_timeColumn = table.columnIndex(m_timeStamp.m_name);
+    layout.m_columns.reserve(labels.size());
+    for (int j = 0; j < labels.size(); ++j)
     {
-        if (timeStampHasToBeAdded.contains(type))
+        // Values are matched by position first like AP2DataPlotColumnStore::appendRow does
+        int column = j + columnOffset;
+        if ((column >= table.m_labels.size()) || (table.m_labels.at(column) != labels.at(j)))
         {
-            valuepairlist.prepend(QPair<QString, QVariant>(m_timeStamp.m_name, lastValidTS));
+            column = table.columnIndex(labels.at(j));
         }
-        // if not store actual time stamp
-        else
+        layout.m_columns.push_back(column);
+        // Only the first field carrying the timestamp name is checked
+        if (!addTime && (layout.m_timeField < 0) && (labels.at(j) == m_timeStamp.m_name))
         {
-            getTimeStamp(valuepairlist, index, lastValidTS);
+            layout.m_timeField = j;
         }
     }
+    return layout;
 }
 
-void AP2DataPlotThread::getTimeStamp(QList<QPair<QString,QVariant> > &valuepairlist, const int index, quint64 &lastValidTS)
+bool AP2DataPlotThread::flushBatch(AP2DataPlotRecordBatch &batch)
 {
-    // find value pair with time stamp name
-    QList<QPair<QString,QVariant> >::Iterator iter;
-    for (iter = valuepairlist.begin(); iter != valuepairlist.end(); ++iter)
+    if (!m_dataModel->appendBatch(batch))
     {
-        if (iter->first == m_timeStamp.m_name)
-        {   // found!
-            quint64 tempVal = static_cast<quint64>(iter->second.toULongLong());
-            // check if time is increasing
-            if (tempVal >= lastValidTS)
-            {
-                lastValidTS = tempVal;
-            }
-            else
-            {
-                QLOG_ERROR() << "Corrupt data read: Time is not increasing! Last valid time stamp:"
-                             << QString::number(lastValidTS) << " actual read time stamp is:"
-                             << QString::number(tempVal);
-                m_plotState.corruptTimeRead(index, "Log time is not increasing! Last Time:" +
-                                            QString::number(lastValidTS) + " new Time:" +
-                                            QString::number(tempVal));
-                // if not increasing set to last valid value
-                iter->second = lastValidTS;
-            }
-            break;
-        }
+        QString actualerror = m_dataModel->getError();
+        m_dataModel->endTransaction(); //endTransaction can re-set the error if it errors, but we should try it anyway.
+        emit error(actualerror);
+        return false;
     }
+    batch.clear();
+    return true;
 }
 
-//*************
-
-AP2DataPlotStatus::AP2DataPlotStatus() : m_lastParsingState(OK), m_globalState(OK)
-{
-}
-
-void AP2DataPlotStatus::corruptDataRead(const int index, const QString &errorMessage)
-{
-    // When here we just know that we have an error but not if it is at the end
-    // or in the middle of the logfile. So we set truncation error. Data error will
-    // be set as soon as valid data is read again.
-    m_globalState = m_globalState == OK ? TruncationError : m_globalState;
-    m_lastParsingState = DataError;
-    errorEntry entry(m_lastParsingState, index, errorMessage);
-    m_errors.push_back(entry);
-}
-
-void AP2DataPlotStatus::corruptFMTRead(const int index, const QString &errorMessage)
-{
-    m_globalState = m_globalState == OK ? FmtError : m_globalState;
-    m_lastParsingState = FmtError;
-    errorEntry entry(m_lastParsingState, index, errorMessage);
-    m_errors.push_back(entry);
-}
-
-void AP2DataPlotStatus::corruptTimeRead(const int index, const QString &errorMessage)
-{
-    m_globalState = m_globalState == OK ? TimeError : m_globalState;
-    m_lastParsingState = TimeError;
-    errorEntry entry(m_lastParsingState, index, errorMessage);
-    m_errors.push_back(entry);
-}
-
-AP2DataPlotStatus::parsingState AP2DataPlotStatus::getParsingState() const
-{
-    return m_globalState;
-}
-
-
-QString AP2DataPlotStatus::getErrorOverview() const
+quint64 AP2DataPlotThread::checkTimeStamp(const quint64 timeStamp, const int index, quint64 &lastValidTS)
 {
-    int timeErrorCount = 0;
-    int dataErrorCount = 0;
-    int fmtErrorCount  = 0;
-    int unknownErrorCount = 0;
-    QString out;
-    QTextStream outStream(&out);
-
-    foreach (const errorEntry &entry, m_errors)
+    // check if time is increasing
+    if (timeStamp >= lastValidTS)
     {
-        switch (entry.m_state)
-        {
-        case OK:
-            break;
-        case FmtError:
-            fmtErrorCount++;
-            break;
-        case TimeError:
-            timeErrorCount++;
-            break;
-        case DataError:
-            dataErrorCount++;
-            break;
-        default:
-            unknownErrorCount++;
-            break;
-        }
+        lastValidTS = timeStamp;
+        return timeStamp;
     }
 
-    if (fmtErrorCount     > 0) outStream << fmtErrorCount << " format corruptions" << endl;
-    if (timeErrorCount    > 0) outStream << timeErrorCount << " time corruptions" << endl;
-    if (dataErrorCount    > 0) outStream << dataErrorCount << " data corruptions" << endl;
-    if (unknownErrorCount > 0) outStream << unknownErrorCount << " unspecific corruptions" << endl;
-
-    return out;
-}
-
-QString AP2DataPlotStatus::getDetailedErrorText() const
-{
-    QString out;
-    QTextStream outStream(&out);
-
-    foreach (const errorEntry &entry, m_errors)
-    {
-        if (entry.m_state != OK)    // Only if a error
-        {
-            outStream << "Logline " << entry.m_index << ": " << entry.m_errortext << endl;
-        }
-    }
-    outStream << endl << " There were " << m_errors.size() << " errors during log parsing." << endl;
-    return out;
+    QLOG_ERROR() << "Corrupt data read: Time is not increasing! Last valid time stamp:"
+                 << QString::number(lastValidTS) << " actual read time stamp is:"
+                 << QString::number(timeStamp);
+    m_plotState.corruptTimeRead(index, "Log time is not increasing! Last Time:" +
+                                QString::number(lastValidTS) + " new Time:" +
+                                QString::number(timeStamp));
+    // if not increasing set to last valid value
+    return lastValidTS;
 }
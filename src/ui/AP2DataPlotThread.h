@@ -33,136 +33,10 @@ This file is part of the APM_PLANNER project
 #include <QThread>
 #include <QVariantMap>
 #include <QSqlDatabase>
-#include "MAVLinkDecoder.h"
 #include "AP2DataPlot2DModel.h"
+#include "AP2DataPlotStatus.h"
 #include "libs/mavlink/include/mavlink/v1.0/ardupilotmega/mavlink.h"
 
-/**
- * @brief The AP2DataPlotStatus class is a helper class desinged as status type for
- *        the log parsing.
- *        It contains the final state of parsing as well as all error strings inserted
- *        with the corruptDataRead() or corruptFMTRead() methods during the parsing process.
- */
-class AP2DataPlotStatus
-{
-public:
-
-    /**
-     * @brief The parsingState enum
-     *        All possible parsing states
-     */
-    enum parsingState
-    {
-        OK,                 /// Perfect result
-        FmtError,           /// Corrupt Format description.
-        TruncationError,    /// The log was truncated due to errors @ the end
-        TimeError,          /// The log contains corrupt time data
-        DataError           /// Data can be corrupted or incomplete
-    };
-
-    /**
-     * @brief AP2DataPlotStatus CTOR
-     */
-    AP2DataPlotStatus();
-
-    /**
-     * @brief validDataRead
-     *        Shall be called if a logline was read successful. Used to
-     *        determine if the error(s) are only at the end of the log.
-     *        Should be inline due to the high calling frequency.
-     */
-    inline void validDataRead()
-    {
-        // Rows with time errors will stored too, so they have to handeled like
-        // the OK ones.
-        if (!((m_lastParsingState == OK)||(m_lastParsingState == TimeError)))
-        {
-            // insert entry with state OK to mark data is ok.
-            m_errors.push_back(errorEntry());
-            m_lastParsingState = OK;
-            // When here we know we had an error and now data is OK again
-            // Set to data error as we cannot predict whats wrong
-            m_globalState = DataError;
-        }
-    }
-
-    /**
-     * @brief corruptDataRead
-     *        Shall be called when ever an error occurs while parsing
-     *        a data package.
-     *
-     * @param index - The log index the error occured
-     * @param errorMessage - Error message describing the error reason
-     */
-    void corruptDataRead(const int index, const QString &errorMessage);
-
-    /**
-     * @brief corruptFMTRead
-     *        Shall be called when ever an error occurs while parsing
-     *        a format package.
-     *
-     * @param index - The log index the error occured
-     * @param errorMessage - Error message describing the error reason
-     */
-    void corruptFMTRead(const int index, const QString &errorMessage);
-
-    /**
-     * @brief corruptTimeRead
-     *        Shall be called when ever a time error occurs while parsing
-     *        any data.
-     *
-     * @param index - The log index the error occured
-     * @param errorMessage - Error message describing the error reason
-     */
-    void corruptTimeRead(const int index, const QString &errorMessage);
-
-    /**
-     * @brief getParsingState
-     *        Delivers the final state of the log parsing. The value
-     *        is only valid if parsing is finished.
-     *FmtError
-     * @return - The parsing state - @see parsingState
-     */
-    parsingState getParsingState() const;
-
-    /**
-     * @brief getErrorOverview
-     *        Creates an overview of errors occured. Type and number are listed
-     * @return
-     */
-    QString getErrorOverview() const;
-
-    /**
-     * @brief getDetailedErrorText
-     *        Creates a text containing all errormessages inserted during
-     *        parsing. One line for each error.
-     *
-     * @return - multi line string with all error messages.
-     */
-    QString getDetailedErrorText() const;
-
-private:
-    /**
-     * @brief The errorEntry struct
-     *        holds all data describing the error
-     */
-    struct errorEntry
-    {
-        parsingState m_state;
-        int m_index;
-        QString m_errortext;
-
-        errorEntry() : m_state(OK), m_index(0){}
-        errorEntry(const parsingState state, const int index, const QString &text) :
-                   m_state(state), m_index(index), m_errortext(text) {}
-    };
-
-    parsingState m_lastParsingState;        /// The internal parsing state since last call
-    parsingState m_globalState;             /// Reflecting the overall parsing state
-    QVector<errorEntry> m_errors;           /// For storing all error entries
-};
-
-
 class AP2DataPlotThread : public QThread
 {
     Q_OBJECT
@@ -211,13 +85,50 @@ private:
             m_length(length), m_name(name), m_format(format), m_labels(labels){}
     };
 
+    /**
+     * @brief The asciiLayout struct
+     *        Maps the values of an ascii log line to the columns of its table
+     */
+    struct asciiLayout
+    {
+        int  m_tableID;         /// Table id in the record batch, -1 if not available
+        bool m_addTime;         /// True if a synthetic timestamp has to be added
+        int  m_timeColumn;      /// Column holding the timestamp, -1 if none
+        int  m_timeField;       /// Field holding the timestamp, -1 if none or synthetic
+        QVector<int> m_columns; /// Column of each field, -1 if not stored
+
+        asciiLayout() : m_tableID(-1), m_addTime(false), m_timeColumn(-1), m_timeField(-1) {}
+    };
+
     void run(); // from QThread;
     bool isMainThread();
 
+    /**
+     * @brief loadBinaryLog loads a binary log by reading it in steps. Used if the
+     *        file cannot be memory mapped.
+     *
+     * @param logfile - opened log file
+     */
     void loadBinaryLog(QFile &logfile);
+
+    /**
+     * @brief loadBinaryLogMapped loads a binary log by memory mapping the file and
+     *        decoding the packets in place using the AP2DataPlotBinaryParser. Big
+     *        logs are decoded using all cores with the AP2DataPlotParallelParser.
+     *
+     * @param logfile - opened log file
+     * @return false if the file could not be mapped, true otherwise
+     */
+    bool loadBinaryLogMapped(QFile &logfile);
     void loadAsciiLog(QFile &logfile);
     void loadTLog(QFile &logfile);
 
+    /**
+     * @brief loadFinished - has to be called by the loaders when a log was loaded
+     *        completely. Sets up the time base of the model and marks the log to be cached.
+     */
+    void loadFinished();
+
     /**
      * @brief addTimeToDescriptor - helper function for parsing. Extends a type descriptor to hold
      *        a timestamp
@@ -229,45 +140,38 @@ private:
      *        by renaming old time stamp name and adding a new one. Needed cause the GPS time does not
      *        match other times
      */
-    void adaptGPSDescriptor(QMap<unsigned int, typeDescriptor> &typeToDescriptorMap, typeDescriptor &desc, unsigned char msg_type);
+    bool adaptGPSDescriptor(QMap<QString, typeDescriptor> &nameToDescriptorMap, typeDescriptor &desc);
 
     /**
-     * @brief adaptGPSDescriptor - helper function for parsing. Manipulates a GPS type descriptor
-     *        by renaming old time stamp name and adding a new one. Needed cause the GPS time does not
-     *        match other times
+     * @brief checkTimeStamp - checks if the time stamps are increasing and updates lastValidTS.
+     * @return The valid time stamp to be stored
      */
-    bool adaptGPSDescriptor(QMap<QString, typeDescriptor> &nameToDescriptorMap, typeDescriptor &desc);
+    quint64 checkTimeStamp(const quint64 timeStamp, const int index, quint64 &lastValidTS);
 
     /**
-     * @brief handleMissingTimeStamps - helper function for parsing. Checks if a timestamp has to be added
-     *        and adds it if needed. If the data already contains a valid time stamp its value is stored
-     *        in lastValidTS. lastValidTS is used to set the time stamp of the data which lacks it.
-     *
-     * @param timeStampHasToBeAdded - Collection holding all message keys of the messages wothout a time stamp
-     * @param desc - typeDescriptor of the actual message
-     * @param valuepairlist - extracted data pairs of the message
-     * @param lastValidTS - last valid time stamp
-     * @param index - actual parsing index
+     * @brief addType - helper function for parsing. Adds a message type to the data model
+     *        and to the record batch so both use the same table id.
+     * @return false if the data model reported an error
      */
-    void handleMissingTimeStamps(const QStringList &timeStampHasToBeAdded, const QString &name, QList<QPair<QString,QVariant> > &valuepairlist,
-                                 quint64 &lastValidTS, const int index);
+    bool addType(AP2DataPlotRecordBatch &batch, const unsigned int typeID, const typeDescriptor &desc);
 
     /**
-     * @brief handleMissingTimeStamps - helper for parsing.
-     * @see handleMissingTimeStamps
+     * @brief compileLayout - helper function for parsing. Maps the fields of a message
+     *        type to the columns of its table in the record batch.
      */
-    void handleMissingTimeStamps(const QList<unsigned int> &timeStampHasToBeAdded, const unsigned char type, QList<QPair<QString,QVariant> > &valuepairlist,
-                                 quint64 &lastValidTS, const int index);
+    asciiLayout compileLayout(const AP2DataPlotRecordBatch &batch, const typeDescriptor &desc, const bool addTime);
 
     /**
-     * @brief getTimeStamp - extracts a valid time stamp from valuepair list and sets lastValidTS.
-     *        checks if the time stamps are increasing. Used by handleMissingTimeStamps methods
+     * @brief flushBatch - hands all rows of the batch to the data model and clears it.
+     *        Emits error() and ends the transaction on failure.
+     * @return false if the data model reported an error
      */
-    void getTimeStamp(QList<QPair<QString,QVariant> > &valuepairlist, const int index, quint64 &lastValidTS);
+    bool flushBatch(AP2DataPlotRecordBatch &batch);
 private:
 
     QString m_fileName;
     bool m_stop;
+    bool m_loadSucceeded;           /// True if the log was loaded completely
     MAV_TYPE m_loadedLogType;
     AP2DataPlot2DModel *m_dataModel;
 
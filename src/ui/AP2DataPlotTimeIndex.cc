@@ -0,0 +1,254 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot time index of the log rows
+ *
+ */
+
+#include "AP2DataPlotTimeIndex.h"
+#include <algorithm>
+
+namespace
+{
+    /**
+     * @brief The entryTimeLess struct orders entry numbers by the timestamp of the entries
+     */
+    struct entryTimeLess
+    {
+        const QVector<AP2DataPlotTimeIndex::Entry> &m_entries;
+
+        explicit entryTimeLess(const QVector<AP2DataPlotTimeIndex::Entry> &entries) : m_entries(entries) {}
+
+        bool operator()(const quint32 left, const quint32 right) const
+        {
+            return m_entries.at(left).m_time < m_entries.at(right).m_time;
+        }
+    };
+}
+
+AP2DataPlotTimeIndex::AP2DataPlotTimeIndex() :
+    m_ordered(true)
+{
+}
+
+void AP2DataPlotTimeIndex::append(const quint64 time, const quint32 row, const quint32 tableID)
+{
+    if (!m_entries.isEmpty() && (time < m_entries.last().m_time))
+    {
+        m_ordered = false;
+    }
+    m_entries.append(Entry(time, row, tableID));
+    if (m_ordered)
+    {
+        addToTypeIndex(tableID, m_entries.size() - 1);
+    }
+    else
+    {
+        // finalize() has to rebuild the time order
+        m_timeOrder.clear();
+    }
+}
+
+void AP2DataPlotTimeIndex::append(const Entry *entries, const int count, const quint32 rowOffset)
+{
+    m_entries.reserve(m_entries.size() + count);
+    for (int i = 0; i < count; ++i)
+    {
+        append(entries[i].m_time, entries[i].m_row + rowOffset, entries[i].m_tableID);
+    }
+}
+
+void AP2DataPlotTimeIndex::finalize()
+{
+    if (!m_ordered && m_timeOrder.isEmpty())
+    {
+        // Entries are not in time order - build the time ordered permutation
+        // and the type index on top of it.
+        m_timeOrder.resize(m_entries.size());
+        for (int i = 0; i < m_timeOrder.size(); ++i)
+        {
+            m_timeOrder[i] = static_cast<quint32>(i);
+        }
+        std::stable_sort(m_timeOrder.begin(), m_timeOrder.end(), entryTimeLess(m_entries));
+        m_typeIndex.clear();
+        for (int pos = 0; pos < m_timeOrder.size(); ++pos)
+        {
+            addToTypeIndex(m_entries.at(m_timeOrder.at(pos)).m_tableID, pos);
+        }
+    }
+    m_entries.squeeze();
+    for (int i = 0; i < m_typeIndex.size(); ++i)
+    {
+        m_typeIndex[i].squeeze();
+    }
+}
+
+void AP2DataPlotTimeIndex::clear()
+{
+    // Keep the memory as record batches are cleared and refilled
+    m_entries.resize(0);
+    m_timeOrder.clear();
+    for (int i = 0; i < m_typeIndex.size(); ++i)
+    {
+        m_typeIndex[i].resize(0);
+    }
+    m_ordered = true;
+}
+
+int AP2DataPlotTimeIndex::lowerBound(const quint64 time) const
+{
+    int first = 0;
+    int count = m_entries.size();
+    while (count > 0)
+    {
+        int step = count / 2;
+        if (at(first + step).m_time < time)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+    return first;
+}
+
+int AP2DataPlotTimeIndex::nearest(const quint64 time, const int tableID) const
+{
+    if (tableID < 0)
+    {
+        if (m_entries.isEmpty())
+        {
+            return -1;
+        }
+        int pos = lowerBound(time);
+        if (pos == m_entries.size())
+        {
+            return pos - 1;
+        }
+        if ((pos > 0) && ((time - at(pos - 1).m_time) <= (at(pos).m_time - time)))
+        {
+            return pos - 1;
+        }
+        return pos;
+    }
+
+    if ((tableID >= m_typeIndex.size()) || m_typeIndex.at(tableID).isEmpty())
+    {
+        return -1;
+    }
+    const QVector<quint32> &positions = m_typeIndex.at(tableID);
+    int pos = typeLowerBound(positions, time);
+    if (pos == positions.size())
+    {
+        return static_cast<int>(positions.last());
+    }
+    if ((pos > 0) && ((time - at(positions.at(pos - 1)).m_time) <= (at(positions.at(pos)).m_time - time)))
+    {
+        return static_cast<int>(positions.at(pos - 1));
+    }
+    return static_cast<int>(positions.at(pos));
+}
+
+bool AP2DataPlotTimeIndex::timeForRow(const quint32 row, quint64 &time) const
+{
+    // Entries are in ascending row order - search the last entry not behind row
+    int first = 0;
+    int count = m_entries.size();
+    while (count > 0)
+    {
+        int step = count / 2;
+        if (m_entries.at(first + step).m_row <= row)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+    if (first == 0)
+    {
+        return false;
+    }
+    time = m_entries.at(first - 1).m_time;
+    return true;
+}
+
+void AP2DataPlotTimeIndex::rowsInRange(const quint64 first, const quint64 last, const int tableID, QVector<quint32> &rows) const
+{
+    rows.clear();
+    if (first > last)
+    {
+        return;
+    }
+    if (tableID < 0)
+    {
+        for (int pos = lowerBound(first); (pos < m_entries.size()) && (at(pos).m_time <= last); ++pos)
+        {
+            rows.append(at(pos).m_row);
+        }
+        return;
+    }
+    if (tableID >= m_typeIndex.size())
+    {
+        return;
+    }
+    const QVector<quint32> &positions = m_typeIndex.at(tableID);
+    for (int i = typeLowerBound(positions, first); (i < positions.size()) && (at(positions.at(i)).m_time <= last); ++i)
+    {
+        rows.append(at(positions.at(i)).m_row);
+    }
+}
+
+void AP2DataPlotTimeIndex::addToTypeIndex(const quint32 tableID, const int pos)
+{
+    if (static_cast<int>(tableID) >= m_typeIndex.size())
+    {
+        m_typeIndex.resize(tableID + 1);
+    }
+    m_typeIndex[tableID].append(static_cast<quint32>(pos));
+}
+
+int AP2DataPlotTimeIndex::typeLowerBound(const QVector<quint32> &positions, const quint64 time) const
+{
+    int first = 0;
+    int count = positions.size();
+    while (count > 0)
+    {
+        int step = count / 2;
+        if (at(positions.at(first + step)).m_time < time)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+    return first;
+}
@@ -0,0 +1,153 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief AP2DataPlot time index of the log rows
+ *
+ */
+
+#ifndef AP2DATAPLOTTIMEINDEX_H
+#define AP2DATAPLOTTIMEINDEX_H
+
+#include <QVector>
+
+/**
+ * @brief The AP2DataPlotTimeIndex class maps between timestamps and global rows of
+ *        a log. It holds one entry per row having a timestamp. The entries are
+ *        appended while the log is loaded and are kept in log order, so a row
+ *        can be found by a binary search. If the timestamps are not ascending in
+ *        log order finalize() creates a time ordered permutation of the entries.
+ *
+ *        For every message type a secondary index holds the positions of its
+ *        entries in time order, which allows searching the rows of one type only.
+ */
+class AP2DataPlotTimeIndex
+{
+public:
+    /**
+     * @brief The Entry struct holds the timestamp of a row. It is 16 bytes in size.
+     */
+    struct Entry
+    {
+        quint64 m_time;     /// Timestamp as stored in the log
+        quint32 m_row;      /// Global row
+        quint32 m_tableID;  /// Table id of the row
+
+        Entry() : m_time(0), m_row(0), m_tableID(0) {}
+        Entry(const quint64 time, const quint32 row, const quint32 tableID) :
+            m_time(time), m_row(row), m_tableID(tableID) {}
+    };
+
+    AP2DataPlotTimeIndex();
+
+    void reserve(const int size) { m_entries.reserve(size); }
+
+    /**
+     * @brief append adds the timestamp of a row. Rows must be appended in
+     *        ascending order.
+     */
+    void append(const quint64 time, const quint32 row, const quint32 tableID);
+
+    /**
+     * @brief append adds entries moving their rows by rowOffset
+     */
+    void append(const Entry *entries, const int count, const quint32 rowOffset);
+
+    /**
+     * @brief append adds all entries of another index moving its rows by rowOffset
+     */
+    void append(const AP2DataPlotTimeIndex &other, const quint32 rowOffset)
+    {
+        append(other.m_entries.constData(), other.m_entries.size(), rowOffset);
+    }
+
+    /**
+     * @brief finalize has to be called after all rows were appended. It orders the
+     *        entries by time if needed and releases memory reserved for growing.
+     *        Lookups are only valid after finalize() if the timestamps were not
+     *        appended in ascending order.
+     */
+    void finalize();
+
+    void clear();
+
+    int size() const { return m_entries.size(); }
+    bool isEmpty() const { return m_entries.isEmpty(); }
+
+    /**
+     * @brief entries delivers all entries in log order
+     */
+    const QVector<Entry> &entries() const { return m_entries; }
+
+    /**
+     * @brief at delivers an entry in time order
+     */
+    const Entry &at(const int pos) const
+    {
+        return m_timeOrder.isEmpty() ? m_entries.at(pos) : m_entries.at(m_timeOrder.at(pos));
+    }
+
+    /**
+     * @brief lowerBound delivers the position in time order of the first entry
+     *        whose timestamp is not smaller than time.
+     *
+     * @return position or size() if all timestamps are smaller
+     */
+    int lowerBound(const quint64 time) const;
+
+    /**
+     * @brief nearest delivers the position in time order of the entry whose
+     *        timestamp has the smallest deviation to time.
+     *
+     * @param tableID - only search the entries of this table, all entries if -1
+     * @return position or -1 if there is no entry
+     */
+    int nearest(const quint64 time, const int tableID = -1) const;
+
+    /**
+     * @brief timeForRow delivers the timestamp of a row. Rows without a timestamp
+     *        deliver the timestamp of the nearest row in front of them.
+     *
+     * @return true on success, false if no row up to row has a timestamp
+     */
+    bool timeForRow(const quint32 row, quint64 &time) const;
+
+    /**
+     * @brief rowsInRange delivers all rows with a timestamp within [first, last]
+     *        in time order.
+     *
+     * @param tableID - only deliver rows of this table, all rows if -1
+     * @param rows - receives the rows
+     */
+    void rowsInRange(const quint64 first, const quint64 last, const int tableID, QVector<quint32> &rows) const;
+
+private:
+    void addToTypeIndex(const quint32 tableID, const int pos);
+    int typeLowerBound(const QVector<quint32> &positions, const quint64 time) const;
+
+    QVector<Entry> m_entries;               /// Entries in log order
+    QVector<quint32> m_timeOrder;           /// Entries in time order, empty if log order is time order
+    QVector<QVector<quint32> > m_typeIndex; /// Positions in time order of the entries of each table
+    bool m_ordered;                         /// True as long as entries were appended in time order
+};
+
+#endif // AP2DATAPLOTTIMEINDEX_H
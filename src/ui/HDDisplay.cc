@@ -13,6 +13,7 @@
 
 #include "QsLog.h"
 #include "UASManager.h"
+#include "LinkManager.h"
 #include "ui_HDDisplay.h"
 #include "MG.h"
 #include "QGC.h"
@@ -53,6 +54,7 @@ HDDisplay::HDDisplay(QStringList* plotList, QString title, QWidget *parent) :
     lastPaintTime(0),
     columns(3),
     valuesChanged(true),
+    m_telemetryReader(LinkManager::instance()->getProtocol()->telemetryStore()),
     m_ui(NULL)
 {
     setWindowTitle(title);
@@ -170,10 +172,31 @@ void HDDisplay::enableGLRendering(bool enable)
 
 void HDDisplay::triggerUpdate()
 {
+    pollTelemetry();
     // Only repaint the regions necessary
     update(this->geometry());
 }
 
+void HDDisplay::pollTelemetry()
+{
+    // Message fields are polled from the telemetry store, the UAS only
+    // emits its own calculated values.
+    m_telemetryChanges.clear();
+    m_telemetryReader.poll(m_telemetryChanges);
+    const TelemetryStore &store = m_telemetryReader.store();
+    for (int i = 0; i < m_telemetryChanges.size(); ++i)
+    {
+        const TelemetryStoreReader::Change &change = m_telemetryChanges.at(i);
+        const QString name = store.slotName(change.m_slot, change.m_component);
+        const QString type = store.slotType(change.m_slot);
+        if (!type.startsWith("float") && !type.startsWith("double") && !intValues.contains(name))
+        {
+            intValues.insert(name, true);
+        }
+        updateValue(m_telemetryReader.system(), name, type, change.m_value.m_value, change.m_value.m_time);
+    }
+}
+
 //void HDDisplay::updateValue(UASInterface* uas, const QString& name, const QString& unit, double value, quint64 msec)
 //{
 //    // UAS is not needed
@@ -491,6 +514,7 @@ void HDDisplay::setActiveUAS(UASInterface* uas)
     // Now connect the new UAS
 	addSource(uas);
     this->uas = uas;
+    m_telemetryReader.setSystem(uas->getUASID());
 }
 
 /**
@@ -42,6 +42,7 @@ This file is part of the QGROUNDCONTROL project
 #include <QPair>
 
 #include "UASInterface.h"
+#include "TelemetryStore.h"
 
 namespace Ui
 {
@@ -112,6 +113,8 @@ protected slots:
     //void render(QPainter* painter, const QRectF& target = QRectF(), const QRect& source = QRect(), Qt::AspectRatioMode aspectRatioMode = Qt::KeepAspectRatio);
     void renderOverlay();
     void triggerUpdate();
+    /** @brief Feeds the message fields updated since the last poll to updateValue() */
+    void pollTelemetry();
     /** @brief Adjust the size hint for the current gauge layout */
     void adjustGaugeAspectRatio();
 
@@ -214,6 +217,9 @@ protected:
     QAction* setColumnsAction; ///< Action setting the number of columns
     bool valuesChanged;
 
+    TelemetryStoreReader m_telemetryReader;     ///< Polls the message fields of the active UAS
+    QVector<TelemetryStoreReader::Change> m_telemetryChanges;
+
 private:
     Ui::HDDisplay *m_ui;
 };
@@ -52,6 +52,7 @@ QGCMAVLinkInspector::QGCMAVLinkInspector(MAVLinkProtocol* protocol, QWidget *par
     // Connect external connections
     connect(UASManager::instance(), SIGNAL(UASCreated(UASInterface*)), this, SLOT(addSystem(UASInterface*)));
     connect(LinkManager::instance(), SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)), this, SLOT(receiveMessage(LinkInterface*,mavlink_message_t)));
+    connect(LinkManager::instance(), SIGNAL(messagesReceived(LinkInterface*,MAVLinkMessageBatch)), this, SLOT(receiveMessages(LinkInterface*,MAVLinkMessageBatch)));
     for(int count=0; count < UASManager::instance()->getUASList().count();count++){
         addSystem(UASManager::instance()->getUASList()[count]);
     }
@@ -352,6 +353,14 @@ void QGCMAVLinkInspector::addUAStoTree(int sysId)
     }
 }
 
+void QGCMAVLinkInspector::receiveMessages(LinkInterface* link, const MAVLinkMessageBatch &messages)
+{
+    for (MAVLinkMessageBatch::const_iterator iter = messages.begin(); iter != messages.end(); ++iter)
+    {
+        receiveMessage(link, *iter);
+    }
+}
+
 void QGCMAVLinkInspector::receiveMessage(LinkInterface* link,mavlink_message_t message)
 {
     Q_UNUSED(link);
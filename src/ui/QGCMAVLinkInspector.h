@@ -24,6 +24,7 @@ public:
 
 public slots:
     void receiveMessage(LinkInterface* link,mavlink_message_t message);
+    void receiveMessages(LinkInterface* link, const MAVLinkMessageBatch &messages);
     /** @brief Clear all messages */
     void clearView();
     /** @brief Update view */
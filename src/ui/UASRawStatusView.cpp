@@ -5,7 +5,9 @@
 #include <QTimer>
 #include <QScrollBar>
 #include "UASManager.h"
-UASRawStatusView::UASRawStatusView(QWidget *parent) : QWidget(parent)
+#include "LinkManager.h"
+UASRawStatusView::UASRawStatusView(QWidget *parent) : QWidget(parent),
+    m_telemetryReader(LinkManager::instance()->getProtocol()->telemetryStore())
 {
     m_uas = 0;
     ui.setupUi(this);
@@ -37,6 +39,8 @@ void UASRawStatusView::activeUASSet(UASInterface* uas)
     }
     m_uas = uas;
     connect(m_uas,SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)),this,SLOT(valueChanged(int,QString,QString,QVariant,quint64)));
+    m_telemetryReader.setSystem(m_uas->getUASID());
+    m_slotToNameMap.clear();
 
 }
 
@@ -57,6 +61,23 @@ void UASRawStatusView::hideEvent(QHideEvent *event)
 }
 void UASRawStatusView::updateTimerTick()
 {
+    // Message fields are polled from the telemetry store
+    m_telemetryChanges.clear();
+    m_telemetryReader.poll(m_telemetryChanges);
+    for (int i = 0; i < m_telemetryChanges.size(); ++i)
+    {
+        const TelemetryStoreReader::Change &change = m_telemetryChanges.at(i);
+        const TelemetryStore &store = m_telemetryReader.store();
+        const int key = store.nameKey(change.m_slot, change.m_component);
+        QHash<int,QString>::const_iterator name = m_slotToNameMap.constFind(key);
+        if (name == m_slotToNameMap.constEnd())
+        {
+            name = m_slotToNameMap.insert(key, QString("M%1:%2").arg(m_telemetryReader.system())
+                                          .arg(store.slotName(change.m_slot, change.m_component)));
+        }
+        valueMap[name.value()] = change.m_value.m_value;
+    }
+
     for (QMap<QString,double>::const_iterator i=valueMap.constBegin();i!=valueMap.constEnd();i++)
     {
         if (nameToUpdateWidgetMap.contains(i.key()))
@@ -3,6 +3,7 @@
 
 #include <QWidget>
 #include "MAVLinkDecoder.h"
+#include "TelemetryStore.h"
 #include "ui_UASRawStatusView.h"
 #include "UASInterface.h"
 class UASRawStatusView : public QWidget
@@ -31,6 +32,9 @@ private:
     QTimer *m_updateTimer;
     QTimer *m_tableRefreshTimer; //This time triggers a reorganization of the cells, for when new cells are added
     bool m_tableDirty;
+    TelemetryStoreReader m_telemetryReader; /// Polls the message fields of the active UAS
+    QVector<TelemetryStoreReader::Change> m_telemetryChanges;
+    QHash<int,QString> m_slotToNameMap;     /// Value name of each telemetry store slot and component seen so far
 };
 
 #endif // UASRAWSTATUSVIEW_H
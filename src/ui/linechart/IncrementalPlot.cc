@@ -36,6 +36,7 @@ This file is part of the QGROUNDCONTROL project
 #include <qwt_plot_grid.h>
 #include <qwt_scale_engine.h>
 #include "IncrementalPlot.h"
+#include "TimeSeriesCurveData.h"
 #include <Scrollbar.h>
 #include <ScrollZoomer.h>
 #include <float.h>
@@ -43,44 +44,36 @@ This file is part of the QGROUNDCONTROL project
 
 
 
-CurveData::CurveData():
-    d_count(0)
+CurveData::CurveData()
 {
 }
 
 void CurveData::append(double *x, double *y, int count)
 {
-    int newSize = ( (d_count + count) / 1000 + 1 ) * 1000;
-    if ( newSize > size() ) {
-        d_x.resize(newSize);
-        d_y.resize(newSize);
+    for (int i = 0; i < count; i++) {
+        d_buffer.append(x[i], y[i]);
     }
-
-    for ( register int i = 0; i < count; i++ ) {
-        d_x[d_count + i] = x[i];
-        d_y[d_count + i] = y[i];
-    }
-    d_count += count;
 }
 
 int CurveData::count() const
 {
-    return d_count;
+    return d_buffer.count();
 }
 
 int CurveData::size() const
 {
-    return d_x.size();
+    const TimeSeriesBuffer::RetentionPolicy& policy = d_buffer.retentionPolicy();
+    return policy.m_fullRateCapacity + policy.m_historyCapacity;
 }
 
-const double* CurveData::x() const
+const TimeSeriesBuffer& CurveData::buffer() const
 {
-    return d_x.data();
+    return d_buffer;
 }
 
-const double* CurveData::y() const
+void CurveData::setRetentionPolicy(const TimeSeriesBuffer::RetentionPolicy& policy)
 {
-    return d_y.data();
+    d_buffer.setRetentionPolicy(policy);
 }
 
 IncrementalPlot::IncrementalPlot(QWidget *parent):
@@ -93,6 +86,10 @@ IncrementalPlot::IncrementalPlot(QWidget *parent):
 {
     setAutoReplot(false);
 
+    retentionPolicy.m_fullRateCapacity = DEFAULT_CAPACITY;
+    retentionPolicy.m_historyDecimation = DEFAULT_HISTORY_DECIMATION;
+    retentionPolicy.m_historyCapacity = DEFAULT_HISTORY_CAPACITY;
+
     setFrameStyle(QFrame::NoFrame);
     setLineWidth(0);
     setStyleText("solid crosses");
@@ -303,6 +300,7 @@ void IncrementalPlot::appendData(QString key, double *x, double *y, int size)
     QwtPlotCurve* curve;
     if (!d_data.contains(key)) {
         data = new CurveData;
+        data->setRetentionPolicy(retentionPolicy);
         d_data.insert(key, data);
     } else {
         data = d_data.value(key);
@@ -324,7 +322,7 @@ void IncrementalPlot::appendData(QString key, double *x, double *y, int size)
     }
 
     data->append(x, y, size);
-    curve->setRawData(data->x(), data->y(), data->count());
+    curve->setData(TimeSeriesCurveData(&data->buffer(), 0, data->count()));
 
     bool scaleChanged = false;
 
@@ -379,7 +377,7 @@ void IncrementalPlot::appendData(QString key, double *x, double *y, int size)
         //            plotCurve->draw(0, curve->dataSize()-1);
         //        }
 
-        curve->draw(curve->dataSize() - size, curve->dataSize() - 1);
+        curve->draw(qMax(0, curve->dataSize() - size), curve->dataSize() - 1);
         canvas()->setPaintAttribute(QwtPlotCanvas::PaintCached, cacheMode);
 
 #if QT_VERSION >= 0x040000 && defined(Q_WS_X11)
@@ -398,8 +396,11 @@ int IncrementalPlot::data(QString key, double* r_x, double* r_y, int maxSize)
         CurveData* d = d_data.value(key);
         if (maxSize >= d->count()) {
             result = d->count();
-            memcpy(r_x, d->x(), sizeof(double) * d->count());
-            memcpy(r_y, d->y(), sizeof(double) * d->count());
+            const TimeSeriesBuffer& buffer = d->buffer();
+            for (int i = 0; i < result; i++) {
+                r_x[i] = buffer.x(i);
+                r_y[i] = buffer.y(i);
+            }
         } else {
             result = 0;
         }
@@ -407,6 +408,19 @@ int IncrementalPlot::data(QString key, double* r_x, double* r_y, int maxSize)
     return result;
 }
 
+void IncrementalPlot::setRetentionPolicy(const TimeSeriesBuffer::RetentionPolicy& policy)
+{
+    retentionPolicy = policy;
+    QMap<QString, CurveData*>::iterator i;
+    for (i = d_data.begin(); i != d_data.end(); ++i) {
+        i.value()->setRetentionPolicy(policy);
+        if (d_curve.contains(i.key())) {
+            d_curve.value(i.key())->setData(TimeSeriesCurveData(&i.value()->buffer(), 0, 0));
+        }
+    }
+    replot();
+}
+
 /**
  * @param show true to show the grid, false else
  */
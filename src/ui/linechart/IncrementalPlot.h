@@ -38,11 +38,13 @@ This file is part of the QGROUNDCONTROL project
 #include <qwt_plot_grid.h>
 #include <QMap>
 #include "ScrollZoomer.h"
+#include "TimeSeriesBuffer.h"
 
 class QwtPlotCurve;
 
 /**
- * @brief Plot data container for growing data
+ * @brief Plot data container for growing data. The points are held in a
+ * TimeSeriesBuffer so the memory use is bounded by its retention policy.
  */
 class CurveData
 {
@@ -53,17 +55,15 @@ public:
 
     /** @brief The number of datasets held in the data structure */
     int count() const;
-    /** @brief The reserved size of the data structure in units */
+    /** @brief The maximum number of datasets the data structure holds */
     int size() const;
-    const double *x() const;
-    const double *y() const;
+    /** @brief The buffer holding the datasets */
+    const TimeSeriesBuffer& buffer() const;
+    /** @brief Set which datasets are kept, drops all datasets */
+    void setRetentionPolicy(const TimeSeriesBuffer::RetentionPolicy& policy);
 
 private:
-    int d_count;
-    QwtArray<double> d_x;
-    QwtArray<double> d_y;
-    QTimer *d_timer;
-    int d_timerCount;
+    TimeSeriesBuffer d_buffer;
 };
 
 /**
@@ -96,6 +96,13 @@ public:
     /** @brief Read out data from a curve */
     int data(QString key, double* r_x, double* r_y, int maxSize);
 
+    /** @brief Set which data points of the curves are kept, drops all data */
+    void setRetentionPolicy(const TimeSeriesBuffer::RetentionPolicy& policy);
+
+    static const int DEFAULT_CAPACITY = 100000; ///< Data points kept at full rate per curve
+    static const int DEFAULT_HISTORY_DECIMATION = 10; ///< Older data points are kept as min and max of 10 points
+    static const int DEFAULT_HISTORY_CAPACITY = 20000;
+
     float symbolWidth;
     float curveWidth;
     float gridWidth;
@@ -144,6 +151,7 @@ protected:
     double xmax;           ///< Maximum x value seen
     double ymin;           ///< Minimum y value seen
     double ymax;           ///< Maximum y value seen
+    TimeSeriesBuffer::RetentionPolicy retentionPolicy; ///< Which data points of the curves are kept
 
 
 private:
@@ -13,6 +13,7 @@
 #include "QsLog.h"
 #include "float.h"
 #include "QGC.h"
+#include "TimeSeriesCurveData.h"
 
 #include <QTimer>
 #include <qwt_plot.h>
@@ -50,6 +51,12 @@ LinechartPlot::LinechartPlot(QWidget *parent, int plotid, quint64 interval): Qwt
     maxValue = -DBL_MAX;
     minValue = DBL_MAX;
 
+    retentionPolicy.m_fullRateInterval = DEFAULT_FULL_RATE_INTERVAL;
+    retentionPolicy.m_fullRateCapacity = DEFAULT_FULL_RATE_CAPACITY;
+    retentionPolicy.m_historyDecimation = DEFAULT_HISTORY_DECIMATION;
+    retentionPolicy.m_historyCapacity = DEFAULT_HISTORY_CAPACITY;
+    retentionPolicy.m_maxInterval = maxInterval;
+
     //lastMaxTimeAdded = QTime();
 
     curves = QMap<QString, QwtPlotCurve*>();
@@ -267,7 +274,9 @@ void LinechartPlot::setZeroValue(QString id, double zeroValue)
     if(data.contains(id)) {
         data.value(id)->setZeroValue(zeroValue);
     } else {
-        data.insert(id, new TimeSeriesData(this, id, maxInterval, zeroValue));
+        TimeSeriesData* dataset = new TimeSeriesData(this, id, maxInterval, zeroValue);
+        dataset->setRetentionPolicy(retentionPolicy);
+        data.insert(id, dataset);
     }
 }
 
@@ -322,7 +331,7 @@ void LinechartPlot::appendData(QString dataname, quint64 ms, double value)
 
     // Assign dataset to curve
     QwtPlotCurve* curve = curves.value(dataname);
-    curve->setRawData(dataset->getPlotX(), dataset->getPlotY(), dataset->getPlotCount());
+    curve->setData(TimeSeriesCurveData(&dataset->getBuffer(), dataset->getPlotFirst(), dataset->getPlotCount()));
 
     //    QLOG_DEBUG() << "mintime" << minTime << "maxtime" << maxTime << "last max time" << "window position" << getWindowPosition();
 
@@ -389,6 +398,7 @@ void LinechartPlot::addCurve(QString id)
 
     // Create dataset
     TimeSeriesData* dataset = new TimeSeriesData(this, id, this->plotInterval, maxInterval);
+    dataset->setRetentionPolicy(retentionPolicy);
 
     // Add dataset to list
     data.insert(id, dataset);
@@ -679,6 +689,26 @@ void LinechartPlot::setAverageWindow(int windowSize)
     }
 }
 
+void LinechartPlot::setRetentionPolicy(const TimeSeriesBuffer::RetentionPolicy& policy)
+{
+    datalock.lock();
+    retentionPolicy = policy;
+    foreach(TimeSeriesData* series, data)
+    {
+        series->setRetentionPolicy(policy);
+    }
+    // The curves reference the dropped samples
+    QMap<QString, QwtPlotCurve*>::iterator i;
+    for(i = curves.begin(); i != curves.end(); ++i)
+    {
+        if (data.contains(i.key()))
+        {
+            i.value()->setData(TimeSeriesCurveData(&data.value(i.key())->getBuffer(), 0, 0));
+        }
+    }
+    datalock.unlock();
+}
+
 /**
  * @brief Paint immediately the plot
  * This method is a replacement for replot(). In contrast to replot(), it takes the
@@ -803,13 +833,10 @@ void LinechartPlot::removeAllData()
 
 TimeSeriesData::TimeSeriesData(QwtPlot* plot, QString friendlyName, quint64 plotInterval, quint64 maxInterval, double zeroValue):
     minValue(DBL_MAX),
-    maxValue(DBL_MIN),
+    maxValue(-DBL_MAX),
     zeroValue(0),
     count(0),
-    mean(0.0),
-    median(0.0),
-    variance(0.0),
-    averageWindow(50)
+    statistics(50)
 {
     this->plot = plot;
     this->friendlyName = friendlyName;
@@ -817,6 +844,10 @@ TimeSeriesData::TimeSeriesData(QwtPlot* plot, QString friendlyName, quint64 plot
     this->zeroValue = zeroValue;
     this->plotInterval = plotInterval;
 
+    TimeSeriesBuffer::RetentionPolicy policy;
+    policy.m_maxInterval = maxInterval;
+    buffer.setRetentionPolicy(policy);
+
     /* initialize time */
     startTime = QUINT64_MAX;
     stopTime = QUINT64_MIN;
@@ -836,7 +867,17 @@ void TimeSeriesData::setInterval(quint64 ms)
 
 void TimeSeriesData::setAverageWindowSize(int windowSize)
 {
-    this->averageWindow = windowSize;
+    dataMutex.lock();
+    statistics.setWindowSize(windowSize);
+    dataMutex.unlock();
+}
+
+void TimeSeriesData::setRetentionPolicy(const TimeSeriesBuffer::RetentionPolicy& policy)
+{
+    dataMutex.lock();
+    buffer.setRetentionPolicy(policy);
+    plotCount = 0;
+    dataMutex.unlock();
 }
 
 /**
@@ -848,75 +889,24 @@ void TimeSeriesData::setAverageWindowSize(int windowSize)
 void TimeSeriesData::append(quint64 ms, double value)
 {
     dataMutex.lock();
-    // Pre- allocate new space
-    // FIXME Check this for validity
-    if(static_cast<quint64>(size()) < (count + 100)) {
-        this->ms.resize(size() + 10000);
-        this->value.resize(size() + 10000);
-    }
-    this->ms[count] = ms;
-    this->value[count] = value;
+    buffer.append(ms, value);
     this->lastValue = value;
-    this->mean = 0;
-    //QList<double> medianList = QList<double>();
-    for (unsigned int i = 0; (i < averageWindow) && (((int)count - (int)i) >= 0); ++i) {
-        this->mean += this->value[count-i];
-        //medianList.append(this->value[count-i]);
-    }
-    this->mean = mean / static_cast<double>(qMin(averageWindow,static_cast<unsigned int>(count)));
-
-    this->variance = 0;
-    for (unsigned int i = 0; (i < averageWindow) && (((int)count - (int)i) >= 0); ++i) {
-        this->variance += (this->value[count-i] - mean) * (this->value[count-i] - mean);
-    }
-    this->variance = this->variance / static_cast<double>(qMin(averageWindow,static_cast<unsigned int>(count)));
-
-//    qSort(medianList);
-
-//    if (medianList.count() > 2)
-//    {
-//        if (medianList.count() % 2 == 0)
-//        {
-//            median = (medianList.at(medianList.count()/2) + medianList.at(medianList.count()/2+1)) / 2.0;
-//        }
-//        else
-//        {
-//            median = medianList.at(medianList.count()/2+1);
-//        }
-//    }
+    statistics.append(value);
 
     // Update statistical values
     if(ms < startTime) startTime = ms;
     if(ms > stopTime) stopTime = ms;
     interval = stopTime - startTime;
 
+    count++;
     if (interval > plotInterval) {
-        while (this->ms[count - plotCount] < stopTime - plotInterval) {
-            plotCount--;
-        }
+        plotCount = buffer.count() - buffer.lowerBound(stopTime - plotInterval);
+    } else {
+        plotCount = buffer.count();
     }
 
-    count++;
-    plotCount++;
-
     if(minValue > value) minValue = value;
     if(maxValue < value) maxValue = value;
-
-    // Trim dataset if necessary
-    if(maxInterval > 0) {
-        // maxInterval = 0 means infinite
-
-        if(interval > maxInterval && !this->ms.isEmpty() && !this->value.isEmpty()) {
-            // The time at which this time series should be cut
-            double minTime = stopTime - maxInterval;
-            // Delete elements from the start of the list as long the time
-            // value of this elements is before the cut time
-            while(this->ms.first() < minTime) {
-                this->ms.pop_front();
-                this->value.pop_front();
-            }
-        }
-    }
     dataMutex.unlock();
 }
 
@@ -955,7 +945,7 @@ double TimeSeriesData::getMaxValue()
  */
 double TimeSeriesData::getMean()
 {
-    return mean;
+    return statistics.mean();
 }
 
 /**
@@ -963,7 +953,7 @@ double TimeSeriesData::getMean()
  */
 double TimeSeriesData::getMedian()
 {
-    return median;
+    return statistics.median();
 }
 
 /**
@@ -971,7 +961,7 @@ double TimeSeriesData::getMedian()
  */
 double TimeSeriesData::getVariance()
 {
-    return variance;
+    return statistics.variance();
 }
 
 double TimeSeriesData::getCurrentValue()
@@ -1022,44 +1012,23 @@ int TimeSeriesData::getPlotCount() const
 }
 
 /**
- * @brief Get the data array size
- * The data array size is \e NOT equal to the number of items in the data set, as
- * array space is pre-allocated. Use getCount() to get the number of data points.
+ * @brief Get the stored samples
+ * Only the samples kept by the retention policy are stored, so the buffer
+ * usually holds less samples than getCount() delivers.
  *
- * @return The data array size
- * @see getCount()
+ * @return The buffer holding the time as x and the values as y
  **/
-int TimeSeriesData::size() const
+const TimeSeriesBuffer& TimeSeriesData::getBuffer() const
 {
-    return ms.size();
+    return buffer;
 }
 
 /**
- * @brief Get the X (time) values
+ * @brief Get the first sample of the plot selection
  *
- * @return The x values
+ * @return The index of the sample in the buffer
  **/
-const double* TimeSeriesData::getX() const
-{
-    return ms.data();
-}
-
-const double* TimeSeriesData::getPlotX() const
-{
-    return ms.data() + (count - plotCount);
-}
-
-/**
- * @brief Get the Y (data) values
- *
- * @return The y values
- **/
-const double* TimeSeriesData::getY() const
-{
-    return value.data();
-}
-
-const double* TimeSeriesData::getPlotY() const
+int TimeSeriesData::getPlotFirst() const
 {
-    return value.data() + (count - plotCount);
+    return buffer.count() - static_cast<int>(plotCount);
 }
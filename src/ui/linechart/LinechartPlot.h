@@ -49,6 +49,8 @@ This file is part of the PIXHAWK project
 #include <qwt_plot.h>
 #include <ScrollZoomer.h>
 #include "MG.h"
+#include "RollingStatistics.h"
+#include "TimeSeriesBuffer.h"
 
 class TimeScaleDraw: public QwtScaleDraw
 {
@@ -115,12 +117,10 @@ public:
     QwtScaleMap* getScaleMap();
 
     int getCount() const;
-    int size() const;
-    const double* getX() const;
-    const double* getY() const;
-
-    const double* getPlotX() const;
-    const double* getPlotY() const;
+    /** @brief Get the stored samples, time as x */
+    const TimeSeriesBuffer& getBuffer() const;
+    /** @brief Get the first stored sample inside the plot interval */
+    int getPlotFirst() const;
     int getPlotCount() const;
 
     int getID();
@@ -139,6 +139,8 @@ public:
     void setZeroValue(double zeroValue);
     void setInterval(quint64 ms);
     void setAverageWindowSize(int windowSize);
+    /** @brief Set which samples are stored, drops all stored samples */
+    void setRetentionPolicy(const TimeSeriesBuffer::RetentionPolicy& policy);
 
 protected:
     QwtPlot* plot;
@@ -164,14 +166,8 @@ protected:
 
 private:
     quint64 count;
-    QwtArray<double> ms;
-    QwtArray<double> value;
-    double mean;
-    double median;
-    double variance;
-    unsigned int averageWindow;
-    QwtArray<double> outputMs;
-    QwtArray<double> outputValue;
+    TimeSeriesBuffer buffer;      ///< Stored samples, bounded by the retention policy
+    RollingStatistics statistics; ///< Mean, median and variance of the last values
 };
 
 
@@ -223,6 +219,10 @@ public:
     static const int DEFAULT_REFRESH_RATE = 100; ///< The default refresh rate is 10 Hz / every 100 ms
     static const int DEFAULT_PLOT_INTERVAL = 1000 * 8; ///< The default plot interval is 15 seconds
     static const int DEFAULT_SCALE_INTERVAL = 1000 * 8;
+    static const int DEFAULT_FULL_RATE_INTERVAL = 1000 * 60 * 5; ///< Samples of the last 5 minutes are stored at full rate
+    static const int DEFAULT_FULL_RATE_CAPACITY = 30000; ///< Enough for 5 minutes at 100 Hz
+    static const int DEFAULT_HISTORY_DECIMATION = 50; ///< Older samples are stored as min and max of 50 samples
+    static const int DEFAULT_HISTORY_CAPACITY = 20000;
 
 public slots:
     void setRefreshRate(int ms);
@@ -267,6 +267,8 @@ public slots:
 
     /** @brief Set the number of values to average over */
     void setAverageWindow(int windowSize);
+    /** @brief Set which samples are stored, drops all stored samples */
+    void setRetentionPolicy(const TimeSeriesBuffer::RetentionPolicy& policy);
     void removeTimedOutCurves();
 
     /** @brief Reset color map */
@@ -309,6 +311,7 @@ protected:
     double valueInterval;
 
     int averageWindowSize; ///< Size of sliding average / sliding median
+    TimeSeriesBuffer::RetentionPolicy retentionPolicy; ///< Which samples of the curves are stored
 
     quint64 plotInterval;
     quint64 plotPosition;
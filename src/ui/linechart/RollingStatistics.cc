@@ -0,0 +1,211 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Sliding window statistics of live linechart curves
+ *
+ */
+
+#include "RollingStatistics.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define ROLLINGSTATISTICS_SSE2
+#endif
+
+RollingStatistics::RollingStatistics(const int windowSize) :
+    m_head(0),
+    m_count(0),
+    m_updates(0),
+    m_mean(0.0),
+    m_m2(0.0)
+{
+    setWindowSize(windowSize);
+}
+
+void RollingStatistics::setWindowSize(const int windowSize)
+{
+    const int size = qMax(1, windowSize);
+    if (size != m_window.size())
+    {
+        m_window.resize(size);
+        m_sorted.reserve(size);
+        clear();
+    }
+}
+
+void RollingStatistics::clear()
+{
+    m_sorted.clear();
+    m_head = 0;
+    m_count = 0;
+    m_updates = 0;
+    m_mean = 0.0;
+    m_m2 = 0.0;
+}
+
+void RollingStatistics::append(const double value)
+{
+    if (!std::isfinite(value))
+    {
+        return;
+    }
+
+    const int size = m_window.size();
+    if (m_count < size)
+    {
+        // Window is growing - plain Welford update
+        m_window[(m_head + m_count) % size] = value;
+        ++m_count;
+        const double delta = value - m_mean;
+        m_mean += delta / m_count;
+        m_m2 += delta * (value - m_mean);
+
+        m_sorted.insert(std::upper_bound(m_sorted.begin(), m_sorted.end(), value), value);
+        return;
+    }
+
+    // Window is full - replace the oldest value
+    const double oldValue = m_window.at(m_head);
+    m_window[m_head] = value;
+    m_head = (m_head + 1) % size;
+
+    const double oldMean = m_mean;
+    m_mean += (value - oldValue) / m_count;
+    m_m2 += (value - oldValue) * (value - m_mean + oldValue - oldMean);
+
+    double *sorted = m_sorted.data();
+    const int oldPos = static_cast<int>(std::lower_bound(sorted, sorted + m_count, oldValue) - sorted);
+    const int newPos = static_cast<int>(std::upper_bound(sorted, sorted + m_count, value) - sorted);
+    if (newPos > oldPos)
+    {
+        std::copy(sorted + oldPos + 1, sorted + newPos, sorted + oldPos);
+        sorted[newPos - 1] = value;
+    }
+    else
+    {
+        std::copy_backward(sorted + newPos, sorted + oldPos, sorted + oldPos + 1);
+        sorted[newPos] = value;
+    }
+
+    // The sliding update accumulates rounding errors which get large after steps
+    // in the data. Calculating exactly once per window keeps the cost at O(1).
+    if (++m_updates >= m_count)
+    {
+        recalculate();
+    }
+}
+
+double RollingStatistics::variance() const
+{
+    return (m_count > 0) ? qMax(0.0, m_m2 / m_count) : 0.0;
+}
+
+double RollingStatistics::median() const
+{
+    if (m_count == 0)
+    {
+        return 0.0;
+    }
+    const int middle = m_count / 2;
+    if (m_count % 2 == 0)
+    {
+        return (m_sorted.at(middle - 1) + m_sorted.at(middle)) / 2.0;
+    }
+    return m_sorted.at(middle);
+}
+
+void RollingStatistics::recalculate()
+{
+    double sum = 0.0;
+    for (int i = 0; i < m_count; ++i)
+    {
+        sum += m_sorted.at(i);
+    }
+    m_mean = sum / m_count;
+
+    m_m2 = 0.0;
+    for (int i = 0; i < m_count; ++i)
+    {
+        const double delta = m_sorted.at(i) - m_mean;
+        m_m2 += delta * delta;
+    }
+    m_updates = 0;
+}
+
+bool RollingStatistics::minMax(const double *values, const int count, double &min, double &max)
+{
+    if (count <= 0)
+    {
+        return false;
+    }
+
+    double minValue = values[0];
+    double maxValue = values[0];
+    int i = 1;
+
+#ifdef ROLLINGSTATISTICS_SSE2
+    if (count >= 9)
+    {
+        // Two independent accumulators per direction hide the latency of min/max.
+        // The new values are passed as first operand, so a NaN yields the
+        // accumulator like the scalar comparison below does.
+        __m128d min0 = _mm_set1_pd(minValue);
+        __m128d min1 = min0;
+        __m128d max0 = min0;
+        __m128d max1 = min0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128d v0 = _mm_loadu_pd(values + i);
+            const __m128d v1 = _mm_loadu_pd(values + i + 2);
+            min0 = _mm_min_pd(v0, min0);
+            min1 = _mm_min_pd(v1, min1);
+            max0 = _mm_max_pd(v0, max0);
+            max1 = _mm_max_pd(v1, max1);
+        }
+        min0 = _mm_min_pd(min0, min1);
+        max0 = _mm_max_pd(max0, max1);
+        min0 = _mm_min_sd(min0, _mm_unpackhi_pd(min0, min0));
+        max0 = _mm_max_sd(max0, _mm_unpackhi_pd(max0, max0));
+        minValue = _mm_cvtsd_f64(min0);
+        maxValue = _mm_cvtsd_f64(max0);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        const double value = values[i];
+        if (value < minValue)
+        {
+            minValue = value;
+        }
+        if (value > maxValue)
+        {
+            maxValue = value;
+        }
+    }
+    min = minValue;
+    max = maxValue;
+    return true;
+}
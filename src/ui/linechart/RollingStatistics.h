@@ -0,0 +1,95 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Sliding window statistics of live linechart curves
+ *
+ */
+
+#ifndef ROLLINGSTATISTICS_H
+#define ROLLINGSTATISTICS_H
+
+#include <QVector>
+
+/**
+ * @brief The RollingStatistics class keeps mean, variance and median over the
+ *        last values of a curve. Every appended value updates the statistics
+ *        incrementally, so the cost does not depend on how often they are read:
+ *
+ *        - Mean and variance use a sliding Welford update which replaces the
+ *          oldest value by the new one in O(1). They are calculated exactly
+ *          once per window to drop accumulated rounding errors.
+ *        - The median is taken from a sorted copy of the window which is updated
+ *          by moving the values between the removed and the inserted one. For the
+ *          window sizes used in the linechart this is a short memmove.
+ *
+ *        Non finite values are ignored as they would spoil all statistics.
+ */
+class RollingStatistics
+{
+public:
+    explicit RollingStatistics(const int windowSize = 50);
+
+    /**
+     * @brief setWindowSize sets the number of values the statistics are taken
+     *        over. All values are dropped if the size changes.
+     */
+    void setWindowSize(const int windowSize);
+    int windowSize() const { return m_window.size(); }
+
+    /**
+     * @brief count delivers the number of values currently in the window
+     */
+    int count() const { return m_count; }
+
+    void append(const double value);
+    void clear();
+
+    double mean() const { return m_mean; }
+
+    /**
+     * @brief variance delivers the population variance of the window
+     */
+    double variance() const;
+    double median() const;
+
+    /**
+     * @brief minMax delivers the smallest and biggest of count values. Uses SSE2 if
+     *        available. NaN values are skipped unless the first value is NaN.
+     *
+     * @return false if count is 0, true otherwise
+     */
+    static bool minMax(const double *values, const int count, double &min, double &max);
+
+private:
+    void recalculate();
+
+    QVector<double> m_window;   /// Ring buffer holding the values of the window
+    QVector<double> m_sorted;   /// Values of the window in ascending order
+    int m_head;                 /// Position of the oldest value in m_window
+    int m_count;                /// Number of values in the window
+    int m_updates;              /// Sliding updates since the last exact calculation
+    double m_mean;              /// Mean of the window
+    double m_m2;                /// Sum of squared deviations from the mean
+};
+
+#endif // ROLLINGSTATISTICS_H
@@ -0,0 +1,280 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Bounded storage of live curve data
+ *
+ */
+
+#include "TimeSeriesBuffer.h"
+#include "RollingStatistics.h"
+#include <algorithm>
+
+namespace
+{
+    // Ring storage starts with this number of samples and doubles until the capacity is reached
+    const int MIN_RING_ALLOCATION = 1024;
+}
+
+void TimeSeriesBuffer::Ring::setCapacity(const int capacity)
+{
+    m_capacity = qMax(0, capacity);
+    m_allocated = 0;
+    m_x.clear();
+    m_y.clear();
+    m_head = 0;
+    m_size = 0;
+}
+
+void TimeSeriesBuffer::Ring::clear()
+{
+    // Keep the storage, a cleared buffer is usually filled again
+    m_head = 0;
+    m_size = 0;
+}
+
+void TimeSeriesBuffer::Ring::push(const double x, const double y)
+{
+    if (m_capacity == 0)
+    {
+        return;
+    }
+    if (m_size == m_capacity)
+    {
+        pop();
+    }
+    else if (m_size == m_allocated)
+    {
+        grow();
+    }
+
+    int pos = m_head + m_size;
+    if (pos >= m_allocated)
+    {
+        pos -= m_allocated;
+    }
+    m_x[pos] = x;
+    m_x[pos + m_allocated] = x;
+    m_y[pos] = y;
+    m_y[pos + m_allocated] = y;
+    ++m_size;
+}
+
+void TimeSeriesBuffer::Ring::pop()
+{
+    if (m_size > 0)
+    {
+        if (++m_head == m_allocated)
+        {
+            m_head = 0;
+        }
+        --m_size;
+    }
+}
+
+void TimeSeriesBuffer::Ring::grow()
+{
+    const int allocated = qMin(m_capacity, qMax(MIN_RING_ALLOCATION, m_allocated * 2));
+    QVector<double> newX(allocated * 2);
+    QVector<double> newY(allocated * 2);
+    std::copy(x(), x() + m_size, newX.data());
+    std::copy(x(), x() + m_size, newX.data() + allocated);
+    std::copy(y(), y() + m_size, newY.data());
+    std::copy(y(), y() + m_size, newY.data() + allocated);
+    m_x.swap(newX);
+    m_y.swap(newY);
+    m_allocated = allocated;
+    m_head = 0;
+}
+
+TimeSeriesBuffer::TimeSeriesBuffer()
+{
+    setRetentionPolicy(RetentionPolicy());
+}
+
+TimeSeriesBuffer::TimeSeriesBuffer(const RetentionPolicy &policy)
+{
+    setRetentionPolicy(policy);
+}
+
+void TimeSeriesBuffer::setRetentionPolicy(const RetentionPolicy &policy)
+{
+    m_policy = policy;
+    m_policy.m_fullRateCapacity = qMax(1, policy.m_fullRateCapacity);
+    m_policy.m_historyDecimation = qMax(0, policy.m_historyDecimation);
+    if (m_policy.m_historyDecimation == 0)
+    {
+        m_policy.m_historyCapacity = 0;
+    }
+
+    // Nothing is kept at full rate longer than it is kept at all
+    m_recentInterval = m_policy.m_fullRateInterval;
+    if ((m_policy.m_maxInterval > 0.0) &&
+        ((m_recentInterval <= 0.0) || (m_policy.m_maxInterval < m_recentInterval)))
+    {
+        m_recentInterval = m_policy.m_maxInterval;
+    }
+
+    m_recent.setCapacity(m_policy.m_fullRateCapacity);
+    m_history.setCapacity(m_policy.m_historyCapacity);
+    m_bucketCount = 0;
+    m_bucketMinX = m_bucketMaxX = 0.0;
+    m_bucketMinY = m_bucketMaxY = 0.0;
+}
+
+void TimeSeriesBuffer::clear()
+{
+    m_recent.clear();
+    m_history.clear();
+    m_bucketCount = 0;
+}
+
+void TimeSeriesBuffer::append(const double x, const double y)
+{
+    if (m_recent.size() == m_policy.m_fullRateCapacity)
+    {
+        retire();
+    }
+    if (m_recentInterval > 0.0)
+    {
+        const double minX = x - m_recentInterval;
+        while ((m_recent.size() > 0) && (m_recent.x()[0] < minX))
+        {
+            retire();
+        }
+    }
+    m_recent.push(x, y);
+
+    if (m_policy.m_maxInterval > 0.0)
+    {
+        const double minX = x - m_policy.m_maxInterval;
+        while ((m_history.size() > 0) && (m_history.x()[0] < minX))
+        {
+            m_history.pop();
+        }
+    }
+}
+
+void TimeSeriesBuffer::retire()
+{
+    const double x = m_recent.x()[0];
+    const double y = m_recent.y()[0];
+    m_recent.pop();
+
+    if (m_policy.m_historyDecimation == 0)
+    {
+        return;
+    }
+    if (m_bucketCount == 0)
+    {
+        m_bucketMinX = m_bucketMaxX = x;
+        m_bucketMinY = m_bucketMaxY = y;
+    }
+    else if (y < m_bucketMinY)
+    {
+        m_bucketMinX = x;
+        m_bucketMinY = y;
+    }
+    else if (y > m_bucketMaxY)
+    {
+        m_bucketMaxX = x;
+        m_bucketMaxY = y;
+    }
+    if (++m_bucketCount >= m_policy.m_historyDecimation)
+    {
+        flushBucket();
+    }
+}
+
+void TimeSeriesBuffer::flushBucket()
+{
+    // Keep the order of the samples so the history stays ascending in x
+    if (m_bucketMinX == m_bucketMaxX)
+    {
+        m_history.push(m_bucketMinX, m_bucketMinY);
+    }
+    else if (m_bucketMinX < m_bucketMaxX)
+    {
+        m_history.push(m_bucketMinX, m_bucketMinY);
+        m_history.push(m_bucketMaxX, m_bucketMaxY);
+    }
+    else
+    {
+        m_history.push(m_bucketMaxX, m_bucketMaxY);
+        m_history.push(m_bucketMinX, m_bucketMinY);
+    }
+    m_bucketCount = 0;
+}
+
+int TimeSeriesBuffer::lowerBound(const double x) const
+{
+    if ((m_recent.size() > 0) && (m_recent.x()[0] < x))
+    {
+        return m_history.size() + static_cast<int>(
+                    std::lower_bound(m_recent.x(), m_recent.x() + m_recent.size(), x) - m_recent.x());
+    }
+    return static_cast<int>(std::lower_bound(m_history.x(), m_history.x() + m_history.size(), x) - m_history.x());
+}
+
+bool TimeSeriesBuffer::bounds(const int first, const int count, double &minX, double &maxX,
+                              double &minY, double &maxY) const
+{
+    const int begin = qMax(0, first);
+    const int end = qMin(this->count(), first + count);
+    if (begin >= end)
+    {
+        return false;
+    }
+
+    bool valid = false;
+    const int historyEnd = qMin(end, m_history.size());
+    if (begin < historyEnd)
+    {
+        RollingStatistics::minMax(m_history.x() + begin, historyEnd - begin, minX, maxX);
+        RollingStatistics::minMax(m_history.y() + begin, historyEnd - begin, minY, maxY);
+        valid = true;
+    }
+
+    const int recentBegin = qMax(begin, m_history.size()) - m_history.size();
+    const int recentEnd = end - m_history.size();
+    if (recentBegin < recentEnd)
+    {
+        double recentMinX, recentMaxX, recentMinY, recentMaxY;
+        RollingStatistics::minMax(m_recent.x() + recentBegin, recentEnd - recentBegin, recentMinX, recentMaxX);
+        RollingStatistics::minMax(m_recent.y() + recentBegin, recentEnd - recentBegin, recentMinY, recentMaxY);
+        if (valid)
+        {
+            minX = qMin(minX, recentMinX);
+            maxX = qMax(maxX, recentMaxX);
+            minY = qMin(minY, recentMinY);
+            maxY = qMax(maxY, recentMaxY);
+        }
+        else
+        {
+            minX = recentMinX;
+            maxX = recentMaxX;
+            minY = recentMinY;
+            maxY = recentMaxY;
+        }
+    }
+    return true;
+}
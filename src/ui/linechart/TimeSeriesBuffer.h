@@ -0,0 +1,170 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Bounded storage of live curve data
+ *
+ */
+
+#ifndef TIMESERIESBUFFER_H
+#define TIMESERIESBUFFER_H
+
+#include <QVector>
+
+/**
+ * @brief The TimeSeriesBuffer class stores the samples of a live curve in fixed
+ *        capacity ring buffers, so memory stays bounded however long a session
+ *        runs. Samples are kept in two parts:
+ *
+ *        - The recent part holds the newest samples at full rate.
+ *        - Samples leaving the recent part are decimated into the history part,
+ *          which keeps the smallest and the biggest value of every bucket of
+ *          samples so spikes stay visible.
+ *
+ *        Each part is a mirrored ring buffer: every value is stored twice, one
+ *        capacity apart, so the samples of a part are always contiguous in memory
+ *        and can be used without copying.
+ */
+class TimeSeriesBuffer
+{
+public:
+    /**
+     * @brief The RetentionPolicy struct defines which samples are kept
+     */
+    struct RetentionPolicy
+    {
+        double m_fullRateInterval;  /// x range kept at full rate, 0 for no limit
+        int m_fullRateCapacity;     /// Maximum number of samples kept at full rate
+        int m_historyDecimation;    /// Number of samples combined into a min and a max sample, 0 disables the history
+        int m_historyCapacity;      /// Maximum number of samples in the history
+        double m_maxInterval;       /// x range kept at all, 0 for no limit
+
+        RetentionPolicy() :
+            m_fullRateInterval(0.0),
+            m_fullRateCapacity(100000),
+            m_historyDecimation(0),
+            m_historyCapacity(0),
+            m_maxInterval(0.0) {}
+    };
+
+    TimeSeriesBuffer();
+    explicit TimeSeriesBuffer(const RetentionPolicy &policy);
+
+    /**
+     * @brief setRetentionPolicy sets the policy and drops all samples
+     */
+    void setRetentionPolicy(const RetentionPolicy &policy);
+    const RetentionPolicy &retentionPolicy() const { return m_policy; }
+
+    /**
+     * @brief append appends a sample. The x values are expected to be ascending,
+     *        the interval limits of the policy refer to the x of the newest sample.
+     */
+    void append(const double x, const double y);
+    void clear();
+
+    /**
+     * @brief count delivers the number of stored samples, history first
+     */
+    int count() const { return m_history.size() + m_recent.size(); }
+    bool isEmpty() const { return count() == 0; }
+
+    double x(const int i) const
+    {
+        return (i < m_history.size()) ? m_history.x()[i] : m_recent.x()[i - m_history.size()];
+    }
+
+    double y(const int i) const
+    {
+        return (i < m_history.size()) ? m_history.y()[i] : m_recent.y()[i - m_history.size()];
+    }
+
+    /**
+     * @brief lowerBound delivers the first sample whose x is not smaller than x
+     * @return The sample or count() if there is none
+     */
+    int lowerBound(const double x) const;
+
+    /**
+     * @brief bounds delivers the smallest and biggest x and y of some samples
+     *
+     * @param first - first sample
+     * @param count - number of samples
+     * @return false if there are no samples in the range, true otherwise
+     */
+    bool bounds(const int first, const int count, double &minX, double &maxX,
+                double &minY, double &maxY) const;
+
+    int historyCount() const { return m_history.size(); }
+    const double *historyX() const { return m_history.x(); }
+    const double *historyY() const { return m_history.y(); }
+
+    int recentCount() const { return m_recent.size(); }
+    const double *recentX() const { return m_recent.x(); }
+    const double *recentY() const { return m_recent.y(); }
+
+private:
+    /**
+     * @brief The Ring class is a mirrored ring buffer of samples. The storage
+     *        grows on demand up to the capacity.
+     */
+    class Ring
+    {
+    public:
+        Ring() : m_capacity(0), m_allocated(0), m_head(0), m_size(0) {}
+
+        void setCapacity(const int capacity);
+        void clear();
+        void push(const double x, const double y);
+        void pop();
+
+        int size() const { return m_size; }
+        const double *x() const { return m_x.constData() + m_head; }
+        const double *y() const { return m_y.constData() + m_head; }
+
+    private:
+        void grow();
+
+        QVector<double> m_x;    /// x values, twice the allocated size
+        QVector<double> m_y;    /// y values, twice the allocated size
+        int m_capacity;         /// Maximum number of samples
+        int m_allocated;        /// Number of samples the storage can hold
+        int m_head;             /// Position of the oldest sample
+        int m_size;             /// Number of samples
+    };
+
+    void retire();
+    void flushBucket();
+
+    RetentionPolicy m_policy;
+    double m_recentInterval;    /// x range of the recent part, 0 for no limit
+    Ring m_recent;              /// Newest samples at full rate
+    Ring m_history;             /// Decimated older samples
+
+    int m_bucketCount;          /// Samples in the current history bucket
+    double m_bucketMinX;        /// x of the smallest sample of the bucket
+    double m_bucketMinY;        /// Smallest value of the bucket
+    double m_bucketMaxX;        /// x of the biggest sample of the bucket
+    double m_bucketMaxY;        /// Biggest value of the bucket
+};
+
+#endif // TIMESERIESBUFFER_H
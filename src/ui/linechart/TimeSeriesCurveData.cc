@@ -0,0 +1,63 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Qwt curve data drawn directly from a TimeSeriesBuffer
+ *
+ */
+
+#include "TimeSeriesCurveData.h"
+
+QwtData *TimeSeriesCurveData::copy() const
+{
+    return new TimeSeriesCurveData(m_buffer, m_first, m_size);
+}
+
+size_t TimeSeriesCurveData::size() const
+{
+    return static_cast<size_t>(m_size);
+}
+
+double TimeSeriesCurveData::x(size_t i) const
+{
+    return m_buffer->x(m_first + static_cast<int>(i));
+}
+
+double TimeSeriesCurveData::y(size_t i) const
+{
+    return m_buffer->y(m_first + static_cast<int>(i));
+}
+
+/**
+ * @brief Get the bounding rect of the curve
+ *
+ * @return The rect spanned by all points or an invalid rect if there are none
+ **/
+QwtDoubleRect TimeSeriesCurveData::boundingRect() const
+{
+    double minX, maxX, minY, maxY;
+    if (!m_buffer->bounds(m_first, m_size, minX, maxX, minY, maxY))
+    {
+        return QwtDoubleRect(1.0, 1.0, -2.0, -2.0); // invalid
+    }
+    return QwtDoubleRect(minX, minY, maxX - minX, maxY - minY);
+}
@@ -0,0 +1,61 @@
+/*===================================================================
+APM_PLANNER Open Source Ground Control Station
+
+(c) 2016 APM_PLANNER PROJECT <http://www.diydrones.com>
+
+This file is part of the APM_PLANNER project
+
+    APM_PLANNER is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    APM_PLANNER is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with APM_PLANNER. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+/**
+ * @file
+ *   @brief Qwt curve data drawn directly from a TimeSeriesBuffer
+ *
+ */
+
+#ifndef TIMESERIESCURVEDATA_H
+#define TIMESERIESCURVEDATA_H
+
+#include <qwt_data.h>
+#include "TimeSeriesBuffer.h"
+
+/**
+ * @brief Curve data referencing a range of the samples of a TimeSeriesBuffer.
+ *        Qwt reads the points from the buffer, nothing is copied. The buffer
+ *        must outlive the curve and the curve data has to be set again after
+ *        the buffer changed. The bounding rect is needed for every replot and
+ *        uses the vectorised RollingStatistics::minMax.
+ */
+class TimeSeriesCurveData : public QwtData
+{
+public:
+    TimeSeriesCurveData(const TimeSeriesBuffer *buffer, const int first, const int size) :
+        m_buffer(buffer),
+        m_first(first),
+        m_size(size) {}
+
+    virtual QwtData *copy() const;
+    virtual size_t size() const;
+    virtual double x(size_t i) const;
+    virtual double y(size_t i) const;
+    virtual QwtDoubleRect boundingRect() const;
+
+private:
+    const TimeSeriesBuffer *m_buffer;   /// Buffer holding the samples
+    int m_first;                        /// First sample of the curve
+    int m_size;                         /// Number of samples of the curve
+};
+
+#endif // TIMESERIESCURVEDATA_H
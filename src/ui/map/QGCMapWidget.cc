@@ -9,6 +9,15 @@
 #include "ArduPilotMegaMAV.h"
 #include "WaypointNavigation.h"
 #include <QInputDialog>
+#include <QFileDialog>
+
+// Minimal time between two updates of the prefetched map tiles in ms
+static const quint64 PREFETCH_INTERVAL = 1000;
+// Time in s the track of the followed system is prefetched ahead
+static const double PREFETCH_LOOKAHEAD = 60.0;
+// Systems slower than this in m/s are treated as standing still
+static const double PREFETCH_MIN_SPEED = 1.0;
+static const double METERS_PER_DEGREE = 111319.5;
 
 QGCMapWidget::QGCMapWidget(QWidget *parent) :
     mapcontrol::OPMapWidget(parent),
@@ -20,7 +29,12 @@ QGCMapWidget::QGCMapWidget(QWidget *parent) :
     followUAVID(0),
     mapInitialized(false),
     homeAltitude(0),
-    uas(NULL)
+    uas(NULL),
+    prefetchPositionTime(0),
+    prefetchVelocityNorth(0.0),
+    prefetchVelocityEast(0.0),
+    lastPrefetch(0),
+    tilePackProgress(NULL)
 {
     // Set the map cache directory
     configuration->SetCacheLocation(QGC::appDataDirectory() + "/mapscache/");
@@ -54,6 +68,14 @@ QGCMapWidget::QGCMapWidget(QWidget *parent) :
     cameraaction->setText("Point Camera Here");
     connect(cameraaction,SIGNAL(triggered()),this,SLOT(cameraActionTriggered()));
     this->addAction(cameraaction);
+    QAction *tilepackaction = new QAction(this);
+    tilepackaction->setText("Export Selected Area to Tile Pack...");
+    connect(tilepackaction,SIGNAL(triggered()),this,SLOT(exportTilePack()));
+    this->addAction(tilepackaction);
+    tilepackaction = new QAction(this);
+    tilepackaction->setText("Import Tile Pack...");
+    connect(tilepackaction,SIGNAL(triggered()),this,SLOT(importTilePack()));
+    this->addAction(tilepackaction);
 }
 void QGCMapWidget::guidedActionTriggered()
 {
@@ -284,6 +306,7 @@ void QGCMapWidget::loadSettings()
 
     trailType = static_cast<mapcontrol::UAVTrailType::Types>(settings.value("TRAIL_TYPE", trailType).toInt());
     trailInterval = settings.value("TRAIL_INTERVAL", trailInterval).toFloat();
+    configuration->SetPrefetchBudget(settings.value("PREFETCH_BUDGET", configuration->PrefetchBudget()).toInt());
     settings.endGroup();
 
     // SET CORRECT MENU CHECKBOXES
@@ -337,6 +360,7 @@ void QGCMapWidget::storeSettings()
     settings.setValue("TRAIL_TYPE", static_cast<int>(trailType));
     settings.setValue("TRAIL_INTERVAL", trailInterval);
     settings.setValue("MAP_TYPE", static_cast<int>(GetMapType()));
+    settings.setValue("PREFETCH_BUDGET", configuration->PrefetchBudget());
     settings.endGroup();
     settings.sync();
 }
@@ -414,6 +438,9 @@ void QGCMapWidget::activeUASSet(UASInterface* uas)
 
     this->uas = uas;
     this->currWPManager = uas->getWaypointManager();
+    prefetchPositionTime = 0;
+    prefetchVelocityNorth = 0.0;
+    prefetchVelocityEast = 0.0;
 
     updateSelectedSystem(uas->getUASID());
     followUAVID = uas->getUASID();
@@ -439,6 +466,11 @@ void QGCMapWidget::updateGlobalPosition(UASInterface* uas, double lat, double lo
 {
     Q_UNUSED(usec);
 
+    if ((this->uas == uas) && isValidPrefetchLocation(lat, lon))
+    {
+        updatePrefetchTrack(lat, lon);
+    }
+
     // Immediate update
     if (maxUpdateInterval == 0)
     {
@@ -483,6 +515,83 @@ void QGCMapWidget::updateGlobalPosition(UASInterface* uas, double lat, double lo
     }
 }
 
+void QGCMapWidget::updatePrefetchTrack(double lat, double lon)
+{
+    quint64 now = QGC::groundTimeMilliseconds();
+    if (prefetchPositionTime != 0)
+    {
+        double dt = (now - prefetchPositionTime) / 1000.0;
+        if (dt < 0.2)
+        {
+            // Too close to the last position for a stable velocity
+            return;
+        }
+        if (dt < 10.0)
+        {
+            double north = (lat - prefetchPosition.Lat()) * METERS_PER_DEGREE;
+            double east = (lon - prefetchPosition.Lng()) * METERS_PER_DEGREE * cos(lat * M_PI / 180.0);
+            // Low pass filter against GPS jitter
+            prefetchVelocityNorth = 0.7 * prefetchVelocityNorth + 0.3 * north / dt;
+            prefetchVelocityEast = 0.7 * prefetchVelocityEast + 0.3 * east / dt;
+        }
+        else
+        {
+            prefetchVelocityNorth = 0.0;
+            prefetchVelocityEast = 0.0;
+        }
+    }
+    prefetchPosition = internals::PointLatLng(lat, lon);
+    prefetchPositionTime = now;
+
+    if (now - lastPrefetch >= PREFETCH_INTERVAL)
+    {
+        updatePrefetch();
+    }
+}
+
+void QGCMapWidget::updatePrefetch()
+{
+    lastPrefetch = QGC::groundTimeMilliseconds();
+
+    // The view only moves along the track while following the system
+    QList<internals::PointLatLng> ahead;
+    if (followUAVEnabled && (prefetchPositionTime != 0))
+    {
+        ahead.append(prefetchPosition);
+        double speed = sqrt(prefetchVelocityNorth * prefetchVelocityNorth + prefetchVelocityEast * prefetchVelocityEast);
+        if (speed >= PREFETCH_MIN_SPEED)
+        {
+            double bearing = atan2(prefetchVelocityEast, prefetchVelocityNorth) * 180.0 / M_PI;
+            // destPoint() takes the distance in km
+            ahead.append(destPoint(prefetchPosition, bearing, speed * PREFETCH_LOOKAHEAD / 1000.0));
+        }
+    }
+
+    QList<internals::PointLatLng> route;
+    if (currWPManager)
+    {
+        QList<Waypoint*> wps = currWPManager->getGlobalFrameAndNavTypeWaypointList(true);
+        // The system flies to the current waypoint first
+        int first = 0;
+        for (int i = 0; i < wps.size(); ++i)
+        {
+            if (wps.at(i)->getCurrent())
+            {
+                first = i;
+            }
+        }
+        for (int i = first; i < wps.size(); ++i)
+        {
+            if ((wps.at(i)->getLatitude() != 0.0) || (wps.at(i)->getLongitude() != 0.0))
+            {
+                route.append(internals::PointLatLng(wps.at(i)->getLatitude(), wps.at(i)->getLongitude()));
+            }
+        }
+    }
+
+    SetPrefetchPath(ahead, route);
+}
+
 bool QGCMapWidget::isValidGpsLocation(UASInterface* system) const
 {
     if ((system->getLatitude() == 0.0f)
@@ -492,6 +601,13 @@ bool QGCMapWidget::isValidGpsLocation(UASInterface* system) const
     return true;
 }
 
+bool QGCMapWidget::isValidPrefetchLocation(double lat, double lon) const
+{
+    // Zero latitude or zero longitude alone are valid positions on the
+    // equator or the prime meridian, only both together mean no fix
+    return (lat != 0.0) || (lon != 0.0);
+}
+
 /**
  * Pulls in the positions of all UAVs from the UAS manager
  */
@@ -655,7 +771,16 @@ void QGCMapWidget::cacheVisibleRegion()
 {
     internals::RectLatLng rect = map->SelectedArea();
 
-    if (rect.IsEmpty())
+    if (rect.IsEmpty() && HasRipCheckpoint())
+    {
+        if (QMessageBox::question(this, "Cache tiles for offline use",
+                                  "The last caching of an area was interrupted. Do you want to continue it?",
+                                  QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes) == QMessageBox::Yes)
+        {
+            ResumeRipMap();
+        }
+    }
+    else if (rect.IsEmpty())
     {
         QMessageBox msgBox(this);
         msgBox.setIcon(QMessageBox::Information);
@@ -673,6 +798,97 @@ void QGCMapWidget::cacheVisibleRegion()
     }
 }
 
+void QGCMapWidget::exportTilePack()
+{
+    if (tilePackProgress)
+    {
+        QMessageBox::information(this, "Export Tile Pack", "A tile pack is already being exported.");
+        return;
+    }
+    internals::RectLatLng rect = map->SelectedArea();
+    if (rect.IsEmpty())
+    {
+        QMessageBox::information(this, "Export Tile Pack",
+                                 "Please select an area first by holding down SHIFT or ALT and selecting the area with the left mouse button.");
+        return;
+    }
+    bool ok = false;
+    int minZoom = static_cast<int>(ZoomTotal());
+    int maxZoom = QInputDialog::getInt(this, "Export Tile Pack", "Export cached tiles up to zoom level:",
+                                       minZoom, minZoom, MaxZoom(), 1, &ok);
+    if (!ok)
+    {
+        return;
+    }
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Tile Pack", QString(), "Tile Packs (*.tilepack)");
+    if (fileName.isEmpty())
+    {
+        return;
+    }
+    if (!fileName.endsWith(".tilepack"))
+    {
+        fileName += ".tilepack";
+    }
+
+    // Reading the tiles from the cache takes a while for big areas, so it is done in the background
+    mapcontrol::TilePackExporter* exporter = ExportTilePack(fileName, rect, minZoom, maxZoom);
+    connect(exporter, SIGNAL(numberOfTilesChanged(int,int)), this, SLOT(tilePackExportProgress(int,int)));
+    connect(exporter, SIGNAL(exportFinished(QString,int)), this, SLOT(tilePackExported(QString,int)));
+
+    tilePackProgress = new QProgressDialog("Exporting Tile Pack", "Cancel", 0, 100, this);
+    tilePackProgress->setAutoClose(false);
+    tilePackProgress->setAutoReset(false);
+    connect(tilePackProgress, SIGNAL(canceled()), exporter, SLOT(cancelExport()));
+    tilePackProgress->show();
+
+    exporter->start();
+}
+
+void QGCMapWidget::tilePackExportProgress(int total, int actual)
+{
+    if (tilePackProgress && (total > 0))
+    {
+        tilePackProgress->setValue(100.0 * ((double)actual / (double)total));
+    }
+}
+
+void QGCMapWidget::tilePackExported(QString fileName, int count)
+{
+    bool canceled = false;
+    if (tilePackProgress)
+    {
+        canceled = tilePackProgress->wasCanceled();
+        tilePackProgress->hide();
+        tilePackProgress->deleteLater();
+        tilePackProgress = NULL;
+    }
+    if (canceled)
+    {
+        return;
+    }
+    if (count < 0)
+    {
+        QMessageBox::warning(this, "Export Tile Pack", "Unable to write " + fileName);
+        return;
+    }
+    QMessageBox::information(this, "Export Tile Pack", QString("%1 cached tiles exported.").arg(count));
+}
+
+void QGCMapWidget::importTilePack()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, "Import Tile Pack", QString(), "Tile Packs (*.tilepack)");
+    if (fileName.isEmpty())
+    {
+        return;
+    }
+    if (!configuration->ImportTilePack(fileName))
+    {
+        QMessageBox::warning(this, "Import Tile Pack", "Unable to import " + fileName);
+        return;
+    }
+    ReloadMap();
+}
+
 
 // WAYPOINT MAP INTERACTION FUNCTIONS
 
@@ -926,5 +1142,6 @@ void QGCMapWidget::updateWaypointList(int uas)
         }
 
         redrawWaypointLines(uas);
+        updatePrefetch();
     }
 }
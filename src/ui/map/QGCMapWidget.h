@@ -3,6 +3,7 @@
 
 #include <QMap>
 #include <QTimer>
+#include <QProgressDialog>
 #include "../../../libs/opmapcontrol/opmapcontrol.h"
 
 class UASInterface;
@@ -79,6 +80,10 @@ public slots:
     void setUpdateRateLimit(float seconds);
     /** @brief Cache visible region to harddisk */
     void cacheVisibleRegion();
+    /** @brief Export the cached tiles of the selected area to a tile pack */
+    void exportTilePack();
+    /** @brief Import a tile pack for offline use */
+    void importTilePack();
     /** @brief Set follow mode */
     void setFollowUAVEnabled(bool enabled) { followUAVEnabled = enabled; }
     /** @brief Set trail to time mode and set time @param seconds The minimum time between trail dots in seconds. If set to a value < 0, trails will be disabled*/
@@ -130,10 +135,20 @@ public slots:
 protected slots:
     /** @brief Convert a map edit into a QGC waypoint event */
     void handleMapWaypointEdit(WayPointItem* waypoint);
+    /** @brief Show the progress of the running tile pack export */
+    void tilePackExportProgress(int total, int actual);
+    /** @brief Report the result of the tile pack export */
+    void tilePackExported(QString fileName, int count);
 
 private:
     void sendGuidedAction(Waypoint *wp, double alt);
+    /** @brief Estimate the velocity of the active system from its positions */
+    void updatePrefetchTrack(double lat, double lon);
+    /** @brief Prefetch map tiles ahead of the active system and along its mission */
+    void updatePrefetch();
     bool isValidGpsLocation(UASInterface* system) const;
+    /** @brief Check a position for the prefetch track, only 0/0 means no fix */
+    bool isValidPrefetchLocation(double lat, double lon) const;
 
     void shiftOtherSelectedWaypoints(mapcontrol::WayPointItem* selectedWaypoint,
                                      double shiftLong, double shiftLat);
@@ -181,6 +196,13 @@ protected:
     double m_lastLat;
     double m_lastLon;
 
+    internals::PointLatLng prefetchPosition;    ///< Last position of the active system
+    quint64 prefetchPositionTime;               ///< Time of prefetchPosition in ms, 0 if unknown
+    double prefetchVelocityNorth;               ///< Filtered velocity of the active system in m/s
+    double prefetchVelocityEast;
+    quint64 lastPrefetch;                       ///< Time of the last prefetch update in ms
+    QProgressDialog* tilePackProgress;          ///< Progress of the running tile pack export, NULL if none
+
 };
 
 #endif // QGCMAPWIDGET_H
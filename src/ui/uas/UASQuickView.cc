@@ -2,10 +2,13 @@
 #include "UASQuickViewItemSelect.h"
 #include "UASQuickViewTextItem.h"
 #include "QsLog.h"
+#include "LinkManager.h"
 #include <QMetaMethod>
 #include <QSettings>
 #include <QInputDialog>
-UASQuickView::UASQuickView(QWidget *parent) : QWidget(parent)
+UASQuickView::UASQuickView(QWidget *parent) : QWidget(parent),
+    uas(0),
+    m_telemetryReader(LinkManager::instance()->getProtocol()->telemetryStore())
 {
     quickViewSelectDialog=0;
     m_columnCount=2;
@@ -331,6 +334,27 @@ void UASQuickView::selectDialogClosed()
 
 void UASQuickView::updateTimerTick()
 {
+    // Message fields are polled from the telemetry store, the UAS only
+    // emits its own calculated values.
+    m_telemetryChanges.clear();
+    m_telemetryReader.poll(m_telemetryChanges);
+    for (int i = 0; i < m_telemetryChanges.size(); ++i)
+    {
+        const TelemetryStoreReader::Change &change = m_telemetryChanges.at(i);
+        const TelemetryStore &store = m_telemetryReader.store();
+        const int key = store.nameKey(change.m_slot, change.m_component);
+        QHash<int,QString>::const_iterator name = m_slotToPropertyMap.constFind(key);
+        if (name == m_slotToPropertyMap.constEnd())
+        {
+            name = m_slotToPropertyMap.insert(key, store.slotName(change.m_slot, change.m_component) + " (" + store.slotType(change.m_slot) + ")");
+            if (!uasPropertyValueMap.contains(name.value()) && quickViewSelectDialog)
+            {
+                quickViewSelectDialog->addItem(name.value());
+            }
+        }
+        uasPropertyValueMap[name.value()] = change.m_value.m_value;
+    }
+
     //uasPropertyValueMap
     for (QMap<QString,UASQuickViewItem*>::const_iterator i = uasPropertyToLabelMap.constBegin(); i != uasPropertyToLabelMap.constEnd();i++)
     {
@@ -358,9 +382,15 @@ void UASQuickView::setActiveUAS(UASInterface* uas)
     {
         return;
     }
+    if (this->uas)
+    {
+        disconnect(this->uas,SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)),this,
+                   SLOT(valueChanged(int,QString,QString,QVariant,quint64)));
+    }
     this->uas = uas;
     connect(uas,SIGNAL(valueChanged(int,QString,QString,QVariant,quint64)),this,
             SLOT(valueChanged(int,QString,QString,QVariant,quint64)));
+    m_telemetryReader.setSystem(uas->getUASID());
 
 }
 void UASQuickView::addSource(MAVLinkDecoder *decoder)
@@ -9,6 +9,7 @@
 #include "ui_UASQuickView.h"
 #include "UASQuickViewItem.h"
 #include "MAVLinkDecoder.h"
+#include "TelemetryStore.h"
 #include "UASQuickViewItemSelect.h"
 class UASQuickView : public QWidget
 {
@@ -30,6 +31,13 @@ private:
     /** Maps from property name to the display item */
     QMap<QString,UASQuickViewItem*> uasPropertyToLabelMap;
 
+    /** Polls the message fields of the active UAS */
+    TelemetryStoreReader m_telemetryReader;
+    QVector<TelemetryStoreReader::Change> m_telemetryChanges;
+
+    /** Property name of each telemetry store slot seen so far */
+    QHash<int,QString> m_slotToPropertyMap;
+
 
     /** Timer for updating the UI */
     QTimer *updateTimer;